@@ -4,6 +4,11 @@ newoption {
 	 description = "Do not generate the project for the viewer."
 }
 
+newoption {
+	 trigger     = "profiler",
+	 description = "Enable the CPU profiler zones."
+}
+
 workspace("eXplorer112")
 
 	-- Configuration.
@@ -23,6 +28,9 @@ workspace("eXplorer112")
 		defines({ "DEBUG" })
 		symbols("On")
 
+	filter("options:profiler")
+		defines({ "PROFILER_ENABLED" })
+
 	filter({})
 
 	startproject("eXplorer112")
@@ -58,6 +66,9 @@ workspace("eXplorer112")
 		files({"src/tool/**", "src/core/**", "src/libs/**.hpp", "src/libs/*/*.cpp", "src/libs/**.h", "src/libs/*/*.c", "premake5.lua"})
 		removefiles({"**.DS_STORE", "**.thumbs"})
 
+	-- Synthetic data generator and benchmarks
+	include("src/benchmarks/premake5.lua")
+
 	-- Optional viewer project
 	if (not _OPTIONS["skip_viewer"]) then
 		include("src/app/premake5.lua")
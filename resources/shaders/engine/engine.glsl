@@ -38,6 +38,9 @@ layout(set = 0, binding = 0) uniform EngineData {
 	int selectedInstance;
 	int selectedTextureArray;
 	int selectedTextureLayer;
+	uint pad0, pad1, pad2;
+	// Zones visible through portals, one bit per zone.
+	uvec4 visibleZones[2];
 
 } engine;
 
@@ -67,6 +70,9 @@ layout(set = 0, binding = 0) uniform EngineData {
 #define SKIP_CULLING_OBJECTS 1
 #define SKIP_CULLING_LIGHTS 2
 #define SKIP_CULLING_ZONES 4
+#define SKIP_CULLING_PORTALS 8
+
+#define MAX_CULLED_ZONES 256
 
 #define BILLBOARD_WORLD 0
 #define BILLBOARD_AROUND_X 1
@@ -98,7 +104,8 @@ struct MeshInfos {
 struct MeshInstanceInfos {
 	mat4 frame;
 	float heat;
-	uint pad0, pad1, pad2;
+	uint zone;
+	uint pad1, pad2;
 };
 
 struct TextureInfos {
@@ -1,21 +1,30 @@
 
-float shadow(vec3 lightSpacePosition, uint layer, float bias){
+// Shadow maps are tiles of a shared atlas, each tile is given by its offset and size in UV space.
+vec2 shadowAtlasCoords(vec2 uv, vec4 tile){
+	return tile.xy + uv * tile.zw;
+}
+
+float shadow(vec3 lightSpacePosition, vec4 tile, float bias){
 	if(any(greaterThan(abs(lightSpacePosition.xy-0.5), vec2(0.5)))){
 		return 1.0;
 	}
-	float refDepth = textureLod(sampler2DArray(shadowMaps, sClampNear), vec3(lightSpacePosition.xy, layer), 0).r;
+	float refDepth = textureLod(sampler2D(shadowMaps, sClampNear), shadowAtlasCoords(lightSpacePosition.xy, tile), 0).r;
 	float curDepth = lightSpacePosition.z;
 	return float(curDepth > refDepth - bias);
 }
 
-float shadowPCF(vec3 lightSpacePosition, uint layer, float bias){
+float shadowPCF(vec3 lightSpacePosition, vec4 tile, float bias){
 	// Avoid shadows when falling outside the shadow map.
 	if(any(greaterThan(abs(lightSpacePosition.xy-0.5), vec2(0.5)))){
 		return 1.0;
 	}
 
-	vec2 texSize = vec2(512.0);
+	vec2 texSize = vec2(textureSize(sampler2D(shadowMaps, sClampNear), 0));
 	vec2 texelSize = 1.0 / texSize;
+	// Keep all gathered texels inside the tile.
+	vec2 tileMin = tile.xy + texelSize;
+	vec2 tileMax = tile.xy + tile.zw - texelSize;
+	vec2 center = shadowAtlasCoords(lightSpacePosition.xy, tile);
 
 	float totalOcclusion = 0.0;
 	float totalWeight = 0.0;
@@ -24,8 +33,8 @@ float shadowPCF(vec3 lightSpacePosition, uint layer, float bias){
 	for(int y = -1; y <= 1; y += 1){
 		for(int x = -1; x <= 1; x += 1){
 
-			vec2 coords = lightSpacePosition.xy + vec2(x,y) * texelSize;
-			vec4 depths = textureGather(sampler2DArray(shadowMaps, sClampNear), vec3(coords, layer), 0);
+			vec2 coords = clamp(center + vec2(x,y) * texelSize, tileMin, tileMax);
+			vec4 depths = textureGather(sampler2D(shadowMaps, sClampNear), coords, 0);
 			bvec4 valids = greaterThan(depths, vec4(0.0));
 			float invWeight = (abs(x)+abs(y)) * 0.1 + 1.0;
 			bvec4 visibles = greaterThanEqual(lightSpacePosition.zzzz, depths - invWeight * bias);
@@ -107,7 +116,9 @@ void applyLighting(vec3 screenPos, vec3 worldPos, vec3 viewDir, vec3 n, float gl
 					faceIndex = localPos.z < 0.f ? 4 : 5;
 				}
 				faceCenter[faceIndex / 2] = faceIndex % 2 == 0 ? -1.f : 1.f;
-				lightShadowIndex += faceIndex;
+				if(lightShadowIndex != NO_SHADOW){
+					lightShadowIndex += faceIndex;
+				}
 				mat4 localView = lookAt(vec3(0.0,0.0,0.0), faceCenter, faceUp);
 				projMatrix = projMatrix * translate(localView, -lightPos);
 			}
@@ -122,7 +133,7 @@ void applyLighting(vec3 screenPos, vec3 worldPos, vec3 viewDir, vec3 n, float gl
 				float f = dotNL * 0.5f + 0.5f;
 				float bias = 0.0005 * mix(10.0, 0.5, f);
 				vec3 lightSpacePos = vec3(projectedUV, projectedPos.z);
-				float shadowing = shadowPCF(lightSpacePos, lightShadowIndex, bias);
+				float shadowing = shadowPCF(lightSpacePos, shadowTiles[lightShadowIndex], bias);
 				attenuation *= shadowing;
 			}
 
@@ -32,10 +32,14 @@ layout(std140, set = 0, binding = 6) readonly buffer ZoneInfosBuffer {
 	ZoneInfos zoneInfos[];
 };
 
+layout(std140, set = 0, binding = 7) readonly buffer ShadowTilesInfos {
+	vec4 shadowTiles[];
+};
+
 layout(set = 2, binding = 0) uniform texture2D fogXYMap;
 layout(set = 2, binding = 1) uniform texture2D fogZMap;
 layout(set = 2, binding = 2, rgba32ui) uniform readonly uimage3D lightClusters;
-layout(set = 2, binding = 3) uniform texture2DArray shadowMaps;
+layout(set = 2, binding = 3) uniform texture2D shadowMaps;
 layout(set = 2, binding = 4, r16ui) uniform readonly uimage3D fogClusters;
 layout(set = 3, binding = 0) uniform texture2DArray textures[]; ///< Color textures.
 
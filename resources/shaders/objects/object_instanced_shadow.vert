@@ -15,10 +15,6 @@ layout(location = 0) out INTERFACE {
 } Out;
 
 
-layout(std140, set = 0, binding = 1) readonly buffer MeshesInfos {
-	MeshInfos meshInfos[];
-};
-
 layout(std140, set = 0, binding = 2) readonly buffer InstancesInfos {
 	MeshInstanceInfos instanceInfos[];
 };
@@ -27,6 +23,11 @@ layout(set = 0, binding = 4) readonly buffer InstanceDrawInfos {
 	uint drawInstanceInfos[];
 };
 
+// Mesh index and offset of the first caster instance for each draw command.
+layout(set = 0, binding = 5) readonly buffer ShadowDrawInfos {
+	uvec2 shadowDrawInfos[];
+};
+
 /** Apply the MVP transformation to the input vertex. */
 void main(){
 
@@ -35,13 +36,13 @@ void main(){
 	DrawIndex += uint(gl_DrawIDARB);
 #endif
 
-	MeshInfos mesh = meshInfos[DrawIndex];
-	uint instanceIndex = drawInstanceInfos[mesh.firstInstanceIndex + gl_InstanceIndex];
+	uvec2 drawInfos = shadowDrawInfos[DrawIndex];
+	uint instanceIndex = drawInstanceInfos[drawInfos.y + gl_InstanceIndex];
 
 	MeshInstanceInfos instance = instanceInfos[instanceIndex];
 
 	vec4 worldPos = instance.frame * vec4(v, 1.0);
 	gl_Position = engine.vp * worldPos;
 	Out.uv.xy = uv;
-	Out.DrawIndex = DrawIndex;
+	Out.DrawIndex = drawInfos.x;
 }
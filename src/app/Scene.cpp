@@ -3,10 +3,21 @@
 #include "core/DFFParser.hpp"
 #include "core/AreaParser.hpp"
 #include "core/Random.hpp"
+#include "core/Profiler.hpp"
 
 #include "graphics/GPU.hpp"
 #include "Common.hpp"
 
+#include <chrono>
+
+// Static batching: only small objects with a few instances are worth merging.
+static const uint BATCH_MAX_INSTANCE_COUNT = 2u;
+static const size_t BATCH_MAX_VERTEX_COUNT = 512u;
+// Size of the spatial cells batched objects are grouped in.
+static const float BATCH_CELL_SIZE = 1024.f;
+// Marks objects removed from the list by static batching.
+static const uint NO_OBJECT = 0xFFFFFFFF;
+
 // Fix up data
 
 static const std::unordered_map<std::string, std::string> texFileSubtitutions = {
@@ -79,6 +90,8 @@ GameFiles::GameFiles(const fs::path& installPath){
 	std::sort(worldsList.begin(), worldsList.end());
 	std::sort(areasList.begin(), areasList.end());
 	std::sort(materialsList.begin(), materialsList.end());
+
+	resourcesHash = ScenePack::hashDirectory(resourcesPath);
 }
 
 void Scene::clean(){
@@ -101,26 +114,54 @@ void Scene::clean(){
 	meshDebugInfos.clear();
 	instanceDebugInfos.clear();
 	textureDebugInfos.clear();
+	instancesBVH.clean();
+	portalGraph.clean();
 }
 
-uint Scene::retrieveTexture(const std::string& textureName, const GameFiles& files, std::vector<Texture>& textures2D) const {
+// Hash the raw content of an image (for DDS files, the complete file including all mips).
+static uint64_t hashImageContent(const Image& image){
+	const uint64_t data[5] = {
+		image.pixels.empty() ? 0u : System::hash64(image.pixels.data(), image.pixels.size()),
+		image.width, image.height, image.components, uint64_t(image.compressedFormat)
+	};
+	return System::hash64(data, sizeof(data));
+}
+
+// Compare the final data of two textures, to rule out hash collisions.
+static bool sameTextureContent(const Texture& a, const Texture& b){
+	if(a.width != b.width || a.height != b.height || a.depth != b.depth || a.levels != b.levels || a.shape != b.shape || a.images.size() != b.images.size()){
+		return false;
+	}
+	for(size_t iid = 0u; iid < a.images.size(); ++iid){
+		const Image& imgA = a.images[iid];
+		const Image& imgB = b.images[iid];
+		if(imgA.width != imgB.width || imgA.height != imgB.height || imgA.components != imgB.components
+		   || imgA.compressedFormat != imgB.compressedFormat || imgA.pixels != imgB.pixels){
+			return false;
+		}
+	}
+	return true;
+}
+
+uint Scene::retrieveTexture(const std::string& textureName, const GameFiles& files, std::vector<Texture>& textures2D, TextureLookup& lookup) const {
 	// Do we have the texture already.
-	uint tid = 0;
-	for( ; tid < textures2D.size(); ++tid){
-		if(textures2D[tid].name() == textureName)
-			return tid;
+	auto known = lookup.names.find(textureName);
+	if(known != lookup.names.end()){
+		return known->second;
 	}
 
 	// Else emplace the texture.
+	const uint tid = (uint)textures2D.size();
 	Texture& tex = textures2D.emplace_back(textureName);
 
 	// Might be an inline color.
 	if(TextUtilities::hasPrefix(textureName, INTERNAL_TEXTURE_PREFIX)){
-		auto tokens = TextUtilities::split(textureName.substr(3), " ", false);
+		TextUtilities::Tokenizer tokens(std::string_view(textureName).substr(3), ' ', false);
 		glm::vec3 color(1.0f);
-		color[0] = std::stof(tokens[0]);
-		color[1] = std::stof(tokens[1]);
-		color[2] = std::stof(tokens[2]);
+		std::string_view token;
+		for(uint i = 0; i < 3 && tokens.next(token); ++i){
+			TextUtilities::parseFloat(token, color[i]);
+		}
 		tex.images.resize(1);
 		Image::generateImageWithColor(tex.images[0], color);
 	} else {
@@ -165,6 +206,11 @@ uint Scene::retrieveTexture(const std::string& textureName, const GameFiles& fil
 			Image::generateDefaultColorImage(tex.images[0]);
 		}
 	}
+
+	// Many images are identical under different names (copies, fallbacks, equivalent inline colors), share them.
+	const uint64_t contentHash = hashImageContent(tex.images[0]);
+	auto sameContent = lookup.contents.find(contentHash);
+
 	// Update texture parameters.
 	tex.width = tex.images[0].width;
 	tex.height = tex.images[0].height;
@@ -172,54 +218,215 @@ uint Scene::retrieveTexture(const std::string& textureName, const GameFiles& fil
 	tex.shape = TextureShape::D2;
 	// Split BCn slices if needed.
 	tex.uncompress();
+
+	if(sameContent != lookup.contents.end()){
+		const uint sharedId = sameContent->second;
+		if(sameTextureContent(textures2D[sharedId], tex)){
+			for(const Image& image : textures2D[sharedId].images){
+				lookup.savedBytes += image.pixels.size();
+			}
+			++lookup.sharedCount;
+			textures2D.pop_back();
+			lookup.names[textureName] = sharedId;
+			return sharedId;
+		}
+		Log::warning("Texture %s has the same content hash as %s but different data.", textureName.c_str(), textures2D[sharedId].name().c_str());
+	} else {
+		lookup.contents[contentHash] = tid;
+	}
+	lookup.names[textureName] = tid;
 	return tid;
 }
 
-Scene::TextureInfos Scene::storeTexture(const Texture& tex, uint tid, std::vector<TextureArrayInfos>& arraysToCreate) const{
+bool Scene::batchStaticObjects(const World& world, std::vector<Object>& objects, std::vector<World::Instance>& instances) const {
 
-	TextureInfos texInfos;
+	const std::vector<Object>& worldObjects = world.objects();
+	const std::vector<World::Instance>& worldInstances = world.instances();
+	const std::vector<Object::Material>& materials = world.materials();
 
-	uint arrayIndex = 0;
-	for(TextureArrayInfos& textureArray : arraysToCreate){
-		// Is the array compatible.
-		if((textureArray.width == tex.width) && (textureArray.height == tex.height) && (textureArray.format == tex.images[0].compressedFormat)){
-			// We found one! update the infos.
-			texInfos.index = arrayIndex;
-			// Is the texture already in there.
-			uint localIndex = 0;
-			for(uint texId : textureArray.textures){
-				if(texId == tid){
-					break;
-				}
-				++localIndex;
+	std::vector<uint> instanceCountPerObject(worldObjects.size(), 0u);
+	for(const World::Instance& instance : worldInstances){
+		++instanceCountPerObject[instance.object];
+	}
+
+	std::vector<bool> batchableObjects(worldObjects.size(), false);
+	for(uint oid = 0u; oid < worldObjects.size(); ++oid){
+		const Object& obj = worldObjects[oid];
+		if(instanceCountPerObject[oid] == 0u || instanceCountPerObject[oid] > BATCH_MAX_INSTANCE_COUNT || obj.positions.size() > BATCH_MAX_VERTEX_COUNT){
+			continue;
+		}
+		// Transparent instances are sorted individually, keep them separate.
+		bool batchable = true;
+		for(const Object::Set& set : obj.faceSets){
+			if(materials[set.material].type == Object::Material::TRANSPARENT){
+				batchable = false;
+				break;
 			}
-			// Else add it to the list.
-			if(localIndex == textureArray.textures.size()){
-				textureArray.textures.push_back(tid);
+		}
+		batchableObjects[oid] = batchable;
+	}
+
+	// Group instance sets by material, heat and spatial cell.
+	struct BatchKey {
+		glm::ivec3 cell;
+		uint material;
+		float heat;
+
+		bool operator<(const BatchKey& b) const {
+			if(material != b.material)
+				return material < b.material;
+			if(heat != b.heat)
+				return heat < b.heat;
+			if(cell.x != b.cell.x)
+				return cell.x < b.cell.x;
+			if(cell.y != b.cell.y)
+				return cell.y < b.cell.y;
+			return cell.z < b.cell.z;
+		}
+	};
+	struct BatchItem {
+		uint instance;
+		uint set;
+	};
+	std::map<BatchKey, std::vector<BatchItem>> batches;
+
+	for(uint iid = 0u; iid < worldInstances.size(); ++iid){
+		const World::Instance& instance = worldInstances[iid];
+		if(!batchableObjects[instance.object]){
+			continue;
+		}
+		const Object& obj = worldObjects[instance.object];
+		BoundingBox bbox;
+		for(const glm::vec3& pos : obj.positions){
+			bbox.merge(pos);
+		}
+		const glm::vec3 center = bbox.transformed(instance.frame).getCentroid();
+		const glm::ivec3 cell = glm::ivec3(glm::floor(center / BATCH_CELL_SIZE));
+		for(uint sid = 0u; sid < obj.faceSets.size(); ++sid){
+			batches[{ cell, obj.faceSets[sid].material, instance.heat }].push_back({ iid, sid });
+		}
+	}
+
+	// Nothing to gain if each batch would contain a single item.
+	bool worthBatching = false;
+	for(const auto& batch : batches){
+		if(batch.second.size() > 1u){
+			worthBatching = true;
+			break;
+		}
+	}
+	if(!worthBatching){
+		return false;
+	}
+
+	// Keep the objects that are still referenced, and their instances.
+	std::vector<uint> objectRemap(worldObjects.size(), NO_OBJECT);
+	objects.clear();
+	instances.clear();
+	for(uint oid = 0u; oid < worldObjects.size(); ++oid){
+		if(batchableObjects[oid] || instanceCountPerObject[oid] == 0u){
+			continue;
+		}
+		objectRemap[oid] = (uint)objects.size();
+		objects.push_back(worldObjects[oid]);
+	}
+	for(const World::Instance& instance : worldInstances){
+		if(batchableObjects[instance.object]){
+			continue;
+		}
+		World::Instance& newInstance = instances.emplace_back(instance);
+		newInstance.object = objectRemap[instance.object];
+		assert(newInstance.object != NO_OBJECT);
+	}
+
+	// Generate pre-transformed geometry for each batch.
+	for(const auto& batch : batches){
+		const BatchKey& key = batch.first;
+		Object& batchObj = objects.emplace_back();
+		batchObj.name = "batch_" + std::to_string(key.material) + "_" + std::to_string(key.cell.x) + "_" + std::to_string(key.cell.y) + "_" + std::to_string(key.cell.z);
+		Object::Set& batchSet = batchObj.faceSets.emplace_back();
+		batchSet.material = key.material;
+
+		for(const BatchItem& item : batch.second){
+			const World::Instance& instance = worldInstances[item.instance];
+			const Object& obj = worldObjects[instance.object];
+			const Object::Set& set = obj.faceSets[item.set];
+			const glm::mat3 normalFrame = glm::transpose(glm::inverse(glm::mat3(instance.frame)));
+			// Mirroring frames flip the winding order.
+			const bool flip = glm::determinant(glm::mat3(instance.frame)) < 0.f;
+
+			// Only copy the vertices used by this set.
+			std::unordered_map<uint, uint> vertexRemap;
+			for(const Object::Set::Face& f : set.faces){
+				std::array<uint, 3> ids = { f.v0, f.v1, f.v2 };
+				for(uint& id : ids){
+					auto vertex = vertexRemap.find(id);
+					if(vertex != vertexRemap.end()){
+						id = vertex->second;
+						continue;
+					}
+					const uint newId = (uint)batchObj.positions.size();
+					batchObj.positions.push_back(glm::vec3(instance.frame * glm::vec4(obj.positions[id], 1.0f)));
+					batchObj.normals.push_back(glm::normalize(normalFrame * obj.normals[id]));
+					batchObj.uvs.push_back(obj.uvs[id]);
+					if(!obj.colors.empty()){
+						batchObj.colors.push_back(obj.colors[id]);
+					}
+					vertexRemap[id] = newId;
+					id = newId;
+				}
+				if(flip){
+					std::swap(ids[1], ids[2]);
+				}
+				Object::Set::Face& face = batchSet.faces.emplace_back();
+				face.v0 = face.t0 = face.n0 = face.c0 = ids[0];
+				face.v1 = face.t1 = face.n1 = face.c1 = ids[1];
+				face.v2 = face.t2 = face.n2 = face.c2 = ids[2];
 			}
-			// Update the infos.
-			texInfos.layer = localIndex;
-			return texInfos;
-		}
-		++arrayIndex;
-	}
-	// Else create a new array.
-	arraysToCreate.push_back({ tex.width, tex.height, tex.images[0].compressedFormat, {tid} });
-	// Update the infos.
-	texInfos.index = arrayIndex;
-	texInfos.layer = 0;
-	return texInfos;
+		}
+		// Colors are either present for all vertices or absent.
+		if(batchObj.colors.size() != batchObj.positions.size()){
+			batchObj.colors.clear();
+		}
+		instances.emplace_back(Name(batchObj.name), (uint)(objects.size() - 1u), glm::mat4(1.0f), key.heat);
+	}
+
+	// Report the number of draw commands (one per face set) and unrolled mesh instances.
+	auto countMeshesAndInstances = [](const std::vector<Object>& objs, const std::vector<World::Instance>& insts, uint& meshCount, uint& instanceCount){
+		meshCount = instanceCount = 0u;
+		for(const Object& obj : objs){
+			meshCount += (uint)obj.faceSets.size();
+		}
+		for(const World::Instance& instance : insts){
+			instanceCount += (uint)objs[instance.object].faceSets.size();
+		}
+	};
+	uint meshCountBefore, instanceCountBefore, meshCountAfter, instanceCountAfter;
+	countMeshesAndInstances(worldObjects, worldInstances, meshCountBefore, instanceCountBefore);
+	countMeshesAndInstances(objects, instances, meshCountAfter, instanceCountAfter);
+
+	Log::info("Static batching: %u batches, draw commands %u -> %u, mesh instances %u -> %u.",
+			  (uint)batches.size(), meshCountBefore, meshCountAfter, instanceCountBefore, instanceCountAfter);
+	return true;
 }
 
 void Scene::generate(const World& world, const GameFiles& files){
+	PROFILE_SCOPE("Scene::generate");
 
 	clean();
 
 	/// Populate the mesh geometry and corresponding sub-mesh info.
 	Log::verbose("Generating meshes...");
 	{
-		const size_t instanceCount = world.instances().size();
-		const size_t objectCount = world.objects().size();
+		// Optionally merge small static objects together.
+		std::vector<Object> batchedObjects;
+		std::vector<World::Instance> batchedInstances;
+		const bool batched = options.staticBatching && batchStaticObjects(world, batchedObjects, batchedInstances);
+		const std::vector<Object>& objects = batched ? batchedObjects : world.objects();
+		const std::vector<World::Instance>& instances = batched ? batchedInstances : world.instances();
+
+		const size_t instanceCount = instances.size();
+		const size_t objectCount = objects.size();
 		globalMesh = Mesh(world.name());
 
 		// Estimate the number of meshes ahead, and per-object submeshes indices in the mesh list.
@@ -232,7 +439,7 @@ void Scene::generate(const World& world, const GameFiles& files){
 		std::array<uint, Object::Material::COUNT> meshCountPerMaterial;
 		meshCountPerMaterial.fill(0u);
 
-		for(const Object& obj : world.objects()){
+		for(const Object& obj : objects){
 			meshCount += (uint)obj.faceSets.size();
 			for(const Object::Set& set : obj.faceSets){
 				assert(set.material != Object::Material::NO_MATERIAL);
@@ -264,7 +471,7 @@ void Scene::generate(const World& world, const GameFiles& files){
 			uint indexOffset = (uint)globalMesh.indices.size();
 
 			// Copy attributes.
-			const Object& obj = world.objects()[oid];
+			const Object& obj = objects[oid];
 			Log::check(!obj.positions.empty(), "Object with no positions.");
 			Log::check((obj.positions.size() == obj.uvs.size()) && (obj.positions.size() == obj.normals.size()), "Discrepancy between positions and other attributes.");
 
@@ -305,6 +512,7 @@ void Scene::generate(const World& world, const GameFiles& files){
 			globalMesh.indices.insert(globalMesh.indices.end(), objMesh.indices.begin(), objMesh.indices.end());
 
 			// Pack each mesh.
+			const Name objName(obj.name);
 			uint currentSetId = 0u;
 			for(const Object::Set& set : obj.faceSets){
 
@@ -317,7 +525,7 @@ void Scene::generate(const World& world, const GameFiles& files){
 				infos.materialIndex = (uint)set.material;
 				// ...and additional CPU info (bounding box).
 				MeshCPUInfos& debugInfos = meshDebugInfos[currentMeshId];
-				debugInfos.name = obj.name + "_part_" + std::to_string(currentSetId);
+				debugInfos.name = Name::compose(objName, "_part_", currentSetId);
 				debugInfos.bbox = BoundingBox();
 				for(const Object::Set::Face& f : set.faces){
 					debugInfos.bbox.merge(obj.positions[f.v0]);
@@ -340,7 +548,7 @@ void Scene::generate(const World& world, const GameFiles& files){
 
 		for(uint iid = 0; iid < instanceCount; ++iid){
 			// From an object instance, create a set of meshes instances.
-			const World::Instance& instance = world.instances()[iid];
+			const World::Instance& instance = instances[iid];
 			const auto& meshIndicesRange = objectMeshIndicesRange[instance.object];
 			for(const size_t mid : meshIndicesRange){
 				perMeshInstanceIndices[mid].push_back(iid);
@@ -348,6 +556,10 @@ void Scene::generate(const World& world, const GameFiles& files){
 			}
 		}
 
+		// Zones connectivity, to assign each instance to the zone containing it.
+		portalGraph.build(world);
+		Log::info("Portal graph: %u zones, %u portals.", (uint)portalGraph.zoneCount(), (uint)portalGraph.portalCount());
+
 		// Build a list of unrolled instance data (frames...) and update mesh infos.
 		instanceInfos = std::make_unique<StructuredBuffer<MeshInstanceInfos>>(totalInstancesCount, BufferType::STORAGE, "InstanceInfos");
 		instanceDebugInfos.resize(totalInstancesCount);
@@ -364,20 +576,39 @@ void Scene::generate(const World& world, const GameFiles& files){
 
 			// And populate the instance data.
 			for(const auto& iid : instanceIndices){
-				const World::Instance& instance = world.instances()[iid];
+				const World::Instance& instance = instances[iid];
 				// Populate rendering info.
 				(*instanceInfos)[currentInstanceId].frame = instance.frame;
 				(*instanceInfos)[currentInstanceId].heat = instance.heat;
 				// ...and additional CPU info.
 				InstanceCPUInfos& debugInfos = instanceDebugInfos[currentInstanceId];
-				debugInfos.name = instance.name + "_" + parentDebugInfos.name;
+				debugInfos.name = Name::compose(instance.name, "_", parentDebugInfos.name);
 				debugInfos.bbox = parentDebugInfos.bbox.transformed(instance.frame);
 				debugInfos.meshIndex = currentMeshId;
+				debugInfos.zone = portalGraph.findZone(debugInfos.bbox);
+				(*instanceInfos)[currentInstanceId].zone = debugInfos.zone;
 				++currentInstanceId;
 			}
 			++currentMeshId;
 		}
 
+		const StringPool::Statistics names = StringPool::statistics();
+		Log::info("Name pool: %lu strings, %lu composed names, %.1fKB.", names.strings, names.composed, double(names.bytes) / 1024.0);
+
+		// Build the acceleration structure for CPU queries.
+		{
+			std::vector<BoundingBox> instanceBoxes;
+			instanceBoxes.reserve(instanceDebugInfos.size());
+			for(const InstanceCPUInfos& debugInfos : instanceDebugInfos){
+				instanceBoxes.push_back(debugInfos.bbox);
+			}
+			const auto start = std::chrono::steady_clock::now();
+			instancesBVH.build(instanceBoxes);
+			const auto end = std::chrono::steady_clock::now();
+			const double duration = std::chrono::duration<double, std::milli>(end - start).count();
+			Log::info("Built instances BVH with %u nodes for %u instances in %.2fms.", (uint)instancesBVH.nodeCount(), (uint)instanceBoxes.size(), duration);
+		}
+
 		// Update per material type instance count
 		for(uint mid = 0; mid < Object::Material::COUNT; ++mid){
 			MeshRange& range = globalMeshMaterialRanges[mid];
@@ -400,31 +631,49 @@ void Scene::generate(const World& world, const GameFiles& files){
 		std::vector<Texture> textures2D;
 		textures2D.reserve(materials.size());
 
-		std::vector<TextureArrayInfos> arraysToCreate;
+		TextureLookup textureLookup;
+		// Texture used by each material, color and normal.
+		std::vector<std::array<uint, 2>> materialTextures;
+		materialTextures.reserve(materials.size());
 
 		uint materialId = 0u;
 		for(const Object::Material& material : materials){
 			MaterialInfos& matInfos = (*materialInfos)[materialId];
 			matInfos.type = uint(material.type);
-			// Color
-			{
-				const std::string textureName = !material.color.empty() ? material.color : DEFAULT_ALBEDO_TEXTURE;
-				const uint tid = retrieveTexture(textureName, files, textures2D);
-				// Now that we have the 2D texture, we need to find a compatible texture array to insert it in.
-				matInfos.color = storeTexture(textures2D[tid], tid, arraysToCreate);
-			}
-			// Normal
-			{
-				const std::string textureName = !material.normal.empty() ? material.normal : DEFAULT_NORMAL_TEXTURE;
-				const uint tid = retrieveTexture(textureName, files, textures2D);
-				// Now that we have the 2D texture, we need to find a compatible texture array to insert it in.
-				matInfos.normal = storeTexture(textures2D[tid], tid, arraysToCreate);
-			}
+			const std::string colorName = !material.color.empty() ? material.color : DEFAULT_ALBEDO_TEXTURE;
+			const std::string normalName = !material.normal.empty() ? material.normal : DEFAULT_NORMAL_TEXTURE;
+			materialTextures.push_back({ retrieveTexture(colorName, files, textures2D, textureLookup),
+										 retrieveTexture(normalName, files, textures2D, textureLookup) });
 			++materialId;
 		}
 
-		// Build the texture arrays we have generated above.
-		for(const TextureArrayInfos& arrayInfos : arraysToCreate){
+		Log::info("Textures: %u loaded, %u names sharing the content of another texture, %.1fMB of texture memory saved.",
+				  (uint)textures2D.size(), textureLookup.sharedCount, double(textureLookup.savedBytes) / (1024.0 * 1024.0));
+
+		// Now that we have all 2D textures, find where to store them in texture arrays.
+		std::vector<TextureArrayPlanner::Texture> texturesToPlace;
+		texturesToPlace.reserve(textures2D.size());
+		for(const Texture& tex : textures2D){
+			texturesToPlace.push_back({ tex.width, tex.height, tex.levels, tex.images[0].compressedFormat });
+		}
+		TextureArrayPlanner::Settings planSettings;
+		planSettings.maxArrays = options.maxTextureArrays;
+		planSettings.budget = size_t(options.textureBudget) * 1024u * 1024u;
+		const TextureArrayPlanner::Plan plan = TextureArrayPlanner::plan(texturesToPlace, planSettings);
+		TextureArrayPlanner::log(plan, TextureArrayPlanner::plan(texturesToPlace, { 0u, 0u, false }));
+
+		for(uint mid = 0u; mid < (uint)materialTextures.size(); ++mid){
+			MaterialInfos& matInfos = (*materialInfos)[mid];
+			const TextureArrayPlanner::Placement& color = plan.placements[materialTextures[mid][0]];
+			const TextureArrayPlanner::Placement& normal = plan.placements[materialTextures[mid][1]];
+			matInfos.color.index = color.array;
+			matInfos.color.layer = color.layer;
+			matInfos.normal.index = normal.array;
+			matInfos.normal.layer = normal.layer;
+		}
+
+		// Build the texture arrays, skipping the top levels of downsampled textures.
+		for(const TextureArrayPlanner::Array& arrayInfos : plan.arrays){
 			const std::string texName = "TexArray_" + std::to_string(arrayInfos.width)
 											  + "_" + std::to_string(arrayInfos.height)
 											  + "_" + std::to_string((uint)arrayInfos.format);
@@ -433,24 +682,20 @@ void Scene::generate(const World& world, const GameFiles& files){
 			tex.height = arrayInfos.height;
 			tex.shape = TextureShape::Array2D;
 			tex.depth = (uint)arrayInfos.textures.size();
-			// Use the minimum mip count provided by all textures in the array.
-			tex.levels = 0xFFFF;
-			for(const uint tid : arrayInfos.textures){
-				const Texture& layerTex = textures2D[tid];
-				tex.levels = std::min(tex.levels, layerTex.levels);
-			}
+			tex.levels = arrayInfos.levels;
 			tex.images.resize(tex.depth * tex.levels);
 			for(uint mid = 0; mid < tex.levels; ++mid){
 				for(uint lid = 0; lid < tex.depth; ++lid){
 					const uint texId = arrayInfos.textures[lid];
-					textures2D[texId].images[mid].clone(tex.images[mid * tex.depth + lid]);
+					const uint srcLevel = mid + plan.placements[texId].skippedLevels;
+					textures2D[texId].images[srcLevel].clone(tex.images[mid * tex.depth + lid]);
 				}
 			}
 		}
 
 		// Unroll the arrays to generate additional CPU infos on all textures.
 		uint currentArrayIndex = 0u;
-		for(const TextureArrayInfos& arrayInfos : arraysToCreate){
+		for(const TextureArrayPlanner::Array& arrayInfos : plan.arrays){
 			uint currentLayerIndex = 0u;
 			for(const uint tid : arrayInfos.textures){
 				TextureCPUInfos& debugInfos = textureDebugInfos.emplace_back();
@@ -633,7 +878,7 @@ void Scene::generate(const World& world, const GameFiles& files){
 				float radius = isBoxFilling ? 0.0f : glm::max(emitter.radius, 1.0f);
 				glm::vec2 sizeRange = emitter.sizeRange;
 				const glm::vec3 velocityScale(0.0f, 0.0f, -0.1f);
-				const bool needDrasticReduction = emitter.name.find("pheromone") != std::string::npos;
+				const bool needDrasticReduction = emitter.name.str().find("pheromone") != std::string::npos;
 				if(needDrasticReduction){
 					particleCount = 1u;
 				}
@@ -688,6 +933,7 @@ void Scene::generate(const World& world, const GameFiles& files){
 }
 
 void Scene::upload(){
+	PROFILE_SCOPE("Scene::upload");
 	Log::verbose("Uploading...");
 	// Send data to the GPU.
 	for(auto& tex : textures){
@@ -709,17 +955,312 @@ void Scene::upload(){
 }
 
 void Scene::load(const fs::path& worldPath, const GameFiles& files){
-	
+	PROFILE_SCOPE("Scene::load");
+
+	// Skip parsing and generation if an up-to-date pack exists.
+	const fs::path packPath = ScenePack::path(files.resourcesPath, worldPath);
+	const uint64_t key = packKey(worldPath, files);
+	if(loadPack(packPath, key)){
+		upload();
+		return;
+	}
+
 	world = World();
 	if( !world.load( worldPath, files.resourcesPath ) ){
 		world = World();
 		return;
 	}
 	generate(world, files);
+	savePack(packPath, key);
 	upload();
 
 }
 
+bool Scene::buildPack(const fs::path& worldPath, const GameFiles& files){
+	const fs::path packPath = ScenePack::path(files.resourcesPath, worldPath);
+	const uint64_t key = packKey(worldPath, files);
+	if(ScenePack::isValid(packPath, key)){
+		return true;
+	}
+	clean();
+	world = World();
+	if( !world.load( worldPath, files.resourcesPath ) ){
+		world = World();
+		return false;
+	}
+	generate(world, files);
+	const bool saved = savePack(packPath, key);
+	clean();
+	world = World();
+	return saved;
+}
+
+uint64_t Scene::packKey(const fs::path& worldPath, const GameFiles& files) const {
+	return ScenePack::sceneKey(worldPath, files.resourcesHash, options);
+}
+
+// Texture description, followed by its images.
+struct PackedTexture {
+	uint width;
+	uint height;
+	uint depth;
+	uint levels;
+	uint shape;
+	uint firstImage;
+	uint imageCount;
+	uint pad0;
+};
+
+// Image description, its pixels are stored in their own section.
+struct PackedImage {
+	uint width;
+	uint height;
+	uint components;
+	uint compression;
+};
+
+// Debug infos without their names.
+struct PackedInstanceDebugInfos {
+	BoundingBox bbox;
+	uint meshIndex;
+	uint zone;
+};
+
+static void addMeshStreams(ScenePack::Writer& pack, const Mesh& mesh, uint32_t firstSection){
+	pack.add(firstSection + 0u, mesh.positions);
+	pack.add(firstSection + 1u, mesh.normals);
+	pack.add(firstSection + 2u, mesh.tangents);
+	pack.add(firstSection + 3u, mesh.bitangents);
+	pack.add(firstSection + 4u, mesh.colors);
+	pack.add(firstSection + 5u, mesh.texcoords);
+	pack.add(firstSection + 6u, mesh.indices);
+}
+
+static bool readMeshStreams(const ScenePack& pack, Mesh& mesh, uint32_t firstSection){
+	return pack.read(firstSection + 0u, mesh.positions)
+		&& pack.read(firstSection + 1u, mesh.normals)
+		&& pack.read(firstSection + 2u, mesh.tangents)
+		&& pack.read(firstSection + 3u, mesh.bitangents)
+		&& pack.read(firstSection + 4u, mesh.colors)
+		&& pack.read(firstSection + 5u, mesh.texcoords)
+		&& pack.read(firstSection + 6u, mesh.indices);
+}
+
+template<typename T>
+static std::unique_ptr<StructuredBuffer<T>> readBuffer(const ScenePack& pack, uint32_t id, const std::string& name){
+	size_t count = 0;
+	if(pack.data(id, sizeof(T), count) == nullptr){
+		return nullptr;
+	}
+	std::unique_ptr<StructuredBuffer<T>> buffer = std::make_unique<StructuredBuffer<T>>(count, BufferType::STORAGE, name);
+	pack.read(id, buffer->data);
+	return buffer;
+}
+
+bool Scene::savePack(const fs::path& path, uint64_t key) const {
+	PROFILE_SCOPE("Scene::savePack");
+	ScenePack::Writer pack;
+	world.save(pack);
+
+	addMeshStreams(pack, globalMesh, ScenePack::MESH_POSITIONS);
+	addMeshStreams(pack, billboardsMesh, ScenePack::BILLBOARD_POSITIONS);
+	pack.add(ScenePack::MESH_RANGES, globalMeshMaterialRanges.data(), sizeof(MeshRange), globalMeshMaterialRanges.size());
+	pack.add(ScenePack::BILLBOARD_RANGES, billboardRanges.data(), sizeof(Range), billboardRanges.size());
+	pack.add(ScenePack::PARTICLE_RANGES, particleRanges.data(), sizeof(Range), particleRanges.size());
+
+	pack.add(ScenePack::MESH_INFOS, meshInfos->data);
+	pack.add(ScenePack::INSTANCE_INFOS, instanceInfos->data);
+	pack.add(ScenePack::MATERIAL_INFOS, materialInfos->data);
+	pack.add(ScenePack::LIGHT_INFOS, lightInfos->data);
+	pack.add(ScenePack::ZONE_INFOS, zoneInfos->data);
+
+	// Textures, each image in its own aligned section.
+	std::vector<PackedTexture> packedTextures;
+	std::vector<PackedImage> packedImages;
+	std::vector<std::string> names;
+	packedTextures.reserve(textures.size());
+	names.reserve(textures.size());
+	for(const Texture& tex : textures){
+		packedTextures.push_back({ tex.width, tex.height, tex.depth, tex.levels, uint(tex.shape), (uint)packedImages.size(), (uint)tex.images.size(), 0u });
+		names.push_back(tex.name());
+		for(const Image& image : tex.images){
+			pack.add(ScenePack::TEXTURE_PIXELS + (uint32_t)packedImages.size(), image.pixels);
+			packedImages.push_back({ image.width, image.height, image.components, uint(image.compressedFormat) });
+		}
+	}
+	pack.addCopy(ScenePack::TEXTURES, packedTextures);
+	pack.addCopy(ScenePack::TEXTURE_IMAGES, packedImages);
+	pack.addStrings(ScenePack::TEXTURE_NAMES, names);
+
+	// CPU infos.
+	{
+		std::vector<BoundingBox> boxes;
+		std::vector<Name> meshNames;
+		for(const MeshCPUInfos& infos : meshDebugInfos){
+			boxes.push_back(infos.bbox);
+			meshNames.push_back(infos.name);
+		}
+		pack.addCopy(ScenePack::MESH_DEBUG_INFOS, boxes);
+		pack.addNames(ScenePack::MESH_DEBUG_NAMES, ScenePack::MESH_DEBUG_NAME_PARTS, meshNames);
+	}
+	{
+		std::vector<PackedInstanceDebugInfos> infos;
+		std::vector<Name> instanceNames;
+		for(const InstanceCPUInfos& instance : instanceDebugInfos){
+			infos.push_back({ instance.bbox, instance.meshIndex, instance.zone });
+			instanceNames.push_back(instance.name);
+		}
+		pack.addCopy(ScenePack::INSTANCE_DEBUG_INFOS, infos);
+		pack.addNames(ScenePack::INSTANCE_DEBUG_NAMES, ScenePack::INSTANCE_DEBUG_NAME_PARTS, instanceNames);
+	}
+	{
+		std::vector<TextureInfos> infos;
+		names.clear();
+		for(const TextureCPUInfos& texture : textureDebugInfos){
+			infos.push_back(texture.data);
+			names.push_back(texture.name);
+		}
+		pack.addCopy(ScenePack::TEXTURE_DEBUG_INFOS, infos);
+		pack.addStrings(ScenePack::TEXTURE_DEBUG_NAMES, names);
+	}
+
+	return pack.save(path, key);
+}
+
+bool Scene::loadPack(const fs::path& path, uint64_t key){
+	PROFILE_SCOPE("Scene::loadPack");
+	const auto start = std::chrono::steady_clock::now();
+
+	ScenePack pack;
+	if(!pack.load(path, key)){
+		return false;
+	}
+
+	clean();
+	auto fail = [this, &path](){
+		Log::warning("Scene: Invalid pack %s, regenerating.", path.string().c_str());
+		clean();
+		world = World();
+		return false;
+	};
+
+	if(!world.load(pack)){
+		return fail();
+	}
+
+	globalMesh = Mesh(world.name());
+	if(!readMeshStreams(pack, globalMesh, ScenePack::MESH_POSITIONS) || !readMeshStreams(pack, billboardsMesh, ScenePack::BILLBOARD_POSITIONS)){
+		return fail();
+	}
+	if(!pack.read(ScenePack::MESH_RANGES, globalMeshMaterialRanges.data(), sizeof(MeshRange), globalMeshMaterialRanges.size())
+	   || !pack.read(ScenePack::BILLBOARD_RANGES, billboardRanges.data(), sizeof(Range), billboardRanges.size())
+	   || !pack.read(ScenePack::PARTICLE_RANGES, particleRanges.data(), sizeof(Range), particleRanges.size())){
+		return fail();
+	}
+
+	meshInfos = readBuffer<MeshInfos>(pack, ScenePack::MESH_INFOS, "MeshInfos");
+	instanceInfos = readBuffer<MeshInstanceInfos>(pack, ScenePack::INSTANCE_INFOS, "InstanceInfos");
+	materialInfos = readBuffer<MaterialInfos>(pack, ScenePack::MATERIAL_INFOS, "MaterialInfos");
+	lightInfos = readBuffer<LightInfos>(pack, ScenePack::LIGHT_INFOS, "LightInfos");
+	zoneInfos = readBuffer<ZoneInfos>(pack, ScenePack::ZONE_INFOS, "ZoneInfos");
+	if(!meshInfos || !instanceInfos || !materialInfos || !lightInfos || !zoneInfos){
+		return fail();
+	}
+
+	// Textures.
+	{
+		std::vector<PackedTexture> packedTextures;
+		std::vector<PackedImage> packedImages;
+		std::vector<std::string> names;
+		if(!pack.read(ScenePack::TEXTURES, packedTextures) || !pack.read(ScenePack::TEXTURE_IMAGES, packedImages)
+		   || !pack.readStrings(ScenePack::TEXTURE_NAMES, names) || names.size() != packedTextures.size()){
+			return fail();
+		}
+		textures.reserve(packedTextures.size());
+		for(size_t tid = 0; tid < packedTextures.size(); ++tid){
+			const PackedTexture& packed = packedTextures[tid];
+			if(packed.firstImage + packed.imageCount > packedImages.size()){
+				return fail();
+			}
+			Texture& tex = textures.emplace_back(names[tid]);
+			tex.width = packed.width;
+			tex.height = packed.height;
+			tex.depth = packed.depth;
+			tex.levels = packed.levels;
+			tex.shape = TextureShape(packed.shape);
+			tex.images.resize(packed.imageCount);
+			for(uint iid = 0; iid < packed.imageCount; ++iid){
+				const PackedImage& packedImage = packedImages[packed.firstImage + iid];
+				Image& image = tex.images[iid];
+				image.width = packedImage.width;
+				image.height = packedImage.height;
+				image.components = packedImage.components;
+				image.compressedFormat = Image::Compression(packedImage.compression);
+				if(!pack.read(ScenePack::TEXTURE_PIXELS + packed.firstImage + iid, image.pixels)){
+					return fail();
+				}
+			}
+		}
+	}
+
+	// CPU infos.
+	{
+		std::vector<BoundingBox> boxes;
+		std::vector<Name> names;
+		if(!pack.read(ScenePack::MESH_DEBUG_INFOS, boxes) || !pack.readNames(ScenePack::MESH_DEBUG_NAMES, ScenePack::MESH_DEBUG_NAME_PARTS, names) || names.size() != boxes.size()){
+			return fail();
+		}
+		meshDebugInfos.resize(boxes.size());
+		for(size_t mid = 0; mid < boxes.size(); ++mid){
+			meshDebugInfos[mid].name = names[mid];
+			meshDebugInfos[mid].bbox = boxes[mid];
+		}
+	}
+	{
+		std::vector<PackedInstanceDebugInfos> infos;
+		std::vector<Name> names;
+		if(!pack.read(ScenePack::INSTANCE_DEBUG_INFOS, infos) || !pack.readNames(ScenePack::INSTANCE_DEBUG_NAMES, ScenePack::INSTANCE_DEBUG_NAME_PARTS, names) || names.size() != infos.size()){
+			return fail();
+		}
+		instanceDebugInfos.resize(infos.size());
+		for(size_t iid = 0; iid < infos.size(); ++iid){
+			InstanceCPUInfos& instance = instanceDebugInfos[iid];
+			instance.name = names[iid];
+			instance.bbox = infos[iid].bbox;
+			instance.meshIndex = infos[iid].meshIndex;
+			instance.zone = infos[iid].zone;
+		}
+	}
+	{
+		std::vector<TextureInfos> infos;
+		std::vector<std::string> names;
+		if(!pack.read(ScenePack::TEXTURE_DEBUG_INFOS, infos) || !pack.readStrings(ScenePack::TEXTURE_DEBUG_NAMES, names) || names.size() != infos.size()){
+			return fail();
+		}
+		textureDebugInfos.resize(infos.size());
+		for(size_t tid = 0; tid < infos.size(); ++tid){
+			textureDebugInfos[tid].name = names[tid];
+			textureDebugInfos[tid].data = infos[tid];
+		}
+	}
+
+	// Rebuild the CPU acceleration structures, they are cheap compared to generation.
+	portalGraph.build(world);
+	{
+		std::vector<BoundingBox> instanceBoxes;
+		instanceBoxes.reserve(instanceDebugInfos.size());
+		for(const InstanceCPUInfos& debugInfos : instanceDebugInfos){
+			instanceBoxes.push_back(debugInfos.bbox);
+		}
+		instancesBVH.build(instanceBoxes);
+	}
+
+	const auto end = std::chrono::steady_clock::now();
+	const double duration = std::chrono::duration<double, std::milli>(end - start).count();
+	Log::info("Scene: Loaded %s from pack (%.1fMB) in %.2fms.", world.name().c_str(), double(pack.size()) / (1024.0 * 1024.0), duration);
+	return true;
+}
+
 void Scene::loadFile(const fs::path& filePath, const GameFiles& files){
 
 	Object obj;
@@ -753,3 +1294,59 @@ BoundingBox Scene::computeBoundingBox() const {
 	}
 	return bbox;
 }
+
+bool Scene::intersect(const BVH::Ray& ray, uint& instance) const {
+	if(!meshInfos || !instanceInfos){
+		return false;
+	}
+
+	// Moller-Trumbore triangle test, in the instance local frame.
+	auto intersectTriangle = [](const BVH::Ray& localRay, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, float& distance){
+		const glm::vec3 e1 = v1 - v0;
+		const glm::vec3 e2 = v2 - v0;
+		const glm::vec3 p = glm::cross(localRay.direction, e2);
+		const float det = glm::dot(e1, p);
+		if(std::abs(det) < 1e-10f){
+			return false;
+		}
+		const float invDet = 1.0f / det;
+		const glm::vec3 s = localRay.origin - v0;
+		const float u = glm::dot(s, p) * invDet;
+		if(u < 0.0f || u > 1.0f){
+			return false;
+		}
+		const glm::vec3 q = glm::cross(s, e1);
+		const float v = glm::dot(localRay.direction, q) * invDet;
+		if(v < 0.0f || (u + v) > 1.0f){
+			return false;
+		}
+		const float t = glm::dot(e2, q) * invDet;
+		if(t < 0.0f || t >= distance){
+			return false;
+		}
+		distance = t;
+		return true;
+	};
+
+	auto intersectInstance = [this, &ray, &intersectTriangle](uint item, float& distance){
+		const MeshInfos& mesh = meshInfos->data[instanceDebugInfos[item].meshIndex];
+		// Distances along the ray are preserved by the affine change of frame, as the direction is not normalized.
+		const glm::mat4 invFrame = glm::inverse(instanceInfos->data[item].frame);
+		const BVH::Ray localRay(glm::vec3(invFrame * glm::vec4(ray.origin, 1.0f)), glm::vec3(invFrame * glm::vec4(ray.direction, 0.0f)));
+		bool found = false;
+		for(uint i = mesh.firstIndex; i < mesh.firstIndex + mesh.indexCount; i += 3){
+			const glm::vec3& v0 = globalMesh.positions[mesh.vertexOffset + globalMesh.indices[i]];
+			const glm::vec3& v1 = globalMesh.positions[mesh.vertexOffset + globalMesh.indices[i + 1]];
+			const glm::vec3& v2 = globalMesh.positions[mesh.vertexOffset + globalMesh.indices[i + 2]];
+			found = intersectTriangle(localRay, v0, v1, v2, distance) || found;
+		}
+		return found;
+	};
+
+	BVH::Hit hit;
+	if(!instancesBVH.intersect(ray, hit, intersectInstance)){
+		return false;
+	}
+	instance = hit.item;
+	return true;
+}
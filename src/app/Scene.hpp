@@ -5,6 +5,11 @@
 #include "core/Common.hpp"
 #include "core/Geometry.hpp"
 #include "core/WorldParser.hpp"
+#include "core/BVH.hpp"
+#include "core/PortalGraph.hpp"
+#include "core/ScenePack.hpp"
+#include "core/StringPool.hpp"
+#include "core/TextureArrayPlanner.hpp"
 
 #include "resources/Texture.hpp"
 #include "resources/Mesh.hpp"
@@ -32,6 +37,8 @@ struct GameFiles {
 	std::vector<fs::path> areasList;
 	std::vector<fs::path> materialsList;
 
+	uint64_t resourcesHash = 0; ///< Hash of the resources directory listing, used to validate scene packs.
+
 };
 
 class Scene {
@@ -51,7 +58,7 @@ public:
 
 	struct MeshInstanceInfos {
 		glm::mat4 frame;
-		float heat; uint pad0, pad1, pad2;
+		float heat; uint zone; uint pad1, pad2;
 	};
 
 	struct TextureInfos {
@@ -90,13 +97,14 @@ public:
 
 	// CPU data.
 	struct MeshCPUInfos {
-		std::string name;
+		Name name;
 		BoundingBox bbox;
 	};
 	struct InstanceCPUInfos {
-		std::string name;
+		Name name;
 		BoundingBox bbox;
 		uint meshIndex;
+		uint zone;
 	};
 	struct TextureCPUInfos {
 		std::string name;
@@ -127,29 +135,80 @@ public:
 
 	void load(const fs::path& worldPath, const GameFiles& files);
 
+	/** Generate and save the pack of a world if it is missing or outdated, without uploading anything to the GPU.
+	 \param worldPath the world file path
+	 \param files the game files
+	 \return true if an up-to-date pack is available
+	 */
+	bool buildPack(const fs::path& worldPath, const GameFiles& files);
+
 	BoundingBox computeBoundingBox() const;
 
+	/** Find the closest instance intersected by a ray, refining the bounding boxes hits with the mesh triangles.
+	 \param ray the world space ray to cast
+	 \param instance will contain the index of the intersected instance
+	 \return true if an instance was intersected
+	 */
+	bool intersect(const BVH::Ray& ray, uint& instance) const;
+
 private:
 
-	struct TextureArrayInfos {
-		uint width = 0;
-		uint height = 0;
-		Image::Compression format = Image::Compression::NONE;
-		std::vector<uint> textures;
+	/** \brief Lookup tables for the 2D textures loaded during generation. */
+	struct TextureLookup {
+		std::unordered_map<std::string, uint> names; ///< Texture index for each requested name.
+		std::unordered_map<uint64_t, uint> contents; ///< Texture index for each image content hash.
+		size_t savedBytes = 0u; ///< Image data not duplicated thanks to content sharing.
+		uint sharedCount = 0u; ///< Number of names sharing the content of another texture.
 	};
 
 	void generate(const World& world, const GameFiles& files);
+
+	/** Merge small, rarely instanced objects sharing a material into pre-transformed meshes, grouped by spatial cell.
+	 \param world the world to batch
+	 \param objects will contain the remaining objects and the batched meshes
+	 \param instances will contain the remaining instances and one instance per batch
+	 \return true if at least one batch was created
+	 */
+	bool batchStaticObjects(const World& world, std::vector<Object>& objects, std::vector<World::Instance>& instances) const;
 	
 	void upload();
 
-	uint retrieveTexture(const std::string& textureName, const GameFiles& files, std::vector<Texture>& textures2D) const;
-	
-	TextureInfos storeTexture(const Texture& tex, uint tid, std::vector<TextureArrayInfos>& arraysToCreate) const;
+	/** Save the generated scene data to a pack.
+	 \param path the pack file path
+	 \param key the key identifying the scene inputs
+	 \return true if the pack was saved
+	 */
+	bool savePack(const fs::path& path, uint64_t key) const;
+
+	/** Restore the generated scene data from a pack, replacing the current content.
+	 \param path the pack file path
+	 \param key the expected key
+	 \return true if the pack was valid and loaded
+	 */
+	bool loadPack(const fs::path& path, uint64_t key);
+
+	/** Compute the pack key for a world, depending on the generation options.
+	 \param worldPath the world file path
+	 \param files the game files
+	 \return the key
+	 */
+	uint64_t packKey(const fs::path& worldPath, const GameFiles& files) const;
+
+	/** Load a 2D texture, reusing an already loaded texture with the same name or the same content.
+	 \param textureName the texture name, or an inline color
+	 \param files the game files
+	 \param textures2D the loaded textures
+	 \param lookup the names and contents of loaded textures
+	 \return the index of the texture in the list
+	 */
+	uint retrieveTexture(const std::string& textureName, const GameFiles& files, std::vector<Texture>& textures2D, TextureLookup& lookup) const;
 
 public:
 
 	World world;
 
+	ScenePack::SceneOptions options; ///< Generation options, part of the pack key.
+
 	Mesh globalMesh{"None"};
 
 	std::array<MeshRange, Object::Material::COUNT> globalMeshMaterialRanges;
@@ -170,4 +229,7 @@ public:
 	std::vector<InstanceCPUInfos> instanceDebugInfos;
 	std::vector<TextureCPUInfos> textureDebugInfos;
 
+	BVH instancesBVH;
+	PortalGraph portalGraph;
+
 };
@@ -1,7 +1,12 @@
 #include "graphics/DescriptorAllocator.hpp"
+#include "graphics/GPU.hpp"
 #include "graphics/GPUInternal.hpp"
+#include "core/System.hpp"
+
+#include <algorithm>
 
 #define DEFAULT_SET_COUNT 1000
+#define CACHE_EVICTION_COUNT 64
 
 void DescriptorAllocator::init(GPUContext* context, uint poolCount){
 	_context = context;
@@ -30,12 +35,27 @@ DescriptorSet DescriptorAllocator::allocateSet(VkDescriptorSetLayout& setLayout)
 		currentPool.allocated += 1;
 		currentPool.lastFrame = _context->frameIndex;
 		set.pool = currentPool.id;
+		++GPU::_metrics.descriptorAllocations;
+		return set;
+	}
+
+	// Else, make room by evicting unused cached sets and try again.
+	if(evictCachedSets(currentPool.id, CACHE_EVICTION_COUNT) != 0 && vkAllocateDescriptorSets(_context->device, &allocInfo, &set.handle) == VK_SUCCESS) {
+		// Success.
+		currentPool.allocated += 1;
+		currentPool.lastFrame = _context->frameIndex;
+		set.pool = currentPool.id;
+		++GPU::_metrics.descriptorAllocations;
 		return set;
 	}
 
 	// Else, try to find an existing pool where all sets have been freed.
 	bool found = false;
 	for(auto poolIt = _pools.begin(); poolIt != _pools.end(); ++poolIt){
+		// Unused cached sets shouldn't keep older pools alive.
+		if(poolIt->allocated != 0){
+			evictCachedSets(poolIt->id, DEFAULT_SET_COUNT);
+		}
 		if(poolIt->allocated == 0 && (poolIt->lastFrame + 2 < _context->frameIndex)){
 			// Copy the pool infos.
 			DescriptorPool pool = DescriptorPool(*poolIt);
@@ -60,6 +80,7 @@ DescriptorSet DescriptorAllocator::allocateSet(VkDescriptorSetLayout& setLayout)
 		newPool.allocated += 1;
 		newPool.lastFrame = _context->frameIndex;
 		set.pool = newPool.id;
+		++GPU::_metrics.descriptorAllocations;
 		return set;
 	}
 
@@ -121,7 +142,132 @@ void DescriptorAllocator::freeSet(const DescriptorSet& set){
 	}
 }
 
+bool DescriptorAllocator::acquireCachedSet(VkDescriptorSetLayout& setLayout, const std::vector<uint64_t>& signature, const std::vector<uint64_t>& resources, DescriptorSet& set){
+	const uint64_t hash = System::hash64(signature.data(), signature.size() * sizeof(uint64_t));
+
+	auto lookup = _cacheLookup.find(hash);
+	if(lookup != _cacheLookup.end()){
+		CachedSet& cachedSet = _cachedSets.at(lookup->second);
+		if(cachedSet.signature == signature){
+			// Reuse the set as-is.
+			++cachedSet.users;
+			cachedSet.lastFrame = _context->frameIndex;
+			_cacheUsage.splice(_cacheUsage.begin(), _cacheUsage, cachedSet.lru);
+			set = cachedSet.set;
+			++GPU::_metrics.descriptorCacheHits;
+			return true;
+		}
+		// Hash collision, the new set will replace the existing one in the lookup.
+		makeUnreachable(cachedSet);
+	}
+
+	set = allocateSet(setLayout);
+	if(set.handle == VK_NULL_HANDLE){
+		return false;
+	}
+
+	CachedSet& cachedSet = _cachedSets[set.handle];
+	cachedSet.set = set;
+	cachedSet.signature = signature;
+	cachedSet.resources = resources;
+	cachedSet.hash = hash;
+	cachedSet.lastFrame = _context->frameIndex;
+	cachedSet.users = 1;
+	cachedSet.reachable = true;
+	_cacheUsage.push_front(set.handle);
+	cachedSet.lru = _cacheUsage.begin();
+
+	_cacheLookup[hash] = set.handle;
+	for(const uint64_t resource : resources){
+		_cachedSetsByResource.emplace(resource, set.handle);
+	}
+	++GPU::_metrics.cachedDescriptorSets;
+	return false;
+}
+
+void DescriptorAllocator::releaseCachedSet(const DescriptorSet& set){
+	if(set.handle == VK_NULL_HANDLE){
+		return;
+	}
+	auto cachedSet = _cachedSets.find(set.handle);
+	if(cachedSet == _cachedSets.end()){
+		return;
+	}
+	assert(cachedSet->second.users != 0);
+	--cachedSet->second.users;
+	// It might still be used by in flight frames.
+	cachedSet->second.lastFrame = _context->frameIndex;
+}
+
+void DescriptorAllocator::invalidateCachedSets(uint64_t handle){
+	auto range = _cachedSetsByResource.equal_range(handle);
+	for(auto it = range.first; it != range.second; ++it){
+		auto cachedSet = _cachedSets.find(it->second);
+		if(cachedSet != _cachedSets.end()){
+			makeUnreachable(cachedSet->second);
+		}
+	}
+}
+
+void DescriptorAllocator::makeUnreachable(CachedSet& cachedSet){
+	if(!cachedSet.reachable){
+		return;
+	}
+	auto lookup = _cacheLookup.find(cachedSet.hash);
+	if(lookup != _cacheLookup.end() && lookup->second == cachedSet.set.handle){
+		_cacheLookup.erase(lookup);
+	}
+	cachedSet.reachable = false;
+}
+
+uint DescriptorAllocator::evictCachedSets(uint pool, uint maxCount){
+	auto poolIt = std::find_if(_pools.begin(), _pools.end(), [pool](const DescriptorPool& other){
+		return other.id == pool;
+	});
+	if(poolIt == _pools.end()){
+		return 0;
+	}
+	const VkDescriptorPool poolHandle = poolIt->handle;
+	const uint64_t currentFrame = _context->frameIndex;
+
+	uint count = 0;
+	// Start from the least recently used sets.
+	auto it = _cacheUsage.end();
+	while(it != _cacheUsage.begin() && count < maxCount){
+		--it;
+		auto cachedSetIt = _cachedSets.find(*it);
+		CachedSet& cachedSet = cachedSetIt->second;
+		// Skip sets from other pools, in use, or that might still be used by in flight frames.
+		if(cachedSet.set.pool != pool || cachedSet.users != 0 || (cachedSet.lastFrame + 2 >= currentFrame)){
+			continue;
+		}
+		makeUnreachable(cachedSet);
+		for(const uint64_t resource : cachedSet.resources){
+			auto range = _cachedSetsByResource.equal_range(resource);
+			for(auto rit = range.first; rit != range.second; ++rit){
+				if(rit->second == cachedSet.set.handle){
+					_cachedSetsByResource.erase(rit);
+					break;
+				}
+			}
+		}
+		VK_RET(vkFreeDescriptorSets(_context->device, poolHandle, 1, &cachedSet.set.handle));
+		freeSet(cachedSet.set);
+		_cachedSets.erase(cachedSetIt);
+		it = _cacheUsage.erase(it);
+		--GPU::_metrics.cachedDescriptorSets;
+		++count;
+	}
+	return count;
+}
+
 void DescriptorAllocator::clean(){
+	GPU::_metrics.cachedDescriptorSets -= _cachedSets.size();
+	_cachedSets.clear();
+	_cacheLookup.clear();
+	_cachedSetsByResource.clear();
+	_cacheUsage.clear();
+
 	for(auto& pool : _pools){
 		vkDestroyDescriptorPool(_context->device, pool.handle, nullptr);
 	}
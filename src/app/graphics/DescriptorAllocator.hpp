@@ -4,6 +4,8 @@
 #include "graphics/GPUObjects.hpp"
 
 #include <deque>
+#include <list>
+#include <unordered_map>
 
 #define BINDLESS_SET_MAX_SIZE 96
 
@@ -11,6 +13,9 @@ struct GPUContext;
 
 /** \brief Manage descriptor set allocations by creating and reusing internal descriptor pools.
  \details By default each pool will contain up to DEFAULT_SET_COUNT of each kind defined in createPool.
+ Sets can also be requested from a cache, keyed by their layout and bound resources, so that programs alternating
+ between the same bindings reuse already written sets. Unused cached sets are evicted in least recently used order
+ when their pool is full.
  \ingroup Graphics
  */
 class DescriptorAllocator {
@@ -36,6 +41,25 @@ public:
 	 */
 	void freeSet(const DescriptorSet& set);
 
+	/** Find a descriptor set with the given layout and content in the cache, or allocate a new one.
+	 \param setLayout the layout to use
+	 \param signature description of the layout and bound resources
+	 \param resources native handles of the layout and bound resources
+	 \param set will contain the descriptor set
+	 \return true if the set content is up to date, false if it has to be written
+	 */
+	bool acquireCachedSet(VkDescriptorSetLayout& setLayout, const std::vector<uint64_t>& signature, const std::vector<uint64_t>& resources, DescriptorSet& set);
+
+	/** Mark a set obtained from the cache as unused by the caller, it stays available for later requests.
+	 \param set the set to release
+	 */
+	void releaseCachedSet(const DescriptorSet& set);
+
+	/** Prevent cached sets referencing a resource from being reused, as the resource is being deleted.
+	 \param handle the native handle of the resource
+	 */
+	void invalidateCachedSets(uint64_t handle);
+
 	/** Reset all descriptor pools */
 	void clean();
 
@@ -59,6 +83,30 @@ private:
 	 */
 	DescriptorPool createPool(uint count, bool combinedImages, bool imagesOnly);
 
+	/** \brief Descriptor set stored in the cache. */
+	struct CachedSet {
+		DescriptorSet set; ///< The descriptor set.
+		std::vector<uint64_t> signature; ///< Layout and bound resources.
+		std::vector<uint64_t> resources; ///< Native handles referenced by the set.
+		std::list<VkDescriptorSet>::iterator lru; ///< Position in the usage list.
+		uint64_t hash = 0; ///< Signature hash.
+		uint64_t lastFrame = 0; ///< Last frame the set was acquired or released.
+		uint users = 0; ///< Number of current users.
+		bool reachable = true; ///< Can the set still be found from its signature.
+	};
+
+	/** Free unused cached sets allocated in a pool, starting from the least recently used ones.
+	 \param pool the pool id
+	 \param maxCount the maximum number of sets to free
+	 \return the number of freed sets
+	 */
+	uint evictCachedSets(uint pool, uint maxCount);
+
+	/** Remove a cached set from the lookup, it will be evicted once unused.
+	 \param cachedSet the set to detach
+	 */
+	void makeUnreachable(CachedSet& cachedSet);
+
 	GPUContext* _context = nullptr; ///< The GPU context.
 	std::deque<DescriptorPool> _pools; ///< Available pools.
 	DescriptorPool _imguiPool; ///< ImGui dedicated pool.
@@ -66,4 +114,9 @@ private:
 
 	uint _maxPoolCount = 2; ///< Maximum number of pools to create.
 	uint _currentPoolCount = 0; ///< Current number of created pools.
+
+	std::unordered_map<VkDescriptorSet, CachedSet> _cachedSets; ///< All cached sets.
+	std::unordered_map<uint64_t, VkDescriptorSet> _cacheLookup; ///< Cached sets by signature hash.
+	std::unordered_multimap<uint64_t, VkDescriptorSet> _cachedSetsByResource; ///< Cached sets by referenced resource.
+	std::list<VkDescriptorSet> _cacheUsage; ///< Cached sets, from most to least recently used.
 };
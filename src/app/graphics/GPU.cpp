@@ -7,6 +7,7 @@
 #include "core/Image.hpp"
 #include "system/Window.hpp"
 #include "core/System.hpp"
+#include "core/Profiler.hpp"
 #include "graphics/GPUInternal.hpp"
 
 #define VMA_STATIC_VULKAN_FUNCTIONS 0
@@ -22,6 +23,7 @@
 #include <vma/vk_mem_alloc.h>
 #pragma clang diagnostic pop
 
+#include <chrono>
 #include <sstream>
 #include <GLFW/glfw3.h>
 #include <set>
@@ -171,8 +173,8 @@ bool GPU::setup(const std::string & appName) {
 }
 
 bool GPU::setupWindow(Window * window){
-	// Create a surface.
-	if(glfwCreateWindowSurface(_context.instance, window->_window, nullptr, &_context.surface) != VK_SUCCESS) {
+	// Create a surface, except for offscreen rendering.
+	if(window->_window && glfwCreateWindowSurface(_context.instance, window->_window, nullptr, &_context.surface) != VK_SUCCESS) {
 		Log::error("GPU: Unable to create surface.");
 		return false;
 	}
@@ -313,6 +315,10 @@ bool GPU::setupWindow(Window * window){
 	_context.queryAllocators[GPUQuery::Type::TIME_ELAPSED].init(GPUQuery::Type::TIME_ELAPSED, 1024);
 	_context.queryAllocators[GPUQuery::Type::ANY_DRAWN].init(GPUQuery::Type::ANY_DRAWN, 1024);
 	_context.queryAllocators[GPUQuery::Type::SAMPLES_DRAWN].init(GPUQuery::Type::SAMPLES_DRAWN, 1024);
+	_context.passTimer.init(512);
+
+	// Staging memory for uploads, needed as soon as frames begin.
+	_context.stagingAllocator.init(&_context, 32u * 1024u * 1024u);
 
 	// Finally setup the swapchain.
 	window->_swapchain.reset(new Swapchain(_context, window->_config));
@@ -431,6 +437,74 @@ void GPU::createComputeProgram(Program& program, const std::string & computeCont
 	++_metrics.programs;
 }
 
+void GPU::createPrograms(const std::vector<Program*> & programs, const std::vector<Program::Sources> & sources) {
+	PROFILE_SCOPE("GPU::createPrograms");
+	assert(programs.size() == sources.size());
+
+	/// \brief Compilation of one stage of a program.
+	struct StageTask {
+		Program* program;
+		ShaderType type;
+		const std::string* content;
+		std::string log;
+	};
+
+	std::vector<StageTask> tasks;
+	for(size_t pid = 0; pid < programs.size(); ++pid){
+		Program* program = programs[pid];
+		Log::verbose("GPU: Compiling %s.", program->name().c_str());
+		for(uint sid = 0; sid < uint(ShaderType::COUNT); ++sid){
+			const ShaderType type = ShaderType(sid);
+			if(sources[pid][sid].empty()){
+				continue;
+			}
+			if((type == ShaderType::COMPUTE) != (program->type() == Program::Type::COMPUTE)){
+				Log::error("GPU: Unexpected shader type for %s.", program->name().c_str());
+				continue;
+			}
+			tasks.push_back({ program, type, &sources[pid][sid], "" });
+		}
+	}
+
+	const ShaderCompiler::CacheStatistics statsBefore = ShaderCompiler::cacheStatistics();
+	const auto start = std::chrono::steady_clock::now();
+
+	// Compile and reflect all stages on worker threads, glslang uses a context per thread.
+	System::forParallel(0, tasks.size(), [&tasks](size_t tid){
+		StageTask& task = tasks[tid];
+		ShaderCompiler::compile(*task.content, task.type, task.program->stage(task.type), false, task.log);
+	});
+
+	// Create native modules on this thread.
+	static const std::unordered_map<ShaderType, std::string> typeNames = {
+		{ShaderType::VERTEX, "Vertex"},
+		{ShaderType::FRAGMENT, "Fragment"},
+		{ShaderType::TESSCONTROL, "Tessellation control"},
+		{ShaderType::TESSEVAL, "Tessellation evaluation"},
+		{ShaderType::COMPUTE, "Compute"},
+	};
+	for(StageTask& task : tasks){
+		if(task.log.empty() && !ShaderCompiler::createModule(task.program->stage(task.type))){
+			task.log = "Unable to create shader module.";
+		}
+		if(!task.log.empty()) {
+			Log::error("GPU: %s shader (for %s) failed to compile:\n%s", typeNames.at(task.type).c_str(), task.program->name().c_str(), task.log.c_str() );
+			assert(false);
+		}
+	}
+	_metrics.programs += programs.size();
+
+	const auto end = std::chrono::steady_clock::now();
+	const double duration = std::chrono::duration<double, std::milli>(end - start).count();
+	const ShaderCompiler::CacheStatistics statsAfter = ShaderCompiler::cacheStatistics();
+	const double serialDuration = (statsAfter.hitTime + statsAfter.missTime) - (statsBefore.hitTime + statsBefore.missTime);
+	Log::info("GPU: Compiled %u stages for %u programs in %.1fms (%.1fms of compilation work across threads).", (uint)tasks.size(), (uint)programs.size(), duration, serialDuration);
+}
+
+void GPU::prewarmPipelines(const std::vector<Program*> & programs){
+	_context.pipelineCache.prewarm(programs);
+}
+
 void GPU::bindProgram(const Program & program){
 	if(program.type() == Program::Type::COMPUTE){
 		_state.computeProgram = (Program*)&program;
@@ -801,8 +875,8 @@ void GPU::uploadTexture(const Texture & texture) {
 	size_t currentOffset = 0;
 	std::vector<size_t> imageOffsets(texture.images.size());
 
-	// Transfer the complete CPU image data to a staging buffer, handling conversion..
-	Buffer transferBuffer(totalSize, BufferType::CPUTOGPU, "ImageUpload");
+	// Transfer the complete CPU image data to staging memory, handling conversion..
+	const StagingAllocator::Allocation staging = _context.stagingAllocator.allocate(totalSize);
 
 	// \todo Could handle float values as a special case converted on the CPU.
 	{
@@ -811,10 +885,11 @@ void GPU::uploadTexture(const Texture & texture) {
 		for(const auto & img: texture.images) {
 			imageOffsets[i] = currentOffset;
 			const size_t compCount = img.pixels.size() * compSize;
-			std::memcpy(transferBuffer.gpu->mapped + currentOffset, img.pixels.data(), compCount);
+			std::memcpy(staging.data + currentOffset, img.pixels.data(), compCount);
 			currentOffset += compCount;
 			++i;
 		}
+		_context.stagingAllocator.flush(staging, totalSize);
 		// If destination is not 8UB or compressed, we need to use an intermediate 8UB texture and convert
 		// to destination format using blit.
 		if(!is8UB && !isCompressed){
@@ -838,9 +913,10 @@ void GPU::uploadTexture(const Texture & texture) {
 
 	// How many images in the mip level (for arrays and cubes)
 	const uint layers = texture.shape == TextureShape::D3 ? 1u : texture.depth;
-	// Copy operation for each mip level that is available on the CPU.
+	// Copy region for each mip level that is available on the CPU.
 	size_t currentImg = 0;
 	currentOffset = 0;
+	std::vector<VkBufferImageCopy> regions;
 
 	for(uint mid = 0; mid < texture.levels; ++mid) {
 		// How deep is the image for 3D textures.
@@ -849,8 +925,8 @@ void GPU::uploadTexture(const Texture & texture) {
 		const uint h = std::max<uint>(texture.height >> mid, 1u);
 
 		// Perform copy for this mip level.
-		VkBufferImageCopy region = {};
-		region.bufferOffset = currentOffset;
+		VkBufferImageCopy& region = regions.emplace_back();
+		region.bufferOffset = staging.offset + currentOffset;
 		region.bufferRowLength = 0; // Tightly packed.
 		region.bufferImageHeight = 0; // Tightly packed.
 		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -861,9 +937,6 @@ void GPU::uploadTexture(const Texture & texture) {
 		region.imageOffset = {0, 0, 0};
 		region.imageExtent = { (uint32_t)w, (uint32_t)h, (uint32_t)d};
 
-		// Copy to the intermediate texture.
-		vkCmdCopyBufferToImage(commandBuffer, transferBuffer.gpu->buffer, dstTexture->gpu->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
 		const uint imageCount = texture.shape == TextureShape::D3 ? d : layers;
 		currentImg += imageCount;
 
@@ -882,6 +955,8 @@ void GPU::uploadTexture(const Texture & texture) {
 		}
 
 	}
+	// Copy all levels at once.
+	vkCmdCopyBufferToImage(commandBuffer, staging.buffer->gpu->buffer, dstTexture->gpu->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, uint32_t(regions.size()), regions.data());
 
 	// If we used an intermediate texture, blit from it to the destination. This will handle format conversion.
 	if(dstTexture != &texture){
@@ -949,6 +1024,116 @@ void GPU::downloadTextureSync(Texture & texture, int level) {
 
 }
 
+/** Build copy regions for rectangles of the first mip level of a texture, tightly packed in a buffer.
+ \param texture the texture
+ \param regions the rectangles, as (x, y, width, height) in pixels
+ \param texelSize the size of a texel in bytes
+ \param bufferOffset offset of the first region in the buffer
+ \param copies will contain one copy per rectangle
+ \return the total size of the rectangles in bytes, or 0 if a rectangle is outside the texture
+ */
+static size_t buildRegionCopies(const Texture & texture, const std::vector<glm::uvec4> & regions, uint texelSize, size_t bufferOffset, std::vector<VkBufferImageCopy> & copies){
+	const uint layers = texture.shape == TextureShape::D3 ? 1u : texture.depth;
+	const uint depth = texture.shape == TextureShape::D3 ? texture.depth : 1u;
+	size_t size = 0u;
+	copies.clear();
+	copies.reserve(regions.size());
+	for(const glm::uvec4& rect : regions){
+		if(rect.x + rect.z > texture.width || rect.y + rect.w > texture.height){
+			return 0u;
+		}
+		VkBufferImageCopy& region = copies.emplace_back();
+		region.bufferOffset = bufferOffset + size;
+		region.bufferRowLength = 0; // Tightly packed.
+		region.bufferImageHeight = 0; // Tightly packed.
+		region.imageSubresource.aspectMask = texture.gpu->aspect;
+		region.imageSubresource.mipLevel = 0;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = uint32_t(layers);
+		region.imageOffset = { int32_t(rect.x), int32_t(rect.y), 0 };
+		region.imageExtent = { rect.z, rect.w, (uint32_t)depth };
+		size += size_t(rect.z) * size_t(rect.w) * size_t(depth) * size_t(layers) * texelSize;
+	}
+	return size;
+}
+
+void GPU::uploadTextureRegions(const Texture & texture, const std::vector<glm::uvec4> & regions, const std::vector<char> & data) {
+	if(!texture.gpu) {
+		Log::error("GPU: Uninitialized GPU texture.");
+		return;
+	}
+	const uint texelSize = VkUtils::getTexelSize(texture.gpu->typedFormat);
+	if(texelSize == 0u || (texture.gpu->aspect & VK_IMAGE_ASPECT_STENCIL_BIT)) {
+		Log::error("GPU: Unsupported upload format.");
+		return;
+	}
+	if(regions.empty()){
+		return;
+	}
+	// Get the expected size first, copies are then placed in the staging allocation.
+	std::vector<VkBufferImageCopy> copies;
+	const size_t size = buildRegionCopies(texture, regions, texelSize, 0u, copies);
+	if(size == 0u || data.size() != size) {
+		Log::error("GPU: Unexpected regions or amount of data for texture upload.");
+		return;
+	}
+
+	const StagingAllocator::Allocation staging = _context.stagingAllocator.allocate(size);
+	std::memcpy(staging.data, data.data(), size);
+	_context.stagingAllocator.flush(staging, size);
+	buildRegionCopies(texture, regions, texelSize, staging.offset, copies);
+
+	const uint layers = texture.shape == TextureShape::D3 ? 1u : texture.depth;
+	VkCommandBuffer commandBuffer = _context.getUploadCommandBuffer();
+	VkUtils::imageLayoutBarrier(commandBuffer, *(texture.gpu), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, 1, 0, layers);
+	vkCmdCopyBufferToImage(commandBuffer, staging.buffer->gpu->buffer, texture.gpu->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, uint32_t(copies.size()), copies.data());
+	VkUtils::imageLayoutBarrier(commandBuffer, *(texture.gpu), texture.gpu->defaultLayout, 0, 1, 0, layers);
+	++_metrics.uploads;
+}
+
+bool GPU::downloadTextureRegionsSync(const Texture & texture, const std::vector<glm::uvec4> & regions, std::vector<char> & data) {
+	if(!texture.gpu) {
+		Log::error("GPU: Uninitialized GPU texture.");
+		return false;
+	}
+	const uint texelSize = VkUtils::getTexelSize(texture.gpu->typedFormat);
+	if(texelSize == 0u || (texture.gpu->aspect & VK_IMAGE_ASPECT_STENCIL_BIT)) {
+		Log::error("GPU: Unsupported download format.");
+		return false;
+	}
+	// Download will take place on an auxiliary command buffer, so the texture should be in its default layout.
+	for(const VkImageLayout& lay : texture.gpu->layouts[0]){
+		if(lay != texture.gpu->defaultLayout){
+			Log::error("GPU: Texture should be in its default layout state.");
+			return false;
+		}
+	}
+	data.clear();
+	if(regions.empty()){
+		return true;
+	}
+	std::vector<VkBufferImageCopy> copies;
+	const size_t size = buildRegionCopies(texture, regions, texelSize, 0u, copies);
+	if(size == 0u) {
+		Log::error("GPU: Download regions outside of the texture.");
+		return false;
+	}
+
+	const uint layers = texture.shape == TextureShape::D3 ? 1u : texture.depth;
+	Buffer transferBuffer(size, BufferType::GPUTOCPU, "Download");
+
+	VkCommandBuffer commandBuffer = VkUtils::beginSyncOperations(_context);
+	VkUtils::imageLayoutBarrier(commandBuffer, *(texture.gpu), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, 0, 1, 0, layers);
+	vkCmdCopyImageToBuffer(commandBuffer, texture.gpu->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, transferBuffer.gpu->buffer, uint32_t(copies.size()), copies.data());
+	VkUtils::imageLayoutBarrier(commandBuffer, *(texture.gpu), texture.gpu->defaultLayout, 0, 1, 0, layers);
+	VkUtils::endSyncOperations(commandBuffer, _context);
+
+	data.resize(size);
+	transferBuffer.download(size, reinterpret_cast<uchar*>(data.data()), 0);
+	++_metrics.downloads;
+	return true;
+}
+
 GPUAsyncTask GPU::downloadTextureAsync(const Texture& texture, const glm::uvec2& offset, const glm::uvec2& size, uint layerCount, std::function<void(const Texture&)> callback){
 	GPU::unbindFramebufferIfNeeded();
 	
@@ -1123,6 +1308,25 @@ void GPU::clearDepth(const Texture & texture, float depth){
 	VkUtils::textureLayoutBarrier(commandBuffer, texture, texture.gpu->defaultLayout);
 }
 
+void GPU::clearDepthRegion(float depth, int x, int y, int w, int h){
+	if(_state.pass.depthStencil == nullptr){
+		Log::error("GPU: No depth attachment bound.");
+		return;
+	}
+	// Clear inside the render pass, the rest of the attachment is preserved.
+	VkClearAttachment attachment = {};
+	attachment.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+	attachment.clearValue.depthStencil.depth = depth;
+	attachment.clearValue.depthStencil.stencil = 0u;
+
+	VkClearRect rect = {};
+	rect.rect.offset = { int32_t(x), int32_t(y) };
+	rect.rect.extent = { uint32_t(w), uint32_t(h) };
+	rect.baseArrayLayer = 0;
+	rect.layerCount = 1;
+	vkCmdClearAttachments(_context.getRenderCommandBuffer(), 1, &attachment, 1, &rect);
+}
+
 void GPU::setupBuffer(Buffer & buffer) {
 	if(buffer.gpu) {
 		buffer.gpu->clean();
@@ -1194,6 +1398,7 @@ void GPU::uploadBuffer(const Buffer & buffer, size_t size, uchar * data, size_t
 		Log::warning("GPU: Not enough allocated space to upload.");
 		return;
 	}
+	_metrics.bufferUploadBytes += size;
 
 	// If the buffer is visible from the CPU side, we don't need an intermediate staging buffer.
 	if(buffer.gpu->mappable){
@@ -1206,15 +1411,10 @@ void GPU::uploadBuffer(const Buffer & buffer, size_t size, uchar * data, size_t
 		return;
 	}
 
-	// Otherwise, create a transfer buffer.
-	Buffer transferBuffer(size, BufferType::CPUTOGPU, "BufferStaging");
-	transferBuffer.upload(size, data, 0);
-	// Copy operation.
-	VkBufferCopy copyRegion = {};
-	copyRegion.srcOffset = 0;
-	copyRegion.dstOffset = offset;
-	copyRegion.size = size;
-	vkCmdCopyBuffer(_context.getUploadCommandBuffer(), transferBuffer.gpu->buffer, buffer.gpu->buffer, 1, &copyRegion);
+	// Otherwise, go through staging memory, the copy will be recorded with the others at the end of the frame.
+	const StagingAllocator::Allocation staging = _context.stagingAllocator.allocate(size);
+	std::memcpy(staging.data, data, size);
+	_context.stagingAllocator.copy(staging, buffer, offset, size);
 
 }
 
@@ -1279,8 +1479,8 @@ void GPU::setupMesh(Mesh & mesh) {
 	totalSize += 3 * mesh.colors.size();
 	totalSize *= sizeof(float);
 
-	// Create a staging buffer to host the geometry data (to avoid creating a staging buffer for each sub-upload).
-	std::vector<uchar> vertexBufferData(totalSize);
+	// Write the geometry data directly in staging memory (to avoid creating a staging buffer for each sub-upload).
+	const StagingAllocator::Allocation staging = _context.stagingAllocator.allocate(totalSize);
 
 	GPUMesh::State& state = mesh.gpu->state;
 	state.attributes.clear();
@@ -1328,7 +1528,7 @@ void GPU::setupMesh(Mesh & mesh) {
 		state.offsets.emplace_back(offset);
 		// Copy data.
 		const size_t size = elementSize * attrib.size;
-		std::memcpy(vertexBufferData.data() + offset, attrib.data, size);
+		std::memcpy(staging.data + offset, attrib.data, size);
 		offset += size;
 		++bindingIndex;
 		++location;
@@ -1341,7 +1541,7 @@ void GPU::setupMesh(Mesh & mesh) {
 	mesh.gpu->vertexBuffer.reset(new Buffer(totalSize, BufferType::VERTEX, "Vertices " + mesh.name()));
 	mesh.gpu->indexBuffer.reset(new Buffer(inSize, BufferType::INDEX, "Indices " + mesh.name()));
 
-	mesh.gpu->vertexBuffer->upload(totalSize, vertexBufferData.data(), 0);
+	_context.stagingAllocator.copy(staging, *mesh.gpu->vertexBuffer, 0, totalSize);
 	mesh.gpu->indexBuffer->upload(inSize, reinterpret_cast<unsigned char *>(mesh.indices.data()), 0);
 
 	// Replicate the buffer as many times as needed for each attribute.
@@ -1518,6 +1718,8 @@ void GPU::beginFrameCommandBuffers() {
 	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
 	VkCommandBuffer& commandBuffer = _context.getRenderCommandBuffer();
 	VkCommandBuffer& commandBufferUpload = _context.getUploadCommandBuffer();
+	// Previous commands using this frame staging memory have completed.
+	_context.stagingAllocator.resetFrame();
 	VK_RET(vkBeginCommandBuffer(commandBuffer, &beginInfo));
 	VK_RET(vkBeginCommandBuffer(commandBufferUpload, &beginInfo));
 }
@@ -1525,6 +1727,7 @@ void GPU::beginFrameCommandBuffers() {
 void GPU::submitFrameCommandBuffers() {
 	VkCommandBuffer& commandBuffer = _context.getRenderCommandBuffer();
 	VkCommandBuffer& commandBufferUpload = _context.getUploadCommandBuffer();
+	_context.stagingAllocator.recordCopies(commandBufferUpload);
 	VK_RET(vkEndCommandBuffer(commandBuffer));
 	VK_RET(vkEndCommandBuffer(commandBufferUpload));
 
@@ -1756,6 +1959,9 @@ void GPU::blit(const Texture & src, Texture & dst, Filter filter) {
 }
 
 void GPU::pushMarker(const std::string& label){
+	// Time the CPU work of each marked block.
+	PROFILE_BEGIN(label);
+	_context.passTimer.begin(label);
 	if(!_context.markersEnabled)
 		return;
 
@@ -1785,11 +1991,17 @@ void GPU::pushMarker(const std::string& label){
 }
 
 void GPU::popMarker(){
+	PROFILE_END();
+	_context.passTimer.end();
 	if(!_context.markersEnabled)
 		return;
 	vkCmdEndDebugUtilsLabelEXT(_context.getRenderCommandBuffer());
 }
 
+const std::vector<GPU::PassTiming>& GPU::getPassTimings(){
+	return _context.passTimer.timings();
+}
+
 void GPU::unbindFramebufferIfNeeded(){
 	if(_state.pass.depthStencil == nullptr && _state.pass.colors.empty()){
 		return;
@@ -1835,8 +2047,10 @@ void GPU::cleanup(){
 	for(auto& alloc : _context.queryAllocators){
 		alloc.second.clean();
 	}
+	_context.passTimer.clean();
 
 	_context.textureTasks.clear();
+	_context.stagingAllocator.clean();
 
 	_context.frameIndex += 100;
 	processDestructionRequests();
@@ -1864,6 +2078,8 @@ void GPU::clean(GPUTexture & tex){
 	rsc.data = tex.data;
 	rsc.frame = _context.frameIndex;
 	rsc.name = tex.name;
+	// Cached descriptor sets referencing the views shouldn't be reused.
+	_context.descriptorAllocator.invalidateCachedSets(uint64_t(tex.view));
 
 	const uint mipCount = uint(tex.views.size());
 	for(uint mid = 0; mid < mipCount; ++mid){
@@ -1872,6 +2088,7 @@ void GPU::clean(GPUTexture & tex){
 		rsc.view = tex.views[mid].mipView;
 		rsc.frame = _context.frameIndex;
 		rsc.name = tex.name;
+		_context.descriptorAllocator.invalidateCachedSets(uint64_t(rsc.view));
 
 		const uint levelCount = uint(tex.views[mid].views.size());
 		for(uint lid = 0; lid < levelCount; ++lid){
@@ -1880,6 +2097,7 @@ void GPU::clean(GPUTexture & tex){
 			rsc.view = tex.views[mid].views[lid];
 			rsc.frame = _context.frameIndex;
 			rsc.name = tex.name;
+			_context.descriptorAllocator.invalidateCachedSets(uint64_t(rsc.view));
 		}
 		tex.views[mid].views.clear();
 	}
@@ -1898,11 +2116,15 @@ void GPU::clean(GPUBuffer & buffer){
 	rsc.buffer = buffer.buffer;
 	rsc.data = buffer.data;
 	rsc.frame = _context.frameIndex;
+	// Cached descriptor sets referencing the buffer shouldn't be reused.
+	_context.descriptorAllocator.invalidateCachedSets(uint64_t(buffer.buffer));
 	--_metrics.buffers;
 }
 
 void GPU::clean(Program & program){
-	
+	// Pipelines being built ahead of use might reference this program.
+	_context.pipelineCache.cancelPrewarm();
+
 	vkDestroyPipelineLayout(_context.device, program._state.layout, nullptr);
 	// Skip the static samplers.
 	const size_t layoutCount = program._state.setLayouts.size();
@@ -1913,6 +2135,7 @@ void GPU::clean(Program & program){
 				continue;
 			}
 			VkDescriptorSetLayout& setLayout = program._state.setLayouts[lid];
+			_context.descriptorAllocator.invalidateCachedSets(uint64_t(setLayout));
 			vkDestroyDescriptorSetLayout(_context.device, setLayout, nullptr);
 		}
 	}
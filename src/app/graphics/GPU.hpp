@@ -32,6 +32,8 @@ class GPU {
 	friend class Program; ///< Access to metrics.
 	friend class Swapchain; ///< Access to texture cleanup.
 	friend class PipelineCache; ///< Access to metrics.
+	friend class StagingAllocator; ///< Access to metrics.
+	friend class DescriptorAllocator; ///< Access to metrics.
 
 public:
 
@@ -44,6 +46,9 @@ public:
 		unsigned long long buffers = 0; ///< Buffers created.
 		unsigned long long programs = 0; ///< Programs created.
 		unsigned long long pipelines = 0; ///< Pipelines created.
+		unsigned long long prewarmedPipelines = 0; ///< Pipelines created ahead of use, based on a previous run.
+		unsigned long long stagingBlocks = 0; ///< Persistent staging blocks allocated.
+		unsigned long long cachedDescriptorSets = 0; ///< Descriptor sets stored in the cache.
 
 		// Per-frame statistics.
 		unsigned long long drawCalls = 0; ///< Mesh draw call.
@@ -52,6 +57,14 @@ public:
 		unsigned long long renderPasses = 0; ///< Number of render passes.
 		unsigned long long meshBindings = 0; ///< Number of mesh bindings.
 		unsigned long long blitCount = 0; ///< Texture blitting operations.
+		unsigned long long pipelineBuilds = 0; ///< Pipelines created when first used.
+		unsigned long long stagingAllocations = 0; ///< Upload regions allocated in staging memory.
+		unsigned long long stagingBytes = 0; ///< Upload data written to staging memory.
+		unsigned long long stagingDedicated = 0; ///< Uploads too large for a staging block.
+		unsigned long long bufferUploadBytes = 0; ///< Data uploaded to buffers.
+		unsigned long long descriptorAllocations = 0; ///< Descriptor sets allocated.
+		unsigned long long descriptorWrites = 0; ///< Descriptor sets written.
+		unsigned long long descriptorCacheHits = 0; ///< Descriptor sets reused from the cache.
 
 		/// Reset metrics that are measured over one frame.
 		void resetPerFrameMetrics(){
@@ -61,8 +74,24 @@ public:
 			renderPasses = 0;
 			meshBindings = 0;
 			blitCount = 0;
+			pipelineBuilds = 0;
+			stagingAllocations = 0;
+			stagingBytes = 0;
+			stagingDedicated = 0;
+			bufferUploadBytes = 0;
+			descriptorAllocations = 0;
+			descriptorWrites = 0;
+			descriptorCacheHits = 0;
 		}
 	};
+
+	/** \brief Duration of a block delimited by pushMarker and popMarker. */
+	struct PassTiming {
+		std::string name; ///< Marker label.
+		uint depth = 0; ///< Nesting depth.
+		double gpu = 0.0; ///< GPU duration in milliseconds.
+		double cpu = 0.0; ///< CPU duration in milliseconds.
+	};
 	
 	/** Setup the GPU device in its initial state.
 	 \param appName the name of the current executable
@@ -93,6 +122,17 @@ public:
 	 */
 	static void createComputeProgram(Program & program, const std::string & computeContent, const std::string & debugInfos);
 
+	/** Create several programs, compiling all their shaders in parallel before creating the native modules.
+	 \param programs the programs to compile
+	 \param sources the shader contents of each program
+	 */
+	static void createPrograms(const std::vector<Program*> & programs, const std::vector<Program::Sources> & sources);
+
+	/** Start building on worker threads the pipelines used with the given programs in previous runs, ahead of their first use.
+	 \param programs the loaded programs
+	 */
+	static void prewarmPipelines(const std::vector<Program*> & programs);
+
 	/** Bind a program to use for rendering
 	 \param program the program to use
 	 */
@@ -161,6 +201,23 @@ public:
 	 */
 	static void downloadTextureSync(Texture & texture, int level);
 
+	/** Upload raw texel data to rectangles of the first mip level of all layers of a texture, without format conversion.
+	 \param texture the texture to fill
+	 \param regions the rectangles to fill, as (x, y, width, height) in pixels
+	 \param data tightly packed texels in the texture GPU format, region after region, and layer after layer in each region
+	 \note Compressed and combined depth-stencil formats are not supported.
+	 */
+	static void uploadTextureRegions(const Texture & texture, const std::vector<glm::uvec4> & regions, const std::vector<char> & data);
+
+	/** Download the raw texel data of rectangles of the first mip level of all layers of a texture, without format conversion.
+	 \param texture the texture to download, it should be in its default layout state
+	 \param regions the rectangles to download, as (x, y, width, height) in pixels
+	 \param data will contain tightly packed texels in the texture GPU format, region after region, and layer after layer in each region
+	 \return true if the regions could be downloaded
+	 \note The download will be performed when this function is called, after all submitted work is complete.
+	 */
+	static bool downloadTextureRegionsSync(const Texture & texture, const std::vector<glm::uvec4> & regions, std::vector<char> & data);
+
 	/** Copy a texture GPU data at this point of the frame command buffer, and download the copied data once the frame is complete.
 	 * \param texture the texture to download
 	 * \param offset (x,y) offset of the region in the texture to download, from the top-left corner
@@ -184,6 +241,15 @@ public:
 	static void clearTexture(const Texture & texture, const glm::vec4& color);
 
 	static void clearDepth(const Texture & texture, float depth);
+
+	/** Clear a region of the depth attachment bound for the current render pass.
+	 \param depth the depth value to clear with
+	 \param x the region horizontal offset, in pixels
+	 \param y the region vertical offset, in pixels
+	 \param w the region width, in pixels
+	 \param h the region height, in pixels
+	 */
+	static void clearDepthRegion(float depth, int x, int y, int w, int h);
 	
 	/** Create and allocate a GPU buffer.
 	 \param buffer the buffer to setup on the GPU
@@ -397,6 +463,9 @@ public:
 	static void pushMarker(const std::string& label);
 
 	static void popMarker();
+
+	/** \return the GPU and CPU durations of all marked blocks, for the last completed frame */
+	static const std::vector<PassTiming>& getPassTimings();
 	
 	/** \return the opaque internal GPU context. */
 	static GPUContext* getInternal();
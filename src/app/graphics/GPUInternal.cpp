@@ -53,7 +53,11 @@ std::vector<const char*> VkUtils::getRequiredInstanceExtensions(bool enableDebug
 	// Default Vulkan has no notion of surface/window. GLFW provide an implementation of the corresponding KHR extensions.
 	uint32_t glfwExtensionCount = 0;
 	const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-	std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+	std::vector<const char*> extensions;
+	// When rendering offscreen, GLFW is not initialized and no surface extension is needed.
+	if(glfwExtensions){
+		extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+	}
 	// MoltenVK is a non conforming driver, we need to enable enumeration of portability drivers.
 	if(enablePortability){
 		extensions.push_back(VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME);
@@ -119,10 +123,16 @@ bool VkUtils::getQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface, in
 		}
 		// CHeck if queue support presentation.
 		VkBool32 presentSupport = false;
-		VK_RET(vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport));
+		if(surface != VK_NULL_HANDLE){
+			VK_RET(vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport));
+		}
 		if(presentSupport) {
 			presentFamily = i;
 		}
+		// Without a surface, nothing is presented, use the graphics queue.
+		if(surface == VK_NULL_HANDLE && graphicsFamily >= 0){
+			presentFamily = graphicsFamily;
+		}
 		// If we have found both queues, exit.
 		if(graphicsFamily >= 0 && presentFamily >= 0){
 			return true;
@@ -599,6 +609,31 @@ unsigned int VkUtils::getGPULayout(Layout typedFormat, VkFormat & format) {
 	return 0;
 }
 
+uint VkUtils::getTexelSize(Layout typedFormat) {
+	switch(typedFormat){
+		case Layout::R8: case Layout::R8_SNORM: case Layout::R8UI:
+			return 1u;
+		case Layout::RG8: case Layout::RG8_SNORM: case Layout::RG8I: case Layout::RG8UI:
+		case Layout::R16: case Layout::R16_SNORM: case Layout::R16F: case Layout::R16I: case Layout::R16UI:
+		case Layout::RGB5_A1: case Layout::DEPTH_COMPONENT16:
+			return 2u;
+		case Layout::RGBA8: case Layout::BGRA8: case Layout::SRGB8_ALPHA8: case Layout::SBGR8_ALPHA8:
+		case Layout::RGBA8_SNORM: case Layout::RGBA8I: case Layout::RGBA8UI:
+		case Layout::RG16: case Layout::RG16_SNORM: case Layout::RG16F: case Layout::RG16I: case Layout::RG16UI:
+		case Layout::R32F: case Layout::R32I: case Layout::R32UI:
+		case Layout::A2_BGR10: case Layout::A2_RGB10: case Layout::DEPTH_COMPONENT32F:
+			return 4u;
+		case Layout::RGBA16: case Layout::RGBA16F: case Layout::RGBA16I: case Layout::RGBA16UI:
+		case Layout::RG32F: case Layout::RG32I: case Layout::RG32UI:
+			return 8u;
+		case Layout::RGBA32F: case Layout::RGBA32I: case Layout::RGBA32UI:
+			return 16u;
+		default:
+			break;
+	}
+	return 0u;
+}
+
 glm::uvec2 VkUtils::copyTextureRegionToBuffer(VkCommandBuffer& commandBuffer, const Texture & srcTexture, std::shared_ptr<Buffer> & dstBuffer, uint mipStart, uint mipCount, uint layerStart, uint layerCount, const glm::uvec2& offset, const glm::uvec2& size){
 
 	const Layout formats[5] = {Layout(0), Layout::R8, Layout::RG8, Layout::RGBA8 /* no 3 channels format */, Layout::RGBA8};
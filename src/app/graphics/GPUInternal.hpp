@@ -4,8 +4,10 @@
 #include "graphics/GPUObjects.hpp"
 #include "graphics/DescriptorAllocator.hpp"
 #include "graphics/QueryAllocator.hpp"
+#include "graphics/PassTimer.hpp"
 #include "graphics/PipelineCache.hpp"
 #include "graphics/SamplerLibrary.hpp"
+#include "graphics/StagingAllocator.hpp"
 #include "graphics/TextureLibrary.hpp"
 #include "resources/Buffer.hpp"
 
@@ -85,7 +87,9 @@ struct GPUContext {
 	VkQueue presentQueue= VK_NULL_HANDLE; ///< Presentation submission queue.
 	DescriptorAllocator descriptorAllocator; ///< Descriptor sets common allocator.
 	std::unordered_map<GPUQuery::Type, QueryAllocator> queryAllocators; ///< Per-type query buffered allocators.
+	PassTimer passTimer; ///< Debug marker blocks timing.
 	PipelineCache pipelineCache; ///< Pipeline cache and creation.
+	StagingAllocator stagingAllocator; ///< Per-frame staging memory for uploads.
 	SamplerLibrary samplerLibrary; ///< List of static samplers shared by all programs.
 	TextureLibrary textureLibrary; ///< List of static samplers shared by all programs.
 
@@ -172,9 +176,9 @@ namespace VkUtils {
 
 	/** Query the graphics and present queue families indices.
 	 * \param device the physical device handle
-	 * \param surface the display surface
+	 * \param surface the display surface, or VK_NULL_HANDLE for offscreen rendering
 	 * \param graphicsFamily will contain the graphics queue family index
-	 * \param presentFamily will contain the present queue family index
+	 * \param presentFamily will contain the present queue family index (the graphics one when offscreen)
 	 * \return true if query successful
 	 */
 	bool getQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface, int & graphicsFamily, int & presentFamily);
@@ -270,6 +274,12 @@ namespace VkUtils {
 	 */
 	unsigned int getGPULayout(Layout typedFormat, VkFormat & format);
 
+	/** Size of a texel when copied to or from a buffer, for formats that can be transferred without conversion.
+	 * \param typedFormat the texture layout
+	 * \return the texel size in bytes, or 0 for compressed and combined depth-stencil formats
+	 */
+	uint getTexelSize(Layout typedFormat);
+
 	/** Copy a texture region to a transfer buffer allocated internally.
 	 * \param commandBuffer the command buffer to record the operation on
 	 * \param srcTexture the source texture
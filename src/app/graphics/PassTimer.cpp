@@ -0,0 +1,97 @@
+#include "graphics/PassTimer.hpp"
+#include "graphics/GPUInternal.hpp"
+
+void PassTimer::init(uint count){
+	GPUContext* context = GPU::getInternal();
+	_count = count;
+	_queries.init(GPUQuery::Type::TIME_ELAPSED, count);
+	_frames.resize(context->frameCount);
+}
+
+void PassTimer::begin(const std::string& label){
+	if(!_active){
+		return;
+	}
+	GPUContext* context = GPU::getInternal();
+	std::vector<Record>& records = _frames[context->swapIndex];
+	if(records.size() >= _count){
+		// Keep the nesting consistent, but don't time the block.
+		_openRecords.push_back(_count);
+		return;
+	}
+
+	Record& record = records.emplace_back();
+	record.name = label;
+	record.depth = uint(_openRecords.size());
+	record.query = _queries.allocate();
+	vkCmdWriteTimestamp(context->getRenderCommandBuffer(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _queries.getWritePool(), record.query);
+	record.cpuStart = std::chrono::steady_clock::now();
+	_openRecords.push_back(uint(records.size() - 1u));
+}
+
+void PassTimer::end(){
+	if(!_active || _openRecords.empty()){
+		return;
+	}
+	const uint rid = _openRecords.back();
+	_openRecords.pop_back();
+	if(rid >= _count){
+		return;
+	}
+
+	GPUContext* context = GPU::getInternal();
+	Record& record = _frames[context->swapIndex][rid];
+	vkCmdWriteTimestamp(context->getRenderCommandBuffer(), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _queries.getWritePool(), record.query + 1u);
+	record.cpu = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - record.cpuStart).count();
+}
+
+void PassTimer::startFrame(){
+	GPUContext* context = GPU::getInternal();
+	std::vector<Record>& records = _frames[context->swapIndex];
+
+	// The frame that last used this pool is complete, retrieve its timestamps.
+	if(!records.empty()){
+		const uint queryCount = 2u * uint(records.size());
+		// Value and availability for each timestamp.
+		std::vector<uint64_t> data(2u * queryCount, 0u);
+		// Blocks interrupted by a resize might be missing their timestamps, don't wait for them.
+		vkGetQueryPoolResults(context->device, _queries.getWritePool(), 0, queryCount, data.size() * sizeof(uint64_t), data.data(), 2u * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+		_timings.resize(records.size());
+		for(size_t rid = 0; rid < records.size(); ++rid){
+			const Record& record = records[rid];
+			GPU::PassTiming& timing = _timings[rid];
+			timing.name = record.name;
+			timing.depth = record.depth;
+			timing.cpu = record.cpu;
+			timing.gpu = 0.0;
+
+			const uint64_t* start = &data[2u * record.query];
+			const uint64_t* end = &data[2u * (record.query + 1u)];
+			// Ignore missing or inconsistent timestamps.
+			if(start[1] != 0u && end[1] != 0u && start[0] <= end[0]){
+				timing.gpu = context->timestep * double(end[0] - start[0]) * 1e-6;
+			}
+		}
+	}
+	records.clear();
+	_openRecords.clear();
+	_queries.resetAllocations();
+
+	_queries.resetWritePool();
+	_active = true;
+}
+
+void PassTimer::endFrame(){
+	while(!_openRecords.empty()){
+		end();
+	}
+	_active = false;
+}
+
+void PassTimer::clean(){
+	_queries.clean();
+	_frames.clear();
+	_openRecords.clear();
+	_active = false;
+}
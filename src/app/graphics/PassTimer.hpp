@@ -0,0 +1,61 @@
+#pragma once
+
+#include "core/Common.hpp"
+#include "graphics/GPU.hpp"
+#include "graphics/QueryAllocator.hpp"
+
+#include <chrono>
+
+/** \brief Measure the GPU and CPU duration of each debug marker block.
+ * Timestamps are written in per-frame query pools, and read back once the frame that used a pool has completed,
+ * just before the pool is reused. Timings are thus available with a delay of a few frames.
+ * \ingroup Graphics
+ */
+class PassTimer {
+public:
+
+	/** Setup the timer.
+	 * \param count the maximum number of timed blocks per frame
+	 */
+	void init(uint count);
+
+	/** Start timing a block on the current render command buffer.
+	 * \param label the block name
+	 */
+	void begin(const std::string& label);
+
+	/** End the last started block. */
+	void end();
+
+	/** Retrieve the timings of the last frame that used the current pool, and reset the pool for the new frame.
+	 * The frame command buffers should have completed.
+	 */
+	void startFrame();
+
+	/** Close blocks still open at the end of the frame, no block can be timed until the next frame starts. */
+	void endFrame();
+
+	/** \return the timings of the last completed frame */
+	const std::vector<GPU::PassTiming>& timings() const { return _timings; }
+
+	/** Clean the query pools. */
+	void clean();
+
+private:
+
+	/** \brief Block timed in a frame. */
+	struct Record {
+		std::string name; ///< Block name.
+		std::chrono::steady_clock::time_point cpuStart; ///< CPU start time.
+		double cpu = 0.0; ///< CPU duration in milliseconds.
+		uint depth = 0; ///< Nesting depth.
+		uint query = 0; ///< Offset of the timestamps pair in the pool.
+	};
+
+	QueryAllocator _queries; ///< Per-frame timestamp pools.
+	std::vector<std::vector<Record>> _frames; ///< Blocks timed in each frame in flight.
+	std::vector<uint> _openRecords; ///< Blocks currently open in the current frame.
+	std::vector<GPU::PassTiming> _timings; ///< Timings of the last completed frame.
+	uint _count = 0; ///< Maximum number of blocks per frame.
+	bool _active = false; ///< Has the current frame pool been reset.
+};
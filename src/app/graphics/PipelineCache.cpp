@@ -5,14 +5,100 @@
 
 #include "core/System.hpp"
 
+#include "core/ScenePack.hpp"
+
+#include <chrono>
+
 #define PIPELINE_CACHE_FILE "pipeline_cache_vulkan.bin"
+#define PIPELINE_RECORDS_FILE "pipeline_cache_states.bin"
+
+/// Identify pipeline cache files, bump the version when the layout of records changes.
+static const uint32_t PIPELINE_CACHE_MAGIC = 0x32313158;
+static const uint32_t PIPELINE_CACHE_VERSION = 1u;
+
+/// Key of the pipeline descriptions file, changes with the layout of the GPU state.
+static const uint64_t PIPELINE_RECORDS_KEY = (uint64_t(offsetof(GPUState, sentinel)) << 32u) | uint64_t(PIPELINE_CACHE_VERSION);
+
+/** \brief Header written before the Vulkan cache data, to reject data from another device or driver. */
+struct PipelineCacheFileHeader {
+	uint32_t magic; ///< File identifier.
+	uint32_t version; ///< File version.
+	uint32_t vendorID; ///< Device vendor.
+	uint32_t deviceID; ///< Device identifier.
+	uint32_t driverVersion; ///< Driver version.
+	uint8_t driverUUID[VK_UUID_SIZE]; ///< Driver identifier.
+	uint8_t pipelineCacheUUID[VK_UUID_SIZE]; ///< Cache compatibility identifier.
+	uint64_t dataSize; ///< Size of the Vulkan data following the header.
+	uint64_t dataHash; ///< Hash of the Vulkan data, to detect corruption.
+};
+
+/** \brief Saved pipeline description, variable-size data is stored in separate sections. */
+struct PipelineRecordInfos {
+	unsigned char state[offsetof(GPUState, sentinel)]; ///< Fixed-function state.
+	uint32_t compute; ///< Is this a compute pipeline.
+	uint32_t attributeCount; ///< Number of vertex attributes.
+	uint32_t bindingCount; ///< Number of vertex bindings.
+	uint32_t colorCount; ///< Number of color attachments.
+	VkFormat depth; ///< Depth attachment format.
+	VkFormat stencil; ///< Stencil attachment format.
+};
+
+/** Build the header expected for the current device.
+ * \param context the GPU context
+ * \return the expected header, with no data
+ */
+static PipelineCacheFileHeader currentCacheHeader(GPUContext* context){
+	VkPhysicalDeviceIDProperties idProperties{};
+	idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+	VkPhysicalDeviceProperties2 properties{};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties.pNext = &idProperties;
+	vkGetPhysicalDeviceProperties2(context->physicalDevice, &properties);
+
+	PipelineCacheFileHeader header{};
+	header.magic = PIPELINE_CACHE_MAGIC;
+	header.version = PIPELINE_CACHE_VERSION;
+	header.vendorID = properties.properties.vendorID;
+	header.deviceID = properties.properties.deviceID;
+	header.driverVersion = properties.properties.driverVersion;
+	memcpy(header.driverUUID, idProperties.driverUUID, VK_UUID_SIZE);
+	memcpy(header.pipelineCacheUUID, properties.properties.pipelineCacheUUID, VK_UUID_SIZE);
+	return header;
+}
 
 void PipelineCache::init(){
+	loadFromDisk();
+}
+
+void PipelineCache::loadFromDisk(){
 	GPUContext* context = GPU::getInternal();
 
+	// Vulkan cache, only used if created by the same device and driver.
+	size_t fileSize = 0;
+	char * fileData = nullptr;
+	if(fs::exists(PIPELINE_CACHE_FILE)){
+		fileData = System::loadData(PIPELINE_CACHE_FILE, fileSize);
+	}
+	const PipelineCacheFileHeader expected = currentCacheHeader(context);
+	const char* pipelineData = nullptr;
 	size_t pipelineSize = 0;
-	char * pipelineData = System::loadData(PIPELINE_CACHE_FILE, pipelineSize);
-	
+	if(fileData && fileSize >= sizeof(PipelineCacheFileHeader)){
+		PipelineCacheFileHeader header;
+		memcpy(&header, fileData, sizeof(PipelineCacheFileHeader));
+		const char* data = fileData + sizeof(PipelineCacheFileHeader);
+		const bool sameDevice = header.magic == expected.magic && header.version == expected.version
+			&& header.vendorID == expected.vendorID && header.deviceID == expected.deviceID && header.driverVersion == expected.driverVersion
+			&& memcmp(header.driverUUID, expected.driverUUID, VK_UUID_SIZE) == 0
+			&& memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+		const bool validData = header.dataSize == fileSize - sizeof(PipelineCacheFileHeader) && header.dataHash == System::hash64(data, header.dataSize);
+		if(sameDevice && validData){
+			pipelineData = data;
+			pipelineSize = header.dataSize;
+		} else {
+			Log::info("GPU: Discarding pipeline cache from %s.", sameDevice ? "a corrupted file" : "another device or driver");
+		}
+	}
+
 	VkPipelineCacheCreateInfo cacheInfos{};
 	cacheInfos.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
 	cacheInfos.flags = 0;
@@ -20,32 +106,174 @@ void PipelineCache::init(){
 	cacheInfos.pInitialData = pipelineData;
 
 	VK_RET(vkCreatePipelineCache(context->device, &cacheInfos, nullptr, &_vulkanCache));
-	free(pipelineData);
+	delete[] fileData;
+
+	// Pipeline descriptions.
+	ScenePack pack;
+	if(!fs::exists(PIPELINE_RECORDS_FILE) || !pack.load(PIPELINE_RECORDS_FILE, PIPELINE_RECORDS_KEY)){
+		return;
+	}
+	std::vector<PipelineRecordInfos> infos;
+	std::vector<std::string> programs;
+	std::vector<VkVertexInputAttributeDescription> attributes;
+	std::vector<VkVertexInputBindingDescription> bindings;
+	std::vector<VkFormat> colors;
+	if(!pack.read(ScenePack::PIPELINE_RECORDS, infos) || !pack.readStrings(ScenePack::PIPELINE_PROGRAM_NAMES, programs)
+	   || !pack.read(ScenePack::PIPELINE_ATTRIBUTES, attributes) || !pack.read(ScenePack::PIPELINE_BINDINGS, bindings)
+	   || !pack.read(ScenePack::PIPELINE_COLOR_FORMATS, colors) || infos.size() != programs.size()){
+		Log::warning("GPU: Invalid pipeline states file.");
+		return;
+	}
+	size_t attributeStart = 0;
+	size_t bindingStart = 0;
+	size_t colorStart = 0;
+	for(size_t rid = 0; rid < infos.size(); ++rid){
+		const PipelineRecordInfos& info = infos[rid];
+		if(attributeStart + info.attributeCount > attributes.size() || bindingStart + info.bindingCount > bindings.size() || colorStart + info.colorCount > colors.size()){
+			Log::warning("GPU: Invalid pipeline states file.");
+			_records.clear();
+			return;
+		}
+		Record& record = _records.emplace_back();
+		record.program = programs[rid];
+		record.compute = info.compute != 0u;
+		memcpy(record.state.data(), info.state, FIXED_STATE_SIZE);
+		record.signature.mesh.attributes.assign(attributes.begin() + attributeStart, attributes.begin() + attributeStart + info.attributeCount);
+		record.signature.mesh.bindings.assign(bindings.begin() + bindingStart, bindings.begin() + bindingStart + info.bindingCount);
+		record.signature.colors.assign(colors.begin() + colorStart, colors.begin() + colorStart + info.colorCount);
+		record.signature.depth = info.depth;
+		record.signature.stencil = info.stencil;
+		attributeStart += info.attributeCount;
+		bindingStart += info.bindingCount;
+		colorStart += info.colorCount;
+	}
 }
 
-VkPipeline PipelineCache::getGraphicsPipeline(const GPUState & state){
-	// Compute the hash (used in all cases).
-	const uint64_t hash = System::hash64( &state, offsetof( GPUState, sentinel ) );
-	
-	// First check if we already have pipelines for the current program.
-	auto sameProgramPipelinesIt = _graphicPipelines.find(state.graphicsProgram);
+void PipelineCache::saveToDisk(){
+	GPUContext* context = GPU::getInternal();
 
-	const bool programReloaded = state.graphicsProgram->reloaded(true);
-	// We have to invalidate program pipelines after a reload, as the layout might change.
-	if(sameProgramPipelinesIt != _graphicPipelines.end() && programReloaded){
-		// Delete the pipelines corresponding to this program.
-		// If we immediatly destroy a pipeline that was in use earlier in the frame, we might get a crash.
-		// So instead schedule the deletion and remove the records.
-		for(auto& pipelineInfo : sameProgramPipelinesIt->second){
+	// Vulkan cache.
+	size_t pipelineSize = 0;
+	VK_RET(vkGetPipelineCacheData(context->device, _vulkanCache, &pipelineSize, nullptr));
+	if(pipelineSize != 0){
+		char* fileData = new char[sizeof(PipelineCacheFileHeader) + pipelineSize];
+		char* pipelineData = fileData + sizeof(PipelineCacheFileHeader);
+		VK_RET(vkGetPipelineCacheData(context->device, _vulkanCache, &pipelineSize, pipelineData));
+		PipelineCacheFileHeader header = currentCacheHeader(context);
+		header.dataSize = pipelineSize;
+		header.dataHash = System::hash64(pipelineData, pipelineSize);
+		memcpy(fileData, &header, sizeof(PipelineCacheFileHeader));
+		System::saveData(PIPELINE_CACHE_FILE, fileData, sizeof(PipelineCacheFileHeader) + pipelineSize);
+		delete[] fileData;
+	}
+
+	// Pipeline descriptions.
+	std::vector<PipelineRecordInfos> infos;
+	std::vector<std::string> programs;
+	std::vector<VkVertexInputAttributeDescription> attributes;
+	std::vector<VkVertexInputBindingDescription> bindings;
+	std::vector<VkFormat> colors;
+	for(const Record& record : _records){
+		PipelineRecordInfos& info = infos.emplace_back();
+		memcpy(info.state, record.state.data(), FIXED_STATE_SIZE);
+		info.compute = record.compute ? 1u : 0u;
+		info.attributeCount = (uint32_t)record.signature.mesh.attributes.size();
+		info.bindingCount = (uint32_t)record.signature.mesh.bindings.size();
+		info.colorCount = (uint32_t)record.signature.colors.size();
+		info.depth = record.signature.depth;
+		info.stencil = record.signature.stencil;
+		programs.push_back(record.program);
+		attributes.insert(attributes.end(), record.signature.mesh.attributes.begin(), record.signature.mesh.attributes.end());
+		bindings.insert(bindings.end(), record.signature.mesh.bindings.begin(), record.signature.mesh.bindings.end());
+		colors.insert(colors.end(), record.signature.colors.begin(), record.signature.colors.end());
+	}
+	ScenePack::Writer writer;
+	writer.add(ScenePack::PIPELINE_RECORDS, infos);
+	writer.addStrings(ScenePack::PIPELINE_PROGRAM_NAMES, programs);
+	writer.add(ScenePack::PIPELINE_ATTRIBUTES, attributes);
+	writer.add(ScenePack::PIPELINE_BINDINGS, bindings);
+	writer.add(ScenePack::PIPELINE_COLOR_FORMATS, colors);
+	writer.save(PIPELINE_RECORDS_FILE, PIPELINE_RECORDS_KEY);
+}
+
+bool PipelineCache::Signature::isEquivalent(const GPUState& state) const {
+	if(!mesh.isEquivalent(state.mesh->state)){
+		return false;
+	}
+	if(colors.size() != state.pass.colors.size()){
+		return false;
+	}
+	if((depth != VK_FORMAT_UNDEFINED) != (state.pass.depthStencil != nullptr)){
+		return false;
+	}
+	if(state.pass.depthStencil && state.pass.depthStencil->gpu->format != depth){
+		return false;
+	}
+	for(uint cid = 0; cid < colors.size(); ++cid){
+		if(state.pass.colors[cid]->gpu->format != colors[cid]){
+			return false;
+		}
+	}
+	return true;
+}
+
+bool PipelineCache::Signature::isEquivalent(const Signature& other) const {
+	return mesh.isEquivalent(other.mesh) && colors == other.colors && depth == other.depth && stencil == other.stencil;
+}
+
+void PipelineCache::discardPipelines(const Program* program){
+	// If we immediatly destroy a pipeline that was in use earlier in the frame, we might get a crash.
+	// So instead schedule the deletion and remove the records.
+	auto graphicsPipelines = _graphicPipelines.find(program);
+	if(graphicsPipelines != _graphicPipelines.end()){
+		for(auto& pipelineInfo : graphicsPipelines->second){
 			_pipelinesToDelete.emplace_back();
 			_pipelinesToDelete.back().pipeline = pipelineInfo.second.pipeline;
 			_pipelinesToDelete.back().frame = GPU::getInternal()->frameIndex;
 		}
-		sameProgramPipelinesIt->second.clear();
-		_graphicPipelines.erase(state.graphicsProgram);
-		sameProgramPipelinesIt = _graphicPipelines.end();
+		_graphicPipelines.erase(graphicsPipelines);
+	}
+	auto computePipeline = _computePipelines.find(program);
+	if(computePipeline != _computePipelines.end()){
+		_pipelinesToDelete.emplace_back();
+		_pipelinesToDelete.back().pipeline = computePipeline->second;
+		_pipelinesToDelete.back().frame = GPU::getInternal()->frameIndex;
+		_computePipelines.erase(computePipeline);
+	}
+}
+
+bool PipelineCache::consumeReload(Program* program){
+	const bool programReloaded = program->reloaded(true);
+	// Pipelines built ahead of use are already up to date with the last reload.
+	const bool prewarmed = _prewarmedPrograms.erase(program) != 0;
+	return programReloaded && !prewarmed;
+}
+
+void PipelineCache::addRecord(const Record& record){
+	for(const Record& other : _records){
+		if(other.compute == record.compute && other.program == record.program && other.state == record.state && other.signature.isEquivalent(record.signature)){
+			return;
+		}
+	}
+	_records.push_back(record);
+}
+
+VkPipeline PipelineCache::getGraphicsPipeline(const GPUState & state){
+	// Pick pipelines built ahead of use if they are ready.
+	if(_prewarmTasks && _prewarmTasks->done()){
+		registerPrewarmedPipelines();
+	}
+
+	// Compute the hash (used in all cases).
+	const uint64_t hash = System::hash64( &state, FIXED_STATE_SIZE );
+
+	// We have to invalidate program pipelines after a reload, as the layout might change.
+	if(consumeReload(state.graphicsProgram)){
+		discardPipelines(state.graphicsProgram);
 	}
 
+	// First check if we already have pipelines for the current program.
+	auto sameProgramPipelinesIt = _graphicPipelines.find(state.graphicsProgram);
 
 	// If not found, create new program cache and generate pipeline.
 	if(sameProgramPipelinesIt == _graphicPipelines.end()){
@@ -60,18 +288,12 @@ VkPipeline PipelineCache::getGraphicsPipeline(const GPUState & state){
 	if(sameStatePipelines.first == sameProgramPipelines.end()){
 		return createNewPipeline(state, hash);
 	}
-	// Else, find a pipeline with the same mesh layout.
+	// Else, find a pipeline with the same mesh and framebuffer layouts.
 	for(auto pipeline = sameStatePipelines.first; pipeline != sameStatePipelines.second; ++pipeline){
 		const Entry& entry = pipeline->second;
-
-		// Test mesh layout compatibility.
-		if(!entry.mesh.isEquivalent(state.mesh->state)){
-			continue;
-		}
-		if(!entry.pass.isEquivalent(state.pass)){
-			continue;
+		if(entry.signature.isEquivalent(state)){
+			return entry.pipeline;
 		}
-		return entry.pipeline;
 	}
 
 	// Else we have to create the pipeline
@@ -80,33 +302,125 @@ VkPipeline PipelineCache::getGraphicsPipeline(const GPUState & state){
 
 
 VkPipeline PipelineCache::getComputePipeline(const GPUState & state){
+	// Pick pipelines built ahead of use if they are ready.
+	if(_prewarmTasks && _prewarmTasks->done()){
+		registerPrewarmedPipelines();
+	}
 
-	// First check if we already have pipelines for the current program.
-	auto sameProgramPipelinesIt = _computePipelines.find(state.computeProgram);
-
-	const bool programReloaded = state.computeProgram->reloaded(true);
 	// We have to invalidate program pipelines after a reload, as the layout might change.
-	if(sameProgramPipelinesIt != _computePipelines.end() && programReloaded){
-		// Delete the pipeline corresponding to this program.
-		// If we immediatly destroy a pipeline that was in use earlier in the frame, we might get a crash.
-		// So instead schedule the deletion and remove the records.
-		VkPipeline pipelineInfo = sameProgramPipelinesIt->second;
-		_pipelinesToDelete.emplace_back();
-		_pipelinesToDelete.back().pipeline = pipelineInfo;
-		_pipelinesToDelete.back().frame = GPU::getInternal()->frameIndex;
-		_computePipelines.erase(state.computeProgram);
-		sameProgramPipelinesIt = _computePipelines.end();
+	if(consumeReload(state.computeProgram)){
+		discardPipelines(state.computeProgram);
 	}
 
-	// If not found, create new program cache and generate pipeline.
+	// If not found, generate pipeline.
+	auto sameProgramPipelinesIt = _computePipelines.find(state.computeProgram);
 	if(sameProgramPipelinesIt == _computePipelines.end()){
-		_computePipelines[state.computeProgram] = buildComputePipeline(*state.computeProgram);
-		return _computePipelines[state.computeProgram];
+		const VkPipeline pipeline = buildComputePipeline(*state.computeProgram);
+		_computePipelines[state.computeProgram] = pipeline;
+		++GPU::_metrics.pipelines;
+		++GPU::_metrics.pipelineBuilds;
+
+		Record record;
+		record.program = state.computeProgram->name();
+		record.state.fill(0);
+		record.compute = true;
+		addRecord(record);
+		return pipeline;
 	}
 
 	return sameProgramPipelinesIt->second;
 }
 
+void PipelineCache::prewarm(const std::vector<Program*>& programs){
+	cancelPrewarm();
+
+	std::unordered_map<std::string, Program*> programsByName;
+	for(Program* program : programs){
+		programsByName[program->name()] = program;
+	}
+	for(const Record& record : _records){
+		auto program = programsByName.find(record.program);
+		if(program == programsByName.end() || (program->second->type() == Program::Type::COMPUTE) != record.compute){
+			continue;
+		}
+		_prewarmed.push_back({ program->second, &record, VK_NULL_HANDLE });
+	}
+	if(_prewarmed.empty()){
+		return;
+	}
+
+	// Each task only writes to its own pipeline, the cache is updated on the main thread once they are all complete.
+	_prewarmTasks = std::make_unique<TaskGroup>();
+	for(PrewarmedPipeline& prewarmed : _prewarmed){
+		_prewarmTasks->run([this, &prewarmed](){
+			if(prewarmed.record->compute){
+				prewarmed.pipeline = buildComputePipeline(*prewarmed.program);
+				return;
+			}
+			GPUState state;
+			memcpy(static_cast<void*>(&state), prewarmed.record->state.data(), FIXED_STATE_SIZE);
+			state.graphicsProgram = prewarmed.program;
+			prewarmed.pipeline = buildGraphicsPipeline(state, prewarmed.record->signature);
+		});
+	}
+	Log::verbose("GPU: Building %u pipelines ahead of use.", (uint)_prewarmed.size());
+}
+
+void PipelineCache::cancelPrewarm(){
+	if(_prewarmTasks){
+		_prewarmTasks->wait();
+		_prewarmTasks.reset();
+		GPUContext* context = GPU::getInternal();
+		for(const PrewarmedPipeline& prewarmed : _prewarmed){
+			vkDestroyPipeline(context->device, prewarmed.pipeline, nullptr);
+		}
+		_prewarmed.clear();
+	}
+	// Pipelines built ahead of use but not used yet will be outdated after the next reload.
+	_prewarmedPrograms.clear();
+}
+
+void PipelineCache::registerPrewarmedPipelines(){
+	_prewarmTasks.reset();
+	GPUContext* context = GPU::getInternal();
+	uint registered = 0;
+	for(const PrewarmedPipeline& prewarmed : _prewarmed){
+		Program* program = prewarmed.program;
+		// Outdated pipelines from before the last reload have to be removed now.
+		if(_prewarmedPrograms.count(program) == 0 && program->reloaded()){
+			discardPipelines(program);
+		}
+		_prewarmedPrograms.insert(program);
+
+		bool duplicate = false;
+		if(prewarmed.record->compute){
+			duplicate = !_computePipelines.emplace(program, prewarmed.pipeline).second;
+		} else {
+			GPUState state;
+			memcpy(static_cast<void*>(&state), prewarmed.record->state.data(), FIXED_STATE_SIZE);
+			const uint64_t hash = System::hash64( &state, FIXED_STATE_SIZE );
+			ProgramPipelines& pipelines = _graphicPipelines[program];
+			// The pipeline might have been needed and built before this one was ready.
+			auto sameStatePipelines = pipelines.equal_range(hash);
+			for(auto pipeline = sameStatePipelines.first; pipeline != sameStatePipelines.second; ++pipeline){
+				duplicate |= pipeline->second.signature.isEquivalent(prewarmed.record->signature);
+			}
+			if(!duplicate){
+				pipelines.insert(std::make_pair(hash, Entry{ prewarmed.pipeline, prewarmed.record->signature }));
+			}
+		}
+		if(duplicate){
+			vkDestroyPipeline(context->device, prewarmed.pipeline, nullptr);
+			continue;
+		}
+		++registered;
+	}
+	_prewarmed.clear();
+	GPU::_metrics.pipelines += registered;
+	GPU::_metrics.prewarmedPipelines += registered;
+	Log::verbose("GPU: Registered %u pipelines built ahead of use.", registered);
+}
+
 void PipelineCache::freeOutdatedPipelines(){
 	GPUContext* context = GPU::getInternal();
 
@@ -130,20 +444,14 @@ void PipelineCache::freeOutdatedPipelines(){
 }
 
 void PipelineCache::clean(){
+	cancelPrewarm();
 	// Free remaining pipelines waiting to be deleted.
 	freeOutdatedPipelines();
 	assert(_pipelinesToDelete.empty());
 
-	// Retrieve cache data.
+	saveToDisk();
+
 	GPUContext* context = GPU::getInternal();
-	size_t pipelineSize = 0;
-	VK_RET(vkGetPipelineCacheData(context->device, _vulkanCache, &pipelineSize, nullptr));
-	if(pipelineSize != 0){
-		char* pipelineData = new char[pipelineSize];
-		VK_RET(vkGetPipelineCacheData(context->device, _vulkanCache, &pipelineSize, pipelineData));
-		System::saveData(PIPELINE_CACHE_FILE, pipelineData, pipelineSize);
-		delete[] pipelineData;
-	}
 
 	for(auto& programPipelines : _graphicPipelines){
 		for(auto& pipeline : programPipelines.second){
@@ -162,22 +470,40 @@ void PipelineCache::clean(){
 }
 
 VkPipeline PipelineCache::createNewPipeline(const GPUState& state, const uint64_t hash){
+	Record record;
+	record.program = state.graphicsProgram->name();
+	memcpy(record.state.data(), &state, FIXED_STATE_SIZE);
+	record.signature.mesh.attributes = state.mesh->state.attributes;
+	record.signature.mesh.bindings = state.mesh->state.bindings;
+	for(const Texture* color : state.pass.colors){
+		record.signature.colors.push_back(color->gpu->format);
+	}
+	if(state.pass.depthStencil){
+		const GPUTexture* depth = state.pass.depthStencil->gpu.get();
+		record.signature.depth = depth->format;
+		if(depth->typedFormat == Layout::DEPTH24_STENCIL8 || depth->typedFormat == Layout::DEPTH32F_STENCIL8){
+			record.signature.stencil = depth->format;
+		}
+	}
+
 	Entry entry;
-	entry.pipeline = buildGraphicsPipeline(state);
-	entry.mesh = state.mesh->state;
-	entry.pass = state.pass;
+	entry.pipeline = buildGraphicsPipeline(state, record.signature);
+	entry.signature = record.signature;
+	++GPU::_metrics.pipelines;
+	++GPU::_metrics.pipelineBuilds;
+	addRecord(record);
 
 	auto it = _graphicPipelines[state.graphicsProgram].insert(std::make_pair(hash, entry));
 	return it->second.pipeline;
 }
 
-VkPipeline PipelineCache::buildGraphicsPipeline(const GPUState& state){
+VkPipeline PipelineCache::buildGraphicsPipeline(const GPUState& state, const Signature& signature){
 	GPUContext* context = GPU::getInternal();
 
 	VkGraphicsPipelineCreateInfo pipelineInfo{};
 	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
 	// Assert no null data.
-	assert(state.graphicsProgram); assert(state.mesh);
+	assert(state.graphicsProgram);
 
 	std::vector<VkPipelineShaderStageCreateInfo> stages;
 	// Program
@@ -211,7 +537,7 @@ VkPipeline PipelineCache::buildGraphicsPipeline(const GPUState& state){
 	// Vertex input.
 	VkPipelineVertexInputStateCreateInfo vertexState{};
 	{
-		const GPUMesh::State& meshState = state.mesh->state;
+		const GPUMesh::State& meshState = signature.mesh;
 		vertexState.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 		vertexState.vertexBindingDescriptionCount = uint32_t(meshState.bindings.size());
 		vertexState.pVertexBindingDescriptions = meshState.bindings.data();
@@ -340,7 +666,7 @@ VkPipeline PipelineCache::buildGraphicsPipeline(const GPUState& state){
 	}
 	// Color blending
 	VkPipelineColorBlendStateCreateInfo colorState{};
-	const size_t attachmentCount = state.pass.colors.size();
+	const size_t attachmentCount = signature.colors.size();
 	std::vector<VkPipelineColorBlendAttachmentState> attachmentStates(attachmentCount);
 	{
 		static const std::unordered_map<BlendEquation, VkBlendOp> eqs = {
@@ -401,27 +727,13 @@ VkPipeline PipelineCache::buildGraphicsPipeline(const GPUState& state){
 
 	// Render pass
 	VkPipelineRenderingCreateInfoKHR renderingInfo{};
-	std::vector<VkFormat> colorFormats(attachmentCount);
 	{
-		for(uint aid = 0; aid < attachmentCount; ++aid){
-			colorFormats[aid] = state.pass.colors[aid]->gpu->format;
-		}
-
 		renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
 		renderingInfo.colorAttachmentCount = colorState.attachmentCount;
-		renderingInfo.pColorAttachmentFormats = colorFormats.data();
+		renderingInfo.pColorAttachmentFormats = signature.colors.data();
 		renderingInfo.viewMask = 0u;
-
-		renderingInfo.depthAttachmentFormat = VK_FORMAT_UNDEFINED;
-		renderingInfo.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
-
-		if(state.pass.depthStencil){
-			const GPUTexture* depth = state.pass.depthStencil->gpu.get();
-			renderingInfo.depthAttachmentFormat = depth->format;
-			if(depth->typedFormat == Layout::DEPTH24_STENCIL8 || depth->typedFormat == Layout::DEPTH32F_STENCIL8){
-				renderingInfo.stencilAttachmentFormat = depth->format;
-			}
-		}
+		renderingInfo.depthAttachmentFormat = signature.depth;
+		renderingInfo.stencilAttachmentFormat = signature.stencil;
 
 		pipelineInfo.pNext = &renderingInfo;
 		pipelineInfo.renderPass = VK_NULL_HANDLE;
@@ -437,7 +749,6 @@ VkPipeline PipelineCache::buildGraphicsPipeline(const GPUState& state){
 	if(vkCreateGraphicsPipelines(context->device, _vulkanCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS){
 		Log::error("GPU: Unable to create pipeline.");
 	}
-	++GPU::_metrics.pipelines;
 	VkUtils::setDebugName(*context, VK_OBJECT_TYPE_PIPELINE, uint64_t(pipeline), "Graphic-%s", state.graphicsProgram->name().c_str());
 	return pipeline;
 }
@@ -464,6 +775,5 @@ VkPipeline PipelineCache::buildComputePipeline(Program& program){
 	if(vkCreateComputePipelines(context->device, _vulkanCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS){
 		Log::error("GPU: Unable to create pipeline.");
 	}
-	++GPU::_metrics.pipelines;
 	return pipeline;
 }
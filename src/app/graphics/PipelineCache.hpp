@@ -1,10 +1,14 @@
 #pragma once
 
 #include "core/Common.hpp"
+#include "core/Scheduler.hpp"
 #include "graphics/GPUObjects.hpp"
 
 #include <unordered_map>
+#include <unordered_set>
 #include <deque>
+#include <array>
+#include <cstddef>
 
 /** \brief Create and reuse GPU pipelines based on a given state. This supports both graphics and compute pipelines.
  * \details We use a two-levels cache, first sorting by Program because each program only has one instance 
@@ -12,7 +16,9 @@
  * parameters to retrieve compatible pipelines, and compare mesh and framebuffer layouts manually as duplicates will be quite rare.
  * (usually a program is used with a specific set of meshes and a fixed framebuffer). 
  * We could compare program layouts to share pipelines between similar programs, but it would be more complex.
- * A Vulkan cache is also used internally, saved on disk and restored at loading.
+ * A Vulkan cache is also used internally, saved on disk and restored at loading if it was created by the same device and driver.
+ * The states of all pipelines created during a run are also saved, so that they can be rebuilt on worker threads
+ * as soon as the corresponding programs are loaded in the next run, instead of at their first use.
  * \ingroup Graphics
  */
 class PipelineCache {
@@ -36,17 +42,67 @@ public:
 	/// Destroy pipelines that are referencing outdated state and are not used anymore. 
 	void freeOutdatedPipelines();
 
+	/** Start building pipelines recorded in previous runs for the given programs, on worker threads.
+	 * \param programs the loaded programs, matched by name with the recorded pipelines
+	 */
+	void prewarm(const std::vector<Program*>& programs);
+
+	/** Wait for pipelines being built ahead of use and discard them, along with previously built pipelines that haven't been used yet.
+	 * \note Call before reloading programs, as these pipelines would reference outdated modules.
+	 */
+	void cancelPrewarm();
+
 	/** Clean all existing pipelines */
 	void clean();
 	
 private:
 
+	/// Size of the part of the GPU state that is directly compared in memory.
+	static constexpr size_t FIXED_STATE_SIZE = offsetof(GPUState, sentinel);
+
+	/** \brief Vertex and attachments layouts of a graphics pipeline, independent of the mesh and textures used.
+	 * */
+	struct Signature {
+		GPUMesh::State mesh; ///< The mesh layout (no buffers).
+		std::vector<VkFormat> colors; ///< The color attachments formats.
+		VkFormat depth = VK_FORMAT_UNDEFINED; ///< The depth attachment format.
+		VkFormat stencil = VK_FORMAT_UNDEFINED; ///< The stencil attachment format.
+
+		/** Check if a GPU state mesh and framebuffer are compatible with this signature.
+		 * \param state the state to compare to
+		 * \return true if equivalent
+		 */
+		bool isEquivalent(const GPUState& state) const;
+
+		/** Check if another signature is compatible with this one.
+		 * \param other the signature to compare to
+		 * \return true if equivalent
+		 */
+		bool isEquivalent(const Signature& other) const;
+	};
+
 	/** \brief Store a pipeline along with part of the information used to generate it
 	 * */
 	struct Entry {
 		VkPipeline pipeline; ///< The native handle.
-		GPUMesh::State mesh; ///< The mesh layout.
-		GPUState::FramebufferInfos pass; ///< The framebuffer layout.
+		Signature signature; ///< The mesh and framebuffer layouts.
+	};
+
+	/** \brief Description of a created pipeline, saved to rebuild it in later runs.
+	 * */
+	struct Record {
+		std::string program; ///< Program name.
+		std::array<unsigned char, FIXED_STATE_SIZE> state; ///< Fixed-function state, unused for compute pipelines.
+		Signature signature; ///< The mesh and framebuffer layouts, unused for compute pipelines.
+		bool compute = false; ///< Is this a compute pipeline.
+	};
+
+	/** \brief Pipeline built ahead of use on a worker thread.
+	 * */
+	struct PrewarmedPipeline {
+		Program* program = nullptr; ///< The program.
+		const Record* record = nullptr; ///< The pipeline description.
+		VkPipeline pipeline = VK_NULL_HANDLE; ///< The native handle, once built.
 	};
 
 	/** Create a new pipeline based on a given state and store it in the cache for future use.
@@ -58,16 +114,44 @@ private:
 
 	/** Build a graphics pipeline from a given graphics state.
 	 * \param state the state to use
+	 * \param signature the mesh and framebuffer layouts to use
 	 * \return the newly created pipeline
+	 * \note Can be called from worker threads.
 	 */
-	VkPipeline buildGraphicsPipeline(const GPUState& state);
+	VkPipeline buildGraphicsPipeline(const GPUState& state, const Signature& signature);
 
 	/** Build a compute pipeline from a given compute program.
 	 * \param program the program to use
 	 * \return the newly created pipeline
+	 * \note Can be called from worker threads.
 	 */
 	VkPipeline buildComputePipeline(Program& program);
 
+	/** Schedule the deletion of all pipelines for a program.
+	 * \param program the program whose pipelines are outdated
+	 */
+	void discardPipelines(const Program* program);
+
+	/** Check if a program has been reloaded since its pipelines were created, absorbing the reload flag.
+	 * \param program the program to check
+	 * \return true if the existing program pipelines are outdated
+	 */
+	bool consumeReload(Program* program);
+
+	/** Add a pipeline description to the list saved at the end of the run, if not already present.
+	 * \param record the description
+	 */
+	void addRecord(const Record& record);
+
+	/// Register pipelines built ahead of use once all of them are complete.
+	void registerPrewarmedPipelines();
+
+	/// Load the Vulkan cache and pipeline descriptions saved in a previous run.
+	void loadFromDisk();
+
+	/// Save the Vulkan cache and pipeline descriptions for the next run.
+	void saveToDisk();
+
 	using ProgramPipelines = std::unordered_multimap<uint64_t, Entry>; ///< Per program pipeline type.
 	using GraphicCache = std::unordered_map<const Program*, ProgramPipelines>; ///< Complete cache type.
 	using ComputeCache = std::unordered_map<const Program*, VkPipeline>; ///< Complete cache type.
@@ -76,6 +160,11 @@ private:
 	ComputeCache _computePipelines; ///< Compute pipeline cache.
 	VkPipelineCache _vulkanCache = VK_NULL_HANDLE; ///< Vulkan pipeline cache.
 
+	std::deque<Record> _records; ///< Descriptions of pipelines created in this and previous runs.
+	std::vector<PrewarmedPipeline> _prewarmed; ///< Pipelines being built ahead of use.
+	std::unique_ptr<TaskGroup> _prewarmTasks; ///< Tasks building pipelines ahead of use.
+	std::unordered_set<const Program*> _prewarmedPrograms; ///< Programs with pipelines built ahead of use, not reloaded since.
+
 	/** \brief Information for buffered pipeline deletion. */
 	struct PipelineToDelete {
 		VkPipeline pipeline; ///< The native handle.
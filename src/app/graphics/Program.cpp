@@ -17,6 +17,22 @@ Program::Program(const std::string & name, const std::string & computeContent) :
 	reload(computeContent);
 }
 
+Program::Program(const std::string & name, Type type) :
+	_name(name), _type(type) {
+}
+
+void Program::reload(const std::vector<Program*> & programs, const std::vector<Sources> & sources){
+	for(Program* program : programs){
+		program->clean();
+		program->_reloaded = true;
+	}
+	GPU::createPrograms(programs, sources);
+	for(Program* program : programs){
+		program->reflect();
+	}
+	GPU::prewarmPipelines(programs);
+}
+
 void Program::reload(const std::string & vertexContent, const std::string & fragmentContent, const std::string & tessControlContent, const std::string & tessEvalContent) {
 	if(_type != Type::GRAPHICS){
 		Log::error("GPU: %s is not a graphics program.", _name.c_str());
@@ -354,53 +370,72 @@ void Program::update(){
 	// Update the texture descriptors
 	if(_dirtySets[IMAGES_SET]){
 
-		// We can't just update the current descriptor set as it might be in use.
-		context->descriptorAllocator.freeSet(_currentSets[IMAGES_SET]);
-		_currentSets[IMAGES_SET] = context->descriptorAllocator.allocateSet(_state.setLayouts[IMAGES_SET]);
-
-		VkUtils::setDebugName(*context, VK_OBJECT_TYPE_DESCRIPTOR_SET, uint64_t(_currentSets[IMAGES_SET].handle), "%s set-%s", "Images", _name.c_str());
-
+		// Describe the layout and bound images.
 		std::vector<std::vector<VkDescriptorImageInfo>> imageInfos(_textures.size());
-		std::vector<VkWriteDescriptorSet> writes;
+		std::vector<uint64_t> signature = { uint64_t(_state.setLayouts[IMAGES_SET]) };
+		std::vector<uint64_t> resources = signature;
 		uint tid = 0;
 		for(const auto& image : _textures){
 			imageInfos[tid].resize(image.second.count);
 			const VkImageLayout tgtLayout = image.second.storage ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			signature.push_back(uint64_t(image.first));
+			signature.push_back(uint64_t(tgtLayout));
 
 			for(uint did = 0; did < image.second.count; ++did){
-				imageInfos[tid][did].imageView = image.second.views[did];
+				const VkImageView view = image.second.views[did];
+				imageInfos[tid][did].imageView = view;
 				imageInfos[tid][did].imageLayout = tgtLayout;
+				signature.push_back(uint64_t(view));
+				if(view != VK_NULL_HANDLE){
+					resources.push_back(uint64_t(view));
+				}
 			}
-
-			VkWriteDescriptorSet write{};
-			write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			write.dstSet = _currentSets[IMAGES_SET].handle;
-			write.dstBinding = image.first;
-			write.dstArrayElement = 0;
-			write.descriptorCount = image.second.count;
-			write.descriptorType = image.second.storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-			write.pImageInfo = &imageInfos[tid][0];
-			writes.push_back(write);
 			++tid;
 		}
 
-		vkUpdateDescriptorSets(context->device, uint32_t(writes.size()), writes.data(), 0, nullptr);
+		// We can't just update the current descriptor set as it might be in use.
+		// Reuse a set with the same content if possible.
+		DescriptorSet set;
+		const bool upToDate = context->descriptorAllocator.acquireCachedSet(_state.setLayouts[IMAGES_SET], signature, resources, set);
+		context->descriptorAllocator.releaseCachedSet(_currentSets[IMAGES_SET]);
+		_currentSets[IMAGES_SET] = set;
+
+		if(!upToDate){
+			VkUtils::setDebugName(*context, VK_OBJECT_TYPE_DESCRIPTOR_SET, uint64_t(_currentSets[IMAGES_SET].handle), "%s set-%s", "Images", _name.c_str());
+
+			std::vector<VkWriteDescriptorSet> writes;
+			tid = 0;
+			for(const auto& image : _textures){
+				VkWriteDescriptorSet write{};
+				write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				write.dstSet = _currentSets[IMAGES_SET].handle;
+				write.dstBinding = image.first;
+				write.dstArrayElement = 0;
+				write.descriptorCount = image.second.count;
+				write.descriptorType = image.second.storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+				write.pImageInfo = &imageInfos[tid][0];
+				writes.push_back(write);
+				++tid;
+			}
+
+			vkUpdateDescriptorSets(context->device, uint32_t(writes.size()), writes.data(), 0, nullptr);
+			++GPU::_metrics.descriptorWrites;
+		}
 		_dirtySets[IMAGES_SET] = false;
 	}
 
 	// Update static buffer descriptors.
 	if(_dirtySets[BUFFERS_SET]){
-		// We can't just update the current descriptor set as it might be in use.
-		context->descriptorAllocator.freeSet(_currentSets[BUFFERS_SET]);
-		_currentSets[BUFFERS_SET] = context->descriptorAllocator.allocateSet(_state.setLayouts[BUFFERS_SET]);
-
-		VkUtils::setDebugName(*context, VK_OBJECT_TYPE_DESCRIPTOR_SET, uint64_t(_currentSets[BUFFERS_SET].handle), "%s set-%s", "Buffers", _name.c_str());
 
+		// Describe the layout and bound buffers.
 		std::vector<std::vector<VkDescriptorBufferInfo>> infos(_staticBuffers.size());
-		std::vector<VkWriteDescriptorSet> writes;
+		std::vector<uint64_t> signature = { uint64_t(_state.setLayouts[BUFFERS_SET]) };
+		std::vector<uint64_t> resources = signature;
 		uint tid = 0;
 		for(const auto& buffer : _staticBuffers){
 			infos[tid].resize(buffer.second.count);
+			signature.push_back(uint64_t(buffer.first));
+			signature.push_back(uint64_t(buffer.second.storage));
 			/// \todo Should we use the real buffer current offset here, if an update happened under the hood more than once per frame?
 			for(uint did = 0; did < buffer.second.count; ++did){
 				VkBuffer rawBuffer = buffer.second.buffers[did];
@@ -413,21 +448,45 @@ void Program::update(){
 				}
 
 				infos[tid][did].range = buffer.second.size;
+
+				signature.push_back(uint64_t(infos[tid][did].buffer));
+				signature.push_back(uint64_t(infos[tid][did].offset));
+				signature.push_back(uint64_t(infos[tid][did].range));
+				if(infos[tid][did].buffer != VK_NULL_HANDLE){
+					resources.push_back(uint64_t(infos[tid][did].buffer));
+				}
 			}
-			
-			VkWriteDescriptorSet write{};
-			write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			write.dstSet = _currentSets[BUFFERS_SET].handle;
-			write.dstBinding = buffer.first;
-			write.dstArrayElement = 0;
-			write.descriptorCount = buffer.second.count;
-			write.descriptorType = buffer.second.storage ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			write.pBufferInfo = &infos[tid][0];
-			writes.push_back(write);
 			++tid;
 		}
 
-		vkUpdateDescriptorSets(context->device, uint32_t(writes.size()), writes.data(), 0, nullptr);
+		// We can't just update the current descriptor set as it might be in use.
+		// Reuse a set with the same content if possible.
+		DescriptorSet set;
+		const bool upToDate = context->descriptorAllocator.acquireCachedSet(_state.setLayouts[BUFFERS_SET], signature, resources, set);
+		context->descriptorAllocator.releaseCachedSet(_currentSets[BUFFERS_SET]);
+		_currentSets[BUFFERS_SET] = set;
+
+		if(!upToDate){
+			VkUtils::setDebugName(*context, VK_OBJECT_TYPE_DESCRIPTOR_SET, uint64_t(_currentSets[BUFFERS_SET].handle), "%s set-%s", "Buffers", _name.c_str());
+
+			std::vector<VkWriteDescriptorSet> writes;
+			tid = 0;
+			for(const auto& buffer : _staticBuffers){
+				VkWriteDescriptorSet write{};
+				write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				write.dstSet = _currentSets[BUFFERS_SET].handle;
+				write.dstBinding = buffer.first;
+				write.dstArrayElement = 0;
+				write.descriptorCount = buffer.second.count;
+				write.descriptorType = buffer.second.storage ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+				write.pBufferInfo = &infos[tid][0];
+				writes.push_back(write);
+				++tid;
+			}
+
+			vkUpdateDescriptorSets(context->device, uint32_t(writes.size()), writes.data(), 0, nullptr);
+			++GPU::_metrics.descriptorWrites;
+		}
 		_dirtySets[BUFFERS_SET] = false;
 	}
 
@@ -489,7 +548,7 @@ void Program::clean() {
 		if(i == SAMPLERS_SET || i == BINDLESS_SET){
 			continue;
 		}
-		GPU::getInternal()->descriptorAllocator.freeSet(_currentSets[i]);
+		GPU::getInternal()->descriptorAllocator.releaseCachedSet(_currentSets[i]);
 		_currentSets[i].handle = VK_NULL_HANDLE;
 		_currentSets[i].pool = 0;
 	}
@@ -604,6 +663,7 @@ void Program::Stage::reset(){
 	images.clear();
 	buffers.clear();
 	pushConstants.clear();
+	spirv.clear();
 	module = VK_NULL_HANDLE;
 }
 
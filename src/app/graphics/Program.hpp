@@ -119,6 +119,23 @@ public:
 	 */
 	Program(const std::string & name, const std::string & computeContent);
 
+	/**
+	 Create an empty program, to be compiled later by a call to reload.
+	 \param name the program name for logging
+	 \param type the type of program
+	 */
+	Program(const std::string & name, Type type);
+
+	/// Shader contents of a program, indexed by shader type, empty for unused stages.
+	using Sources = std::array<std::string, int(ShaderType::COUNT)>;
+
+	/**
+	 Load several programs at once, compiling all their shaders in parallel.
+	 \param programs the programs to load
+	 \param sources the shader contents of each program
+	 */
+	static void reload(const std::vector<Program*> & programs, const std::vector<Sources> & sources);
+
 	/**
 	 Load the program, compiling the shader and updating all uniform locations.
 	 \param vertexContent the content of the vertex shader
@@ -255,6 +272,7 @@ public:
 		ConstantsDef pushConstants;
 		VkShaderModule module = VK_NULL_HANDLE; ///< Native shader data.
 		glm::uvec3 size = glm::uvec3(0); ///< Local group size.
+		std::vector<uint32_t> spirv; ///< Compiled code, kept until the native module is created.
 		/// Reset the stage state.
 		void reset();
 	};
@@ -49,6 +49,10 @@ uint QueryAllocator::allocate(){
 	return start;
 }
 
+void QueryAllocator::resetAllocations(){
+	_currentCount = 0u;
+}
+
 void QueryAllocator::clean(){
 	GPUContext* context = GPU::getInternal();
 	for(VkQueryPool& pool : _pools){
@@ -21,6 +21,9 @@ public:
 	 *  */
 	uint allocate();
 
+	/** Release all allocated queries, for queries that are allocated again at each frame. */
+	void resetAllocations();
+
 	/** 
 	 * Reset the pool that will be used at the current frame for new queries.
 	 */
@@ -3,12 +3,16 @@
 #include "graphics/GPUInternal.hpp"
 
 #include "core/TextUtilities.hpp"
+#include "core/Profiler.hpp"
+#include "core/ScenePack.hpp"
 
 #include <glslang/Public/ShaderLang.h>
 #include <glslang/SPIRV/GlslangToSpv.h>
 #include <spirv_cross/spirv_cross.hpp>
 
+#include <chrono>
 #include <map>
+#include <mutex>
 #include <sstream>
 
 // SPIRV compilation settings based on glslang standalone example
@@ -144,20 +148,150 @@ void ShaderCompiler::clean(Program::Stage & stage){
 	stage.reset();
 }
 
-void ShaderCompiler::compile(const std::string & prog, ShaderType type, Program::Stage & stage, bool generateModule, std::string & finalLog) {
+/// Internal cache helpers
 
-	// Add GLSL version.
-	std::string outputProg = "#version 450\n\n";
-	outputProg.append("#extension GL_ARB_separate_shader_objects : enable\n");
-	outputProg.append("#extension GL_EXT_samplerless_texture_functions : enable\n");
-#if defined(DRAW_ID_FALLBACK)
-	outputProg.append("#define DRAW_ID_FALLBACK 1\n");
-#else
-	outputProg.append("#extension GL_ARB_shader_draw_parameters : enable\n");
-#endif
-	outputProg.append("#line 1 0\n");
-	outputProg.append(prog);
+/// Bump when the compilation settings or the cached layout change.
+static const uint64_t CACHE_VERSION = 1u;
+
+/** \brief Shader cache state. */
+struct ShaderCacheState {
+	std::mutex mutex; ///< Protect all members.
+	fs::path directory; ///< Cache location, empty if disabled.
+	ShaderCompiler::CacheStatistics stats;
+};
+
+static ShaderCacheState& cacheState(){
+	static ShaderCacheState state;
+	return state;
+}
+
+/** \brief Cached stage size and push constants. */
+struct CachedStageInfos {
+	uint size[3];
+	uint pushConstantsSize;
+};
+
+/** \brief Cached image definition, without its name. */
+struct CachedImageDef {
+	TextureShape shape;
+	uint binding;
+	uint set;
+	uint count;
+	uint storage;
+};
+
+/** \brief Cached buffer definition, without its name. */
+struct CachedBufferDef {
+	uint binding;
+	uint size;
+	uint set;
+	uint count;
+	uint storage;
+};
+
+static uint64_t cacheKey(const std::string& prog, ShaderType type){
+	static const uint64_t compilerHash = [](){
+		const std::string version = std::string(glslang::GetGlslVersionString()) + glslang::GetEsslVersionString();
+		return System::hash64(version.data(), version.size());
+	}();
+	const uint64_t keyData[4] = {
+		System::hash64(prog.data(), prog.size()),
+		uint64_t(type),
+		compilerHash,
+		CACHE_VERSION
+	};
+	return System::hash64(keyData, sizeof(keyData));
+}
+
+static bool loadCachedStage(const fs::path& path, uint64_t key, std::vector<uint32_t>& spirv, Program::Stage& stage){
+	ScenePack pack;
+	if(!pack.load(path, key)){
+		return false;
+	}
+	CachedStageInfos infos;
+	std::vector<CachedImageDef> images;
+	std::vector<CachedBufferDef> buffers;
+	std::vector<std::string> imageNames;
+	std::vector<std::string> bufferNames;
+	if(!pack.read(ScenePack::SHADER_SPIRV, spirv) || !pack.read(ScenePack::SHADER_INFOS, &infos, sizeof(CachedStageInfos), 1)
+	   || !pack.read(ScenePack::SHADER_IMAGES, images) || !pack.readStrings(ScenePack::SHADER_IMAGE_NAMES, imageNames)
+	   || !pack.read(ScenePack::SHADER_BUFFERS, buffers) || !pack.readStrings(ScenePack::SHADER_BUFFER_NAMES, bufferNames)
+	   || spirv.empty() || images.size() != imageNames.size() || buffers.size() != bufferNames.size()){
+		Log::warning("ShaderCompiler: Cached stage at %s is invalid.", path.string().c_str());
+		spirv.clear();
+		return false;
+	}
+
+	stage.size = glm::uvec3(infos.size[0], infos.size[1], infos.size[2]);
+	stage.pushConstants.size = infos.pushConstantsSize;
+	stage.images.resize(images.size());
+	for(size_t iid = 0; iid < images.size(); ++iid){
+		Program::ImageDef& def = stage.images[iid];
+		def.name = imageNames[iid];
+		def.shape = images[iid].shape;
+		def.binding = images[iid].binding;
+		def.set = images[iid].set;
+		def.count = images[iid].count;
+		def.storage = images[iid].storage != 0u;
+	}
+	stage.buffers.resize(buffers.size());
+	for(size_t bid = 0; bid < buffers.size(); ++bid){
+		Program::BufferDef& def = stage.buffers[bid];
+		def.name = bufferNames[bid];
+		def.binding = buffers[bid].binding;
+		def.size = buffers[bid].size;
+		def.set = buffers[bid].set;
+		def.count = buffers[bid].count;
+		def.storage = buffers[bid].storage != 0u;
+	}
+	return true;
+}
+
+static void saveCachedStage(const fs::path& path, uint64_t key, const std::vector<uint32_t>& spirv, const Program::Stage& stage){
+	const CachedStageInfos infos = { { stage.size[0], stage.size[1], stage.size[2] }, stage.pushConstants.size };
+	std::vector<CachedImageDef> images;
+	std::vector<std::string> imageNames;
+	for(const Program::ImageDef& def : stage.images){
+		images.push_back({ def.shape, def.binding, def.set, def.count, def.storage ? 1u : 0u });
+		imageNames.push_back(def.name);
+	}
+	std::vector<CachedBufferDef> buffers;
+	std::vector<std::string> bufferNames;
+	for(const Program::BufferDef& def : stage.buffers){
+		buffers.push_back({ def.binding, def.size, def.set, def.count, def.storage ? 1u : 0u });
+		bufferNames.push_back(def.name);
+	}
+
+	ScenePack::Writer writer;
+	writer.add(ScenePack::SHADER_SPIRV, spirv);
+	writer.add(ScenePack::SHADER_INFOS, &infos, sizeof(CachedStageInfos), 1);
+	writer.add(ScenePack::SHADER_IMAGES, images);
+	writer.addStrings(ScenePack::SHADER_IMAGE_NAMES, imageNames);
+	writer.add(ScenePack::SHADER_BUFFERS, buffers);
+	writer.addStrings(ScenePack::SHADER_BUFFER_NAMES, bufferNames);
+	writer.save(path, key);
+}
+
+void ShaderCompiler::setCacheDirectory(const fs::path& directory){
+	ShaderCacheState& cache = cacheState();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	cache.directory = directory;
+}
+
+ShaderCompiler::CacheStatistics ShaderCompiler::cacheStatistics(){
+	ShaderCacheState& cache = cacheState();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	return cache.stats;
+}
 
+/** Compile a GLSL shader to SPIR-V.
+ \param prog the complete shader source
+ \param type the type of shader
+ \param spirv will contain the compiled SPIR-V code
+ \param finalLog will contain the compilation log if it failed
+ \return true if the compilation succeeded
+ */
+static bool compileToSpirv(const std::string& prog, ShaderType type, std::vector<uint32_t>& spirv, std::string& finalLog){
 	// Create shader object.
 	static const std::unordered_map<ShaderType, EShLanguage> types = {
 		{ShaderType::VERTEX, EShLangVertex},
@@ -166,7 +300,7 @@ void ShaderCompiler::compile(const std::string & prog, ShaderType type, Program:
 		{ShaderType::TESSEVAL, EShLangTessEvaluation},
 		{ShaderType::COMPUTE, EShLangCompute}
 	};
-	const char* progStr = outputProg.c_str();
+	const char* progStr = prog.c_str();
 	const EShLanguage stageDest = types.at(type);
 	glslang::TShader shader(stageDest);
 	shader.setStrings(&progStr, 1);
@@ -175,8 +309,6 @@ void ShaderCompiler::compile(const std::string & prog, ShaderType type, Program:
 	shader.setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_1);
 	shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_3);
 
-
-	finalLog = "";
 	const EShMessages messages = (EShMessages)(EShMsgDefault | EShMsgSpvRules | EShMsgVulkanRules);
 	bool success = shader.parse(&defaultBuiltInResources, 110, true, messages);
 	if(!success){
@@ -184,7 +316,7 @@ void ShaderCompiler::compile(const std::string & prog, ShaderType type, Program:
 		TextUtilities::replace(infoLogString, "\n", "\n\t");
 		infoLogString.insert(0, "\t");
 		finalLog = infoLogString;
-		return;
+		return false;
 	}
 
 	glslang::TProgram program;
@@ -193,14 +325,13 @@ void ShaderCompiler::compile(const std::string & prog, ShaderType type, Program:
 	if(!success){
 		std::string infoLogString(program.getInfoLog());
 		finalLog = infoLogString;
-		return;
+		return false;
 	}
 	if(!program.mapIO()){
 		finalLog = "Unable to map IO.";
-		return;
+		return false;
 	}
 
-	std::vector<unsigned int> spirv;
 	glslang::SpvOptions spvOptions;
 	spvOptions.generateDebugInfo = false;
 	spvOptions.disableOptimizer = false;
@@ -210,28 +341,92 @@ void ShaderCompiler::compile(const std::string & prog, ShaderType type, Program:
 	glslang::GlslangToSpv(*program.getIntermediate(stageDest), spirv, &spvOptions);
 	if(spirv.empty()){
 		finalLog = "Unable to generate SPIRV.";
-		return;
+		return false;
 	}
+	return true;
+}
 
-	reflect(spirv, stage);
+void ShaderCompiler::compile(const std::string & prog, ShaderType type, Program::Stage & stage, bool generateModule, std::string & finalLog) {
+	PROFILE_SCOPE("ShaderCompiler::compile");
+	const auto start = std::chrono::steady_clock::now();
 
-	if(generateModule){
-		VkShaderModuleCreateInfo createInfo{};
-		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-		createInfo.codeSize = spirv.size() * sizeof(unsigned int);
-		createInfo.pCode = reinterpret_cast<const uint32_t*>(spirv.data());
-		VkShaderModule shaderModule;
-		GPUContext* context = GPU::getInternal();
-		if(vkCreateShaderModule(context->device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
-			finalLog = "Unable to create shader module.";
+	// Add GLSL version.
+	std::string outputProg = "#version 450\n\n";
+	outputProg.append("#extension GL_ARB_separate_shader_objects : enable\n");
+	outputProg.append("#extension GL_EXT_samplerless_texture_functions : enable\n");
+#if defined(DRAW_ID_FALLBACK)
+	outputProg.append("#define DRAW_ID_FALLBACK 1\n");
+#else
+	outputProg.append("#extension GL_ARB_shader_draw_parameters : enable\n");
+#endif
+	outputProg.append("#line 1 0\n");
+	outputProg.append(prog);
+
+	finalLog = "";
+
+	// Look for the compiled stage and its reflection in the cache first.
+	fs::path cachePath;
+	{
+		ShaderCacheState& cache = cacheState();
+		std::lock_guard<std::mutex> lock(cache.mutex);
+		cachePath = cache.directory;
+	}
+	const uint64_t key = cacheKey(outputProg, type);
+	if(!cachePath.empty()){
+		char keyStr[17];
+		snprintf(keyStr, sizeof(keyStr), "%016llx", (unsigned long long)key);
+		cachePath /= std::string(keyStr) + ".spvpack";
+	}
+
+	std::vector<uint32_t> spirv;
+	const bool cached = !cachePath.empty() && loadCachedStage(cachePath, key, spirv, stage);
+	if(!cached){
+		if(!compileToSpirv(outputProg, type, spirv, finalLog)){
 			return;
 		}
-		stage.module = shaderModule;
-	} else {
-		stage.module = VK_NULL_HANDLE;
+		reflect(spirv, stage);
+		if(!cachePath.empty()){
+			saveCachedStage(cachePath, key, spirv, stage);
+		}
+	}
+
+	const auto end = std::chrono::steady_clock::now();
+	const double duration = std::chrono::duration<double, std::milli>(end - start).count();
+	{
+		ShaderCacheState& cache = cacheState();
+		std::lock_guard<std::mutex> lock(cache.mutex);
+		if(cached){
+			++cache.stats.hits;
+			cache.stats.hitTime += duration;
+		} else {
+			++cache.stats.misses;
+			cache.stats.missTime += duration;
+		}
+	}
+
+	stage.spirv = std::move(spirv);
+	stage.module = VK_NULL_HANDLE;
+	if(generateModule && !createModule(stage)){
+		finalLog = "Unable to create shader module.";
 	}
 }
 
+bool ShaderCompiler::createModule(Program::Stage & stage){
+	VkShaderModuleCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	createInfo.codeSize = stage.spirv.size() * sizeof(uint32_t);
+	createInfo.pCode = stage.spirv.data();
+	VkShaderModule shaderModule;
+	GPUContext* context = GPU::getInternal();
+	if(vkCreateShaderModule(context->device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+		return false;
+	}
+	stage.module = shaderModule;
+	stage.spirv.clear();
+	stage.spirv.shrink_to_fit();
+	return true;
+}
+
 /// Internal reflection helpers
 
 bool reflectBuffer( const spirv_cross::Compiler& compiler, const spirv_cross::Resource& ubo, bool storage, Program::BufferDef& def )
@@ -3,29 +3,54 @@
 #include "graphics/Program.hpp"
 #include "graphics/GPUObjects.hpp"
 #include "core/Common.hpp"
+#include "core/System.hpp"
 
 /**
  \brief Relies on glslang to compile GLSL shaders to SPIR-V and SPIRV-Cross to generate reflection data.
+ Compiled stages and their reflection data can be cached on disk, keyed by the shader source, stage and compiler version.
  \ingroup Graphics
  */
 class ShaderCompiler {
 
 public:
 
+	/** \brief Shader cache usage since startup. */
+	struct CacheStatistics {
+		uint hits = 0u; ///< Number of stages loaded from the cache.
+		uint misses = 0u; ///< Number of stages compiled with glslang.
+		double hitTime = 0.0; ///< Time spent loading cached stages, in milliseconds.
+		double missTime = 0.0; ///< Time spent compiling stages, in milliseconds.
+	};
+
 	/** Create a shader of a given type from a string. Extract additional informations from the shader.
 	 \param prog the content of the shader
 	 \param type the type of shader (vertex, fragment,...)
 	 \param stage will be filled with reflection information: the samplers/buffers present in the shader and their user-defined locations, along with the compiled results
-	 \param generateModule shoud a Vulkan module be generated from the SPIR-V code
+	 \param generateModule shoud a Vulkan module be generated from the SPIR-V code, else the code is kept in the stage
 	 \param finalLog will contain the compilation log of the shader
+	 \note Without module generation, this can be called from multiple threads.
 	 */
 	static void compile(const std::string & prog, ShaderType type, Program::Stage & stage, bool generateModule, std::string & finalLog);
 
+	/** Create the Vulkan module of a stage compiled without it, and release the SPIR-V code.
+	 \param stage the compiled stage
+	 \return true if the module was created
+	 */
+	static bool createModule(Program::Stage & stage);
+
 	/** Initialize the compiler library.
 	 * \return the success status
 	 */
 	static bool init();
 
+	/** Enable the on-disk cache of compiled stages.
+	 * \param directory the cache directory, created if needed, or an empty path to disable the cache
+	 */
+	static void setCacheDirectory(const fs::path& directory);
+
+	/** \return the shader cache usage since startup */
+	static CacheStatistics cacheStatistics();
+
 	/** Close the compiler library. */
 	static void cleanup();
 
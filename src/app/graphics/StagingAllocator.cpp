@@ -0,0 +1,182 @@
+#include "graphics/StagingAllocator.hpp"
+#include "graphics/GPU.hpp"
+#include "graphics/GPUInternal.hpp"
+#include "resources/Buffer.hpp"
+
+#include <algorithm>
+
+/// Alignment of staging regions, compatible with all texel block sizes used for image copies.
+#define STAGING_ALIGNMENT 16u
+/// Number of recycled blocks kept around after a large upload, the others are released.
+#define STAGING_MAX_FREE_BLOCKS 4u
+
+void StagingAllocator::init(GPUContext* context, size_t blockSize){
+	_context = context;
+	_blockSize = blockSize;
+	_frames.resize(context->frameCount);
+}
+
+StagingAllocator::Allocation StagingAllocator::allocate(size_t size){
+	FramePool& frame = _frames[_context->swapIndex];
+	Allocation allocation;
+
+	++GPU::_metrics.stagingAllocations;
+	GPU::_metrics.stagingBytes += size;
+
+	// Oversized uploads get their own buffer.
+	if(size > _blockSize){
+		frame.dedicated.emplace_back(new Buffer(size, BufferType::CPUTOGPU, "Staging dedicated"));
+		allocation.buffer = frame.dedicated.back().get();
+		allocation.data = allocation.buffer->gpu->mapped;
+		allocation.offset = 0u;
+		++GPU::_metrics.stagingDedicated;
+		return allocation;
+	}
+
+	const size_t offset = (frame.offset + STAGING_ALIGNMENT - 1u) & ~size_t(STAGING_ALIGNMENT - 1u);
+	if(frame.blocks.empty() || offset + size > _blockSize){
+		// Move to a recycled block if available, else create a new one.
+		if(_freeBlocks.empty()){
+			frame.blocks.emplace_back(new Buffer(_blockSize, BufferType::CPUTOGPU, "Staging block " + std::to_string(_blockCount)));
+			++_blockCount;
+			++GPU::_metrics.stagingBlocks;
+		} else {
+			frame.blocks.emplace_back(std::move(_freeBlocks.back()));
+			_freeBlocks.pop_back();
+		}
+		frame.offset = 0u;
+	} else {
+		frame.offset = offset;
+	}
+
+	allocation.buffer = frame.blocks.back().get();
+	allocation.data = allocation.buffer->gpu->mapped + frame.offset;
+	allocation.offset = frame.offset;
+	frame.offset += size;
+	return allocation;
+}
+
+void StagingAllocator::flush(const Allocation& allocation, size_t size){
+	GPU::flushBuffer(*allocation.buffer, size, allocation.offset);
+}
+
+void StagingAllocator::copy(const Allocation& allocation, const Buffer& dst, size_t dstOffset, size_t size){
+	if(size == 0u){
+		return;
+	}
+	flush(allocation, size);
+	Copy& copy = _copies.emplace_back();
+	copy.src = allocation.buffer->gpu->buffer;
+	copy.dst = dst.gpu->buffer;
+	copy.region.srcOffset = allocation.offset;
+	copy.region.dstOffset = dstOffset;
+	copy.region.size = size;
+}
+
+void StagingAllocator::recordCopies(VkCommandBuffer& commandBuffer){
+	if(_copies.empty()){
+		return;
+	}
+	// Copies to different buffers are independent: group them by destination,
+	// preserving the order of copies to the same buffer.
+	std::stable_sort(_copies.begin(), _copies.end(), [](const Copy& a, const Copy& b){
+		return uint64_t(a.dst) < uint64_t(b.dst);
+	});
+
+	// Regions of a command can't overlap, and successive writes to the same bytes have to be ordered.
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+	std::vector<VkBufferCopy> regions;
+	// Destination ranges written to the current destination since the last barrier.
+	std::vector<VkBufferCopy> written;
+	VkBuffer regionsSrc = VK_NULL_HANDLE;
+	VkBuffer regionsDst = VK_NULL_HANDLE;
+
+	auto flushRegions = [&commandBuffer, &regions, &regionsSrc, &regionsDst](){
+		if(!regions.empty()){
+			vkCmdCopyBuffer(commandBuffer, regionsSrc, regionsDst, uint32_t(regions.size()), regions.data());
+			regions.clear();
+		}
+	};
+
+	for(const Copy& copy : _copies){
+		if(copy.dst != regionsDst){
+			written.clear();
+		}
+		// Emit one command for each run of copies sharing the same source and destination.
+		if(copy.src != regionsSrc || copy.dst != regionsDst){
+			flushRegions();
+			regionsSrc = copy.src;
+			regionsDst = copy.dst;
+		}
+		const VkDeviceSize start = copy.region.dstOffset;
+		const VkDeviceSize end = start + copy.region.size;
+		const bool overlaps = std::any_of(written.begin(), written.end(), [start, end](const VkBufferCopy& other){
+			return start < other.dstOffset + other.size && other.dstOffset < end;
+		});
+		if(overlaps){
+			// The later copy has to land after the previous ones.
+			flushRegions();
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+			written.clear();
+		}
+		regions.push_back(copy.region);
+		written.push_back(copy.region);
+	}
+	flushRegions();
+	_copies.clear();
+}
+
+void StagingAllocator::retainPending(std::vector<std::unique_ptr<Buffer>>& buffers, std::vector<std::unique_ptr<Buffer>>& pending) const {
+	for(std::unique_ptr<Buffer>& buffer : buffers){
+		const VkBuffer src = buffer->gpu->buffer;
+		const bool used = std::any_of(_copies.begin(), _copies.end(), [src](const Copy& copy){
+			return copy.src == src;
+		});
+		if(used){
+			pending.emplace_back(std::move(buffer));
+		}
+	}
+	buffers.erase(std::remove(buffers.begin(), buffers.end(), nullptr), buffers.end());
+}
+
+void StagingAllocator::resetFrame(){
+	// Copies requested before the command buffers were recreated (swapchain resize) haven't been recorded yet.
+	// Their source buffers, from any frame, are kept untouched until the current frame that records them has completed.
+	std::vector<std::unique_ptr<Buffer>> pendingBlocks;
+	std::vector<std::unique_ptr<Buffer>> pendingDedicated;
+	if(!_copies.empty()){
+		for(FramePool& frame : _frames){
+			retainPending(frame.blocks, pendingBlocks);
+			retainPending(frame.dedicated, pendingDedicated);
+		}
+	}
+
+	FramePool& frame = _frames[_context->swapIndex];
+	for(std::unique_ptr<Buffer>& block : frame.blocks){
+		_freeBlocks.emplace_back(std::move(block));
+	}
+	frame.blocks = std::move(pendingBlocks);
+	frame.dedicated = std::move(pendingDedicated);
+	// Retained blocks are considered full, new allocations start in another block.
+	frame.offset = frame.blocks.empty() ? 0u : _blockSize;
+
+	// Don't keep all blocks used by a large upload around.
+	while(_freeBlocks.size() > STAGING_MAX_FREE_BLOCKS){
+		_freeBlocks.pop_back();
+		--GPU::_metrics.stagingBlocks;
+	}
+}
+
+void StagingAllocator::clean(){
+	_copies.clear();
+	for(FramePool& frame : _frames){
+		GPU::_metrics.stagingBlocks -= frame.blocks.size();
+	}
+	GPU::_metrics.stagingBlocks -= _freeBlocks.size();
+	_frames.clear();
+	_freeBlocks.clear();
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "core/Common.hpp"
+#include "graphics/GPUObjects.hpp"
+
+class Buffer;
+struct GPUContext;
+
+/** \brief Sub-allocate CPU to GPU upload data from persistent staging blocks, buffered per frame.
+ * Each frame in flight owns a list of blocks, filled linearly and recycled once the frame command buffers have completed.
+ * Buffer copies are batched and recorded at the end of the frame; uploads larger than a block get a dedicated buffer.
+ * \ingroup Graphics
+ */
+class StagingAllocator {
+public:
+
+	/** \brief Region of a staging buffer, mapped for writing. */
+	struct Allocation {
+		Buffer* buffer = nullptr; ///< Staging buffer.
+		char* data = nullptr; ///< Mapped pointer to the start of the region.
+		size_t offset = 0u; ///< Offset of the region in the buffer.
+	};
+
+	/** Setup the allocator.
+	 \param context the GPU context
+	 \param blockSize the size of each staging block, in bytes
+	 */
+	void init(GPUContext* context, size_t blockSize);
+
+	/** Allocate a staging region for the current frame, valid until the frame has completed on the GPU.
+	 \param size the size of the region, in bytes
+	 \return the allocated region
+	 */
+	Allocation allocate(size_t size);
+
+	/** Flush CPU writes to a staging region.
+	 \param allocation the region
+	 \param size the size of the written data
+	 */
+	void flush(const Allocation& allocation, size_t size);
+
+	/** Flush a staging region and request a copy from it to a buffer, recorded with other copies at the end of the frame.
+	 \param allocation the source region
+	 \param dst the destination buffer
+	 \param dstOffset the offset in the destination buffer
+	 \param size the size of the data to copy
+	 */
+	void copy(const Allocation& allocation, const Buffer& dst, size_t dstOffset, size_t size);
+
+	/** Record all requested buffer copies.
+	 \param commandBuffer the command buffer to record the copies on
+	 */
+	void recordCopies(VkCommandBuffer& commandBuffer);
+
+	/** Recycle the staging blocks of the current frame. The frame command buffers should have completed.
+	 Blocks still read by copies not recorded yet are kept until the current frame completes. */
+	void resetFrame();
+
+	/** Release all staging blocks. */
+	void clean();
+
+private:
+
+	/** \brief Staging data used by a frame in flight. */
+	struct FramePool {
+		std::vector<std::unique_ptr<Buffer>> blocks; ///< Blocks in use, the last one is being filled.
+		std::vector<std::unique_ptr<Buffer>> dedicated; ///< Buffers for oversized uploads.
+		size_t offset = 0u; ///< Current position in the last block.
+	};
+
+	/** \brief Requested buffer copy. */
+	struct Copy {
+		VkBuffer src; ///< Staging buffer.
+		VkBuffer dst; ///< Destination buffer.
+		VkBufferCopy region; ///< Copied region.
+	};
+
+	/** Move the buffers that are the source of copies not recorded yet.
+	 \param buffers the buffers to check, pending ones are removed
+	 \param pending will receive the pending buffers
+	 */
+	void retainPending(std::vector<std::unique_ptr<Buffer>>& buffers, std::vector<std::unique_ptr<Buffer>>& pending) const;
+
+	GPUContext* _context = nullptr; ///< The GPU context.
+	std::vector<FramePool> _frames; ///< Per-frame staging data.
+	std::vector<std::unique_ptr<Buffer>> _freeBlocks; ///< Recycled blocks.
+	std::vector<Copy> _copies; ///< Buffer copies to record.
+	size_t _blockSize = 0u; ///< Size of each block.
+	uint _blockCount = 0u; ///< Number of blocks created.
+};
@@ -14,6 +14,12 @@ Swapchain::Swapchain(GPUContext & context, const RenderingConfig & config) : _de
 
 void Swapchain::setup(uint32_t width, uint32_t height){
 	_frameStarted = false;
+	// Without a surface, render in textures we own.
+	_offscreen = _context->surface == VK_NULL_HANDLE;
+	if(_offscreen){
+		setupOffscreen(width, height);
+		return;
+	}
 	// Query swapchain properties and pick settings.
 	// Basic capabilities.
 	VkSurfaceCapabilitiesKHR capabilities;
@@ -133,20 +139,7 @@ void Swapchain::setup(uint32_t width, uint32_t height){
 	// be used for swapchain images transitions and data uploads.
 	GPU::beginFrameCommandBuffers();
 
-	// Find a proper depth format for the swapchain.
-	const Layout depthLayout = VkUtils::findSupportedFormat(_context->physicalDevice,  {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT}, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
-
-	// Create shared depth buffer.
-	_depth.width  = extent.width;
-	_depth.height = extent.height;
-	_depth.depth  = 1;
-	_depth.levels = 1;
-	_depth.shape  = TextureShape::D2;
-
-	GPU::setupTexture(_depth, depthLayout, true);
-	_depth.gpu->defaultLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-	VkUtils::imageLayoutBarrier(_context->getUploadCommandBuffer(), *_depth.gpu, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 0, _depth.levels, 0, _depth.depth);
+	setupDepth(extent.width, extent.height);
 
 	// Retrieve image count in the swap chain.
 	std::vector<VkImage> colorImages;
@@ -208,7 +201,46 @@ void Swapchain::setup(uint32_t width, uint32_t height){
 		VkUtils::setDebugName(*_context, VK_OBJECT_TYPE_IMAGE_VIEW, uint64_t(color.gpu->views[0].views[0]), "Swapchain color %u - mip0 - level0", i);
 	}
 
+	setupSynchronization();
+}
+
+void Swapchain::setupOffscreen(uint32_t width, uint32_t height){
+	// Keep the same number of backbuffers as a regular swapchain.
+	_minImageCount = _imageCount = 3;
+
+	VkUtils::createCommandBuffers(*_context, _context->frameCount);
+	GPU::beginFrameCommandBuffers();
+
+	setupDepth(width, height);
+
+	Log::info("GPU: offscreen rendering using %u images of size %ux%u.", _imageCount, width, height);
+	_colors.reserve(_imageCount);
+	for(uint i = 0; i < _imageCount; ++i){
+		Texture& color = _colors.emplace_back("Color " + std::to_string(i));
+		Texture::setupRendertarget(color, Layout::RGBA8, width, height);
+	}
+
+	setupSynchronization();
+}
+
+void Swapchain::setupDepth(uint32_t width, uint32_t height){
+	// Find a proper depth format for the swapchain.
+	const Layout depthLayout = VkUtils::findSupportedFormat(_context->physicalDevice,  {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT}, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+
+	// Create shared depth buffer.
+	_depth.width  = width;
+	_depth.height = height;
+	_depth.depth  = 1;
+	_depth.levels = 1;
+	_depth.shape  = TextureShape::D2;
+
+	GPU::setupTexture(_depth, depthLayout, true);
+	_depth.gpu->defaultLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
+	VkUtils::imageLayoutBarrier(_context->getUploadCommandBuffer(), *_depth.gpu, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 0, _depth.levels, 0, _depth.depth);
+}
+
+void Swapchain::setupSynchronization(){
 	// Semaphores and fences.
 	_imagesAvailable.resize(_context->frameCount);
 	_framesFinished.resize(_context->frameCount);
@@ -234,7 +266,6 @@ void Swapchain::setup(uint32_t width, uint32_t height){
 			Log::error("GPU: Unable to create semaphores and fences.");
 		}
 	}
-	
 }
 
 void Swapchain::resize(uint width, uint height){
@@ -260,13 +291,21 @@ bool Swapchain::finishFrame(){
 
 	GPU::unbindFramebufferIfNeeded();
 
+	// Blocks can't be timed once the frame is complete.
+	_context->passTimer.endFrame();
+
+	// Record the buffer copies batched during the frame.
+	_context->stagingAllocator.recordCopies(_context->getUploadCommandBuffer());
+
 	// If we have upload operations to perform, ensure they are all complete before
 	// we start executing the render command buffer.
 	vkCmdPipelineBarrier(_context->getUploadCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT,
 		VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
 
 	// Make sure that the backbuffer is presentable.
-	VkUtils::imageLayoutBarrier(_context->getRenderCommandBuffer(), *(_backbuffer->gpu), VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, 0, 1, 0, 1);
+	if(!_offscreen){
+		VkUtils::imageLayoutBarrier(_context->getRenderCommandBuffer(), *(_backbuffer->gpu), VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, 0, 1, 0, 1);
+	}
 
 	// Finish the command buffers for this frame.
 	VK_RET(vkEndCommandBuffer(_context->getRenderCommandBuffer()));
@@ -288,10 +327,19 @@ bool Swapchain::finishFrame(){
 	// Semaphore for when the command buffer is done, so that we can present the image.
 	submitInfo.signalSemaphoreCount = 1;
 	submitInfo.pSignalSemaphores = &_framesFinished[swapIndex];
+	// Offscreen, no image to wait for nor to present.
+	if(_offscreen){
+		submitInfo.waitSemaphoreCount = 0;
+		submitInfo.signalSemaphoreCount = 0;
+	}
 	// Add the fence so that we don't reuse the command buffer while it's in use.
 	VK_RET(vkResetFences(_context->device, 1, &_framesInFlight[swapIndex]));
 	VK_RET(vkQueueSubmit(_context->graphicsQueue, 1, &submitInfo, _framesInFlight[swapIndex]));
 
+	if(_offscreen){
+		return true;
+	}
+
 	// Present swap chain.
 	VkPresentInfoKHR presentInfo = {};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -335,7 +383,12 @@ bool Swapchain::nextFrame(){
 
 	// Acquire image from next frame.
 	// Use a semaphore to know when the image is available.
-	VkResult status = vkAcquireNextImageKHR(_context->device, _swapchain, std::numeric_limits<uint64_t>::max(), _imagesAvailable[_context->swapIndex], VK_NULL_HANDLE, &_imageIndex);
+	VkResult status = VK_SUCCESS;
+	if(_offscreen){
+		_imageIndex = (_imageIndex + 1u) % _imageCount;
+	} else {
+		status = vkAcquireNextImageKHR(_context->device, _swapchain, std::numeric_limits<uint64_t>::max(), _imagesAvailable[_context->swapIndex], VK_NULL_HANDLE, &_imageIndex);
+	}
 
 
 	// We should resize the swapachain.
@@ -358,6 +411,7 @@ bool Swapchain::nextFrame(){
 	for(auto& alloc : _context->queryAllocators){
 		alloc.second.resetWritePool();
 	}
+	_context->passTimer.startFrame();
 
 	return true;
 }
@@ -377,7 +431,8 @@ void Swapchain::clean() {
 	VK_RET(vkDeviceWaitIdle(_context->device));
 
 	// We have to manually delete the color textures, because they don't own their color images (system created) nor their depth texture (shared).
-	for(size_t i = 0; i < _imageCount; ++i) {
+	// Offscreen backbuffers are owned and cleaned as regular textures.
+	for(size_t i = 0; i < _imageCount && !_offscreen; ++i) {
 		// Destroy the view but not the image, as we don't own it (and there is no sampler).
 		vkDestroyImageView(_context->device, _colors[i].gpu->view, nullptr);
 		vkDestroyImageView(_context->device, _colors[i].gpu->views[0].mipView, nullptr);
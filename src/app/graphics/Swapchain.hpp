@@ -57,6 +57,21 @@ private:
 	 */
 	void setup(uint32_t width, uint32_t height);
 
+	/** Setup offscreen backbuffers for a given size, when no surface is available.
+	 * \param width the new width
+	 * \param height the new height
+	 */
+	void setupOffscreen(uint32_t width, uint32_t height);
+
+	/** Create the shared depth buffer.
+	 * \param width the buffer width
+	 * \param height the buffer height
+	 */
+	void setupDepth(uint32_t width, uint32_t height);
+
+	/** Create the per-frame semaphores and fences. */
+	void setupSynchronization();
+
 	/** Submit the current frame's work.
 	 * \return true if the submission was successful
 	 */
@@ -81,4 +96,5 @@ private:
 	bool _vsync = false; ///< Is V-sync enabled.
 	uint32_t _imageIndex = 0; ///< Current image index.
 	bool _frameStarted = false; ///< Has a frame been previously submitted.
+	bool _offscreen = false; ///< Render to owned textures instead of presenting.
 };
@@ -0,0 +1,90 @@
+#include "input/CameraPath.hpp"
+#include "input/Camera.hpp"
+#include "core/WorldParser.hpp"
+#include "core/Log.hpp"
+
+#include <sstream>
+
+void CameraPath::record(const Camera& camera){
+	_keyframes.push_back({ camera.position(), camera.center(), camera.up() });
+}
+
+CameraPath CameraPath::fromWorld(const World& world){
+	CameraPath path;
+	for(const World::Camera& cam : world.cameras()){
+		const glm::vec4 camPos = cam.frame * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		const glm::vec4 camCenter = cam.frame * glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+		const glm::vec4 camAbove = cam.frame * glm::vec4(0.0f, 1.0f, 0.0f, 1.0f);
+		path._keyframes.push_back({ glm::vec3(camPos), glm::vec3(camCenter), glm::normalize(glm::vec3(camAbove - camPos)) });
+	}
+	return path;
+}
+
+bool CameraPath::load(const fs::path& path){
+	_keyframes.clear();
+	const std::string content = System::loadString(path);
+	std::stringstream stream(content);
+	std::string line;
+	while(std::getline(stream, line)){
+		// Skip comments and empty lines.
+		if(line.empty() || line[0] == '#'){
+			continue;
+		}
+		std::stringstream lineStream(line);
+		Keyframe keyframe;
+		lineStream >> keyframe.position.x >> keyframe.position.y >> keyframe.position.z;
+		lineStream >> keyframe.center.x >> keyframe.center.y >> keyframe.center.z;
+		lineStream >> keyframe.up.x >> keyframe.up.y >> keyframe.up.z;
+		if(lineStream.fail()){
+			Log::warning("Camera path: invalid keyframe \"%s\" in %s.", line.c_str(), path.string().c_str());
+			continue;
+		}
+		_keyframes.push_back(keyframe);
+	}
+	return !_keyframes.empty();
+}
+
+void CameraPath::save(const fs::path& path) const {
+	std::stringstream stream;
+	stream << "# position (xyz), center (xyz), up (xyz)\n";
+	for(const Keyframe& keyframe : _keyframes){
+		stream << keyframe.position.x << " " << keyframe.position.y << " " << keyframe.position.z << " ";
+		stream << keyframe.center.x << " " << keyframe.center.y << " " << keyframe.center.z << " ";
+		stream << keyframe.up.x << " " << keyframe.up.y << " " << keyframe.up.z << "\n";
+	}
+	System::saveString(path, stream.str());
+}
+
+CameraPath::Keyframe CameraPath::sample(float t) const {
+	if(_keyframes.empty()){
+		return { glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f) };
+	}
+	const float position = glm::clamp(t, 0.0f, 1.0f) * float(_keyframes.size() - 1u);
+	const size_t first = std::min(size_t(position), _keyframes.size() - 1u);
+	const size_t second = std::min(first + 1u, _keyframes.size() - 1u);
+	const float mix = position - float(first);
+
+	const Keyframe& a = _keyframes[first];
+	const Keyframe& b = _keyframes[second];
+	// Interpolate view directions rather than centers, to avoid spinning when the center distance changes.
+	const glm::vec3 dirA = glm::normalize(a.center - a.position);
+	const glm::vec3 dirB = glm::normalize(b.center - b.position);
+	glm::vec3 dir = glm::mix(dirA, dirB, mix);
+	dir = glm::length(dir) > 1e-4f ? glm::normalize(dir) : dirB;
+	glm::vec3 up = glm::mix(a.up, b.up, mix);
+	up = glm::length(up) > 1e-4f ? glm::normalize(up) : b.up;
+
+	Keyframe keyframe;
+	keyframe.position = glm::mix(a.position, b.position, mix);
+	keyframe.center = keyframe.position + dir;
+	keyframe.up = up;
+	return keyframe;
+}
+
+void CameraPath::apply(float t, Camera& camera) const {
+	if(_keyframes.empty()){
+		return;
+	}
+	const Keyframe keyframe = sample(t);
+	camera.pose(keyframe.position, keyframe.center, keyframe.up);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "core/Common.hpp"
+#include "core/System.hpp"
+
+class Camera;
+class World;
+
+/** \brief A sequence of camera poses, recorded interactively or built from a world cameras, that can be played back.
+ \details Keyframes are evenly spaced along the path, so that a path can be played back over any number of frames.
+ \ingroup Input
+ */
+class CameraPath {
+
+public:
+
+	/** \brief A camera pose. */
+	struct Keyframe {
+		glm::vec3 position; ///< Camera position.
+		glm::vec3 center; ///< Camera center of interest.
+		glm::vec3 up; ///< Camera vertical orientation.
+	};
+
+	/** Append the current pose of a camera to the path.
+	 \param camera the camera to record
+	 */
+	void record(const Camera& camera);
+
+	/** Build a fly-through visiting all cameras placed in a world, in order.
+	 \param world the world to visit
+	 \return the path, empty if the world has no camera
+	 */
+	static CameraPath fromWorld(const World& world);
+
+	/** Load a path from a text file, one keyframe per line.
+	 \param path the file path
+	 \return true if at least one keyframe was loaded
+	 */
+	bool load(const fs::path& path);
+
+	/** Save the path to a text file, one keyframe per line.
+	 \param path the file path
+	 */
+	void save(const fs::path& path) const;
+
+	/** Interpolate the pose at a given position along the path.
+	 \param t the position along the path, from 0 to 1
+	 \return the interpolated pose
+	 */
+	Keyframe sample(float t) const;
+
+	/** Place a camera at a given position along the path.
+	 \param t the position along the path, from 0 to 1
+	 \param camera the camera to update
+	 */
+	void apply(float t, Camera& camera) const;
+
+	/** Remove all keyframes. */
+	void clear(){ _keyframes.clear(); }
+
+	/** \return the number of keyframes */
+	size_t size() const { return _keyframes.size(); }
+
+	/** \return true if the path has no keyframe */
+	bool empty() const { return _keyframes.empty(); }
+
+private:
+
+	std::vector<Keyframe> _keyframes; ///< Poses along the path.
+};
@@ -4,14 +4,22 @@
 #include "core/System.hpp"
 #include "core/TextUtilities.hpp"
 #include "core/Random.hpp"
+#include "core/Profiler.hpp"
+#include "core/ScenePack.hpp"
 #include "core/Common.hpp"
 
 #include "system/Window.hpp"
 #include "graphics/GPU.hpp"
+#include "graphics/ShaderCompiler.hpp"
 #include "input/Input.hpp"
 #include "input/ControllableCamera.hpp"
+#include "input/CameraPath.hpp"
 #include "Common.hpp"
 
+#include <chrono>
+#include <deque>
+#include <numeric>
+
 #ifdef DEBUG
 #define DEBUG_UI
 #endif
@@ -36,6 +44,9 @@
 #define SKIP_CULLING_OBJECTS 1
 #define SKIP_CULLING_LIGHTS 2
 #define SKIP_CULLING_ZONES 4
+#define SKIP_CULLING_PORTALS 8
+
+#define MAX_CULLED_ZONES 256
 
 #define CLUSTER_XY_SIZE 64
 #define CLUSTER_Z_COUNT 32
@@ -44,6 +55,22 @@
 #define SORT_BIN_COUNT (1 << SORT_BIT_RANGE)
 #define SORT_ITEMS_PER_BATCH 32
 
+// Frames rendered after loading a world before measuring, to populate caches.
+#define BENCHMARK_WARMUP_FRAMES 16
+// Frames submitted before GPU timings of a frame are available.
+#define BENCHMARK_GPU_LATENCY 2
+
+// Shadow atlas size, and range of tile sizes allocated to each light face.
+#define SHADOW_ATLAS_SIZE 4096u
+#define SHADOW_TILE_MIN 128u
+#define SHADOW_TILE_MAX 1024u
+// Maximum number of shadow tiles rendered in a frame.
+#define SHADOW_FACES_PER_FRAME 4
+// Tangent of the half field of view used to estimate the screen coverage of lights.
+#define SHADOW_COVERAGE_TAN_HALF_FOV 0.577f
+// Bump when the shadow rendering or the cached data layout changes, to invalidate cached atlases.
+#define SHADOW_CACHE_VERSION 1u
+
 static const std::vector<uint> boxIndices = { 0, 1, 0, 0, 2, 0,
 	1, 3, 1, 2, 3, 2,
 	4, 5, 4, 4, 6, 4,
@@ -109,15 +136,53 @@ public:
 
 			if(key == "path") {
 				path = values[0];
+			} else if(key == "static-batching") {
+				sceneOptions.staticBatching = true;
+			} else if(key == "build-packs") {
+				buildPacks = true;
+			} else if(key == "bake-shadows") {
+				bakeShadows = true;
+			} else if(key == "texture-arrays") {
+				sceneOptions.maxTextureArrays = uint(std::stoi(values[0]));
+			} else if(key == "texture-budget") {
+				sceneOptions.textureBudget = uint(std::stoi(values[0]));
+			} else if(key == "benchmark") {
+				benchmark = values[0];
+			} else if(key == "benchmark-frames") {
+				benchmarkFrames = uint(std::max(std::stoi(values[0]), 1));
+			} else if(key == "benchmark-output") {
+				benchmarkOutput = values[0];
+			} else if(key == "camera-paths") {
+				cameraPaths = values[0];
 			}
 		}
+		// Benchmarks and shadow baking are always rendered offscreen.
+		if(!benchmark.empty() || bakeShadows) {
+			headless = true;
+		}
 
 		registerSection("Viewer");
 		registerArgument("path", "", "Path to the game 'resources' directory");
+		registerArgument("static-batching", "", "Merge small static objects sharing a material when loading a world.");
+		registerArgument("build-packs", "", "Generate scene packs for all worlds at startup, to speed up later loads.");
+		registerArgument("bake-shadows", "", "Generate and cache the shadow maps of all worlds offscreen, then quit (or run the benchmark).");
+		registerArgument("texture-arrays", "", "Maximum number of texture arrays, larger textures are downsampled to fit (0 for no limit).", "count");
+		registerArgument("texture-budget", "", "Maximum size of texture arrays in MB, top mip levels are dropped to fit (0 for no limit).", "MB");
+		registerArgument("camera-paths", "", "Directory of camera paths (one <world>.path file per world), recorded from the viewer and played back by benchmarks.", "path");
+		registerArgument("benchmark", "", "Render a world ('all' for every world) offscreen along a camera path, and save per-frame statistics.", "world");
+		registerArgument("benchmark-frames", "", "Number of frames measured for each world (300 by default).", "count");
+		registerArgument("benchmark-output", "", "Benchmark output files, without extension (eXplorer112_benchmark by default).", "path");
 
 	}
 
 	fs::path path;
+	ScenePack::SceneOptions sceneOptions;
+	bool buildPacks = false;
+	bool bakeShadows = false;
+	fs::path cameraPaths;
+	std::string benchmark;
+	uint benchmarkFrames = 300u;
+	fs::path benchmarkOutput = "eXplorer112_benchmark";
 };
 
 
@@ -160,6 +225,9 @@ struct FrameData {
 	int selectedInstance= -1;
 	int selectedTextureArray= -1;
 	int selectedTextureLayer= -1;
+	uint pad0, pad1, pad2;
+	// Zones visible through portals, one bit per zone.
+	glm::uvec4 visibleZones[2]{glm::uvec4(0xFFFFFFFFu), glm::uvec4(0xFFFFFFFFu)};
 
 };
 
@@ -197,35 +265,33 @@ struct ProgramInfos {
 #define SHADERS_DIRECTORY (APP_RESOURCE_DIRECTORY / "shaders")
 
 ProgramInfos loadProgram(const std::string& vertName, const std::string& fragName){
-	std::vector<fs::path> names;
-	const std::string vertContent = System::getStringWithIncludes(SHADERS_DIRECTORY / (vertName + ".vert"), names);
-	names.clear();
-	const std::string fragContent = System::getStringWithIncludes(SHADERS_DIRECTORY / (fragName + ".frag"), names);
-
-	Program* prog = new Program(vertName + "_" + fragName, vertContent, fragContent);
+	// Shaders are compiled later for all programs at once.
+	Program* prog = new Program(vertName + "_" + fragName, Program::Type::GRAPHICS);
 	return {prog, {vertName, fragName}};
 }
 
 ProgramInfos loadProgram(const std::string& computeName){
-	std::vector<fs::path> names;
-	const std::string compContent = System::getStringWithIncludes(SHADERS_DIRECTORY / (computeName + ".comp"), names);
-	Program* prog =  new Program(computeName, compContent);
+	Program* prog = new Program(computeName, Program::Type::COMPUTE);
 	return {prog, {computeName}};
 }
 
-void reload(ProgramInfos& infos){
-	if(infos.program->type() == Program::Type::COMPUTE){
-		std::vector<fs::path> names;
-		const std::string compContent = System::getStringWithIncludes(SHADERS_DIRECTORY / (infos.names[0] + ".comp"), names);
-		infos.program->reload(compContent);
-	} else {
+void reload(std::vector<ProgramInfos>& programPool){
+	const size_t programCount = programPool.size();
+	std::vector<Program*> programs(programCount);
+	std::vector<Program::Sources> sources(programCount);
+	System::forParallel(0, programCount, [&programPool, &programs, &sources](size_t pid){
+		const ProgramInfos& infos = programPool[pid];
 		std::vector<fs::path> names;
-		const std::string vertContent = System::getStringWithIncludes(SHADERS_DIRECTORY / (infos.names[0] + ".vert"), names);
-		names.clear();
-		const std::string fragContent = System::getStringWithIncludes(SHADERS_DIRECTORY / (infos.names[1] + ".frag"), names);
-		infos.program->reload(vertContent, fragContent);
-	}
-
+		programs[pid] = infos.program;
+		if(infos.program->type() == Program::Type::COMPUTE){
+			sources[pid][uint(ShaderType::COMPUTE)] = System::getStringWithIncludes(SHADERS_DIRECTORY / (infos.names[0] + ".comp"), names);
+		} else {
+			sources[pid][uint(ShaderType::VERTEX)] = System::getStringWithIncludes(SHADERS_DIRECTORY / (infos.names[0] + ".vert"), names);
+			names.clear();
+			sources[pid][uint(ShaderType::FRAGMENT)] = System::getStringWithIncludes(SHADERS_DIRECTORY / (infos.names[1] + ".frag"), names);
+		}
+	});
+	Program::reload(programs, sources);
 }
 
 
@@ -664,48 +730,99 @@ struct DebugVisualisation {
 
 struct ShadowGeneration {
 
-	Texture maps{"ShadowMaps"};
-	UniformBuffer<FrameData> shadowInfos{1, 2, "ShadowInfos"};
+	/** \brief Shadow casting light, with one face for spot and directional lights and six for point lights. */
+	struct Light {
+		uint light = 0u; ///< Index of the light in the scene.
+		uint firstFace = 0u; ///< First face of the light, faces of a light are contiguous.
+		uint faceCount = 0u; ///< Number of faces.
+		uint tileSize = 0u; ///< Size of each face tile in the atlas, 0 if the light has no tile.
+		uint casters = 0u; ///< Caster instances drawn for all faces.
+		float importance = 0.0f; ///< Relative need for resolution, from 0 to 1.
+	};
 
+	/** \brief Light face, rendered in its own atlas tile from a precomputed list of casters. */
+	struct Face {
+		glm::mat4 vp{1.0f}; ///< Face view-projection matrix.
+		glm::uvec2 tileOffset{0u}; ///< Tile position in the atlas, in pixels.
+		uint tileSize = 0u; ///< Tile size in pixels, 0 if the face has no tile.
+		uint light = 0u; ///< Index of the owning light.
+		uint firstCommand = 0u; ///< First draw command of the face casters.
+		uint commandCount = 0u; ///< Number of draw commands, one per caster mesh.
+		uint casterCount = 0u; ///< Number of caster instances.
+		bool dirty = false; ///< Should the tile be rendered.
+	};
+
+	Texture atlas{"ShadowAtlas"};
+	UniformBuffer<FrameData> shadowInfos{1, 3 * SHADOW_FACES_PER_FRAME, "ShadowInfos"};
+	// UV offset and size of each face tile.
+	std::unique_ptr<StructuredBuffer<glm::vec4>> tiles = nullptr;
+
+	// Caster lists of all faces: draw commands, mesh and first instance for each command, and instances.
 	std::unique_ptr<Buffer> drawCommands = nullptr;
+	std::unique_ptr<Buffer> drawInfos = nullptr;
 	std::unique_ptr<Buffer> drawInstances = nullptr;
 
-    uint currentLight = 0u;
-    uint currentLightFace = 0u;
-    uint currentMapLayer = 0u;
-    bool rendering = false;
+	std::vector<Light> lights;
+	std::vector<Face> faces;
+	std::vector<uint> lookup; ///< Index in lights for each scene light, or NO_SHADOW.
+	float sceneRadius = 1.0f;
+
+	uint queuedFaces = 0u;
+	uint renderedFaces = 0u;
+	uint droppedLights = 0u; ///< Enabled lights that didn't fit in the atlas.
+	float occupancy = 0.0f; ///< Fraction of the atlas used by tiles.
+	bool rendering = false;
+
+	// Lights and geometry are static, generated maps are cached on disk.
+	fs::path cachePath;
+	uint64_t cacheKey = 0u;
+	bool cachePending = false; ///< Maps still have to be generated and saved to the cache.
 
-	Program* drawArgsCompute = nullptr;
 	Program* shadowInstancedObject = nullptr;
 
-	void setup(const Scene& scene){
-		uint shadowCount = 0u;
-		uint shadowcasterCount = 0u;
-		for( const World::Light& light : scene.world.lights() ){
-			if( light.shadow ){
-				shadowCount += ( light.type == World::Light::POINT ? 6u : 1u );
-				++shadowcasterCount;
-			}
-		}
-		shadowCount = std::max( shadowCount, 1u );
-		maps.resize( maps.width, maps.height, shadowCount );
+	void setup(Scene& scene, const fs::path& path){
+		sceneRadius = std::max( scene.computeBoundingBox().getSphere().radius, 1e-3f );
+		buildCasters( scene );
 
-		currentLight = 0u;
-		currentMapLayer = 0u;
-		currentLightFace = 0u;
+		// Before the user moves around, estimate coverage from the viewpoints placed in the world.
+		std::vector<glm::vec3> viewpoints;
+		for( const World::Camera& camera : scene.world.cameras() ){
+			viewpoints.push_back( glm::vec3( camera.frame[ 3 ] ) );
+		}
+		allocate( scene, viewpoints );
+		Log::info( "Shadow atlas: %u lights, %u faces, %.1f%% occupied, %u lights dropped.", (uint)lights.size(), (uint)faces.size(), 100.0f * occupancy, droppedLights );
 
-		const Scene::MeshRange& opaqueRange = scene.globalMeshMaterialRanges[Object::Material::OPAQUE];
-		drawCommands = std::make_unique<Buffer>( opaqueRange.count * sizeof( GPU::DrawCommand ), BufferType::INDIRECT, "ShadowDrawCommands" );
-		drawInstances = std::make_unique<Buffer>( opaqueRange.instanceCount * sizeof( uint ), BufferType::STORAGE, "ShadowDrawInstances" );
+		cachePath = path;
+		cachePending = !faces.empty();
+		if( !cachePending ){
+			return;
+		}
+		cacheKey = computeCacheKey( scene );
+		if( loadCache() ){
+			// Skip generation.
+			for( Face& face : faces ){
+				face.dirty = false;
+			}
+			renderedFaces = queuedFaces;
+			cachePending = false;
+			Log::info( "Loaded shadow atlas from %s.", cachePath.string().c_str() );
+		}
 	}
 
-	void renderMapIfNeeded(const Scene& scene){
-		rendering = false;
-		uint lightsCount = (uint)scene.world.lights().size();
-		if(currentLight >= lightsCount || currentMapLayer >= maps.depth){
-			return;
+	void reallocate(Scene& scene, const glm::vec3& viewpoint){
+		// The allocation now depends on the current view, keep the cached maps as they are.
+		if( cachePending ){
+			Log::warning( "Shadow atlas changed before generation completed, it won't be cached in this session." );
+			cachePending = false;
+		}
+		std::vector<glm::vec3> viewpoints = { viewpoint };
+		for( const World::Camera& camera : scene.world.cameras() ){
+			viewpoints.push_back( glm::vec3( camera.frame[ 3 ] ) );
 		}
-		// As long as we have a light left to process and enough room in the texture array.
+		allocate( scene, viewpoints );
+	}
+
+	void buildCasters(const Scene& scene){
 		const glm::mat4 pointViews[6] = {
 			glm::lookAt(glm::vec3(0.0f), glm::vec3(-1.0f,0.0f,0.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
 			glm::lookAt(glm::vec3(0.0f), glm::vec3( 1.0f,0.0f,0.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
@@ -715,55 +832,331 @@ struct ShadowGeneration {
 			glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f,0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
 		};
 
-		// Find the next light and face to render.
-		uint currentLightFaceCount = scene.world.lights()[currentLight].type == World::Light::POINT ? 6u : 1u;
-		if(currentLightFace >= currentLightFaceCount){
-			// Look at following lights
-			++currentLight;
-			currentLightFace = 0u;
-			// Until we find a shadow casting one.
-			for(; currentLight < lightsCount; ++currentLight){
-				if(scene.world.lights()[currentLight].shadow){
+		lights.clear();
+		faces.clear();
+		const uint lightsCount = (uint)scene.world.lights().size();
+		lookup.assign( lightsCount, uint( World::Light::NO_SHADOW ) );
+
+		// Render opaques, skip decals and transparent.
+		const Scene::MeshRange& range = scene.globalMeshMaterialRanges[Object::Material::OPAQUE];
+		std::vector<GPU::DrawCommand> commands;
+		std::vector<glm::uvec2> infos;
+		std::vector<uint> instances;
+		std::vector<uint> candidates;
+		std::vector<uint> casters;
+
+		for( uint lid = 0; lid < lightsCount; ++lid ){
+			const World::Light& worldLight = scene.world.lights()[ lid ];
+			if( !worldLight.shadow ){
+				continue;
+			}
+			const Scene::LightInfos& lightInfos = scene.lightInfos->data[ lid ];
+			const bool isPointLight = worldLight.type == World::Light::POINT;
+			const glm::vec3 position( lightInfos.positionAndMaxRadius );
+			const float radius = lightInfos.positionAndMaxRadius.w;
+
+			lookup[ lid ] = (uint)lights.size();
+			Light& light = lights.emplace_back();
+			light.light = lid;
+			light.firstFace = (uint)faces.size();
+			light.faceCount = isPointLight ? 6u : 1u;
+
+			// Point lights only reach instances in their sphere of influence, other lights are bounded by their frustum.
+			candidates.clear();
+			if( !scene.instancesBVH.empty() ){
+				if( isPointLight ){
+					scene.instancesBVH.query( BoundingBox( position - glm::vec3( radius ), position + glm::vec3( radius ) ), candidates );
+				} else {
+					scene.instancesBVH.query( Frustum( lightInfos.vp ), candidates );
+				}
+			}
+
+			for( uint fid = 0; fid < light.faceCount; ++fid ){
+				Face& face = faces.emplace_back();
+				face.light = (uint)lights.size() - 1u;
+				face.vp = lightInfos.vp;
+				if( isPointLight ){
+					face.vp = lightInfos.vp * glm::translate( pointViews[ fid ], -position );
+				}
+
+				const Frustum frustum( face.vp );
+				casters.clear();
+				for( const uint iid : candidates ){
+					const Scene::InstanceCPUInfos& instance = scene.instanceDebugInfos[ iid ];
+					if( instance.meshIndex < range.firstIndex || instance.meshIndex >= range.firstIndex + range.count ){
+						continue;
+					}
+					if( isPointLight && !frustum.intersects( instance.bbox ) ){
+						continue;
+					}
+					casters.push_back( iid );
+				}
+				// Group casters by mesh, with one draw command per mesh.
+				std::sort( casters.begin(), casters.end(), [&scene]( uint a, uint b ){
+					const uint meshA = scene.instanceDebugInfos[ a ].meshIndex;
+					const uint meshB = scene.instanceDebugInfos[ b ].meshIndex;
+					return meshA < meshB || ( meshA == meshB && a < b );
+				} );
+
+				face.firstCommand = (uint)commands.size();
+				size_t cid = 0u;
+				while( cid < casters.size() ){
+					const uint meshIndex = scene.instanceDebugInfos[ casters[ cid ] ].meshIndex;
+					const Scene::MeshInfos& mesh = scene.meshInfos->data[ meshIndex ];
+					GPU::DrawCommand& command = commands.emplace_back();
+					command.indexCount = mesh.indexCount;
+					command.instanceCount = 0u;
+					command.firstIndex = mesh.firstIndex;
+					command.vertexOffset = int32_t( mesh.vertexOffset );
+					command.firstInstance = 0u;
+					infos.emplace_back( meshIndex, (uint)instances.size() );
+					for( ; cid < casters.size() && scene.instanceDebugInfos[ casters[ cid ] ].meshIndex == meshIndex; ++cid ){
+						instances.push_back( casters[ cid ] );
+						++command.instanceCount;
+					}
+				}
+				face.commandCount = (uint)commands.size() - face.firstCommand;
+				face.casterCount = (uint)casters.size();
+				light.casters += face.casterCount;
+			}
+		}
+
+		// Buffers can't be empty.
+		if( commands.empty() ){
+			commands.emplace_back();
+			infos.emplace_back( 0u );
+		}
+		if( instances.empty() ){
+			instances.push_back( 0u );
+		}
+		drawCommands = std::make_unique<Buffer>( commands.size() * sizeof( GPU::DrawCommand ), BufferType::INDIRECT, "ShadowDrawCommands" );
+		drawInfos = std::make_unique<Buffer>( infos.size() * sizeof( glm::uvec2 ), BufferType::STORAGE, "ShadowDrawInfos" );
+		drawInstances = std::make_unique<Buffer>( instances.size() * sizeof( uint ), BufferType::STORAGE, "ShadowDrawInstances" );
+		drawCommands->upload( commands );
+		drawInfos->upload( infos );
+		drawInstances->upload( instances );
+
+		tiles = std::make_unique<StructuredBuffer<glm::vec4>>( std::max( faces.size(), size_t( 1u ) ), BufferType::STORAGE, "ShadowTiles" );
+	}
+
+	float lightImportance(const Scene::LightInfos& infos, const std::vector<glm::vec3>& viewpoints) const {
+		const glm::vec3 position( infos.positionAndMaxRadius );
+		const float radius = infos.positionAndMaxRadius.w;
+		// Lights reaching a large part of the scene, or covering a large part of the screen, need more resolution.
+		float importance = radius / sceneRadius;
+		for( const glm::vec3& viewpoint : viewpoints ){
+			const float distance = glm::distance( viewpoint, position );
+			const float coverage = distance <= radius ? 1.0f : radius / ( distance * SHADOW_COVERAGE_TAN_HALF_FOV );
+			importance = std::max( importance, coverage );
+		}
+		return glm::clamp( importance, 0.0f, 1.0f );
+	}
+
+	void allocate(Scene& scene, const std::vector<glm::vec3>& viewpoints){
+		// Pick the smallest power-of-two tile matching the importance of each enabled light.
+		uint64_t usedArea = 0u;
+		for( Light& light : lights ){
+			const Scene::LightInfos& infos = scene.lightInfos->data[ light.light ];
+			light.importance = lightImportance( infos, viewpoints );
+			light.tileSize = 0u;
+			if( infos.enabled == 0u ){
+				continue;
+			}
+			light.tileSize = SHADOW_TILE_MIN;
+			while( light.tileSize < SHADOW_TILE_MAX && float( light.tileSize ) < light.importance * float( SHADOW_TILE_MAX ) ){
+				light.tileSize *= 2u;
+			}
+			usedArea += uint64_t( light.faceCount ) * light.tileSize * light.tileSize;
+		}
+
+		// Shrink the least important lights first until all tiles fit, then drop them.
+		std::vector<uint> order( lights.size() );
+		std::iota( order.begin(), order.end(), 0u );
+		std::stable_sort( order.begin(), order.end(), [this]( uint a, uint b ){
+			return lights[ a ].importance < lights[ b ].importance;
+		} );
+		const uint64_t atlasArea = uint64_t( SHADOW_ATLAS_SIZE ) * SHADOW_ATLAS_SIZE;
+		droppedLights = 0u;
+		while( usedArea > atlasArea ){
+			Light* shrunk = nullptr;
+			for( const uint lid : order ){
+				if( lights[ lid ].tileSize > SHADOW_TILE_MIN ){
+					shrunk = &lights[ lid ];
+					break;
+				}
+			}
+			if( shrunk ){
+				const uint64_t size = shrunk->tileSize;
+				usedArea -= shrunk->faceCount * ( size * size - ( size / 2u ) * ( size / 2u ) );
+				shrunk->tileSize /= 2u;
+				continue;
+			}
+			for( const uint lid : order ){
+				Light& light = lights[ lid ];
+				if( light.tileSize != 0u ){
+					usedArea -= uint64_t( light.faceCount ) * light.tileSize * light.tileSize;
+					light.tileSize = 0u;
+					++droppedLights;
 					break;
 				}
 			}
 		}
-		// None.
-		if(currentLight >= lightsCount){
-			return;
+
+		// Place tiles from the largest, power-of-two squares are split without leaving unusable gaps.
+		std::vector<uint> faceOrder;
+		for( uint fid = 0; fid < faces.size(); ++fid ){
+			if( lights[ faces[ fid ].light ].tileSize != 0u ){
+				faceOrder.push_back( fid );
+			}
+		}
+		std::stable_sort( faceOrder.begin(), faceOrder.end(), [this]( uint a, uint b ){
+			return lights[ faces[ a ].light ].tileSize > lights[ faces[ b ].light ].tileSize;
+		} );
+		// Free squares, as position and size.
+		std::vector<glm::uvec3> freeSquares = { glm::uvec3( 0u, 0u, SHADOW_ATLAS_SIZE ) };
+		std::vector<bool> placed( faces.size(), false );
+		for( const uint fid : faceOrder ){
+			Face& face = faces[ fid ];
+			const uint size = lights[ face.light ].tileSize;
+			// Smallest free square that can contain the tile.
+			size_t best = freeSquares.size();
+			for( size_t sid = 0; sid < freeSquares.size(); ++sid ){
+				if( freeSquares[ sid ].z >= size && ( best == freeSquares.size() || freeSquares[ sid ].z < freeSquares[ best ].z ) ){
+					best = sid;
+				}
+			}
+			assert( best != freeSquares.size() );
+			glm::uvec3 square = freeSquares[ best ];
+			freeSquares[ best ] = freeSquares.back();
+			freeSquares.pop_back();
+			while( square.z > size ){
+				const uint half = square.z / 2u;
+				freeSquares.emplace_back( square.x + half, square.y, half );
+				freeSquares.emplace_back( square.x, square.y + half, half );
+				freeSquares.emplace_back( square.x + half, square.y + half, half );
+				square.z = half;
+			}
+			// Only render tiles that moved or changed size.
+			const glm::uvec2 offset( square.x, square.y );
+			face.dirty = face.dirty || face.tileSize != size || face.tileOffset != offset;
+			face.tileSize = size;
+			face.tileOffset = offset;
+			placed[ fid ] = true;
 		}
 
-		GPU::pushMarker( "Shadow map" );
-		const Scene::LightInfos& infos = ( *scene.lightInfos )[ currentLight ];
-		const bool isPointLight = scene.world.lights()[ currentLight ].type == World::Light::POINT;
-		uint layerId = currentLightFace;
+		uint64_t tilesArea = 0u;
+		queuedFaces = 0u;
+		renderedFaces = 0u;
+		for( uint fid = 0; fid < faces.size(); ++fid ){
+			Face& face = faces[ fid ];
+			if( !placed[ fid ] ){
+				face.tileSize = 0u;
+				face.dirty = false;
+			}
+			queuedFaces += face.dirty ? 1u : 0u;
+			tilesArea += uint64_t( face.tileSize ) * face.tileSize;
+			const float scale = float( face.tileSize ) / float( SHADOW_ATLAS_SIZE );
+			( *tiles )[ fid ] = glm::vec4( glm::vec2( face.tileOffset ) / float( SHADOW_ATLAS_SIZE ), scale, scale );
+		}
+		occupancy = float( double( tilesArea ) / double( atlasArea ) );
 
-		// Shadow map projection
-		glm::mat4 vp = infos.vp;
-		if( isPointLight ){
-			vp = infos.vp * glm::translate(pointViews[layerId], -glm::vec3(infos.positionAndMaxRadius));
+		for( const Light& light : lights ){
+			( *scene.lightInfos )[ light.light ].shadow = light.tileSize != 0u ? light.firstFace : uint( World::Light::NO_SHADOW );
 		}
+		tiles->upload();
+		scene.lightInfos->upload();
+	}
 
-		// Render opaques, skip decals and transparent.
-		const auto& range = scene.globalMeshMaterialRanges[Object::Material::OPAQUE];
-		shadowInfos[ 0 ].vp = vp;
-		shadowInfos[ 0 ].vpCulling = vp;
-		shadowInfos[ 0 ].skipCulling = 0;
-		shadowInfos[ 0 ].meshCount = range.count;
-		shadowInfos.upload();
-
-		// Draw commands for the shadow maps.
-		drawArgsCompute->use();
-		drawArgsCompute->buffer( shadowInfos, 0 );
-		drawArgsCompute->buffer( *scene.meshInfos, 1 );
-		drawArgsCompute->buffer( *scene.instanceInfos, 2 );
-		drawArgsCompute->buffer( *drawCommands, 3 );
-		drawArgsCompute->buffer( *drawInstances, 4 );
-
-		GPU::dispatch( range.count, 1, 1 );
-
-		GPU::bindFramebuffer( currentMapLayer, 0, 0.0f, LoadOperation::DONTCARE, LoadOperation::DONTCARE, &maps, nullptr, nullptr, nullptr, nullptr );
-		GPU::setViewport( maps );
+	uint64_t computeCacheKey(const Scene& scene) const {
+		// Lights can be toggled at runtime, and tiles are hashed separately.
+		std::vector<Scene::LightInfos> lightInfos = scene.lightInfos->data;
+		for( Scene::LightInfos& light : lightInfos ){
+			light.enabled = 0u;
+			light.shadow = 0u;
+		}
+		std::vector<glm::mat4> frames;
+		frames.reserve( scene.instanceInfos->size() );
+		for( const Scene::MeshInstanceInfos& instance : scene.instanceInfos->data ){
+			frames.push_back( instance.frame );
+		}
+		const std::vector<glm::vec3>& positions = scene.globalMesh.positions;
+		const std::vector<unsigned int>& indices = scene.globalMesh.indices;
+		const std::vector<Scene::MeshInfos>& meshes = scene.meshInfos->data;
+		const std::vector<Scene::MaterialInfos>& materials = scene.materialInfos->data;
+
+		const uint64_t keyData[] = {
+			System::hash64( lightInfos.data(), lightInfos.size() * sizeof( Scene::LightInfos ) ),
+			System::hash64( positions.data(), positions.size() * sizeof( glm::vec3 ) ),
+			System::hash64( indices.data(), indices.size() * sizeof( unsigned int ) ),
+			System::hash64( meshes.data(), meshes.size() * sizeof( Scene::MeshInfos ) ),
+			System::hash64( frames.data(), frames.size() * sizeof( glm::mat4 ) ),
+			System::hash64( materials.data(), materials.size() * sizeof( Scene::MaterialInfos ) ),
+			System::hash64( tiles->data.data(), tiles->size() * sizeof( glm::vec4 ) ),
+			atlas.width, atlas.height,
+			SHADOW_CACHE_VERSION,
+		};
+		return System::hash64( keyData, sizeof( keyData ) );
+	}
+
+	/** \return the atlas rectangle of each face with a tile, as (x, y, width, height) */
+	std::vector<glm::uvec4> tileRegions() const {
+		std::vector<glm::uvec4> regions;
+		for( const Face& face : faces ){
+			if( face.tileSize != 0u ){
+				regions.emplace_back( face.tileOffset, face.tileSize, face.tileSize );
+			}
+		}
+		return regions;
+	}
+
+	bool loadCache(){
+		ScenePack pack;
+		if( !fs::exists( cachePath ) || !pack.load( cachePath, cacheKey ) ){
+			return false;
+		}
+		std::vector<glm::uvec4> regions;
+		std::vector<char> depth;
+		if( !pack.read( ScenePack::SHADOW_INFOS, regions ) || !pack.read( ScenePack::SHADOW_DEPTH, depth ) ){
+			return false;
+		}
+		// Only occupied tiles are stored.
+		if( regions != tileRegions() ){
+			return false;
+		}
+		GPU::uploadTextureRegions( atlas, regions, depth );
+		return true;
+	}
+
+	void saveCache(){
+		// Only try once, even if the maps can't be saved.
+		cachePending = false;
+		// Read back the tiles rendered in previous frames, waiting for their completion.
+		const std::vector<glm::uvec4> regions = tileRegions();
+		std::vector<char> depth;
+		if( regions.empty() || !GPU::downloadTextureRegionsSync( atlas, regions, depth ) ){
+			return;
+		}
+		ScenePack::Writer writer;
+		writer.add( ScenePack::SHADOW_INFOS, regions );
+		writer.add( ScenePack::SHADOW_DEPTH, depth );
+		if( writer.save( cachePath, cacheKey ) ){
+			Log::info( "Saved shadow atlas to %s.", cachePath.string().c_str() );
+		}
+	}
+
+	void renderMapIfNeeded(const Scene& scene){
+		rendering = false;
+		if( renderedFaces >= queuedFaces ){
+			// All tiles have been rendered in previous frames, before anything is recorded in this one.
+			if( cachePending ){
+				saveCache();
+			}
+			return;
+		}
+
+		GPU::pushMarker( "Shadow maps" );
+		// Preserve the other tiles.
+		GPU::bindFramebuffer( 0, 0, LoadOperation::LOAD, LoadOperation::DONTCARE, LoadOperation::DONTCARE, &atlas, nullptr, nullptr, nullptr, nullptr );
 
 		GPU::setPolygonState( PolygonMode::FILL );
 		GPU::setCullState( false );
@@ -771,19 +1164,43 @@ struct ShadowGeneration {
 		GPU::setBlendState( false );
 		GPU::setColorState( false, false, false, false );
 
-		shadowInstancedObject->use();
-		shadowInstancedObject->buffer( shadowInfos, 0 );
-		shadowInstancedObject->buffer( *scene.meshInfos, 1 );
-		shadowInstancedObject->buffer( *scene.instanceInfos, 2 );
-		shadowInstancedObject->buffer( *scene.materialInfos, 3 );
-		shadowInstancedObject->buffer( *drawInstances, 4 );
+		uint budget = SHADOW_FACES_PER_FRAME;
+		for( Face& face : faces ){
+			if( !face.dirty ){
+				continue;
+			}
+			if( budget == 0u ){
+				break;
+			}
+			--budget;
+			face.dirty = false;
+			++renderedFaces;
+
+			const int x = int( face.tileOffset.x );
+			const int y = int( face.tileOffset.y );
+			const int size = int( face.tileSize );
+			GPU::setViewport( x, y, size, size );
+			GPU::clearDepthRegion( 0.0f, x, y, size, size );
+			if( face.commandCount == 0u ){
+				continue;
+			}
 
-		GPU::drawIndirectMesh(scene.globalMesh, *drawCommands, range.firstIndex, range.count);
+			shadowInfos[ 0 ].vp = face.vp;
+			shadowInfos[ 0 ].vpCulling = face.vp;
+			shadowInfos.upload();
 
-		GPU::popMarker();
+			shadowInstancedObject->use();
+			shadowInstancedObject->buffer( shadowInfos, 0 );
+			shadowInstancedObject->buffer( *scene.meshInfos, 1 );
+			shadowInstancedObject->buffer( *scene.instanceInfos, 2 );
+			shadowInstancedObject->buffer( *scene.materialInfos, 3 );
+			shadowInstancedObject->buffer( *drawInstances, 4 );
+			shadowInstancedObject->buffer( *drawInfos, 5 );
 
-		++currentMapLayer;
-		++currentLightFace;
+			GPU::drawIndirectMesh( scene.globalMesh, *drawCommands, face.firstCommand, face.commandCount );
+		}
+
+		GPU::popMarker();
 		rendering = true;
 	}
 };
@@ -799,6 +1216,177 @@ uint upperMultiple( uint a, uint b){
 	return (a + b - 1u) / b;
 }
 
+bool savePassTimingsCSV(const std::vector<std::vector<GPU::PassTiming>>& frames, const fs::path& path){
+	FILE* file = fopen(path.string().c_str(), "w");
+	if(!file){
+		Log::error("Unable to save pass timings to %s.", path.string().c_str());
+		return false;
+	}
+	fprintf(file, "frame,pass,depth,gpu_ms,cpu_ms\n");
+	for(size_t fid = 0; fid < frames.size(); ++fid){
+		for(const GPU::PassTiming& timing : frames[fid]){
+			std::string name = timing.name;
+			std::replace(name.begin(), name.end(), ',', ';');
+			fprintf(file, "%lu,%s,%u,%.4f,%.4f\n", fid, name.c_str(), timing.depth, timing.gpu, timing.cpu);
+		}
+	}
+	fclose(file);
+	Log::info("Saved pass timings for %lu frames to %s.", frames.size(), path.string().c_str());
+	return true;
+}
+
+bool savePassTimingsJSON(const std::vector<std::vector<GPU::PassTiming>>& frames, const fs::path& path){
+	FILE* file = fopen(path.string().c_str(), "w");
+	if(!file){
+		Log::error("Unable to save pass timings to %s.", path.string().c_str());
+		return false;
+	}
+	fprintf(file, "{\"frames\":[\n");
+	for(size_t fid = 0; fid < frames.size(); ++fid){
+		fprintf(file, "{\"frame\":%lu,\"passes\":[", fid);
+		const size_t passCount = frames[fid].size();
+		for(size_t pid = 0; pid < passCount; ++pid){
+			const GPU::PassTiming& timing = frames[fid][pid];
+			std::string name = timing.name;
+			std::replace(name.begin(), name.end(), '"', '\'');
+			std::replace(name.begin(), name.end(), '\\', '/');
+			fprintf(file, "{\"name\":\"%s\",\"depth\":%u,\"gpu\":%.4f,\"cpu\":%.4f}%s", name.c_str(), timing.depth, timing.gpu, timing.cpu, pid + 1 == passCount ? "" : ",");
+		}
+		fprintf(file, "]}%s\n", fid + 1 == frames.size() ? "" : ",");
+	}
+	fprintf(file, "]}\n");
+	fclose(file);
+	Log::info("Saved pass timings for %lu frames to %s.", frames.size(), path.string().c_str());
+	return true;
+}
+
+/** \brief Instances remaining after each CPU culling step, from a culling viewpoint. */
+struct CullingStatistics {
+	uint frustum = 0u; ///< Instances in the view frustum.
+	uint zones = 0u; ///< Instances in zones visible through portals.
+	uint volumes = 0u; ///< Instances in the frusta clipped by portals.
+};
+
+CullingStatistics computeCullingStatistics(const Scene& scene, const glm::mat4& vpCulling, const PortalGraph::Visibility& visibility){
+	CullingStatistics stats;
+	std::vector<uint> frustumInstances;
+	scene.instancesBVH.query(Frustum(vpCulling), frustumInstances);
+	stats.frustum = (uint)frustumInstances.size();
+	if(!visibility.culled){
+		stats.zones = stats.volumes = stats.frustum;
+		return stats;
+	}
+	for(const uint iid : frustumInstances){
+		const Scene::InstanceCPUInfos& infos = scene.instanceDebugInfos[iid];
+		if(infos.zone >= visibility.zones.size()){
+			++stats.zones;
+			++stats.volumes;
+			continue;
+		}
+		if(!visibility.zones[infos.zone]){
+			continue;
+		}
+		++stats.zones;
+		for(const ConvexVolume& volume : visibility.volumes[infos.zone]){
+			if(volume.intersects(infos.bbox)){
+				++stats.volumes;
+				break;
+			}
+		}
+	}
+	return stats;
+}
+
+/** \brief Statistics measured for a benchmark frame. */
+struct BenchmarkFrame {
+	std::string world; ///< World name.
+	uint frame = 0u; ///< Frame index along the camera path.
+	double cpu = 0.0; ///< CPU time spent preparing and recording the frame, in milliseconds.
+	double gpu = 0.0; ///< GPU time of all top-level passes, in milliseconds.
+	double wall = 0.0; ///< Duration between the start of this frame and of the next one, in milliseconds.
+	unsigned long long drawCalls = 0u; ///< Draw calls recorded.
+	CullingStatistics culling; ///< Instances remaining after CPU culling steps.
+};
+
+double percentile(std::vector<double> values, double ratio){
+	if(values.empty()){
+		return 0.0;
+	}
+	std::sort(values.begin(), values.end());
+	// Nearest rank.
+	const size_t rank = (size_t)std::ceil(ratio * double(values.size()));
+	return values[std::min(std::max(rank, size_t(1u)), values.size()) - 1u];
+}
+
+bool saveBenchmarkCSV(const std::vector<BenchmarkFrame>& frames, const fs::path& path){
+	FILE* file = fopen(path.string().c_str(), "w");
+	if(!file){
+		Log::error("Unable to save benchmark results to %s.", path.string().c_str());
+		return false;
+	}
+	fprintf(file, "world,frame,cpu_ms,gpu_ms,wall_ms,draw_calls,frustum_instances,zone_instances,portal_instances\n");
+	for(const BenchmarkFrame& frame : frames){
+		fprintf(file, "%s,%u,%.4f,%.4f,%.4f,%llu,%u,%u,%u\n", frame.world.c_str(), frame.frame, frame.cpu, frame.gpu, frame.wall,
+				frame.drawCalls, frame.culling.frustum, frame.culling.zones, frame.culling.volumes);
+	}
+	fclose(file);
+	Log::info("Saved benchmark results for %lu frames to %s.", frames.size(), path.string().c_str());
+	return true;
+}
+
+bool saveBenchmarkJSON(const std::vector<BenchmarkFrame>& frames, const fs::path& path){
+	FILE* file = fopen(path.string().c_str(), "w");
+	if(!file){
+		Log::error("Unable to save benchmark results to %s.", path.string().c_str());
+		return false;
+	}
+	// Summarize each world, in order of appearance.
+	std::vector<std::string> worlds;
+	for(const BenchmarkFrame& frame : frames){
+		if(worlds.empty() || worlds.back() != frame.world){
+			worlds.push_back(frame.world);
+		}
+	}
+	fprintf(file, "{\"worlds\":[\n");
+	for(size_t wid = 0; wid < worlds.size(); ++wid){
+		std::vector<double> cpu, gpu, wall;
+		double drawCalls = 0.0;
+		double frustum = 0.0;
+		double zones = 0.0;
+		double volumes = 0.0;
+		for(const BenchmarkFrame& frame : frames){
+			if(frame.world != worlds[wid]){
+				continue;
+			}
+			cpu.push_back(frame.cpu);
+			gpu.push_back(frame.gpu);
+			wall.push_back(frame.wall);
+			drawCalls += double(frame.drawCalls);
+			frustum += double(frame.culling.frustum);
+			zones += double(frame.culling.zones);
+			volumes += double(frame.culling.volumes);
+		}
+		const double count = std::max(double(cpu.size()), 1.0);
+		fprintf(file, "{\"world\":\"%s\",\"frames\":%lu,", worlds[wid].c_str(), cpu.size());
+		const std::vector<std::pair<const char*, const std::vector<double>*>> series = { {"cpu", &cpu}, {"gpu", &gpu}, {"wall", &wall} };
+		for(const auto& serie : series){
+			const std::vector<double>& values = *serie.second;
+			const double mean = std::accumulate(values.begin(), values.end(), 0.0) / count;
+			fprintf(file, "\"%s\":{\"mean\":%.4f,\"p50\":%.4f,\"p95\":%.4f,\"p99\":%.4f,\"max\":%.4f},", serie.first, mean,
+					percentile(values, 0.50), percentile(values, 0.95), percentile(values, 0.99), percentile(values, 1.0));
+		}
+		fprintf(file, "\"drawCalls\":%.1f,\"frustumInstances\":%.1f,\"zoneInstances\":%.1f,\"portalInstances\":%.1f}%s\n",
+				drawCalls / count, frustum / count, zones / count, volumes / count, wid + 1 == worlds.size() ? "" : ",");
+
+		Log::info("Benchmark %s: CPU %.2fms (p95 %.2fms), GPU %.2fms (p95 %.2fms), frame %.2fms (p99 %.2fms), %.0f draw calls.", worlds[wid].c_str(),
+				  percentile(cpu, 0.50), percentile(cpu, 0.95), percentile(gpu, 0.50), percentile(gpu, 0.95), percentile(wall, 0.50), percentile(wall, 0.99), drawCalls / count);
+	}
+	fprintf(file, "]}\n");
+	fclose(file);
+	Log::info("Saved benchmark summary for %lu worlds to %s.", worlds.size(), path.string().c_str());
+	return true;
+}
+
 int main(int argc, char ** argv) {
 
 	// FIXME:
@@ -820,7 +1408,10 @@ int main(int argc, char ** argv) {
 	const std::string iniPath = (APP_RESOURCE_DIRECTORY / "imgui.ini").string();
 
 	Window window("eXperience112 viewer", config, allowEscapeQuit);
-	ImGui::GetIO().IniFilename = iniPath.c_str();
+	// Offscreen, don't restore nor overwrite the interactive layout.
+	if(!config.headless){
+		ImGui::GetIO().IniFilename = iniPath.c_str();
+	}
 
 	// Try to load configuration.
 	GameFiles gameFiles;
@@ -845,6 +1436,10 @@ int main(int argc, char ** argv) {
 
 	// Rendering
 
+	// Compiled shaders are cached next to the resources.
+	ShaderCompiler::setCacheDirectory(APP_RESOURCE_DIRECTORY.parent_path() / "cache" / "shaders");
+	const auto programsStart = std::chrono::steady_clock::now();
+
 	std::vector<ProgramInfos> programPool;
 
 	programPool.push_back(loadProgram("texture_passthrough", "debug/texture_debug"));
@@ -880,9 +1475,6 @@ int main(int argc, char ** argv) {
 	programPool.push_back(loadProgram("objects/object_instanced_debug", "objects/object_instanced_debug"));
 	Program* debugInstancedObject = programPool.back().program;
 
-	programPool.push_back(loadProgram("objects/object_instanced_selection", "objects/object_instanced_selection"));
-	Program* selectionObject = programPool.back().program;
-
 	programPool.push_back(loadProgram("objects/object_billboard", "objects/object_billboard"));
 	Program* billboardObject = programPool.back().program;
 
@@ -913,7 +1505,19 @@ int main(int argc, char ** argv) {
 	programPool.push_back(loadProgram("sort/sort_reorder"));
 	Program* sortReorder = programPool.back().program;
 
+	reload(programPool);
+
+	{
+		const auto programsEnd = std::chrono::steady_clock::now();
+		const double duration = std::chrono::duration<double, std::milli>(programsEnd - programsStart).count();
+		const ShaderCompiler::CacheStatistics stats = ShaderCompiler::cacheStatistics();
+		Log::info("Loaded %u programs in %.1fms (shader cache: %u stages loaded in %.1fms, %u compiled in %.1fms).", (uint)programPool.size(), duration,
+				  stats.hits, stats.hitTime, stats.misses, stats.missTime);
+	}
+
 	UniformBuffer<FrameData> frameInfos(1, 64, "FrameInfos");
+	PortalGraph::Visibility zonesVisibility;
+	glm::vec3 cullingPosition(0.0f);
 	UniformBuffer<TransparentFrameData> transparentInfos(1, 16, "TransparentInfos");
 	UniformBuffer<glm::vec2> blurInfosV(1, 2, "BlurInfosV");
 	UniformBuffer<glm::vec2> blurInfosH(1, 2, "BlurInfosH");
@@ -947,9 +1551,6 @@ int main(int argc, char ** argv) {
 	Texture::setupRendertarget(textureView, Layout::RGBA8, 512, 512);
 	GPU::clearTexture(textureView, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
 
-	Texture selectionColor("selection");
-	Texture::setupRendertarget(selectionColor, Layout::RG8, renderRes[0], renderRes[1]);
-
 	glm::ivec2 clusterDims(CLUSTER_XY_SIZE, CLUSTER_Z_COUNT);
 
 	Texture lightClusters("lightClusters");
@@ -995,12 +1596,21 @@ int main(int argc, char ** argv) {
 	DebugVisualisation debug;
 
 	ShadowGeneration shadow;
-	Texture::setupRendertarget(shadow.maps, Layout::DEPTH_COMPONENT32F, 512, 512, 1, TextureShape::Array2D, 16);
-	shadow.drawArgsCompute = drawArgsCompute;
+	Texture::setupRendertarget(shadow.atlas, Layout::DEPTH_COMPONENT32F, SHADOW_ATLAS_SIZE, SHADOW_ATLAS_SIZE, 1, TextureShape::D2, 1);
 	shadow.shadowInstancedObject = shadowInstancedObject;
 
 	// Data storage.
 	Scene scene;
+	scene.options = config.sceneOptions;
+
+	if(config.buildPacks){
+		uint builtCount = 0u;
+		for(const fs::path& worldPath : gameFiles.worldsList){
+			Log::info("Building pack for %s...", worldPath.filename().string().c_str());
+			builtCount += scene.buildPack(worldPath, gameFiles) ? 1u : 0u;
+		}
+		Log::info("Scene packs: %u/%u worlds up to date.", builtCount, (uint)gameFiles.worldsList.size());
+	}
 
 	// GUi state
 	enum class ViewerMode {
@@ -1028,7 +1638,7 @@ int main(int argc, char ** argv) {
 	bool updateInstanceBoundingBox = false;
 	bool scrollToItem = false;
 
-	auto uploadScene = [&] ()
+	auto uploadScene = [&] (const fs::path& sourcePath)
 	{
 		// Allocate commands buffer.
 		const size_t meshCount = scene.meshInfos->size();
@@ -1043,7 +1653,7 @@ int main(int argc, char ** argv) {
 		const uint sortBatchesCount = upperMultiple(transparentRange.instanceCount, SORT_ITEMS_PER_BATCH);
 		atomicBinCounters = std::make_unique<Buffer>(sortBatchesCount * SORT_BIN_COUNT * sizeof(uint32_t), BufferType::STORAGE, "BinCounters");
 
-		shadow.setup(scene);
+		shadow.setup(scene, ScenePack::shadowsPath(gameFiles.resourcesPath, sourcePath));
 
 		// Center camera
 		if( scene.world.cameras().empty() )
@@ -1081,7 +1691,7 @@ int main(int argc, char ** argv) {
 		const fs::path worldpath = gameFiles.worldsPath / "tutoeco.world";
 		viewMode = ViewerMode::WORLD;
 		scene.load( worldpath, gameFiles );
-		uploadScene();
+		uploadScene( worldpath );
 		selected.item = 0;
 		for( const auto& world : gameFiles.worldsList ){
 			if( world.filename() == worldpath.filename() )
@@ -1095,7 +1705,147 @@ int main(int argc, char ** argv) {
 	
 #endif
 
+#ifdef PROFILER_ENABLED
+	std::vector<Profiler::Event> profilerEvents;
+	bool pauseProfiler = false;
+#endif
+	// Per-pass timings of the last frames, and frames recorded for export.
+	const size_t passHistorySize = 240;
+	std::deque<std::vector<GPU::PassTiming>> passHistory;
+	std::vector<std::vector<GPU::PassTiming>> passRecording;
+	bool recordingPasses = false;
+	std::string selectedPass;
+
+	// Camera path recorded from the interactive camera, for the given world.
+	CameraPath recordedPath;
+	fs::path recordedPathFile;
+	bool recordingPath = false;
+	auto cameraPathFile = [&config](const fs::path& worldPath){
+		return config.cameraPaths / (worldPath.stem().string() + ".path");
+	};
+
+	// Benchmark: worlds rendered offscreen along a camera path, and their per-frame statistics.
+	std::vector<size_t> benchmarkWorlds;
+	if(!config.benchmark.empty()){
+		for(size_t wid = 0; wid < gameFiles.worldsList.size(); ++wid){
+			const fs::path& worldPath = gameFiles.worldsList[wid];
+			if(config.benchmark == "all" || worldPath.filename() == config.benchmark || worldPath.stem() == config.benchmark){
+				benchmarkWorlds.push_back(wid);
+			}
+		}
+		if(benchmarkWorlds.empty()){
+			Log::error("Benchmark: no world matching %s.", config.benchmark.c_str());
+			window.perform(Window::Action::Quit);
+		}
+	}
+	// Shadow baking: all worlds are loaded in turn, until their shadow maps are generated and cached.
+	bool bakingShadows = config.bakeShadows && !gameFiles.worldsList.empty();
+	if(config.bakeShadows && !bakingShadows){
+		Log::error("Shadow baking: no world found.");
+		window.perform(Window::Action::Quit);
+	}
+	size_t bakeWorld = 0u;
+	bool bakeWorldLoaded = false;
+	// Benchmark once shadows are baked.
+	bool benchmarking = !benchmarkWorlds.empty() && !bakingShadows;
+	CameraPath benchmarkPath;
+	std::vector<BenchmarkFrame> benchmarkFrames;
+	size_t benchmarkWorld = 0u;
+	// Frames rendered for the current world, including warmup.
+	uint benchmarkFrame = 0u;
+	size_t benchmarkFirstSample = 0u;
+	const uint benchmarkWorldFrames = BENCHMARK_WARMUP_FRAMES + config.benchmarkFrames + BENCHMARK_GPU_LATENCY;
+	auto benchmarkSample = [&](uint frame) -> BenchmarkFrame* {
+		if(frame < BENCHMARK_WARMUP_FRAMES || frame - BENCHMARK_WARMUP_FRAMES >= config.benchmarkFrames){
+			return nullptr;
+		}
+		return &benchmarkFrames[benchmarkFirstSample + frame - BENCHMARK_WARMUP_FRAMES];
+	};
+
+	const auto firstFrameStart = std::chrono::steady_clock::now();
+	auto lastFrameStart = firstFrameStart;
 	while(window.nextFrame()) {
+		PROFILE_FRAME();
+		PROFILE_SCOPE("Frame");
+		const auto frameStart = std::chrono::steady_clock::now();
+
+		// Metrics of the first frame are available once it has been submitted.
+		if(frameIndex == 1){
+			const auto firstFrameEnd = std::chrono::steady_clock::now();
+			const double duration = std::chrono::duration<double, std::milli>(firstFrameEnd - firstFrameStart).count();
+			const GPU::Metrics& metrics = GPU::getMetrics();
+			Log::info("First frame: %.1fms, %llu pipelines created on first use, %llu created ahead of use.", duration, metrics.pipelineBuilds, metrics.prewarmedPipelines);
+		}
+
+		if(bakingShadows){
+			// Move to the next world once its shadow maps are cached.
+			if(bakeWorldLoaded && !shadow.cachePending){
+				++bakeWorld;
+				bakeWorldLoaded = false;
+			}
+			if(bakeWorld == gameFiles.worldsList.size()){
+				Log::info("Shadow baking: %u worlds processed.", (uint)bakeWorld);
+				bakingShadows = false;
+				benchmarking = !benchmarkWorlds.empty();
+				if(!benchmarking){
+					window.perform(Window::Action::Quit);
+				}
+			} else if(!bakeWorldLoaded){
+				const fs::path& worldPath = gameFiles.worldsList[bakeWorld];
+				Log::info("Shadow baking: %s (%u/%u).", worldPath.filename().string().c_str(), (uint)bakeWorld + 1u, (uint)gameFiles.worldsList.size());
+				viewMode = ViewerMode::WORLD;
+				selected.item = int(bakeWorld);
+				scene.load(worldPath, gameFiles);
+				uploadScene(worldPath);
+				bakeWorldLoaded = true;
+			}
+		}
+
+		if(benchmarking){
+			// Complete the statistics of previous frames, as they become available.
+			if(benchmarkFrame >= 1u){
+				if(BenchmarkFrame* sample = benchmarkSample(benchmarkFrame - 1u)){
+					sample->wall = std::chrono::duration<double, std::milli>(frameStart - lastFrameStart).count();
+					sample->drawCalls = GPU::getMetrics().drawCalls;
+				}
+			}
+			if(benchmarkFrame >= BENCHMARK_GPU_LATENCY){
+				if(BenchmarkFrame* sample = benchmarkSample(benchmarkFrame - BENCHMARK_GPU_LATENCY)){
+					for(const GPU::PassTiming& timing : GPU::getPassTimings()){
+						sample->gpu += timing.depth == 0u ? timing.gpu : 0.0;
+					}
+				}
+			}
+			// Move to the next world once all frames have been measured.
+			if(benchmarkFrame == benchmarkWorldFrames){
+				++benchmarkWorld;
+				benchmarkFrame = 0u;
+			}
+			if(benchmarkWorld == benchmarkWorlds.size()){
+				saveBenchmarkCSV(benchmarkFrames, config.benchmarkOutput.string() + ".csv");
+				saveBenchmarkJSON(benchmarkFrames, config.benchmarkOutput.string() + ".json");
+				window.perform(Window::Action::Quit);
+				benchmarking = false;
+			} else if(benchmarkFrame == 0u){
+				const size_t wid = benchmarkWorlds[benchmarkWorld];
+				const fs::path& worldPath = gameFiles.worldsList[wid];
+				viewMode = ViewerMode::WORLD;
+				camera.mode(ControllableCamera::Mode::FPS);
+				selected.item = int(wid);
+				scene.load(worldPath, gameFiles);
+				uploadScene(worldPath);
+				// Play back a recorded path if available, else visit the world cameras.
+				const fs::path pathFile = cameraPathFile(worldPath);
+				if(fs::exists(pathFile) && benchmarkPath.load(pathFile)){
+					Log::info("Benchmark: playing back %s (%u keyframes) over %u frames.", pathFile.string().c_str(), (uint)benchmarkPath.size(), config.benchmarkFrames);
+				} else {
+					benchmarkPath = CameraPath::fromWorld(scene.world);
+					Log::info("Benchmark: visiting %u world cameras over %u frames.", (uint)benchmarkPath.size(), config.benchmarkFrames);
+				}
+				benchmarkFirstSample = benchmarkFrames.size();
+			}
+		}
+		lastFrameStart = frameStart;
 
 		// Handle window resize.
 		if(Input::manager().resized()) {
@@ -1109,9 +1859,7 @@ int main(int argc, char ** argv) {
 
 		if(Input::manager().triggered(Input::Key::P)) {
 			// Load something.
-			for(ProgramInfos& infos : programPool){
-				reload(infos);
-			}
+			reload(programPool);
 		}
 
 		// Compute new time.
@@ -1135,6 +1883,17 @@ int main(int argc, char ** argv) {
 			remainingTime -= deltaTime;
 		}
 
+		// Benchmarks follow their camera path, from the first measured frame to the last.
+		if(benchmarking){
+			const uint measuredFrame = benchmarkFrame > BENCHMARK_WARMUP_FRAMES ? benchmarkFrame - BENCHMARK_WARMUP_FRAMES : 0u;
+			const float pathPosition = config.benchmarkFrames > 1u ? float(measuredFrame) / float(config.benchmarkFrames - 1u) : 0.0f;
+			benchmarkPath.apply(pathPosition, camera);
+		}
+		if(recordingPath){
+			recordedPath.record(camera);
+		}
+
+		PROFILE_BEGIN("Interface");
 		ImGui::DockSpaceOverViewport(nullptr, ImGuiDockNodeFlags_PassthruCentralNode);
 
 		const ImGuiTableFlags tableFlags = ImGuiTableFlags_ScrollY | ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersOuter | ImGuiTableFlags_BordersV | ImGuiTableFlags_Resizable;
@@ -1237,7 +1996,7 @@ int main(int argc, char ** argv) {
 									if(selected.item != row){
 										selected.item = row;
 										(scene.*tab.load)(itemPath, gameFiles);
-										uploadScene();
+										uploadScene(itemPath);
 									}
 								}
 								ImGui::TableNextColumn();
@@ -1298,7 +2057,7 @@ int main(int argc, char ** argv) {
 							const int rowCount = (int)scene.meshDebugInfos.size();
 							for(int row = 0; row < rowCount; ++row){
 
-								const Scene::MeshInfos& meshInfos = (*scene.meshInfos)[row];
+								const Scene::MeshInfos& meshInfos = scene.meshInfos->data[row];
 								const Scene::MeshCPUInfos& meshDebugInfos = scene.meshDebugInfos[row];
 								if(!meshFilter.PassFilter(meshDebugInfos.name.c_str())){
 									continue;
@@ -1392,15 +2151,18 @@ int main(int argc, char ** argv) {
 					if(ImGui::BeginTabItem(lightsTabName.c_str())){
 
 						bool lightsBufferDirty = false;
+						bool shadowAtlasDirty = false;
 						static ImGuiTextFilter lightFilter;
 						lightFilter.Draw();
+						ImGui::Text("Shadow atlas: %.1f%% occupied, %u lights, %u dropped", 100.0f * shadow.occupancy, (uint)shadow.lights.size(), shadow.droppedLights);
 
-						if(ImGui::BeginTable("#LightsList", 4, tableFlags, winSize)){
+						if(ImGui::BeginTable("#LightsList", 5, tableFlags, winSize)){
 							// Header
 							ImGui::TableSetupScrollFreeze(0, 1); // Make top row always visible
 							ImGui::TableSetupColumn("On", ImGuiTableColumnFlags_None);
 							ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_None);
 							ImGui::TableSetupColumn("Type", ImGuiTableColumnFlags_None);
+							ImGui::TableSetupColumn("Shadow", ImGuiTableColumnFlags_None);
 							ImGui::TableSetupColumn("Color", ImGuiTableColumnFlags_None);
 							ImGui::TableHeadersRow();
 
@@ -1411,12 +2173,17 @@ int main(int argc, char ** argv) {
 								if(!lightFilter.PassFilter(light.name.c_str())){
 									continue;
 								}
-								Scene::LightInfos& infos = ( *scene.lightInfos )[ row ];
+								// Read through a const reference, only modified lights are uploaded.
+								const Scene::LightInfos& infos = scene.lightInfos->data[ row ];
 
 								ImGui::TableNextColumn();
 								ImGui::PushID(row);
-								if(ImGui::CheckboxFlags("##On", &infos.enabled, 1)){
+								uint enabled = infos.enabled;
+								if(ImGui::CheckboxFlags("##On", &enabled, 1)){
+									( *scene.lightInfos )[ row ].enabled = enabled;
 									lightsBufferDirty = true;
+									// Shadow tiles are only reallocated and redrawn when a shadow casting light is toggled.
+									shadowAtlasDirty |= light.shadow;
 								}
 								ImGui::TableNextColumn();
 								if(ImGui::Selectable(light.name.c_str())){
@@ -1431,7 +2198,16 @@ int main(int argc, char ** argv) {
 									{ World::Light::SPOT, "Spot" },
 									{ World::Light::DIRECTIONAL, "Directional" },
 								};
-								ImGui::Text("%s (%u)", lightTypeNames.at(light.type), infos.shadow);
+								ImGui::Text("%s", lightTypeNames.at(light.type));
+								ImGui::TableNextColumn();
+								const uint shadowIndex = row < (int)shadow.lookup.size() ? shadow.lookup[row] : uint(World::Light::NO_SHADOW);
+								if(shadowIndex == World::Light::NO_SHADOW){
+									ImGui::TextUnformatted("-");
+								} else if(shadow.lights[shadowIndex].tileSize == 0u){
+									ImGui::Text("None, %u casters", shadow.lights[shadowIndex].casters);
+								} else {
+									ImGui::Text("%upx, %u casters", shadow.lights[shadowIndex].tileSize, shadow.lights[shadowIndex].casters);
+								}
 								ImGui::TableNextColumn();
 								glm::vec3 tmpColor = light.color;
 								ImGui::ColorEdit3("##LightColor", &tmpColor[0], ImGuiColorEditFlags_NoLabel | ImGuiColorEditFlags_NoInputs);
@@ -1441,7 +2217,10 @@ int main(int argc, char ** argv) {
 						}
 						ImGui::EndTabItem();
 
-						if(lightsBufferDirty){
+						if(shadowAtlasDirty){
+							// Also uploads the lights.
+							shadow.reallocate(scene, camera.position());
+						} else if(lightsBufferDirty){
 							scene.lightInfos->upload();
 						}
 					}
@@ -1596,8 +2375,8 @@ int main(int argc, char ** argv) {
 					int startRow = 0;
 					int rowCount = (int)scene.instanceDebugInfos.size();
 					if(selected.mesh >= 0){
-					   startRow = (int)(*scene.meshInfos)[selected.mesh].firstInstanceIndex;
-					   rowCount = (int)(*scene.meshInfos)[selected.mesh].instanceCount;
+					   startRow = (int)scene.meshInfos->data[selected.mesh].firstInstanceIndex;
+					   rowCount = (int)scene.meshInfos->data[selected.mesh].instanceCount;
 					}
 
 					ImGuiListClipper clipper;
@@ -1746,6 +2525,7 @@ int main(int argc, char ** argv) {
 				ImGui::CheckboxFlags("Skip objects", &frameInfos[0].skipCulling, SKIP_CULLING_OBJECTS);
 				ImGui::CheckboxFlags("Skip lights", &frameInfos[0].skipCulling, SKIP_CULLING_LIGHTS);
 				ImGui::CheckboxFlags("Skip zones", &frameInfos[0].skipCulling, SKIP_CULLING_ZONES);
+				ImGui::CheckboxFlags("Skip portals", &frameInfos[0].skipCulling, SKIP_CULLING_PORTALS);
 
 				if(ImGui::Checkbox("Freeze frustum", &debug.freezeCulling)){
 				 debug.camera.clean();
@@ -1755,6 +2535,20 @@ int main(int argc, char ** argv) {
 				 }
 			 }
 
+				// Portal culling statistics, for the current culling frustum.
+				ImGui::Text("Zones: %u, portals: %u", (uint)scene.portalGraph.zoneCount(), (uint)scene.portalGraph.portalCount());
+				if(zonesVisibility.culled){
+					const uint visibleZoneCount = (uint)std::count(zonesVisibility.zones.begin(), zonesVisibility.zones.end(), true);
+					const CullingStatistics culling = computeCullingStatistics(scene, frameInfos[0].vpCulling, zonesVisibility);
+					const float frustumCount = std::max(1.0f, float(culling.frustum));
+					ImGui::Text("Visible zones: %u, portals crossed: %u", visibleZoneCount, zonesVisibility.portalsTraversed);
+					ImGui::Text("Instances in frustum: %u", culling.frustum);
+					ImGui::Text("In visible zones: %u (%.1f%% culled)", culling.zones, 100.0f * (1.0f - float(culling.zones) / frustumCount));
+					ImGui::Text("In portal frusta: %u (%.1f%% culled)", culling.volumes, 100.0f * (1.0f - float(culling.volumes) / frustumCount));
+				} else {
+					ImGui::TextUnformatted("No portal culling from this viewpoint.");
+				}
+
 				ImGui::EndPopup();
 			}
 			ImGui::SameLine();
@@ -1765,6 +2559,33 @@ int main(int argc, char ** argv) {
 				camera.reset();
 				adjustCameraToBoundingBox(camera, scene.computeBoundingBox());
 			}
+			// Camera paths are stored per world, for benchmarks.
+			if(viewMode == ViewerMode::WORLD && selected.item >= 0){
+				ImGui::SameLine();
+				if(ImGui::Button(recordingPath ? "Stop and save path" : "Record path")){
+					if(recordingPath){
+						recordedPath.save(recordedPathFile);
+						Log::info("Saved camera path with %u keyframes to %s.", (uint)recordedPath.size(), recordedPathFile.string().c_str());
+					} else {
+						recordedPath.clear();
+						recordedPathFile = cameraPathFile(gameFiles.worldsList[selected.item]);
+					}
+					recordingPath = !recordingPath;
+				}
+				if(recordingPath){
+					ImGui::SameLine();
+					ImGui::Text("%u keyframes", (uint)recordedPath.size());
+				}
+			}
+
+			ImGui::Checkbox("Static batching (on load)", &scene.options.staticBatching);
+			if(scene.meshInfos){
+				const GPU::Metrics& metrics = GPU::getMetrics();
+				ImGui::Text("Meshes: %u, instances: %u, draw calls: %llu", (uint)scene.meshInfos->size(), (uint)scene.instanceInfos->size(), metrics.drawCalls);
+				ImGui::Text("Staging: %llu uploads, %.2fMB (%llu dedicated), %llu blocks", metrics.stagingAllocations, double(metrics.stagingBytes) / (1024.0 * 1024.0), metrics.stagingDedicated, metrics.stagingBlocks);
+				ImGui::Text("Buffer uploads: %.2fKB", double(metrics.bufferUploadBytes) / 1024.0);
+				ImGui::Text("Descriptor sets: %llu allocated, %llu written, %llu reused, %llu cached", metrics.descriptorAllocations, metrics.descriptorWrites, metrics.descriptorCacheHits, metrics.cachedDescriptorSets);
+			}
 			ImGui::Separator();
 			camera.interface();
 		}
@@ -1803,7 +2624,7 @@ int main(int argc, char ** argv) {
 			const float ratioCurr = float(sceneLit.width) / float(sceneLit.height);
 			const float ratioWin = winSize.x / winSize.y;
 			// \todo Derive a more robust threshold.
-			if(std::abs(ratioWin - ratioCurr) > 0.01f){
+			if(!config.headless && std::abs(ratioWin - ratioCurr) > 0.01f){
 				const glm::vec2 renderRes = config.resolutionRatio * glm::vec2(winSize.x, winSize.y);
 				resizeRenderTargets(renderRes);
 			}
@@ -1811,11 +2632,19 @@ int main(int argc, char ** argv) {
 		ImGui::End();
 		ImGui::PopStyleColor(6);
 
+		// Offscreen, render at the requested resolution instead of the view size.
+		if(config.headless){
+			const glm::uvec2 renderRes(config.resolutionRatio * config.screenResolution);
+			if(sceneLit.width != renderRes.x || sceneLit.height != renderRes.y){
+				resizeRenderTargets(glm::vec2(renderRes));
+			}
+		}
+
 		if(shadow.rendering ){
 			if( ImGui::Begin( "Work in progress", nullptr, ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoCollapse ) ) {
 				ImGui::Text( "Generating shadows..." );
-				std::string currProg = std::to_string( shadow.currentMapLayer + 1 ) + "/" + std::to_string( shadow.maps.depth );
-				ImGui::ProgressBar( ( float )( shadow.currentMapLayer + 1 ) / ( float )shadow.maps.depth, ImVec2( -1.0f, 0.0f ), currProg.c_str() );
+				std::string currProg = std::to_string( shadow.renderedFaces ) + "/" + std::to_string( shadow.queuedFaces );
+				ImGui::ProgressBar( ( float )( shadow.renderedFaces ) / ( float )shadow.queuedFaces, ImVec2( -1.0f, 0.0f ), currProg.c_str() );
 			}
 			ImGui::End();
 		}
@@ -1841,10 +2670,125 @@ int main(int argc, char ** argv) {
 		}
 		ImGui::End();
 #endif
+#ifdef PROFILER_ENABLED
+		if(ImGui::Begin("Profiler")){
+			const bool capturing = Profiler::capturing();
+			if(ImGui::Button(capturing ? "Stop capture" : "Start capture")){
+				if(capturing){
+					Profiler::stopCapture("eXplorer112_trace.json");
+				} else {
+					Profiler::startCapture();
+				}
+			}
+			ImGui::SameLine();
+			ImGui::Checkbox("Pause", &pauseProfiler);
+			if(!pauseProfiler){
+				profilerEvents = Profiler::frameEvents();
+			}
+			if(ImGui::BeginTable("#ProfilerZones", 3, tableFlags)){
+				// Header
+				ImGui::TableSetupScrollFreeze(0, 1); // Make top row always visible
+				ImGui::TableSetupColumn("Zone", ImGuiTableColumnFlags_None);
+				ImGui::TableSetupColumn("Thread", ImGuiTableColumnFlags_None);
+				ImGui::TableSetupColumn("Duration", ImGuiTableColumnFlags_None);
+				ImGui::TableHeadersRow();
+
+				for(const Profiler::Event& event : profilerEvents){
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn();
+					ImGui::Text("%*s%s", int(2 * event.depth), "", event.name);
+					ImGui::TableNextColumn();
+					ImGui::Text("%u", event.thread);
+					ImGui::TableNextColumn();
+					ImGui::Text("%.3fms", double(event.end - event.start) * 1e-6);
+				}
+				ImGui::EndTable();
+			}
+		}
+		ImGui::End();
+#endif
+		{
+			// Timings are available a few frames later.
+			const std::vector<GPU::PassTiming>& passTimings = GPU::getPassTimings();
+			if(passHistory.size() >= passHistorySize){
+				passHistory.pop_front();
+			}
+			passHistory.push_back(passTimings);
+			if(recordingPasses){
+				passRecording.push_back(passTimings);
+			}
+		}
+		if(ImGui::Begin("Passes")){
+			if(ImGui::Button(recordingPasses ? "Stop and export" : "Start recording")){
+				if(recordingPasses){
+					savePassTimingsCSV(passRecording, "eXplorer112_passes.csv");
+					savePassTimingsJSON(passRecording, "eXplorer112_passes.json");
+					passRecording.clear();
+				}
+				recordingPasses = !recordingPasses;
+			}
+			if(recordingPasses){
+				ImGui::SameLine();
+				ImGui::Text("%lu frames", passRecording.size());
+			}
+
+			// Graph of the selected pass, or of the whole frame.
+			std::vector<float> gpuTimes(passHistory.size(), 0.0f);
+			std::vector<float> cpuTimes(passHistory.size(), 0.0f);
+			for(size_t fid = 0; fid < passHistory.size(); ++fid){
+				for(const GPU::PassTiming& timing : passHistory[fid]){
+					if(selectedPass.empty() ? (timing.depth == 0) : (timing.name == selectedPass)){
+						gpuTimes[fid] += float(timing.gpu);
+						cpuTimes[fid] += float(timing.cpu);
+						if(!selectedPass.empty()){
+							break;
+						}
+					}
+				}
+			}
+			const char* graphName = selectedPass.empty() ? "All passes" : selectedPass.c_str();
+			const float graphWidth = ImGui::GetContentRegionAvail().x;
+			ImGui::PlotLines("##GPUPassGraph", gpuTimes.data(), int(gpuTimes.size()), 0, graphName, 0.0f, FLT_MAX, ImVec2(graphWidth, 60.0f));
+			ImGui::Text("GPU: %.3fms, CPU: %.3fms", gpuTimes.empty() ? 0.0f : gpuTimes.back(), cpuTimes.empty() ? 0.0f : cpuTimes.back());
+			ImGui::PlotLines("##CPUPassGraph", cpuTimes.data(), int(cpuTimes.size()), 0, nullptr, 0.0f, FLT_MAX, ImVec2(graphWidth, 60.0f));
+
+			if(ImGui::Selectable("All passes", selectedPass.empty())){
+				selectedPass.clear();
+			}
+			if(!passHistory.empty() && ImGui::BeginTable("#PassTimings", 3, tableFlags)){
+				// Header
+				ImGui::TableSetupScrollFreeze(0, 1); // Make top row always visible
+				ImGui::TableSetupColumn("Pass", ImGuiTableColumnFlags_None);
+				ImGui::TableSetupColumn("GPU", ImGuiTableColumnFlags_None);
+				ImGui::TableSetupColumn("CPU", ImGuiTableColumnFlags_None);
+				ImGui::TableHeadersRow();
+
+				uint pid = 0;
+				for(const GPU::PassTiming& timing : passHistory.back()){
+					ImGui::PushID(pid++);
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn();
+					ImGui::Text("%*s", int(2 * timing.depth), "");
+					ImGui::SameLine(0.0f, 0.0f);
+					if(ImGui::Selectable(timing.name.c_str(), selectedPass == timing.name, ImGuiSelectableFlags_SpanAllColumns)){
+						selectedPass = timing.name;
+					}
+					ImGui::TableNextColumn();
+					ImGui::Text("%.3fms", timing.gpu);
+					ImGui::TableNextColumn();
+					ImGui::Text("%.3fms", timing.cpu);
+					ImGui::PopID();
+				}
+				ImGui::EndTable();
+			}
+		}
+		ImGui::End();
+		PROFILE_END();
 		/// Rendering
 
 		// Fill frame infos
 		{
+			PROFILE_SCOPE("Frame data");
 			// Camera.
 			const glm::mat4 vp = camera.projection() * camera.view();
 			frameInfos[0].v = camera.view();
@@ -1853,6 +2797,7 @@ int main(int argc, char ** argv) {
 			// Only update the culling VP if needed.
 			if(!debug.freezeCulling){
 				frameInfos[0].vpCulling = vp;
+				cullingPosition = camera.position();
 			}
 			frameInfos[0].iv = glm::inverse(frameInfos[0].v);
 			frameInfos[0].ip = glm::inverse(frameInfos[0].p);
@@ -1885,6 +2830,15 @@ int main(int argc, char ** argv) {
 			frameInfos[0].clustersParams = glm::vec4(logRatio, std::log(nearFar.x) * logRatio, 0.0f, 0.0f);
 			frameInfos[0].frameIndex = (uint)(frameIndex % UINT32_MAX);
 
+			// Zones visible through portals from the culling viewpoint.
+			scene.portalGraph.computeVisibility(cullingPosition, frameInfos[0].vpCulling, zonesVisibility);
+			for(uint zid = 0; zid < MAX_CULLED_ZONES; ++zid){
+				const bool visible = !zonesVisibility.culled || zid >= zonesVisibility.zones.size() || zonesVisibility.zones[zid];
+				uint& bits = frameInfos[0].visibleZones[zid / 128u][(zid / 32u) % 4u];
+				const uint mask = 1u << (zid % 32u);
+				bits = visible ? (bits | mask) : (bits & ~mask);
+			}
+
 			frameInfos.upload();
 
 			// Scale calibrated on existing frame.
@@ -1963,6 +2917,7 @@ int main(int argc, char ** argv) {
 				lightingCompute->buffer(*scene.lightInfos, 1);
 				lightingCompute->buffer(*scene.materialInfos, 2);
 				lightingCompute->buffer(*scene.zoneInfos, 3);
+				lightingCompute->buffer(*shadow.tiles, 4);
 
 				lightingCompute->texture(sceneColor, 0);
 				lightingCompute->texture(sceneNormal, 1);
@@ -1970,7 +2925,7 @@ int main(int argc, char ** argv) {
 				lightingCompute->texture(sceneLit, 3);
 				lightingCompute->texture(sceneFog, 4);
 				lightingCompute->texture(lightClusters, 5);
-				lightingCompute->texture(shadow.maps, 6);
+				lightingCompute->texture(shadow.atlas, 6);
 				lightingCompute->texture(fogClusters, 7);
 				lightingCompute->texture(textures.fogXY, 8);
 				lightingCompute->texture(textures.fogZ, 9);
@@ -2221,10 +3176,11 @@ int main(int argc, char ** argv) {
 				forwardInstancedObject->buffer(*transparentItemsIn, 4);
 				forwardInstancedObject->buffer(*scene.lightInfos, 5);
 				forwardInstancedObject->buffer(*scene.zoneInfos, 6);
+				forwardInstancedObject->buffer(*shadow.tiles, 7);
 				forwardInstancedObject->texture(textures.fogXY, 0);
 				forwardInstancedObject->texture(textures.fogZ, 1);
 				forwardInstancedObject->texture(lightClusters, 2);
-				forwardInstancedObject->texture(shadow.maps, 3);
+				forwardInstancedObject->texture(shadow.atlas, 3);
 				forwardInstancedObject->texture(fogClusters, 4);
 
 				GPU::drawIndirectMesh(scene.globalMesh, *transparentDrawCommands, 0, transparentRange.instanceCount);
@@ -2391,42 +3347,23 @@ int main(int argc, char ** argv) {
 				// Check that we are in the viewport.
 				if(glm::all(glm::lessThan(mousePos, glm::vec2(1.0f))) && glm::all(glm::greaterThan(mousePos, glm::vec2(0.0f)))){
 
-					GPU::pushMarker("Selection");
-					// Render to selection ID texture
-					{
-						selectionColor.resize(sceneLit.width, sceneLit.height);
-						GPU::setViewport(selectionColor);
-						GPU::bind(selectionColor, sceneDepth, glm::vec4(0.0f), LoadOperation::LOAD, LoadOperation::DONTCARE);
-
-						GPU::setPolygonState(PolygonMode::FILL);
-						GPU::setCullState(true, Faces::BACK);
-						GPU::setDepthState(true, TestFunction::GEQUAL, false);
-						GPU::setBlendState(false);
-
-						selectionObject->use();
-						selectionObject->buffer(frameInfos, 0 );
-						selectionObject->buffer(*scene.meshInfos, 1);
-						selectionObject->buffer(*scene.instanceInfos, 2);
-						selectionObject->buffer(*scene.materialInfos, 3);
-						selectionObject->buffer(*drawInstances, 4);
-						// Draw all meshes.
-						GPU::drawIndirectMesh(scene.globalMesh, *drawCommands, 0, ( uint )scene.meshInfos->size());
+					// Cast a ray from the camera through the pixel.
+					const glm::vec2 ndc = 2.0f * mousePos - 1.0f;
+					const glm::vec4 viewPos = frameInfos[0].ip * glm::vec4(ndc, 0.5f, 1.0f);
+					const glm::vec3 worldPos = glm::vec3(frameInfos[0].iv * glm::vec4(glm::vec3(viewPos) / viewPos.w, 1.0f));
+					const glm::vec3 camPos = glm::vec3(frameInfos[0].iv[3]);
+					const BVH::Ray ray(camPos, glm::normalize(worldPos - camPos));
+
+					const auto start = std::chrono::steady_clock::now();
+					uint index = 0;
+					const bool hit = scene.intersect(ray, index);
+					const auto end = std::chrono::steady_clock::now();
+					Log::verbose("Picking query took %.3fms.", std::chrono::duration<double, std::milli>(end - start).count());
+					if(hit){
+						selected.instance = index;
+						selected.mesh = scene.instanceDebugInfos[selected.instance].meshIndex;
+						updateInstanceBoundingBox = true;
 					}
-					GPU::popMarker();
-
-					const glm::vec2 texSize(selectionColor.width, selectionColor.height);
-					glm::uvec2 readbackCoords = mousePos * texSize;
-					readbackCoords = glm::min(readbackCoords, glm::uvec2(texSize) - 2u);
-					GPU::downloadTextureAsync( selectionColor, readbackCoords, glm::uvec2(2u), 1, [&selected, &updateInstanceBoundingBox, &scene](const Texture& result){
-						const auto& pixels = result.images[0].pixels;
-
-						uint index = uint(pixels[0]) + (uint(pixels[1] ) << 8u);
-						if(index != 0){
-							selected.instance = index-1;
-							selected.mesh = scene.instanceDebugInfos[selected.instance].meshIndex;
-							updateInstanceBoundingBox = true;
-						}
-					});
 				}
 			}
 
@@ -2474,6 +3411,17 @@ int main(int argc, char ** argv) {
 			GPU::drawQuad();
 			GPU::popMarker();
 		}
+
+		if(benchmarking){
+			if(benchmarkFrame >= BENCHMARK_WARMUP_FRAMES && benchmarkFrame - BENCHMARK_WARMUP_FRAMES < config.benchmarkFrames){
+				BenchmarkFrame& sample = benchmarkFrames.emplace_back();
+				sample.cpu = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+				sample.world = gameFiles.worldsList[benchmarkWorlds[benchmarkWorld]].stem().string();
+				sample.frame = benchmarkFrame - BENCHMARK_WARMUP_FRAMES;
+				sample.culling = computeCullingStatistics(scene, frameInfos[0].vpCulling, zonesVisibility);
+			}
+			++benchmarkFrame;
+		}
 		++frameIndex;
 	}
 
@@ -2,6 +2,8 @@
 #include "graphics/GPUTypes.hpp"
 #include "core/Common.hpp"
 
+#include <algorithm>
+
 class GPUBuffer;
 
 /** \brief General purpose GPU buffer, with different use types determining its memory type, visibility  and access pattern.
@@ -110,6 +112,7 @@ public:
 	\return a reference to the item
 	*/
    T & operator[](size_t i){
+	   setDirty(i);
 	   return data[i];
    }
 
@@ -126,6 +129,7 @@ public:
 	\return a reference to the item
 	*/
    T & at(size_t i){
+	   setDirty(i);
 	   return data[i];
    }
 
@@ -142,8 +146,20 @@ public:
 	   return data.size();
    }
 
-   /** Send the buffer data to the GPU.
-	Previously uploaded content will potentially be erased.
+   /** Mark a range of elements as modified, to be sent at the next upload.
+	Elements written through the accessors are marked automatically, direct writes to data have to be marked explicitly.
+	\param first the first modified element
+	\param count the number of modified elements
+	*/
+   void setDirty(size_t first, size_t count = 1);
+
+   /** Mark all elements as modified. */
+   void setDirty(){
+	   setDirty(0, data.size());
+   }
+
+   /** Send the modified elements to the GPU. Adjacent and overlapping ranges are merged,
+	and all elements are sent at the first upload.
 	*/
    void upload();
 
@@ -168,17 +184,63 @@ public:
 
    std::vector<T> data; ///< The CPU data.
 
+private:
+
+   std::vector<std::pair<size_t, size_t>> _dirtyRanges; ///< Modified elements, as (first, end) ranges.
+
 };
 
 template <typename T>
 StructuredBuffer<T>::StructuredBuffer(size_t count, BufferType type, const std::string& name) :
    Buffer(count * sizeof(T), type, name) {
    data.resize(count);
+   // The GPU content is undefined until the first upload.
+   setDirty();
+}
+
+template <typename T>
+void StructuredBuffer<T>::setDirty(size_t first, size_t count) {
+   if(count == 0){
+	   return;
+   }
+   const size_t end = first + count;
+   // Sequential writes extend the last range.
+   if(!_dirtyRanges.empty()){
+	   std::pair<size_t, size_t>& last = _dirtyRanges.back();
+	   if(first <= last.second && end >= last.first){
+		   last.first = std::min(last.first, first);
+		   last.second = std::max(last.second, end);
+		   return;
+	   }
+   }
+   _dirtyRanges.emplace_back(first, end);
 }
 
 template <typename T>
 void StructuredBuffer<T>::upload() {
-   Buffer::upload(data, 0);
+   if(_dirtyRanges.empty()){
+	   return;
+   }
+   std::sort(_dirtyRanges.begin(), _dirtyRanges.end());
+   size_t rangeStart = _dirtyRanges[0].first;
+   size_t rangeEnd = _dirtyRanges[0].second;
+   const size_t rangeCount = _dirtyRanges.size();
+   for(size_t rid = 1; rid <= rangeCount; ++rid){
+	   // Merge with the current range if touching it.
+	   if(rid < rangeCount && _dirtyRanges[rid].first <= rangeEnd){
+		   rangeEnd = std::max(rangeEnd, _dirtyRanges[rid].second);
+		   continue;
+	   }
+	   rangeEnd = std::min(rangeEnd, data.size());
+	   if(rangeStart < rangeEnd){
+		   Buffer::upload((rangeEnd - rangeStart) * sizeof(T), reinterpret_cast<unsigned char*>(data.data() + rangeStart), rangeStart * sizeof(T));
+	   }
+	   if(rid < rangeCount){
+		   rangeStart = _dirtyRanges[rid].first;
+		   rangeEnd = _dirtyRanges[rid].second;
+	   }
+   }
+   _dirtyRanges.clear();
 }
 
 
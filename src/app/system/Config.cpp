@@ -196,6 +196,8 @@ RenderingConfig::RenderingConfig(const std::vector<std::string> & argv) : Config
 			initialHeight = h;
 		} else if(key == "force-aspect" || key == "far") {
 			forceAspectRatio = true;
+		} else if(key == "headless") {
+			headless = true;
 		}
 	}
 
@@ -206,4 +208,5 @@ RenderingConfig::RenderingConfig(const std::vector<std::string> & argv) : Config
 	registerArgument("rendering-ration", "ratio", "Rendering resolution ratio", "fraction");
 	registerArgument("wxh", "", "Window dimensions.", std::vector<std::string> {"width", "height"});
 	registerArgument("force-aspect", "far", "Force window aspect ratio.");
+	registerArgument("headless", "", "Render offscreen, without a window (dimensions set with wxh).");
 }
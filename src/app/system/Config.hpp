@@ -137,6 +137,9 @@ public:
 	/// Should the aspect ratio of the window be constrained.
 	bool forceAspectRatio = false;
 
+	/// Render offscreen, without a window nor a swapchain.
+	bool headless = false;
+
 	/// Size of the window in raw pixels, updated at launch based on screen density.
 	glm::vec2 screenResolution = glm::vec2(0.f, 0.f);
 
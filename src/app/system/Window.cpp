@@ -23,6 +23,19 @@
 
 Window::Window(const std::string & name, RenderingConfig & config, bool escapeQuit, bool hidden) :
 _config(config), _allowEscape(escapeQuit) {
+	// Offscreen rendering doesn't rely on the windowing system.
+	if(config.headless) {
+		const uint width = config.initialWidth != 0 ? config.initialWidth : 1280u;
+		const uint height = config.initialHeight != 0 ? config.initialHeight : 720u;
+		config.screenResolution = glm::vec2(width, height);
+		if(!GPU::setup(name)){
+			return;
+		}
+		GPU::setupWindow(this);
+		setupImGui();
+		return;
+	}
+
 	// Initialize glfw.
 	if(!glfwInit()) {
 		Log::error("GPU: Could not start GLFW3.");
@@ -107,6 +120,11 @@ _config(config), _allowEscape(escapeQuit) {
 }
 
 void Window::perform(Action action) {
+	// Only quitting is meaningful offscreen.
+	if(!_window) {
+		_shouldClose = _shouldClose || (action == Action::Quit);
+		return;
+	}
 	switch(action) {
 		case Action::Quit:
 			glfwSetWindowShouldClose(_window, GLFW_TRUE);
@@ -185,6 +203,17 @@ bool Window::nextFrame() {
 	// Notify GPU for book-keeping.
 	bool validSwapchain = _swapchain->nextFrame();
 
+	// Offscreen, there are no events to process.
+	if(!_window){
+		ImGuiIO & io = ImGui::GetIO();
+		io.DisplaySize = ImVec2(_config.screenResolution.x, _config.screenResolution.y);
+		io.DeltaTime = 1.0f / float(_config.rate);
+		ImGui_ImplVulkan_NewFrame();
+		ImGui::NewFrame();
+		_frameStarted = true;
+		return validSwapchain && !_shouldClose;
+	}
+
 	do {
 		// Update events (inputs,...).
 		Input::manager().update();
@@ -235,11 +264,16 @@ Window::~Window() {
 
 	// Clean the interface.
 	ImGui_ImplVulkan_Shutdown();
-	ImGui_ImplGlfw_Shutdown();
+	if(_window){
+		ImGui_ImplGlfw_Shutdown();
+	}
 	ImGui::DestroyContext();
 	// Close context and any other GLFW resources.
 	GPU::cleanup();
 
+	if(!_window){
+		return;
+	}
 	sr_gui_cleanup();
 
 	glfwDestroyWindow(_window);
@@ -267,7 +301,12 @@ void Window::setupImGui() {
 	int width, height;
 	io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
 	io.Fonts->TexID = 0;
-	ImGui_ImplGlfw_InitForVulkan(_window, false);
+	if(_window){
+		ImGui_ImplGlfw_InitForVulkan(_window, false);
+	} else {
+		// No window to store the layout for.
+		io.IniFilename = nullptr;
+	}
 
 	_imgui = new ImGui_ImplVulkan_InitInfo;
 	std::memset(_imgui, 0, sizeof(ImGui_ImplVulkan_InitInfo));
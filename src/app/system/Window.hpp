@@ -23,6 +23,7 @@ public:
 	 \param config the configuration to use (additional info will be added to it)
 	 \param escapeQuit allows the user to close the window by pressing escape
 	 \param hidden should the window be hidden (for preprocess for instance)
+	 \note If the configuration requests headless rendering, no OS window is created and frames are rendered offscreen.
 	*/
 	Window(const std::string & name, RenderingConfig & config, bool escapeQuit = true, bool hidden = false);
 
@@ -80,4 +81,5 @@ private:
 	ImGui_ImplVulkan_InitInfo * _imgui = nullptr; ///< ImGui setup information.
 	bool _frameStarted = false; ///< Has a frame been started.
 	bool _allowEscape = false; ///< Can the window be closed by pressing escape.
+	bool _shouldClose = false; ///< Has quitting been requested when rendering offscreen.
 };
@@ -0,0 +1,799 @@
+#include "benchmarks/SyntheticData.hpp"
+#include "core/Log.hpp"
+#include "core/Random.hpp"
+#include "core/Bounds.hpp"
+
+#include <stb/stb_image_write.h>
+#include <squish/squish.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+
+namespace Synthetic {
+
+// Size of an area along the X and Z axes, in centimeters.
+static const float kAreaSize = 2000.0f;
+// RenderWare version tag stored in each section header.
+static const uint32_t kRwVersion = 0x1803FFFF;
+
+/** \brief Generated resources, referenced by later files. */
+struct Catalog {
+	std::vector<std::string> textures; ///< Color texture names.
+	std::vector<std::string> texturePaths; ///< Color texture paths relative to the resources.
+	std::vector<bool> hasNormalMap; ///< Does each color texture have a normal map.
+	std::vector<std::string> materials; ///< Material paths relative to the resources, one per color texture.
+	std::vector<std::string> models; ///< Model paths relative to the resources.
+	std::vector<std::string> templates; ///< Template paths relative to the resources.
+	std::vector<std::string> fxDefs; ///< FX definition paths relative to the resources.
+};
+
+/** \brief Triangle mesh, before writing to a specific format. */
+struct Geometry {
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> uvs;
+	std::vector<glm::uvec3> triangles;
+
+	void addQuad(const glm::vec3& origin, const glm::vec3& u, const glm::vec3& v, float uvScale = 1.0f){
+		const uint first = (uint)positions.size();
+		const glm::vec3 n = glm::normalize(glm::cross(u, v));
+		const glm::vec3 corners[4] = { origin, origin + u, origin + u + v, origin + v };
+		const glm::vec2 cornerUVs[4] = { {0.0f, 0.0f}, {uvScale, 0.0f}, {uvScale, uvScale}, {0.0f, uvScale} };
+		for(uint i = 0; i < 4; ++i){
+			positions.push_back(corners[i]);
+			normals.push_back(n);
+			uvs.push_back(cornerUVs[i]);
+		}
+		triangles.emplace_back(first, first + 1, first + 2);
+		triangles.emplace_back(first, first + 2, first + 3);
+	}
+
+	void addBox(const glm::vec3& minis, const glm::vec3& maxis){
+		const glm::vec3 size = maxis - minis;
+		const glm::vec3 dx(size.x, 0.0f, 0.0f);
+		const glm::vec3 dy(0.0f, size.y, 0.0f);
+		const glm::vec3 dz(0.0f, 0.0f, size.z);
+		addQuad(minis, dy, dx);
+		addQuad(minis + dz, dx, dy);
+		addQuad(minis, dz, dy);
+		addQuad(minis + dx, dy, dz);
+		addQuad(minis, dx, dz);
+		addQuad(minis + dy, dz, dx);
+	}
+};
+
+static std::string vec(const glm::vec2& v){
+	char buffer[64];
+	snprintf(buffer, sizeof(buffer), "(%.3f %.3f)", v.x, v.y);
+	return buffer;
+}
+
+static std::string vec(const glm::vec3& v){
+	char buffer[96];
+	snprintf(buffer, sizeof(buffer), "(%.3f %.3f %.3f)", v.x, v.y, v.z);
+	return buffer;
+}
+
+static std::string vec(const glm::vec4& v){
+	char buffer[128];
+	snprintf(buffer, sizeof(buffer), "(%.3f %.3f %.3f %.3f)", v.x, v.y, v.z, v.w);
+	return buffer;
+}
+
+// Game files use backslashes.
+static std::string gamePath(const std::string& path){
+	std::string res = path;
+	std::replace(res.begin(), res.end(), '/', '\\');
+	return res;
+}
+
+static FILE* openFile(const fs::path& path, const char* mode){
+	fs::create_directories(path.parent_path());
+	FILE* file = fopen(path.string().c_str(), mode);
+	if(file == nullptr){
+		Log::error("Unable to write file at path %s", path.string().c_str());
+	}
+	return file;
+}
+
+// Textures
+
+static void generatePattern(uint size, const glm::vec3& color, bool normalMap, std::vector<unsigned char>& pixels){
+	pixels.resize(size * size * 4u);
+	const uint checker = std::max(1u, size / 8u);
+	for(uint y = 0; y < size; ++y){
+		for(uint x = 0; x < size; ++x){
+			unsigned char* pixel = &pixels[(y * size + x) * 4u];
+			const float noise = Random::Float(-0.05f, 0.05f);
+			if(normalMap){
+				// Bumps along the checker borders.
+				const float dx = std::sin(float(x) / float(checker) * glm::pi<float>()) * 0.3f;
+				const float dy = std::sin(float(y) / float(checker) * glm::pi<float>()) * 0.3f;
+				const glm::vec3 n = glm::normalize(glm::vec3(dx + noise, dy + noise, 1.0f));
+				pixel[0] = (unsigned char)((n.x * 0.5f + 0.5f) * 255.0f);
+				pixel[1] = (unsigned char)((n.y * 0.5f + 0.5f) * 255.0f);
+				pixel[2] = (unsigned char)((n.z * 0.5f + 0.5f) * 255.0f);
+				pixel[3] = 255;
+			} else {
+				const bool dark = ((x / checker) + (y / checker)) % 2u == 0u;
+				const glm::vec3 c = glm::clamp(color * (dark ? 0.6f : 1.0f) + noise, 0.0f, 1.0f);
+				pixel[0] = (unsigned char)(c.r * 255.0f);
+				pixel[1] = (unsigned char)(c.g * 255.0f);
+				pixel[2] = (unsigned char)(c.b * 255.0f);
+				pixel[3] = 255;
+			}
+		}
+	}
+}
+
+static bool writeDDS(const fs::path& path, uint size, const glm::vec3& color, bool normalMap){
+	std::vector<unsigned char> level;
+	generatePattern(size, color, normalMap, level);
+
+	uint mipCount = 1u;
+	while((size >> mipCount) != 0u){
+		++mipCount;
+	}
+
+	// BC1 header with a full mip chain.
+	uint32_t header[32] = {};
+	header[0] = 0x20534444; // "DDS "
+	header[1] = 124u;
+	header[2] = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; // Caps, height, width, pixel format, mip count, linear size.
+	header[3] = size;
+	header[4] = size;
+	header[5] = (uint32_t)SquishGetStorageRequirements(size, size, squishDxt1);
+	header[7] = mipCount;
+	header[19] = 32u;
+	header[20] = 0x4; // Four CC
+	header[21] = 0x31545844; // "DXT1"
+	header[27] = 0x1000 | 0x8 | 0x400000; // Texture, complex, mipmap.
+
+	FILE* file = openFile(path, "wb");
+	if(file == nullptr){
+		return false;
+	}
+	fwrite(header, sizeof(uint32_t), 32, file);
+
+	std::vector<unsigned char> blocks;
+	uint levelSize = size;
+	for(uint mip = 0; mip < mipCount; ++mip){
+		blocks.resize(SquishGetStorageRequirements(levelSize, levelSize, squishDxt1));
+		SquishCompressImage(level.data(), levelSize, levelSize, blocks.data(), squishDxt1 | squishColourRangeFit);
+		fwrite(blocks.data(), 1, blocks.size(), file);
+		// Box filter for the next level.
+		const uint nextSize = std::max(1u, levelSize / 2u);
+		std::vector<unsigned char> next(nextSize * nextSize * 4u);
+		for(uint y = 0; y < nextSize; ++y){
+			for(uint x = 0; x < nextSize; ++x){
+				for(uint c = 0; c < 4u; ++c){
+					uint sum = 0u;
+					for(uint k = 0; k < 4u; ++k){
+						const uint sx = std::min(2u * x + (k & 1u), levelSize - 1u);
+						const uint sy = std::min(2u * y + (k >> 1u), levelSize - 1u);
+						sum += level[(sy * levelSize + sx) * 4u + c];
+					}
+					next[(y * nextSize + x) * 4u + c] = (unsigned char)(sum / 4u);
+				}
+			}
+		}
+		level.swap(next);
+		levelSize = nextSize;
+	}
+	fclose(file);
+	return true;
+}
+
+static bool writeTGA(const fs::path& path, uint size, const glm::vec3& color){
+	std::vector<unsigned char> pixels;
+	generatePattern(size, color, false, pixels);
+	fs::create_directories(path.parent_path());
+	if(stbi_write_tga(path.string().c_str(), size, size, 4, pixels.data()) == 0){
+		Log::error("Unable to write file at path %s", path.string().c_str());
+		return false;
+	}
+	return true;
+}
+
+static bool generateTextures(const fs::path& root, const Settings& settings, Catalog& catalog){
+	const uint count = settings.textures * settings.scale;
+	for(uint tid = 0; tid < count; ++tid){
+		char name[64];
+		snprintf(name, sizeof(name), "syn_tex_%03u", tid);
+		// A quarter of the textures are uncompressed.
+		const bool compressed = (tid % 4u) != 3u;
+		const std::string relativePath = std::string("textures/synthetic/") + name + (compressed ? ".dds" : ".tga");
+		// Most textures share the same size, with a few larger and smaller ones.
+		uint size = settings.textureSize;
+		if((tid % 8u) == 2u){
+			size *= 2u;
+		} else if((tid % 8u) == 4u){
+			size = std::max(size / 2u, 4u);
+		} else if((tid % 8u) == 6u){
+			size = std::max(size / 4u, 4u);
+		}
+		const glm::vec3 color = Random::Color();
+		const bool success = compressed ? writeDDS(root / relativePath, size, color, false) : writeTGA(root / relativePath, size, color);
+		if(!success){
+			return false;
+		}
+		// Every other texture has a normal map.
+		const bool normalMap = (tid % 2u) == 0u;
+		if(normalMap && !writeDDS(root / "textures" / "synthetic" / (std::string(name) + "_n.dds"), size, color, true)){
+			return false;
+		}
+		catalog.textures.push_back(name);
+		catalog.texturePaths.push_back(relativePath);
+		catalog.hasNormalMap.push_back(normalMap);
+
+		// Material definition referencing the texture.
+		const std::string materialPath = std::string("materials/synthetic/syn_mat_") + std::to_string(tid) + ".mtl";
+		FILE* file = openFile(root / materialPath, "w");
+		if(file == nullptr){
+			return false;
+		}
+		fprintf(file, "<matDef>\n<framelist>\n<frame sourcename=\"%s\" duration=\"1.0\"/>\n</framelist>\n</matDef>\n", gamePath(relativePath).c_str());
+		fclose(file);
+		catalog.materials.push_back(materialPath);
+	}
+	return true;
+}
+
+// Models
+
+/** \brief Build RenderWare binary streams, sections sizes are patched when closed. */
+class ChunkWriter {
+public:
+
+	void begin(uint32_t type){
+		_starts.push_back(_data.size());
+		const uint32_t header[3] = { type, 0u, kRwVersion };
+		write(header, sizeof(header));
+	}
+
+	void end(){
+		const size_t start = _starts.back();
+		_starts.pop_back();
+		const uint32_t size = uint32_t(_data.size() - start - 3u * sizeof(uint32_t));
+		std::memcpy(&_data[start + sizeof(uint32_t)], &size, sizeof(uint32_t));
+	}
+
+	void write(const void* data, size_t size){
+		const char* bytes = static_cast<const char*>(data);
+		_data.insert(_data.end(), bytes, bytes + size);
+	}
+
+	template<typename T>
+	void write(const T& value){
+		write(&value, sizeof(T));
+	}
+
+	template<typename T>
+	void write(const std::vector<T>& values){
+		write(values.data(), values.size() * sizeof(T));
+	}
+
+	void string(const std::string& str){
+		begin(2u);
+		// Null-terminated and padded to four bytes.
+		const size_t size = (str.size() / 4u + 1u) * 4u;
+		std::vector<char> padded(size, '\0');
+		std::memcpy(padded.data(), str.data(), str.size());
+		write(padded);
+		end();
+	}
+
+	bool save(const fs::path& path) const {
+		FILE* file = openFile(path, "wb");
+		if(file == nullptr){
+			return false;
+		}
+		fwrite(_data.data(), 1, _data.size(), file);
+		fclose(file);
+		return true;
+	}
+
+private:
+	std::vector<char> _data;
+	std::vector<size_t> _starts;
+};
+
+static void writeTexture(ChunkWriter& writer, const std::string& name){
+	writer.begin(6u); // Texture
+	{
+		writer.begin(1u);
+		const uint8_t filterAndAddress[2] = { 2u, 1u };
+		const uint16_t hasMips = 1u;
+		writer.write(filterAndAddress, sizeof(filterAndAddress));
+		writer.write(hasMips);
+		writer.end();
+	}
+	writer.string(name);
+	writer.string("");
+	writer.end();
+}
+
+static void writeGeometry(ChunkWriter& writer, const Geometry& geometry, const std::vector<uint>& triangleMaterials, const std::vector<uint>& textures, const Catalog& catalog){
+	const uint vertexCount = (uint)geometry.positions.size();
+	const uint triangleCount = (uint)geometry.triangles.size();
+
+	writer.begin(15u); // Geometry
+	{
+		writer.begin(1u);
+		// One texture set, prelit.
+		const int32_t header[4] = { (1 << 16) | 0x8, (int32_t)triangleCount, (int32_t)vertexCount, 1 };
+		writer.write(header, sizeof(header));
+		for(uint vid = 0; vid < vertexCount; ++vid){
+			const uint8_t shade = uint8_t(200u + vid % 56u);
+			const uint8_t color[4] = { shade, shade, shade, 255u };
+			writer.write(color, sizeof(color));
+		}
+		writer.write(geometry.uvs);
+		for(uint tid = 0; tid < triangleCount; ++tid){
+			const glm::uvec3& tri = geometry.triangles[tid];
+			// Stored as v1, v0, material, v2.
+			const uint16_t face[4] = { uint16_t(tri[1]), uint16_t(tri[0]), uint16_t(triangleMaterials[tid]), uint16_t(tri[2]) };
+			writer.write(face, sizeof(face));
+		}
+		// Single morph set.
+		BoundingBox bbox;
+		for(const glm::vec3& pos : geometry.positions){
+			bbox.merge(pos);
+		}
+		const glm::vec3 center = bbox.getCentroid();
+		const float sphere[4] = { center.x, center.y, center.z, glm::length(bbox.getSize()) * 0.5f };
+		const uint32_t hasData[2] = { 1u, 1u };
+		writer.write(sphere, sizeof(sphere));
+		writer.write(hasData, sizeof(hasData));
+		writer.write(geometry.positions);
+		writer.write(geometry.normals);
+		writer.end();
+	}
+	writer.begin(8u); // Material list
+	{
+		writer.begin(1u);
+		writer.write(uint32_t(textures.size()));
+		for(size_t mid = 0; mid < textures.size(); ++mid){
+			writer.write(int32_t(-1));
+		}
+		writer.end();
+		for(const uint texture : textures){
+			writer.begin(7u); // Material
+			{
+				writer.begin(1u);
+				// Some materials are transparent.
+				const bool transparent = (texture % 7u) == 6u;
+				const int32_t flags = 0;
+				const uint8_t color[4] = { 255u, 255u, 255u, uint8_t(transparent ? 0u : 255u) };
+				const int32_t unused = 0;
+				const int32_t textured = 1;
+				const float ambSpecDiff[3] = { 1.0f, 0.0f, 1.0f };
+				writer.write(flags);
+				writer.write(color, sizeof(color));
+				writer.write(unused);
+				writer.write(textured);
+				writer.write(ambSpecDiff, sizeof(ambSpecDiff));
+				writer.end();
+			}
+			writeTexture(writer, catalog.textures[texture]);
+			if(catalog.hasNormalMap[texture]){
+				writer.begin(3u); // Extension
+				writer.begin(307u); // Normal map
+				writer.write(uint32_t(0u));
+				writeTexture(writer, catalog.textures[texture] + "_n");
+				writer.end();
+				writer.end();
+			}
+			writer.end();
+		}
+	}
+	writer.end();
+	writer.begin(3u); // Empty geometry extension.
+	writer.end();
+	writer.end();
+}
+
+// Tube of rings around the Y axis, with a bulge to avoid flat normals.
+static void generateTube(uint triangleCount, float radius, float height, Geometry& geometry){
+	const uint segments = 16u;
+	const uint rings = std::max(1u, std::min(triangleCount / (2u * segments), 2000u));
+	for(uint r = 0; r <= rings; ++r){
+		const float v = float(r) / float(rings);
+		const float ringRadius = radius * (0.7f + 0.3f * std::sin(v * glm::pi<float>()));
+		for(uint s = 0; s <= segments; ++s){
+			const float u = float(s) / float(segments);
+			const float angle = u * glm::two_pi<float>();
+			const glm::vec3 dir(std::cos(angle), 0.0f, std::sin(angle));
+			geometry.positions.push_back(dir * ringRadius + glm::vec3(0.0f, v * height, 0.0f));
+			geometry.normals.push_back(dir);
+			geometry.uvs.emplace_back(u, v);
+		}
+	}
+	for(uint r = 0; r < rings; ++r){
+		for(uint s = 0; s < segments; ++s){
+			const uint i0 = r * (segments + 1u) + s;
+			const uint i1 = i0 + 1u;
+			const uint i2 = i0 + segments + 1u;
+			const uint i3 = i2 + 1u;
+			geometry.triangles.emplace_back(i0, i2, i1);
+			geometry.triangles.emplace_back(i1, i2, i3);
+		}
+	}
+}
+
+static bool writeModel(const fs::path& path, uint triangleCount, const Catalog& catalog){
+	// One to three geometries, each with one frame.
+	const uint geometryCount = (uint)Random::Int(1, 3);
+	ChunkWriter writer;
+	writer.begin(16u); // Clump
+	{
+		writer.begin(1u);
+		const int32_t counts[3] = { (int32_t)geometryCount, 0, 0 };
+		writer.write(counts, sizeof(counts));
+		writer.end();
+	}
+	writer.begin(14u); // Frame list
+	{
+		writer.begin(1u);
+		writer.write(int32_t(geometryCount + 1u));
+		for(uint fid = 0; fid <= geometryCount; ++fid){
+			const glm::mat3 rotation(1.0f);
+			const glm::vec3 position = fid == 0 ? glm::vec3(0.0f) : glm::vec3(Random::Float(-50.0f, 50.0f), 0.0f, Random::Float(-50.0f, 50.0f));
+			const int32_t parent = fid == 0 ? -1 : 0;
+			const uint32_t flags = 0u;
+			writer.write(rotation);
+			writer.write(position);
+			writer.write(parent);
+			writer.write(flags);
+		}
+		writer.end();
+	}
+	writer.end();
+	writer.begin(26u); // Geometry list
+	{
+		writer.begin(1u);
+		writer.write(int32_t(geometryCount));
+		writer.end();
+		for(uint gid = 0; gid < geometryCount; ++gid){
+			Geometry geometry;
+			generateTube(std::max(32u, triangleCount / geometryCount), Random::Float(10.0f, 60.0f), Random::Float(20.0f, 200.0f), geometry);
+			// One or two materials, split along the tube height.
+			const uint materialCount = (uint)Random::Int(1, 2);
+			std::vector<uint> textures(materialCount);
+			for(uint& texture : textures){
+				texture = (uint)Random::Int(0, (int)catalog.textures.size() - 1);
+			}
+			std::vector<uint> triangleMaterials(geometry.triangles.size());
+			for(size_t tid = 0; tid < triangleMaterials.size(); ++tid){
+				triangleMaterials[tid] = (uint)((tid * materialCount) / triangleMaterials.size());
+			}
+			writeGeometry(writer, geometry, triangleMaterials, textures, catalog);
+		}
+	}
+	writer.end();
+	for(uint gid = 0; gid < geometryCount; ++gid){
+		writer.begin(20u); // Atomic
+		writer.begin(1u);
+		const uint32_t values[4] = { gid + 1u, gid, 5u, 0u };
+		writer.write(values, sizeof(values));
+		writer.end();
+		writer.end();
+	}
+	writer.end();
+	return writer.save(path);
+}
+
+static bool generateModels(const fs::path& root, const Settings& settings, Catalog& catalog){
+	const uint count = settings.models * settings.scale;
+	for(uint mid = 0; mid < count; ++mid){
+		const std::string relativePath = "models/synthetic/syn_model_" + std::to_string(mid) + ".dff";
+		if(!writeModel(root / relativePath, settings.modelTriangles, catalog)){
+			return false;
+		}
+		catalog.models.push_back(relativePath);
+	}
+	// Default camera model, used by camera entities.
+	return writeModel(root / "models" / "objets" / "cameras" / "camera.dff", 64u, catalog);
+}
+
+// Areas
+
+static void writeGroup(FILE* file, const std::string& name, const char* userType, const char* shader, const glm::vec3& offset, const Geometry& geometry){
+	fprintf(file, "<group name=\"%s\">\n", name.c_str());
+	fprintf(file, "<param name=\"localxform\">(1 0 0)(0 1 0)(0 0 1)%s</param>\n", vec(offset).c_str());
+	if(userType){
+		fprintf(file, "<userdata><param name=\"3dsmax User Properties\">\"%s\"</param></userdata>\n", userType);
+	}
+	const bool full = shader != nullptr;
+	fprintf(file, "<polymesh>\n<vertexlist count=\"%u\">\n<format><param name=\"position\"/>%s</format>\n",
+			(uint)geometry.positions.size(), full ? "<param name=\"normal\"/><param name=\"uv0\"/>" : "");
+	for(size_t vid = 0; vid < geometry.positions.size(); ++vid){
+		if(full){
+			fprintf(file, "<v>%s%s%s</v>\n", vec(geometry.positions[vid]).c_str(), vec(geometry.normals[vid]).c_str(), vec(geometry.uvs[vid]).c_str());
+		} else {
+			fprintf(file, "<v>%s</v>\n", vec(geometry.positions[vid]).c_str());
+		}
+	}
+	fprintf(file, "</vertexlist>\n");
+	if(full){
+		fprintf(file, "<primlist count=\"%u\" shader=\"%s\">\n", (uint)geometry.triangles.size(), shader);
+	} else {
+		fprintf(file, "<primlist count=\"%u\">\n", (uint)geometry.triangles.size());
+	}
+	for(const glm::uvec3& tri : geometry.triangles){
+		fprintf(file, "<p>%u %u %u</p>\n", tri.x, tri.y, tri.z);
+	}
+	fprintf(file, "</primlist>\n</polymesh>\n</group>\n");
+}
+
+static bool writeArea(const fs::path& path, uint areaIndex, uint areaCount, const Settings& settings, const Catalog& catalog){
+	FILE* file = openFile(path, "w");
+	if(file == nullptr){
+		return false;
+	}
+	// Areas are laid out along X.
+	const glm::vec3 origin(float(areaIndex) * kAreaSize, 0.0f, 0.0f);
+	const char* shaderNames[] = { "floor-mat", "wall-mat", "glass-mat", "decal-mat" };
+
+	fprintf(file, "<RwRf3 version=\"1.0\">\n<scene>\n<param name=\"axis system\">(1 0 0)(0 1 0)(0 0 1)(0 0 0)</param>\n<shaderlist>\n");
+	for(uint sid = 0; sid < 4; ++sid){
+		const uint texture = (uint)Random::Int(0, (int)catalog.textures.size() - 1);
+		fprintf(file, "<shader name=\"%s\">\n<texture name=\"tex0\" sourcename=\"%s\"/>\n", shaderNames[sid], gamePath(catalog.texturePaths[texture]).c_str());
+		if(catalog.hasNormalMap[texture]){
+			fprintf(file, "<texture name=\"tex1\" sourcename=\"textures\\synthetic\\%s_n.dds\"/>\n", catalog.textures[texture].c_str());
+		}
+		fprintf(file, "<shaderfunc type=\"standard\">\n<channel name=\"color\"><texture ref=\"tex0\"/></channel>\n");
+		if(catalog.hasNormalMap[texture]){
+			fprintf(file, "<channel name=\"normal\"><texture ref=\"tex1\"/></channel>\n");
+		}
+		fprintf(file, "</shaderfunc>\n</shader>\n");
+	}
+	// Non-textured shader, ignored by the parser.
+	fprintf(file, "<shader name=\"collision\"><shaderfunc type=\"standard\"/></shader>\n</shaderlist>\n");
+
+	// Floor grid.
+	{
+		Geometry floor;
+		const uint res = std::max(1u, settings.areaResolution);
+		const float step = kAreaSize / float(res);
+		for(uint z = 0; z < res; ++z){
+			for(uint x = 0; x < res; ++x){
+				floor.addQuad(glm::vec3(float(x) * step, 0.0f, float(z) * step), glm::vec3(0.0f, 0.0f, step), glm::vec3(step, 0.0f, 0.0f));
+			}
+		}
+		writeGroup(file, "floor", nullptr, shaderNames[0], origin, floor);
+	}
+	// Walls and pillars.
+	{
+		Geometry walls;
+		walls.addQuad(glm::vec3(0.0f), glm::vec3(kAreaSize, 0.0f, 0.0f), glm::vec3(0.0f, 400.0f, 0.0f), 8.0f);
+		walls.addQuad(glm::vec3(0.0f, 0.0f, kAreaSize), glm::vec3(0.0f, 400.0f, 0.0f), glm::vec3(kAreaSize, 0.0f, 0.0f), 8.0f);
+		for(uint pid = 0; pid < 8u; ++pid){
+			const glm::vec3 corner(Random::Float(100.0f, kAreaSize - 200.0f), 0.0f, Random::Float(100.0f, kAreaSize - 200.0f));
+			walls.addBox(corner, corner + glm::vec3(60.0f, 400.0f, 60.0f));
+		}
+		writeGroup(file, "walls", nullptr, shaderNames[1], origin, walls);
+	}
+	// Disjoint windows, split in components by the parser.
+	{
+		Geometry windows;
+		for(uint wid = 0; wid < 6u; ++wid){
+			windows.addQuad(glm::vec3(200.0f + float(wid) * 250.0f, 100.0f, 5.0f), glm::vec3(0.0f, 150.0f, 0.0f), glm::vec3(150.0f, 0.0f, 0.0f));
+		}
+		writeGroup(file, "windows", "transparent", shaderNames[2], origin, windows);
+	}
+	// Decals on the floor.
+	{
+		Geometry decals;
+		for(uint did = 0; did < 12u; ++did){
+			const glm::vec3 corner(Random::Float(0.0f, kAreaSize - 100.0f), 0.5f, Random::Float(0.0f, kAreaSize - 100.0f));
+			decals.addQuad(corner, glm::vec3(0.0f, 0.0f, 100.0f), glm::vec3(100.0f, 0.0f, 0.0f));
+		}
+		writeGroup(file, "decals", "decal", shaderNames[3], origin, decals);
+	}
+	// Portals on the shared boundaries.
+	for(int side = 0; side < 2; ++side){
+		const int neighbor = int(areaIndex) + (side == 0 ? -1 : 1);
+		if(neighbor < 0 || neighbor >= int(areaCount)){
+			continue;
+		}
+		Geometry portal;
+		const float x = side == 0 ? 0.0f : kAreaSize;
+		portal.addQuad(glm::vec3(x, 0.0f, 800.0f), glm::vec3(0.0f, 300.0f, 0.0f), glm::vec3(0.0f, 0.0f, 400.0f));
+		writeGroup(file, "portal_" + std::to_string(side), "portal", nullptr, origin, portal);
+	}
+	// Collision mesh without a textured shader.
+	{
+		Geometry collision;
+		collision.addBox(glm::vec3(0.0f), glm::vec3(kAreaSize, 400.0f, kAreaSize));
+		fprintf(file, "<group name=\"collision\">\n<param name=\"localxform\">(1 0 0)(0 1 0)(0 0 1)%s</param>\n", vec(origin).c_str());
+		fprintf(file, "<polymesh>\n<vertexlist count=\"%u\">\n<format><param name=\"position\"/><param name=\"normal\"/><param name=\"uv0\"/></format>\n", (uint)collision.positions.size());
+		for(size_t vid = 0; vid < collision.positions.size(); ++vid){
+			fprintf(file, "<v>%s%s%s</v>\n", vec(collision.positions[vid]).c_str(), vec(collision.normals[vid]).c_str(), vec(collision.uvs[vid]).c_str());
+		}
+		fprintf(file, "</vertexlist>\n<primlist count=\"%u\" shader=\"collision\">\n", (uint)collision.triangles.size());
+		for(const glm::uvec3& tri : collision.triangles){
+			fprintf(file, "<p>%u %u %u</p>\n", tri.x, tri.y, tri.z);
+		}
+		fprintf(file, "</primlist>\n</polymesh>\n</group>\n");
+	}
+	fprintf(file, "</scene>\n</RwRf3>\n");
+	fclose(file);
+	return true;
+}
+
+// Entities
+
+static void writeLight(FILE* file, const std::string& name, const glm::vec3& position, const std::string& material){
+	const int type = Random::Int(1, 3);
+	const float radius = Random::Float(200.0f, 1500.0f);
+	fprintf(file, "<entity type=\"light\" name=\"%s\">\n<param name=\"position\">%s</param>\n<param name=\"rotation\">%s</param>\n",
+			name.c_str(), vec(position).c_str(), vec(glm::vec3(Random::Float(-90.0f, 0.0f), Random::Float(0.0f, 360.0f), 0.0f)).c_str());
+	fprintf(file, "<light type=\"%d\">\n<param name=\"color\">%s</param>\n<param name=\"radius\">%s</param>\n<param name=\"coneAngle\">%d</param>\n<param name=\"shadow\">%s</param>\n",
+			type, vec(Random::Color()).c_str(), vec(glm::vec3(radius)).c_str(), Random::Int(20, 90), Random::Int(0, 3) == 0 ? "true" : "false");
+	if(!material.empty()){
+		fprintf(file, "<param name=\"material\">%s</param>\n", gamePath(material).c_str());
+	}
+	fprintf(file, "</light>\n</entity>\n");
+}
+
+static void writeBillboard(FILE* file, const std::string& name, const glm::vec3& position, const std::string& material){
+	fprintf(file, "<entity type=\"fx\" name=\"%s\">\n<param name=\"fxType\">9</param>\n<param name=\"position\">%s</param>\n", name.c_str(), vec(position).c_str());
+	fprintf(file, "<param name=\"billboardType\">%d</param>\n<param name=\"blending\">%d</param>\n<param name=\"width\">%.1f</param>\n<param name=\"height\">%.1f</param>\n",
+			Random::Int(0, 1) * 3, Random::Int(1, 3), Random::Float(20.0f, 200.0f), Random::Float(20.0f, 200.0f));
+	fprintf(file, "<param name=\"color\">%s</param>\n<param name=\"material\">%s</param>\n</entity>\n", vec(Random::Color()).c_str(), gamePath(material).c_str());
+}
+
+static bool generateFxDefs(const fs::path& root, const Settings& settings, Catalog& catalog){
+	const uint count = 4u * settings.scale;
+	for(uint fid = 0; fid < count; ++fid){
+		const std::string relativePath = "fx/synthetic/syn_fx_" + std::to_string(fid) + ".fxdef";
+		FILE* file = openFile(root / relativePath, "w");
+		if(file == nullptr){
+			return false;
+		}
+		fprintf(file, "<fxDef>\n<emitters>\n");
+		for(uint eid = 0; eid < 2u; ++eid){
+			const std::string& material = catalog.materials[Random::Int(0, (int)catalog.materials.size() - 1)];
+			fprintf(file, "<emitter>\n<param name=\"type\">%d</param>\n<param name=\"blending\">%d</param>\n<param name=\"particletype\">%d</param>\n",
+					Random::Int(0, 1) * 2, Random::Int(1, 3), Random::Int(0, 1) * 2);
+			fprintf(file, "<param name=\"material\">\"%s\"</param>\n", gamePath(material).c_str());
+			fprintf(file, "<param name=\"dimension_min\">(-20 -20 -20)</param>\n<param name=\"dimension_max\">(20 20 20)</param>\n");
+			fprintf(file, "<param name=\"color_min\">%s</param>\n<param name=\"color_max\">%s</param>\n",
+					vec(glm::vec4(Random::Color(), 0.5f)).c_str(), vec(glm::vec4(Random::Color(), 1.0f)).c_str());
+			fprintf(file, "<param name=\"tanksize\">%d</param>\n<param name=\"size\">(5 20)</param>\n<param name=\"angle\">(0 30)</param>\n", Random::Int(16, 256));
+			fprintf(file, "<param name=\"velocity\">(10 50)</param>\n<param name=\"radius\">%.1f</param>\n<param name=\"regenrate\">%.1f</param>\n</emitter>\n",
+					Random::Float(0.0f, 50.0f), Random::Float(1.0f, 100.0f));
+		}
+		fprintf(file, "</emitters>\n</fxDef>\n");
+		fclose(file);
+		catalog.fxDefs.push_back(relativePath);
+	}
+	return true;
+}
+
+static bool generateTemplates(const fs::path& root, const Settings& settings, Catalog& catalog){
+	const uint count = settings.templates * settings.scale;
+	for(uint tid = 0; tid < count; ++tid){
+		const std::string relativePath = "templates/synthetic/syn_template_" + std::to_string(tid) + ".template";
+		FILE* file = openFile(root / relativePath, "w");
+		if(file == nullptr){
+			return false;
+		}
+		// A main model, with linked props and a light.
+		fprintf(file, "<template>\n<entities>\n");
+		fprintf(file, "<entity type=\"solid\" name=\"main\">\n<param name=\"sourceName\">%s</param>\n</entity>\n",
+				gamePath(catalog.models[Random::Int(0, (int)catalog.models.size() - 1)]).c_str());
+		for(uint pid = 0; pid < 3u; ++pid){
+			fprintf(file, "<entity type=\"actor\" name=\"prop_%u\">\n<param name=\"link\">main</param>\n<param name=\"sourceName\">%s</param>\n<param name=\"position\">%s</param>\n</entity>\n",
+					pid, gamePath(catalog.models[Random::Int(0, (int)catalog.models.size() - 1)]).c_str(),
+					vec(glm::vec3(Random::Float(-100.0f, 100.0f), 0.0f, Random::Float(-100.0f, 100.0f))).c_str());
+		}
+		fprintf(file, "<entity type=\"light\" name=\"lamp\">\n<param name=\"link\">main</param>\n<param name=\"position\">(0 150 0)</param>\n<param name=\"lightType\">1</param>\n<light>\n<param name=\"color\">(1 0.9 0.7)</param>\n<param name=\"radius\">(400 400 400)</param>\n</light>\n</entity>\n");
+		fprintf(file, "</entities>\n</template>\n");
+		fclose(file);
+		catalog.templates.push_back(relativePath);
+	}
+	return true;
+}
+
+static bool writeWorld(const fs::path& root, uint worldIndex, const Settings& settings, const Catalog& catalog){
+	const uint areaCount = std::max(1u, settings.areasPerWorld * settings.scale);
+	char worldName[64];
+	snprintf(worldName, sizeof(worldName), "synthetic_%02u", worldIndex);
+
+	std::vector<std::string> areaPaths;
+	for(uint aid = 0; aid < areaCount; ++aid){
+		const std::string relativePath = std::string("zones/synthetic/") + worldName + "_area_" + std::to_string(aid) + ".rf3";
+		if(!writeArea(root / relativePath, aid, areaCount, settings, catalog)){
+			return false;
+		}
+		areaPaths.push_back(relativePath);
+	}
+
+	FILE* file = openFile(root / "zones" / "world" / (std::string(worldName) + ".world"), "w");
+	if(file == nullptr){
+		return false;
+	}
+	const glm::vec3 worldMax(float(areaCount) * kAreaSize, 300.0f, kAreaSize);
+	auto randomPosition = [&worldMax](){
+		return glm::vec3(Random::Float(0.0f, worldMax.x), Random::Float(0.0f, worldMax.y), Random::Float(0.0f, worldMax.z));
+	};
+	auto randomItem = [](const std::vector<std::string>& items) -> const std::string& {
+		return items[Random::Int(0, (int)items.size() - 1)];
+	};
+
+	fprintf(file, "<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?>\n<World>\n<scene>\n<entities>\n");
+	const uint entityCount = settings.entitiesPerWorld * settings.scale;
+	for(uint eid = 0; eid < entityCount; ++eid){
+		const std::string name = "entity_" + std::to_string(eid);
+		const glm::vec3 position = randomPosition();
+		if(eid < 2u){
+			fprintf(file, "<entity type=\"camera\" name=\"%s\">\n<param name=\"position\">%s</param>\n<param name=\"cameraInitialRotation\">(%.1f %.1f)</param>\n<param name=\"fov\">%d</param>\n<param name=\"uiName\">Camera %u</param>\n</entity>\n",
+					name.c_str(), vec(position).c_str(), Random::Float(-30.0f, 30.0f), Random::Float(0.0f, 360.0f), Random::Int(45, 75), eid);
+			continue;
+		}
+		const uint kind = eid % 20u;
+		if(kind == 0u){
+			writeLight(file, name, position, Random::Int(0, 1) == 0 ? randomItem(catalog.materials) : std::string());
+		} else if(kind == 1u){
+			writeBillboard(file, name, position, randomItem(catalog.materials));
+		} else if(kind == 2u && (eid % 40u) == 2u){
+			fprintf(file, "<entity type=\"fx\" name=\"%s\">\n<param name=\"fxType\">7</param>\n<param name=\"position\">%s</param>\n<param name=\"sourceName\">%s</param>\n</entity>\n",
+					name.c_str(), vec(position).c_str(), gamePath(randomItem(catalog.fxDefs)).c_str());
+		} else if(kind == 3u){
+			fprintf(file, "<instance name=\"%s\">\n<param name=\"template\">%s</param>\n<param name=\"position\">%s</param>\n<param name=\"rotation\">(0 %.1f 0)</param>\n</instance>\n",
+					name.c_str(), gamePath(randomItem(catalog.templates)).c_str(), vec(position).c_str(), Random::Float(0.0f, 360.0f));
+		} else {
+			const char* types[] = { "actor", "solid", "door", "creature" };
+			fprintf(file, "<entity type=\"%s\" name=\"%s\">\n<param name=\"sourceName\" data=\"string\"count=\"1\">%s</param>\n",
+					types[eid % 4u], name.c_str(), gamePath(randomItem(catalog.models)).c_str());
+			// Some entities are attached to the previous one.
+			if(kind == 4u && eid > 2u){
+				fprintf(file, "<param name=\"link\">entity_%u</param>\n<param name=\"position\">(0 %.1f 0)</param>\n", eid - 1u, Random::Float(10.0f, 100.0f));
+			} else {
+				fprintf(file, "<param name=\"position\">%s</param>\n", vec(position).c_str());
+			}
+			fprintf(file, "<param name=\"rotation\">%s</param>\n<param name=\"scale\">%s</param>\n<param name=\"heat\">%.2f</param>\n<param name=\"visible\">true</param>\n</entity>\n",
+					vec(glm::vec3(0.0f, Random::Float(0.0f, 360.0f), 0.0f)).c_str(), vec(glm::vec3(Random::Float(0.5f, 2.0f))).c_str(), Random::Float(0.0f, 1.0f));
+		}
+	}
+	fprintf(file, "</entities>\n<areas>\n");
+	for(uint aid = 0; aid < areaCount; ++aid){
+		fprintf(file, "<area name=\"zone_%u\" sourceName=\"%s\">\n<param name=\"ambientColor\">%s</param>\n<param name=\"fogColor\">%s</param>\n<param name=\"hfogParams\">(0 200 0 0)</param>\n<param name=\"fogDensity\">%.4f</param>\n</area>\n",
+				aid, gamePath(areaPaths[aid]).c_str(), vec(glm::vec4(Random::Color() * 0.3f, 1.0f)).c_str(), vec(glm::vec4(Random::Color(), 1.0f)).c_str(), Random::Float(0.0f, 0.002f));
+	}
+	fprintf(file, "</areas>\n</scene>\n</World>\n");
+	fclose(file);
+	return true;
+}
+
+bool generate(const fs::path& resourcesPath, const Settings& settings){
+	Random::seed(settings.seed);
+	Catalog catalog;
+	if(!generateTextures(resourcesPath, settings, catalog)){
+		return false;
+	}
+	if(catalog.textures.empty()){
+		Log::error("At least one texture is needed.");
+		return false;
+	}
+	if(!generateModels(resourcesPath, settings, catalog) || catalog.models.empty()){
+		return false;
+	}
+	if(!generateFxDefs(resourcesPath, settings, catalog) || !generateTemplates(resourcesPath, settings, catalog)){
+		return false;
+	}
+	for(uint wid = 0; wid < settings.worlds; ++wid){
+		if(!writeWorld(resourcesPath, wid, settings, catalog)){
+			return false;
+		}
+	}
+	Log::info("Generated %lu textures, %lu models, %lu templates and %u worlds in %s.", catalog.textures.size(),
+			  catalog.models.size(), catalog.templates.size(), settings.worlds, resourcesPath.string().c_str());
+	return true;
+}
+
+}
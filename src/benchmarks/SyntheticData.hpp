@@ -0,0 +1,35 @@
+#pragma once
+
+#include "core/System.hpp"
+#include "core/Common.hpp"
+
+/**
+ \brief Generate synthetic but format-valid game resources, to benchmark parsing and processing without the game data.
+ The output mirrors the layout of the game 'resources' directory: models (.dff), areas (.rf3), worlds with
+ entities, template instances, lights and fx, materials, fx definitions and textures (.dds, .tga).
+ */
+namespace Synthetic {
+
+/** \brief Generation parameters, counts are multiplied by the scale. */
+struct Settings {
+	uint scale = 1; ///< Multiplier applied to the counts below.
+	uint worlds = 2; ///< Number of worlds.
+	uint models = 24; ///< Number of distinct models.
+	uint modelTriangles = 1024; ///< Approximate triangle count of a model.
+	uint areasPerWorld = 4; ///< Number of areas in each world, connected by portals.
+	uint areaResolution = 32; ///< Number of floor quads along each side of an area.
+	uint entitiesPerWorld = 400; ///< Number of entities in each world.
+	uint templates = 4; ///< Number of distinct templates.
+	uint textures = 16; ///< Number of color textures.
+	uint textureSize = 256; ///< Most common texture width and height in pixels.
+	uint seed = 112; ///< Random seed, for reproducible output.
+};
+
+/** Generate a complete resources directory.
+ \param resourcesPath the output directory, will be created if needed
+ \param settings the generation parameters
+ \return true if all files were written
+ */
+bool generate(const fs::path& resourcesPath, const Settings& settings);
+
+}
@@ -0,0 +1,635 @@
+#include "benchmarks/SyntheticData.hpp"
+#include "core/Log.hpp"
+#include "core/System.hpp"
+#include "core/DFFParser.hpp"
+#include "core/AreaParser.hpp"
+#include "core/WorldParser.hpp"
+#include "core/Image.hpp"
+#include "core/BVH.hpp"
+#include "core/BoundsBatch.hpp"
+#include "core/PortalGraph.hpp"
+#include "core/Random.hpp"
+#include "core/Scheduler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <new>
+#include <thread>
+
+// Increment when the results format changes.
+static const uint kResultsVersion = 2u;
+// Number of random queries per world for BVH benchmarks.
+static const uint kBvhQueryCount = 10000u;
+
+// Count heap allocations, to measure the allocation cost of each benchmark.
+static std::atomic<size_t> sAllocationCount{0};
+
+static void* countedAlloc(size_t size){
+	sAllocationCount.fetch_add(1, std::memory_order_relaxed);
+	if(void* ptr = std::malloc(size == 0 ? 1 : size)){
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+// Over-allocate and store the malloc pointer right before the aligned block.
+static void* countedAlignedAlloc(size_t size, std::align_val_t alignment){
+	const size_t align = std::max(size_t(alignment), sizeof(void*));
+	void* raw = countedAlloc(size + align + sizeof(void*));
+	const uintptr_t aligned = (reinterpret_cast<uintptr_t>(raw) + sizeof(void*) + align - 1) & ~(uintptr_t(align) - 1);
+	void* ptr = reinterpret_cast<void*>(aligned);
+	static_cast<void**>(ptr)[-1] = raw;
+	return ptr;
+}
+
+static void countedAlignedFree(void* ptr){
+	if(ptr){
+		std::free(static_cast<void**>(ptr)[-1]);
+	}
+}
+
+void* operator new(size_t size){ return countedAlloc(size); }
+void* operator new[](size_t size){ return countedAlloc(size); }
+void* operator new(size_t size, std::align_val_t alignment){ return countedAlignedAlloc(size, alignment); }
+void* operator new[](size_t size, std::align_val_t alignment){ return countedAlignedAlloc(size, alignment); }
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { countedAlignedFree(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { countedAlignedFree(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { countedAlignedFree(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { countedAlignedFree(ptr); }
+
+/** \brief Timings of a benchmark over all iterations. */
+struct Result {
+	std::string name;
+	size_t items = 0; ///< Number of processed elements per iteration.
+	size_t allocations = 0; ///< Number of heap allocations in the last iteration.
+	std::vector<double> timings; ///< Duration of each iteration, in milliseconds.
+
+	double min() const { return *std::min_element(timings.begin(), timings.end()); }
+	double max() const { return *std::max_element(timings.begin(), timings.end()); }
+	double mean() const {
+		double sum = 0.0;
+		for(const double timing : timings){
+			sum += timing;
+		}
+		return sum / double(timings.size());
+	}
+	double median() const {
+		std::vector<double> sorted(timings);
+		std::sort(sorted.begin(), sorted.end());
+		const size_t mid = sorted.size() / 2u;
+		return (sorted.size() % 2u == 1u) ? sorted[mid] : 0.5 * (sorted[mid - 1u] + sorted[mid]);
+	}
+};
+
+/** \brief Run and record benchmarks. */
+class Benchmarks {
+public:
+
+	explicit Benchmarks(uint iterations) : _iterations(std::max(1u, iterations)) {}
+
+	/** Time a function over all iterations.
+	 \param name the benchmark name
+	 \param setup called before each iteration, not timed
+	 \param run the timed function, returns the number of processed items
+	 */
+	void run(const std::string& name, const std::function<void()>& setup, const std::function<size_t()>& run){
+		Result& result = _results.emplace_back();
+		result.name = name;
+		for(uint it = 0; it < _iterations; ++it){
+			if(setup){
+				setup();
+			}
+			const size_t allocationsBefore = sAllocationCount.load();
+			const auto start = std::chrono::steady_clock::now();
+			result.items = run();
+			const auto end = std::chrono::steady_clock::now();
+			result.allocations = sAllocationCount.load() - allocationsBefore;
+			result.timings.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+		}
+		Log::info("%-28s %6lu items, median %9.2fms, min %9.2fms, max %9.2fms, %lu allocations", name.c_str(), result.items, result.median(), result.min(), result.max(), result.allocations);
+	}
+
+	/** Save results in JSON, one benchmark per line to ease comparisons.
+	 \param path the output file path
+	 \param resourcesPath the resources used as input
+	 \return true if the file was saved
+	 */
+	bool save(const fs::path& path, const fs::path& resourcesPath) const {
+		FILE* file = fopen(path.string().c_str(), "w");
+		if(file == nullptr){
+			Log::error("Unable to write results to %s", path.string().c_str());
+			return false;
+		}
+		std::string resources = resourcesPath.string();
+		std::replace(resources.begin(), resources.end(), '\\', '/');
+		fprintf(file, "{\n\"version\": %u,\n\"resources\": \"%s\",\n\"iterations\": %u,\n\"results\": [\n", kResultsVersion, resources.c_str(), _iterations);
+		for(size_t rid = 0; rid < _results.size(); ++rid){
+			const Result& result = _results[rid];
+			fprintf(file, "{\"name\": \"%s\", \"items\": %lu, \"medianMs\": %.4f, \"meanMs\": %.4f, \"minMs\": %.4f, \"maxMs\": %.4f, \"allocations\": %lu}%s\n",
+					result.name.c_str(), result.items, result.median(), result.mean(), result.min(), result.max(), result.allocations,
+					rid + 1u == _results.size() ? "" : ",");
+		}
+		fprintf(file, "]\n}\n");
+		fclose(file);
+		Log::info("Saved %lu results to %s.", _results.size(), path.string().c_str());
+		return true;
+	}
+
+	/** Compare median timings with results saved by a previous run.
+	 \param path the baseline results file
+	 */
+	void compare(const fs::path& path) const {
+		std::ifstream file(path);
+		if(!file.is_open()){
+			Log::error("Unable to read baseline results from %s", path.string().c_str());
+			return;
+		}
+		Log::info("Comparison with %s:", path.string().c_str());
+		std::string line;
+		while(std::getline(file, line)){
+			char name[256];
+			unsigned long items = 0;
+			double median = 0.0;
+			if(sscanf(line.c_str(), "{\"name\": \"%255[^\"]\", \"items\": %lu, \"medianMs\": %lf", name, &items, &median) != 3){
+				continue;
+			}
+			const auto result = std::find_if(_results.begin(), _results.end(), [&name](const Result& res){
+				return res.name == name;
+			});
+			if(result == _results.end()){
+				continue;
+			}
+			const double current = result->median();
+			Log::info("%-28s %9.2fms -> %9.2fms (x%.2f)%s", name, median, current, median / std::max(current, 1e-6),
+					  items != result->items ? ", item count changed" : "");
+		}
+	}
+
+private:
+	std::vector<Result> _results;
+	uint _iterations;
+};
+
+// CPU part of the viewer scene generation: merge all objects in global buffers, unroll instances and build the CPU structures.
+static size_t generateScene(const World& world, BVH& bvh, PortalGraph& graph){
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> uvs;
+	std::vector<uint> indices;
+	std::vector<BoundingBox> objectBoxes;
+	objectBoxes.reserve(world.objects().size());
+
+	for(const Object& obj : world.objects()){
+		const uint vertexOffset = (uint)positions.size();
+		positions.insert(positions.end(), obj.positions.begin(), obj.positions.end());
+		normals.insert(normals.end(), obj.normals.begin(), obj.normals.end());
+		uvs.insert(uvs.end(), obj.uvs.begin(), obj.uvs.end());
+		BoundingBox& bbox = objectBoxes.emplace_back();
+		for(const Object::Set& set : obj.faceSets){
+			for(const Object::Set::Face& f : set.faces){
+				indices.push_back(vertexOffset + f.v0);
+				indices.push_back(vertexOffset + f.v1);
+				indices.push_back(vertexOffset + f.v2);
+				bbox.merge(obj.positions[f.v0]);
+				bbox.merge(obj.positions[f.v1]);
+				bbox.merge(obj.positions[f.v2]);
+			}
+		}
+	}
+
+	graph.build(world);
+	std::vector<BoundingBox> instanceBoxes;
+	instanceBoxes.reserve(world.instances().size());
+	uint zoneHits = 0u;
+	for(const World::Instance& instance : world.instances()){
+		const BoundingBox& bbox = instanceBoxes.emplace_back(objectBoxes[instance.object].transformed(instance.frame));
+		zoneHits += graph.findZone(bbox) != World::Portal::NO_ZONE ? 1u : 0u;
+	}
+	bvh.build(instanceBoxes);
+	(void)zoneHits;
+	return indices.size() / 3u;
+}
+
+// Previous System::forParallel implementation, spawning threads on each call with an even split.
+template<typename ThreadFunc>
+static void forParallelSpawn(size_t low, size_t high, ThreadFunc func) {
+	const size_t count = size_t(std::max(int(std::thread::hardware_concurrency())-1, 1));
+	std::vector<std::thread> threads;
+	threads.reserve(count);
+	const size_t span = std::max(size_t(1), (high - low) / count);
+	auto launchThread = [&func](size_t a, size_t b) {
+		for(size_t i = a; i < b; ++i) {
+			func(i);
+		}
+	};
+	for(size_t tid = 0; tid < count; ++tid) {
+		const size_t threadLow  = low + tid * span;
+		const size_t threadHigh = tid == (count-1) ? high : std::min(high, low + (tid + 1) * span);
+		threads.emplace_back(launchThread, threadLow, threadHigh);
+	}
+	std::for_each(threads.begin(), threads.end(), [](std::thread & x) { x.join(); });
+}
+
+// Synthetic work, with a cost proportional to the weight.
+static float syntheticWork(size_t weight){
+	float accum = 0.0f;
+	for(size_t i = 0; i < weight; ++i){
+		accum += std::sqrt(float(i) + accum);
+	}
+	return accum;
+}
+
+/** \brief Instances of a world, as inputs of the bounds benchmarks. */
+struct WorldBounds {
+	std::vector<BoundingBox> objectBoxes; ///< Local box of each object.
+	std::vector<uint> indices; ///< Object of each instance.
+	std::vector<glm::mat4> frames; ///< Frame of each instance.
+	glm::mat4 viewProj{1.0f}; ///< Culling viewpoint.
+};
+
+static WorldBounds computeWorldBounds(const World& world){
+	WorldBounds bounds;
+	bounds.objectBoxes.resize(world.objects().size());
+	for(size_t oid = 0; oid < bounds.objectBoxes.size(); ++oid){
+		for(const glm::vec3& pos : world.objects()[oid].positions){
+			bounds.objectBoxes[oid].merge(pos);
+		}
+	}
+	for(const World::Instance& instance : world.instances()){
+		bounds.indices.push_back(instance.object);
+		bounds.frames.push_back(instance.frame);
+	}
+	// Look at the scene from its first camera if available.
+	glm::mat4 view = glm::mat4(1.0f);
+	if(!world.cameras().empty()){
+		view = glm::inverse(world.cameras()[0].frame);
+	}
+	bounds.viewProj = Frustum::perspective(1.3f, 1.5f, 10.0f, 10000.0f) * view;
+	return bounds;
+}
+
+int main(int argc, const char** argv)
+{
+	fs::path outputPath = "benchmarks.json";
+	fs::path resourcesPath;
+	fs::path baselinePath;
+	uint iterations = 5u;
+	uint scale = 1u;
+	for(int aid = 1; aid < argc; ++aid){
+		const std::string arg(argv[aid]);
+		const bool hasValue = aid + 1 < argc;
+		if(arg == "--output" && hasValue){
+			outputPath = argv[++aid];
+		} else if(arg == "--resources" && hasValue){
+			resourcesPath = argv[++aid];
+		} else if(arg == "--baseline" && hasValue){
+			baselinePath = argv[++aid];
+		} else if(arg == "--iterations" && hasValue){
+			iterations = (uint)std::max(1, std::atoi(argv[++aid]));
+		} else if(arg == "--scale" && hasValue){
+			scale = (uint)std::max(1, std::atoi(argv[++aid]));
+		} else {
+			Log::error("Usage: benchmarks [--resources <dir>] [--scale <n>] [--iterations <n>] [--output <results.json>] [--baseline <results.json>]");
+			return 1;
+		}
+	}
+
+	// Report the memory used by world documents, before any is allocated.
+	World::trackXmlMemory();
+
+	// Generate synthetic data if no game resources are provided.
+	if(resourcesPath.empty()){
+		resourcesPath = fs::temp_directory_path() / ("eXplorer112_synthetic_" + std::to_string(scale));
+		if(!fs::exists(resourcesPath / "zones" / "world")){
+			Synthetic::Settings settings;
+			settings.scale = scale;
+			if(!Synthetic::generate(resourcesPath, settings)){
+				return 1;
+			}
+		}
+	}
+
+	std::vector<fs::path> modelsList;
+	std::vector<fs::path> areasList;
+	std::vector<fs::path> worldsList;
+	std::vector<fs::path> texturesList;
+	System::listAllFilesOfType(resourcesPath / "models", ".dff", modelsList);
+	System::listAllFilesOfType(resourcesPath / "zones", ".rf3", areasList);
+	System::listAllFilesOfType(resourcesPath / "zones" / "world", ".world", worldsList);
+	System::listAllFilesOfType(resourcesPath / "textures", ".dds", texturesList);
+	System::listAllFilesOfType(resourcesPath / "textures", ".tga", texturesList);
+	System::listAllFilesOfType(resourcesPath / "textures", ".png", texturesList);
+	// Stable order between runs.
+	std::sort(modelsList.begin(), modelsList.end());
+	std::sort(areasList.begin(), areasList.end());
+	std::sort(worldsList.begin(), worldsList.end());
+	std::sort(texturesList.begin(), texturesList.end());
+	Log::info("Benchmarking %s: %lu models, %lu areas, %lu worlds, %lu textures, %u iterations.", resourcesPath.string().c_str(),
+			  modelsList.size(), areasList.size(), worldsList.size(), texturesList.size(), iterations);
+
+	// Parsers are verbose.
+	const Log::Level logLevel = Log::getLevel();
+	auto quiet = [logLevel](bool enable){
+		Log::setLevel(enable ? Log::Level::ERROR : logLevel);
+	};
+
+	Benchmarks benchmarks(iterations);
+
+	// Scheduler fork/join overhead on many small loops, and load balance on a skewed loop.
+	const size_t smallCount = 64u;
+	const uint smallLoops = 1000u;
+	std::vector<float> workResults(smallCount);
+	benchmarks.run("forParallel small (spawn)", nullptr, [&workResults](){
+		for(uint lid = 0; lid < smallLoops; ++lid){
+			forParallelSpawn(0, workResults.size(), [&workResults](size_t i){ workResults[i] = syntheticWork(16); });
+		}
+		return size_t(smallLoops);
+	});
+	benchmarks.run("forParallel small (pool)", nullptr, [&workResults](){
+		for(uint lid = 0; lid < smallLoops; ++lid){
+			System::forParallel(0, workResults.size(), [&workResults](size_t i){ workResults[i] = syntheticWork(16); });
+		}
+		return size_t(smallLoops);
+	});
+	// The cost increases sharply towards the end of the range.
+	const size_t skewedCount = 4096u;
+	workResults.resize(skewedCount);
+	const auto skewedWork = [&workResults](size_t i){
+		const size_t weight = 1 + (i * i * i) / (skewedCount * skewedCount) * 4;
+		workResults[i] = syntheticWork(weight);
+	};
+	benchmarks.run("forParallel skewed (serial)", nullptr, [&skewedWork](){
+		for(size_t i = 0; i < skewedCount; ++i){
+			skewedWork(i);
+		}
+		return skewedCount;
+	});
+	benchmarks.run("forParallel skewed (spawn)", nullptr, [&skewedWork](){
+		forParallelSpawn(0, skewedCount, skewedWork);
+		return skewedCount;
+	});
+	benchmarks.run("forParallel skewed (pool)", nullptr, [&skewedWork](){
+		System::forParallel(0, skewedCount, skewedWork);
+		return skewedCount;
+	});
+	// Dependent groups: the second group starts once the first is complete.
+	std::atomic<uint> orderErrors{0};
+	benchmarks.run("TaskGroup dependencies", nullptr, [&orderErrors](){
+		const uint taskCount = 64u;
+		std::atomic<uint> firstDone{0};
+		TaskGroup first;
+		TaskGroup second;
+		for(uint tid = 0; tid < taskCount; ++tid){
+			first.run([&firstDone](){ syntheticWork(2000); ++firstDone; });
+		}
+		second.dependsOn(first);
+		for(uint tid = 0; tid < taskCount; ++tid){
+			second.run([&firstDone, &orderErrors](){
+				if(firstDone != taskCount){
+					++orderErrors;
+				}
+				float* scratch = Scheduler::scratch().allocate<float>(1024);
+				scratch[0] = syntheticWork(2000);
+			});
+		}
+		second.wait();
+		return size_t(2u * taskCount);
+	});
+	if(orderErrors != 0u){
+		Log::warning("TaskGroup dependencies: %u tasks started before their dependency completed.", orderErrors.load());
+	}
+
+	benchmarks.run("Dff::load", nullptr, [&modelsList, &quiet](){
+		quiet(true);
+		size_t count = 0;
+		for(const fs::path& path : modelsList){
+			Object object;
+			count += Dff::load(path, object) ? 1u : 0u;
+		}
+		quiet(false);
+		return count;
+	});
+
+	benchmarks.run("Area::load", nullptr, [&areasList, &quiet](){
+		quiet(true);
+		size_t count = 0;
+		for(const fs::path& path : areasList){
+			Object object;
+			std::vector<Area::Portal> portals;
+			count += Area::load(path, object, &portals) ? 1u : 0u;
+		}
+		quiet(false);
+		return count;
+	});
+
+	benchmarks.run("World::load", nullptr, [&worldsList, &resourcesPath, &quiet](){
+		quiet(true);
+		size_t count = 0;
+		for(const fs::path& path : worldsList){
+			World world;
+			count += world.load(path, resourcesPath) ? 1u : 0u;
+		}
+		quiet(false);
+		return count;
+	});
+
+	benchmarks.run("Image::load", nullptr, [&texturesList](){
+		size_t count = 0;
+		for(const fs::path& path : texturesList){
+			Image image;
+			count += image.load(path) ? 1u : 0u;
+		}
+		return count;
+	});
+
+	// Uncompress copies of the loaded images.
+	std::vector<Image> sourceImages;
+	for(const fs::path& path : texturesList){
+		Image& image = sourceImages.emplace_back();
+		if(!image.load(path) || image.compressedFormat == Image::Compression::NONE){
+			sourceImages.pop_back();
+		}
+	}
+	std::vector<Image> images;
+	benchmarks.run("Image::uncompress", [&sourceImages, &images](){
+		images.resize(sourceImages.size());
+		for(size_t iid = 0; iid < sourceImages.size(); ++iid){
+			sourceImages[iid].clone(images[iid]);
+		}
+	}, [&images](){
+		size_t count = 0;
+		for(Image& image : images){
+			count += image.uncompress() ? 1u : 0u;
+		}
+		return count;
+	});
+	images.clear();
+	sourceImages.clear();
+
+	// Loaded worlds for processing benchmarks.
+	quiet(true);
+	std::vector<World> worlds(worldsList.size());
+	for(size_t wid = 0; wid < worldsList.size(); ++wid){
+		worlds[wid].load(worldsList[wid], resourcesPath);
+	}
+	quiet(false);
+
+	const fs::path objPath = fs::temp_directory_path() / "eXplorer112_benchmark.obj";
+	benchmarks.run("writeObjToStream", nullptr, [&worlds, &objPath](){
+		size_t count = 0;
+		for(const World& world : worlds){
+			ObjOffsets offsets;
+			std::ofstream objFile(objPath);
+			for(const World::Instance& instance : world.instances()){
+				writeObjToStream(world.objects()[instance.object], objFile, offsets, instance.frame);
+				++count;
+			}
+		}
+		return count;
+	});
+	fs::remove(objPath);
+
+	benchmarks.run("Scene generation (CPU)", nullptr, [&worlds](){
+		size_t count = 0;
+		for(const World& world : worlds){
+			BVH bvh;
+			PortalGraph graph;
+			count += generateScene(world, bvh, graph);
+		}
+		return count;
+	});
+
+	// Instance bounds transformation and culling, one box at a time and in batches.
+	std::vector<WorldBounds> worldBounds;
+	for(const World& world : worlds){
+		worldBounds.push_back(computeWorldBounds(world));
+	}
+
+	// Instances BVH construction and queries.
+	std::vector<std::vector<BoundingBox>> instanceBoxes(worldBounds.size());
+	std::vector<BoundingBox> sceneBoxes(worldBounds.size());
+	for(size_t wid = 0; wid < worldBounds.size(); ++wid){
+		const WorldBounds& bounds = worldBounds[wid];
+		for(size_t i = 0; i < bounds.indices.size(); ++i){
+			instanceBoxes[wid].push_back(bounds.objectBoxes[bounds.indices[i]].transformed(bounds.frames[i]));
+			sceneBoxes[wid].merge(instanceBoxes[wid].back());
+		}
+	}
+	std::vector<BVH> bvhs(worldBounds.size());
+	benchmarks.run("BVH::build", nullptr, [&instanceBoxes, &bvhs](){
+		size_t count = 0;
+		for(size_t wid = 0; wid < instanceBoxes.size(); ++wid){
+			bvhs[wid].build(instanceBoxes[wid]);
+			count += instanceBoxes[wid].size();
+		}
+		return count;
+	});
+	// Random rays and regions inside the scene bounds, identical across runs.
+	benchmarks.run("BVH::intersect", [](){ Random::seed(1234u); }, [&bvhs, &sceneBoxes](){
+		size_t count = 0;
+		for(size_t wid = 0; wid < bvhs.size(); ++wid){
+			if(bvhs[wid].nodeCount() == 0u){
+				continue;
+			}
+			for(uint qid = 0; qid < kBvhQueryCount; ++qid){
+				const glm::vec3 origin = glm::mix(sceneBoxes[wid].minis, sceneBoxes[wid].maxis, Random::Float3());
+				BVH::Hit hit;
+				bvhs[wid].intersect(BVH::Ray(origin, Random::sampleSphere()), hit);
+			}
+			count += kBvhQueryCount;
+		}
+		return count;
+	});
+	std::vector<uint> items;
+	benchmarks.run("BVH::query", [](){ Random::seed(1234u); }, [&bvhs, &sceneBoxes, &items](){
+		size_t count = 0;
+		for(size_t wid = 0; wid < bvhs.size(); ++wid){
+			if(bvhs[wid].nodeCount() == 0u){
+				continue;
+			}
+			const glm::vec3 regionSize = 0.05f * sceneBoxes[wid].getSize();
+			for(uint qid = 0; qid < kBvhQueryCount; ++qid){
+				const glm::vec3 center = glm::mix(sceneBoxes[wid].minis, sceneBoxes[wid].maxis, Random::Float3());
+				items.clear();
+				bvhs[wid].query(BoundingBox(center - regionSize, center + regionSize), items);
+			}
+			count += kBvhQueryCount;
+		}
+		return count;
+	});
+	// Visible counts are compared between kernels.
+	size_t referenceVisible = 0u;
+	benchmarks.run("Bounds reference", nullptr, [&worldBounds, &referenceVisible](){
+		size_t count = 0;
+		referenceVisible = 0u;
+		for(const WorldBounds& bounds : worldBounds){
+			const Frustum frustum(bounds.viewProj);
+			for(size_t i = 0; i < bounds.indices.size(); ++i){
+				const BoundingBox box = bounds.objectBoxes[bounds.indices[i]].transformed(bounds.frames[i]);
+				referenceVisible += frustum.intersects(box) ? 1u : 0u;
+			}
+			count += bounds.indices.size();
+		}
+		return count;
+	});
+
+	std::vector<BoundingBoxBatch> objectBatches;
+	for(const WorldBounds& bounds : worldBounds){
+		objectBatches.emplace_back(bounds.objectBoxes);
+	}
+	std::vector<BoundingBoxBatch> instanceBatches(worldBounds.size());
+	std::vector<uint64_t> visibility;
+	const char* kernelNames[] = { "scalar", "SSE", "AVX2", "auto" };
+	for(uint kid = 0; kid <= (uint)BoundingBoxBatch::Kernel::AUTO; ++kid){
+		const BoundingBoxBatch::Kernel kernel = BoundingBoxBatch::Kernel(kid);
+		if(kernel != BoundingBoxBatch::Kernel::AUTO && kid > (uint)BoundingBoxBatch::bestKernel()){
+			continue;
+		}
+		for(size_t wid = 0; wid < worldBounds.size(); ++wid){
+			objectBatches[wid].setKernel(kernel);
+			instanceBatches[wid].setKernel(kernel);
+		}
+		benchmarks.run(std::string("Bounds transform (") + kernelNames[kid] + ")", nullptr, [&worldBounds, &objectBatches, &instanceBatches](){
+			size_t count = 0;
+			for(size_t wid = 0; wid < worldBounds.size(); ++wid){
+				objectBatches[wid].transform(worldBounds[wid].indices, worldBounds[wid].frames, instanceBatches[wid]);
+				count += instanceBatches[wid].size();
+			}
+			return count;
+		});
+		size_t batchVisible = 0u;
+		benchmarks.run(std::string("Bounds cull (") + kernelNames[kid] + ")", nullptr, [&worldBounds, &instanceBatches, &visibility, &batchVisible](){
+			size_t count = 0;
+			batchVisible = 0u;
+			for(size_t wid = 0; wid < worldBounds.size(); ++wid){
+				batchVisible += instanceBatches[wid].cull(Frustum(worldBounds[wid].viewProj), visibility);
+				count += instanceBatches[wid].size();
+			}
+			return count;
+		});
+		if(batchVisible != referenceVisible){
+			Log::warning("Bounds %s: %lu visible boxes, expected %lu.", kernelNames[kid], batchVisible, referenceVisible);
+		}
+	}
+
+	if(!benchmarks.save(outputPath, resourcesPath)){
+		return 1;
+	}
+	if(!baselinePath.empty()){
+		benchmarks.compare(baselinePath);
+	}
+	return 0;
+}
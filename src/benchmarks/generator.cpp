@@ -0,0 +1,21 @@
+#include "benchmarks/SyntheticData.hpp"
+#include "core/Log.hpp"
+
+#include <cstdlib>
+
+int main(int argc, const char** argv)
+{
+	if(argc < 2){
+		Log::error("Usage: eXgenerator112 <output resources directory> [scale] [seed]");
+		return 1;
+	}
+
+	Synthetic::Settings settings;
+	if(argc > 2){
+		settings.scale = (uint)std::max(1, std::atoi(argv[2]));
+	}
+	if(argc > 3){
+		settings.seed = (uint)std::strtoul(argv[3], nullptr, 10);
+	}
+	return Synthetic::generate(argv[1], settings) ? 0 : 1;
+}
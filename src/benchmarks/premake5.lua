@@ -0,0 +1,50 @@
+
+-- Synthetic game data generator
+project("eXgenerator112")
+	kind("ConsoleApp")
+
+	language("C++")
+	cppdialect("C++17")
+
+	-- Compiler flags
+	filter("toolset:not msc*")
+		buildoptions({ "-Wall", "-Wextra", "-Wno-unknown-pragmas" })
+	filter("toolset:msc*")
+		buildoptions({ "-W3", "-wd4068"})
+	filter({})
+	-- visual studio filters
+	filter("action:vs*")
+		defines({ "_CRT_SECURE_NO_WARNINGS" })  
+	filter({})
+
+	-- System headers are used to support angled brackets in Xcode.
+	includedirs({"../"})
+	sysincludedirs({ "../libs" })
+
+	files({"SyntheticData.hpp", "SyntheticData.cpp", "generator.cpp", "../core/**", "../libs/**.hpp", "../libs/*/*.cpp", "../libs/**.h", "../libs/*/*.c"})
+	removefiles({"**.DS_STORE", "**.thumbs"})
+
+-- Parsing and processing benchmarks, on synthetic data or the game resources
+project("benchmarks")
+	kind("ConsoleApp")
+
+	language("C++")
+	cppdialect("C++17")
+
+	-- Compiler flags
+	filter("toolset:not msc*")
+		buildoptions({ "-Wall", "-Wextra", "-Wno-unknown-pragmas" })
+	filter("toolset:msc*")
+		buildoptions({ "-W3", "-wd4068"})
+	filter({})
+	-- visual studio filters
+	filter("action:vs*")
+		defines({ "_CRT_SECURE_NO_WARNINGS" })  
+	filter({})
+
+	-- System headers are used to support angled brackets in Xcode.
+	includedirs({"../"})
+	sysincludedirs({ "../libs" })
+
+	files({"SyntheticData.hpp", "SyntheticData.cpp", "benchmarks.cpp", "../core/**", "../libs/**.hpp", "../libs/*/*.cpp", "../libs/**.h", "../libs/*/*.c"})
+	removefiles({"**.DS_STORE", "**.thumbs"})
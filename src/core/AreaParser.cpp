@@ -1,6 +1,7 @@
 #include "core/AreaParser.hpp"
 #include "core/Log.hpp"
 #include "core/TextUtilities.hpp"
+#include "core/Profiler.hpp"
 
 #include <unordered_map>
 #include <set>
@@ -21,7 +22,6 @@ int parseInt(const char* val, int fallback){
 	if(val == nullptr || val[0] == '\0'){
 		return fallback;
 	}
-	std::string valStr(val);
 	return std::stoi(val);
 }
 
@@ -29,29 +29,41 @@ float parseFloat(const char* val, float fallback){
 	if(val == nullptr || val[0] == '\0'){
 		return fallback;
 	}
-	std::string valStr(val);
 	return std::stof(val);
 }
 
 // e for exponent should not be first/last character.
 // f at the end of a float has no extra meaning
-static const std::string kTrimVecStr = "()abcdefghijklmnopqrstuvwxyz_ABCDEFGHIJKLMNOPQRSTUVWXYZ[]{}";
+static const std::string_view kTrimVecStr = "()abcdefghijklmnopqrstuvwxyz_ABCDEFGHIJKLMNOPQRSTUVWXYZ[]{}";
+
+// Parse up to count space-separated floats, return the number of parsed values.
+static uint parseFloats(std::string_view val, float* dst, uint count){
+	TextUtilities::Tokenizer tokenizer(TextUtilities::trimView(val, kTrimVecStr), ' ', true);
+	std::string_view token;
+	uint parsed = 0;
+	while(parsed < count && tokenizer.next(token)){
+		if(!TextUtilities::parseFloat(token, dst[parsed])){
+			break;
+		}
+		++parsed;
+	}
+	return parsed;
+}
 
 glm::vec2 parseVec2(const char* val, const glm::vec2& fallback){
 	if(val == nullptr || val[0] == '\0'){
 		return fallback;
 	}
+	return parseVec2(std::string_view(val), fallback);
+}
 
-	std::string valStr(val);
-	valStr = TextUtilities::trim(valStr, kTrimVecStr);
-	const std::vector<std::string> tokens = TextUtilities::split(valStr, " ", true);
-	const uint tokenCount = glm::min(2u, (uint)tokens.size());
-	if(tokenCount < 2u){
-		Log::warning("Unable to fully parse vec2: %s", valStr.c_str());
-	}
+glm::vec2 parseVec2(std::string_view val, const glm::vec2& fallback){
 	glm::vec2 res = fallback;
-	for(uint i = 0; i < tokenCount; ++i){
-		res[i] = std::stof(tokens[i]);
+	if(val.empty()){
+		return res;
+	}
+	if(parseFloats(val, &res[0], 2u) < 2u){
+		Log::warning("Unable to fully parse vec2: %.*s", int(val.size()), val.data());
 	}
 	return res;
 }
@@ -60,17 +72,16 @@ glm::vec3 parseVec3(const char* val, const glm::vec3& fallback){
 	if(val == nullptr || val[0] == '\0'){
 		return fallback;
 	}
+	return parseVec3(std::string_view(val), fallback);
+}
 
-	std::string valStr(val);
-	valStr = TextUtilities::trim(valStr, kTrimVecStr);
-	const std::vector<std::string> tokens = TextUtilities::split(valStr, " ", true);
-	const uint tokenCount = glm::min(3u, (uint)tokens.size());
-	if(tokenCount < 3u){
-		Log::warning("Unable to fully parse vec3: %s", valStr.c_str());
-	}
+glm::vec3 parseVec3(std::string_view val, const glm::vec3& fallback){
 	glm::vec3 res = fallback;
-	for(uint i = 0; i < tokenCount; ++i){
-		res[i] = std::stof(tokens[i]);
+	if(val.empty()){
+		return res;
+	}
+	if(parseFloats(val, &res[0], 3u) < 3u){
+		Log::warning("Unable to fully parse vec3: %.*s", int(val.size()), val.data());
 	}
 	return res;
 }
@@ -79,18 +90,16 @@ glm::vec4 parseVec4(const char* val, const glm::vec4& fallback){
 	if(val == nullptr || val[0] == '\0'){
 		return fallback;
 	}
+	return parseVec4(std::string_view(val), fallback);
+}
 
-	std::string valStr(val);
-	valStr = TextUtilities::trim(valStr, kTrimVecStr);
-	const std::vector<std::string> tokens = TextUtilities::split(valStr, " ", true);
-
-	const uint tokenCount = glm::min(4u, (uint)tokens.size());
-	if(tokenCount < 4u){
-		Log::warning("Unable to fully parse vec4: %s", valStr.c_str());
-	}
+glm::vec4 parseVec4(std::string_view val, const glm::vec4& fallback){
 	glm::vec4 res = fallback;
-	for(uint i = 0; i < tokenCount; ++i){
-		res[i] = std::stof(tokens[i]);
+	if(val.empty()){
+		return res;
+	}
+	if(parseFloats(val, &res[0], 4u) < 4u){
+		Log::warning("Unable to fully parse vec4: %.*s", int(val.size()), val.data());
 	}
 	return res;
 }
@@ -99,25 +108,26 @@ glm::mat4 parseFrame(const char* val){
 	if(val == nullptr || val[0] == '\0'){
 		return glm::mat4(1.0f);
 	}
-	std::string valStr(val);
-	valStr = TextUtilities::trim(valStr, kTrimVecStr);
-	TextUtilities::replace(valStr, ")(", ";");
-	const auto rows = TextUtilities::split(valStr, ";", true);
-	if(rows.size() != 4){
-		Log::error("Unable to parse frame.");
-		return glm::mat4(1.0f);
-	}
+	// Rows are delimited by parentheses.
+	TextUtilities::Tokenizer rows(TextUtilities::trimView(val, kTrimVecStr), ')', true);
 	glm::mat4 res(1.0f);
-
-	for(int i = 0; i < 4; ++i){
-		const auto coeffs = TextUtilities::split(rows[i], " ", true);
-		if(coeffs.size() != 3){
+	std::string_view row;
+	int i = 0;
+	while(rows.next(row)){
+		row = TextUtilities::trimView(row, "( ");
+		if(row.empty()){
+			continue;
+		}
+		// Exactly three coefficients per row (a fourth one would be caught here).
+		if(i == 4 || parseFloats(row, &res[i][0], 4u) != 3u){
 			Log::error("Unable to parse frame.");
 			return glm::mat4(1.0f);
 		}
-		for(int j = 0; j < 3; ++j){
-			res[i][j] = std::stof(coeffs[j]);
-		}
+		++i;
+	}
+	if(i != 4){
+		Log::error("Unable to parse frame.");
+		return glm::mat4(1.0f);
 	}
 	return res;
 }
@@ -134,7 +144,7 @@ std::string retrieveTextureName(const pugi::xml_node& textureRef, const pugi::xm
 	}
 
 	std::string texturePath = textureDec.attribute("sourcename").as_string();
-	TextUtilities::replace(texturePath, "\\", "/");
+	TextUtilities::replace(texturePath, '\\', '/');
 	texturePath = TextUtilities::trim(texturePath, "/");
 
 	std::string textureName = texturePath;
@@ -149,7 +159,134 @@ std::string retrieveTextureName(const pugi::xml_node& textureRef, const pugi::xm
 	return TextUtilities::lowercase(textureName);
 }
 
-bool load(const fs::path& path, Object& outObject){
+// Split a string into views, reusing the storage of the token list.
+static void splitViews(std::string_view str, char delimiter, std::vector<std::string_view>& tokens){
+	tokens.clear();
+	TextUtilities::Tokenizer tokenizer(str, delimiter, true);
+	std::string_view token;
+	while(tokenizer.next(token)){
+		tokens.push_back(token);
+	}
+}
+
+// Parse exactly three space-separated vertex indices.
+static bool parseTriangle(std::string_view str, uint (&indices)[3]){
+	TextUtilities::Tokenizer tokenizer(str, ' ', true);
+	std::string_view token;
+	uint count = 0;
+	while(tokenizer.next(token)){
+		if(count == 3 || !TextUtilities::parseUint(token, indices[count])){
+			return false;
+		}
+		++count;
+	}
+	return count == 3;
+}
+
+static bool extractPortal(const pugi::xml_node& polymesh, const glm::mat4& frame, Portal& portal){
+	const auto vertexList = polymesh.child("vertexlist");
+	int vIndex = -1;
+	int count = 0;
+	for(const auto& param : vertexList.child("format").children()){
+		if(strcmp(param.attribute("name").value(), "position") == 0){
+			vIndex = count;
+		}
+		++count;
+	}
+	if(vIndex < 0){
+		return false;
+	}
+
+	std::vector<glm::vec3> positions;
+	std::vector<std::string_view> tokens;
+	for(const auto& v : vertexList.children("v")){
+		splitViews(v.child_value(), '(', tokens);
+		if(tokens.size() != (size_t)count){
+			continue;
+		}
+		const glm::vec3 pos = parseVec3(tokens[vIndex]);
+		positions.push_back(glm::vec3(frame * glm::vec4(pos, 1.0f)));
+	}
+	if(positions.size() < 3){
+		return false;
+	}
+
+	// Estimate the portal plane from its triangles, aligning their orientations.
+	glm::vec3 normal(0.0f);
+	for(const auto& primList : polymesh.children("primlist")){
+		for(const auto& p : primList.children("p")){
+			uint indices[3];
+			if(!parseTriangle(p.child_value(), indices)){
+				continue;
+			}
+			const uint32_t v0 = indices[0];
+			const uint32_t v1 = indices[1];
+			const uint32_t v2 = indices[2];
+			if(v0 >= positions.size() || v1 >= positions.size() || v2 >= positions.size()){
+				continue;
+			}
+			const glm::vec3 faceNormal = glm::cross(positions[v1] - positions[v0], positions[v2] - positions[v0]);
+			normal += glm::dot(normal, faceNormal) < 0.0f ? -faceNormal : faceNormal;
+		}
+	}
+	if(glm::length(normal) < 1e-6f){
+		return false;
+	}
+	normal = glm::normalize(normal);
+
+	glm::vec3 center(0.0f);
+	for(const glm::vec3& pos : positions){
+		center += pos;
+	}
+	center /= float(positions.size());
+
+	// Build the 2D convex hull of the vertices in the portal plane (monotone chain).
+	const glm::vec3 axisU = glm::normalize(std::abs(normal.x) < 0.9f ? glm::cross(normal, glm::vec3(1.0f, 0.0f, 0.0f)) : glm::cross(normal, glm::vec3(0.0f, 1.0f, 0.0f)));
+	const glm::vec3 axisV = glm::cross(normal, axisU);
+	std::vector<std::pair<glm::vec2, uint>> points;
+	points.reserve(positions.size());
+	for(uint vid = 0; vid < positions.size(); ++vid){
+		const glm::vec3 local = positions[vid] - center;
+		points.emplace_back(glm::vec2(glm::dot(local, axisU), glm::dot(local, axisV)), vid);
+	}
+	std::sort(points.begin(), points.end(), [](const std::pair<glm::vec2, uint>& a, const std::pair<glm::vec2, uint>& b){
+		return a.first.x < b.first.x || (a.first.x == b.first.x && a.first.y < b.first.y);
+	});
+	auto turn = [](const glm::vec2& o, const glm::vec2& a, const glm::vec2& b){
+		return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+	};
+	std::vector<std::pair<glm::vec2, uint>> hull(2 * points.size());
+	size_t k = 0;
+	for(size_t i = 0; i < points.size(); ++i){
+		while(k >= 2 && turn(hull[k-2].first, hull[k-1].first, points[i].first) <= 0.0f){
+			--k;
+		}
+		hull[k++] = points[i];
+	}
+	for(size_t i = points.size() - 1, t = k + 1; i > 0; --i){
+		while(k >= t && turn(hull[k-2].first, hull[k-1].first, points[i-1].first) <= 0.0f){
+			--k;
+		}
+		hull[k++] = points[i-1];
+	}
+	// The last point is the same as the first one.
+	hull.resize(k > 0 ? k - 1 : 0);
+	if(hull.size() < 3){
+		return false;
+	}
+
+	portal.polygon.clear();
+	for(const auto& point : hull){
+		// Flatten the vertex on the plane.
+		portal.polygon.push_back(center + point.first.x * axisU + point.first.y * axisV);
+	}
+	portal.normal = normal;
+	portal.center = center;
+	return true;
+}
+
+bool load(const fs::path& path, Object& outObject, std::vector<Portal>* outPortals){
+	PROFILE_SCOPE("Area::load");
 
 	pugi::xml_document areaFile;
 	if(!areaFile.load_file(path.c_str())){
@@ -176,7 +313,7 @@ bool load(const fs::path& path, Object& outObject){
 
 		const char* shaderName = shader.attribute("name").as_string();
 		std::string shaderBaseName(shaderName);
-		TextUtilities::replace(shaderBaseName, "-", "_");
+		TextUtilities::replace(shaderBaseName, '-', '_');
 		const std::string shaderFullName = areaName + "_" + shaderBaseName;
 		// Check if the material has at least one texture, else ignore it (shadow mesh or bounds).
 		const auto textureRef = shader.child("shaderfunc").find_child_by_attribute("channel", "name", "color").child("texture");
@@ -229,7 +366,15 @@ bool load(const fs::path& path, Object& outObject){
 			} else if(strcmp(userType, "\"transparent\"") == 0){
 				materialType = Object::Material::TRANSPARENT;
 			} else if(strstr(userType, "\"portal") != nullptr){
-				// Skip physics/sound/visibility portals
+				// Keep visibility portals for culling, skip physics/sound portals.
+				const bool visibilityPortal = (strstr(userType, "physic") == nullptr) && (strstr(userType, "sound") == nullptr);
+				if(outPortals && visibilityPortal){
+					Portal portal;
+					portal.name = areaName + "_portal_" + std::to_string(outPortals->size());
+					if(extractPortal(group.child("polymesh"), frame, portal)){
+						outPortals->push_back(portal);
+					}
+				}
 				continue;
 			} // "bounds" (see t16)
 		}
@@ -261,10 +406,12 @@ bool load(const fs::path& path, Object& outObject){
 			}
 
 
+			std::vector<std::string_view> tokens;
+			tokens.reserve(count);
 			for(const auto& v : vertexList.children("v")){
 				// Assume index at the beginning.
 				// Split on opening parenthesis
-				const auto tokens = TextUtilities::split(v.child_value(), "(", true);
+				splitViews(v.child_value(), '(', tokens);
 				if(tokens.size() != (size_t)count){
 					Log::error("Unexpected token count");
 					continue;
@@ -272,15 +419,15 @@ bool load(const fs::path& path, Object& outObject){
 				//indices.push_back(std::stoul(tokens[0]));
 				assert(vIndex >= 0);
 
-				const glm::vec3 pos = parseVec3(tokens[vIndex].c_str());
+				const glm::vec3 pos = parseVec3(tokens[vIndex]);
 				outObject.positions.push_back(glm::vec3(frame * glm::vec4(pos, 1.0f)));
 
 				if(tIndex >= 0){
-					const glm::vec2 flipUV = parseVec2(tokens[tIndex].c_str());
+					const glm::vec2 flipUV = parseVec2(tokens[tIndex]);
 					outObject.uvs.emplace_back(flipUV.x, 1.0f - flipUV.y);
 				}
 				if(nIndex >= 0){
-					const glm::vec3 nor = glm::normalize(parseVec3(tokens[nIndex].c_str()));
+					const glm::vec3 nor = glm::normalize(parseVec3(tokens[nIndex]));
 					outObject.normals.push_back(glm::normalize(frameNormal * nor));
 				}
 			}
@@ -295,7 +442,7 @@ bool load(const fs::path& path, Object& outObject){
 				}
 
 				std::string shaderBaseName(pShader);
-				TextUtilities::replace(shaderBaseName, "-", "_");
+				TextUtilities::replace(shaderBaseName, '-', '_');
 				const std::string shaderFullName = areaName + "_" + shaderBaseName;
 				auto shadIt = shaders.find(shaderFullName);
 				// Skip missing (non-textured materials).
@@ -314,15 +461,15 @@ bool load(const fs::path& path, Object& outObject){
 				set.faces.reserve(pCount);
 
 				for(const auto& p : primList.children("p")){
-					const auto tokens = TextUtilities::split(p.child_value(), " ", true);
-					if(tokens.size() != 3){
+					uint indices[3];
+					if(!parseTriangle(p.child_value(), indices)){
 						Log::error("Unexpected primitive index count");
 						continue;
 					}
 					Object::Set::Face& f = set.faces.emplace_back();
-					const uint32_t v0 = std::stoul(tokens[0]);
-					const uint32_t v1 = std::stoul(tokens[1]);
-					const uint32_t v2 = std::stoul(tokens[2]);
+					const uint32_t v0 = indices[0];
+					const uint32_t v1 = indices[1];
+					const uint32_t v2 = indices[2];
 					f.v0 = v0 + offsets.v;
 					f.v1 = v1 + offsets.v;
 					f.v2 = v2 + offsets.v;
@@ -3,15 +3,28 @@
 #include "core/System.hpp"
 #include "core/Geometry.hpp"
 
+#include <string_view>
+
 namespace Area {
 
+/** \brief Visibility portal between two areas, as a convex polygon in world space. */
+struct Portal {
+	std::string name;
+	std::vector<glm::vec3> polygon; ///< Vertices ordered around the portal normal.
+	glm::vec3 normal{0.0f, 0.0f, 1.0f};
+	glm::vec3 center{0.0f};
+};
+
 bool parseBool(const char* v, bool fallback = false);
 int parseInt(const char* v, int fallback = 0);
 float parseFloat(const char* v, float fallback = 0.0f);
 glm::vec2 parseVec2(const char* v, const glm::vec2& fallback = glm::vec2(0.0f));
 glm::vec3 parseVec3(const char* v, const glm::vec3& fallback = glm::vec3(0.0f));
 glm::vec4 parseVec4(const char* v, const glm::vec4& fallback = glm::vec4(0.0f));
+glm::vec2 parseVec2(std::string_view v, const glm::vec2& fallback = glm::vec2(0.0f));
+glm::vec3 parseVec3(std::string_view v, const glm::vec3& fallback = glm::vec3(0.0f));
+glm::vec4 parseVec4(std::string_view v, const glm::vec4& fallback = glm::vec4(0.0f));
 
-bool load(const fs::path& path, Object& outObject);
+bool load(const fs::path& path, Object& outObject, std::vector<Portal>* outPortals = nullptr);
 
 }
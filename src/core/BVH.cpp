@@ -0,0 +1,278 @@
+#include "core/BVH.hpp"
+
+#include <array>
+
+// Build parameters.
+static const uint kMaxLeafItems = 4u;
+static const uint kBinCount = 12u;
+static const float kTraversalCost = 1.0f;
+static const float kIntersectionCost = 1.0f;
+
+static float surfaceArea(const BoundingBox& box){
+	if(box.empty()){
+		return 0.0f;
+	}
+	const glm::vec3 size = box.getSize();
+	return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+BVH::Ray::Ray(const glm::vec3& aOrigin, const glm::vec3& aDirection) :
+	origin(aOrigin), direction(aDirection) {
+	// Division by zero yields infinities, which the slab test handles.
+	invDirection = 1.0f / direction;
+}
+
+void BVH::clean(){
+	_nodes.clear();
+	_items.clear();
+	_boxes.clear();
+}
+
+void BVH::build(const std::vector<BoundingBox>& boxes){
+	clean();
+	if(boxes.empty()){
+		return;
+	}
+
+	_boxes = boxes;
+	const uint itemCount = (uint)boxes.size();
+	_items.resize(itemCount);
+	std::vector<glm::vec3> centroids(itemCount);
+	for(uint i = 0; i < itemCount; ++i){
+		_items[i] = i;
+		centroids[i] = boxes[i].getCentroid();
+	}
+
+	// At most 2N-1 nodes for N items.
+	_nodes.reserve(2 * itemCount);
+	_nodes.emplace_back();
+	_nodes[0].first = 0;
+	_nodes[0].count = itemCount;
+
+	struct Bin {
+		BoundingBox bbox;
+		uint count = 0;
+	};
+
+	std::vector<uint> stack;
+	stack.push_back(0);
+
+	while(!stack.empty()){
+		const uint nodeId = stack.back();
+		stack.pop_back();
+
+		const uint first = _nodes[nodeId].first;
+		const uint count = _nodes[nodeId].count;
+
+		BoundingBox bbox;
+		BoundingBox centroidBox;
+		for(uint i = first; i < first + count; ++i){
+			bbox.merge(_boxes[_items[i]]);
+			centroidBox.merge(centroids[_items[i]]);
+		}
+		_nodes[nodeId].bbox = bbox;
+
+		if(count <= kMaxLeafItems){
+			continue;
+		}
+
+		// Evaluate binned split candidates along each axis.
+		const float leafCost = kIntersectionCost * float(count);
+		float bestCost = std::numeric_limits<float>::max();
+		uint bestAxis = 0;
+		uint bestSplit = 0;
+		const glm::vec3 centroidExtent = centroidBox.getSize();
+
+		for(uint axis = 0; axis < 3; ++axis){
+			if(centroidExtent[axis] <= 0.0f){
+				continue;
+			}
+			const float scale = float(kBinCount) / centroidExtent[axis];
+			std::array<Bin, kBinCount> bins;
+			for(uint i = first; i < first + count; ++i){
+				const uint item = _items[i];
+				const uint binId = std::min(kBinCount - 1u, uint((centroids[item][axis] - centroidBox.minis[axis]) * scale));
+				bins[binId].bbox.merge(_boxes[item]);
+				++bins[binId].count;
+			}
+			// Sweep from the right to accumulate areas, then from the left to evaluate costs.
+			std::array<float, kBinCount> rightAreas;
+			std::array<uint, kBinCount> rightCounts;
+			BoundingBox rightBox;
+			uint rightCount = 0;
+			for(uint b = kBinCount - 1u; b > 0; --b){
+				rightBox.merge(bins[b].bbox);
+				rightCount += bins[b].count;
+				rightAreas[b] = surfaceArea(rightBox);
+				rightCounts[b] = rightCount;
+			}
+			BoundingBox leftBox;
+			uint leftCount = 0;
+			for(uint b = 0; b < kBinCount - 1u; ++b){
+				leftBox.merge(bins[b].bbox);
+				leftCount += bins[b].count;
+				if(leftCount == 0 || rightCounts[b + 1] == 0){
+					continue;
+				}
+				const float cost = surfaceArea(leftBox) * float(leftCount) + rightAreas[b + 1] * float(rightCounts[b + 1]);
+				if(cost < bestCost){
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = b;
+				}
+			}
+		}
+
+		const float parentArea = std::max(surfaceArea(bbox), 1e-8f);
+		bestCost = kTraversalCost + kIntersectionCost * bestCost / parentArea;
+
+		uint mid = first;
+		if(bestCost < leafCost){
+			// Partition items around the selected bin.
+			const float scale = float(kBinCount) / centroidExtent[bestAxis];
+			auto midIt = std::partition(_items.begin() + first, _items.begin() + first + count, [&](uint item){
+				const uint binId = std::min(kBinCount - 1u, uint((centroids[item][bestAxis] - centroidBox.minis[bestAxis]) * scale));
+				return binId <= bestSplit;
+			});
+			mid = uint(midIt - _items.begin());
+		} else if(count > 2u * kMaxLeafItems){
+			// Degenerate distribution (all centroids at the same place), split in the middle to bound leaf size.
+			mid = first + count / 2u;
+		} else {
+			continue;
+		}
+
+		if(mid == first || mid == first + count){
+			mid = first + count / 2u;
+		}
+
+		const uint leftId = (uint)_nodes.size();
+		_nodes.emplace_back();
+		_nodes.emplace_back();
+		_nodes[leftId].first = first;
+		_nodes[leftId].count = mid - first;
+		_nodes[leftId + 1].first = mid;
+		_nodes[leftId + 1].count = first + count - mid;
+
+		_nodes[nodeId].first = leftId;
+		_nodes[nodeId].count = 0;
+
+		stack.push_back(leftId + 1);
+		stack.push_back(leftId);
+	}
+}
+
+bool BVH::intersects(const Ray& ray, const BoundingBox& box, float maxDistance, float& distance){
+	const glm::vec3 t0 = (box.minis - ray.origin) * ray.invDirection;
+	const glm::vec3 t1 = (box.maxis - ray.origin) * ray.invDirection;
+	const glm::vec3 tMin = glm::min(t0, t1);
+	const glm::vec3 tMax = glm::max(t0, t1);
+	const float tEnter = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.0f));
+	const float tExit = std::min(std::min(tMax.x, tMax.y), std::min(tMax.z, maxDistance));
+	distance = tEnter;
+	return tEnter <= tExit;
+}
+
+bool BVH::intersect(const Ray& ray, Hit& hit, const ItemIntersector& intersector) const {
+	if(_nodes.empty()){
+		return false;
+	}
+	float distance = 0.0f;
+	if(!intersects(ray, _nodes[0].bbox, hit.distance, distance)){
+		return false;
+	}
+
+	bool found = false;
+	// Store node indices along with their entry distance.
+	std::vector<std::pair<uint, float>> stack;
+	stack.reserve(64);
+	stack.emplace_back(0u, distance);
+
+	while(!stack.empty()){
+		const auto current = stack.back();
+		stack.pop_back();
+		// Skip nodes farther than the closest hit found since they were pushed.
+		if(current.second > hit.distance){
+			continue;
+		}
+		const Node& node = _nodes[current.first];
+
+		if(node.count != 0){
+			for(uint i = node.first; i < node.first + node.count; ++i){
+				const uint item = _items[i];
+				float itemDistance = 0.0f;
+				if(!intersects(ray, _boxes[item], hit.distance, itemDistance)){
+					continue;
+				}
+				if(intersector){
+					float refinedDistance = hit.distance;
+					if(!intersector(item, refinedDistance) || refinedDistance >= hit.distance){
+						continue;
+					}
+					itemDistance = refinedDistance;
+				}
+				hit.distance = itemDistance;
+				hit.item = item;
+				found = true;
+			}
+			continue;
+		}
+
+		// Visit the closest child first.
+		float distances[2];
+		const bool hits[2] = {
+			intersects(ray, _nodes[node.first].bbox, hit.distance, distances[0]),
+			intersects(ray, _nodes[node.first + 1].bbox, hit.distance, distances[1])
+		};
+		const uint nearChild = distances[1] < distances[0] ? 1u : 0u;
+		const uint farChild = 1u - nearChild;
+		if(hits[farChild]){
+			stack.emplace_back(node.first + farChild, distances[farChild]);
+		}
+		if(hits[nearChild]){
+			stack.emplace_back(node.first + nearChild, distances[nearChild]);
+		}
+	}
+	return found;
+}
+
+template<typename Predicate>
+void BVH::queryRegion(const Predicate& test, std::vector<uint>& items) const {
+	if(_nodes.empty()){
+		return;
+	}
+	std::vector<uint> stack;
+	stack.reserve(64);
+	stack.push_back(0u);
+
+	while(!stack.empty()){
+		const Node& node = _nodes[stack.back()];
+		stack.pop_back();
+		if(!test(node.bbox)){
+			continue;
+		}
+		if(node.count == 0){
+			stack.push_back(node.first + 1);
+			stack.push_back(node.first);
+			continue;
+		}
+		for(uint i = node.first; i < node.first + node.count; ++i){
+			const uint item = _items[i];
+			if(test(_boxes[item])){
+				items.push_back(item);
+			}
+		}
+	}
+}
+
+void BVH::query(const Frustum& frustum, std::vector<uint>& items) const {
+	queryRegion([&frustum](const BoundingBox& box){
+		return frustum.intersects(box);
+	}, items);
+}
+
+void BVH::query(const BoundingBox& region, std::vector<uint>& items) const {
+	queryRegion([&region](const BoundingBox& box){
+		return glm::all(glm::lessThanEqual(box.minis, region.maxis)) && glm::all(glm::greaterThanEqual(box.maxis, region.minis));
+	}, items);
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include "core/Common.hpp"
+#include "core/Bounds.hpp"
+
+#include <functional>
+
+/**
+ \brief Bounding volume hierarchy over a list of bounding boxes, built using a binned surface area heuristic.
+ Items are referenced by their index in the list provided at build time.
+ \ingroup Resources
+ */
+class BVH {
+public:
+
+	/** \brief Ray with a precomputed inverse direction. */
+	struct Ray {
+
+		/** Constructor
+		 \param aOrigin the ray origin
+		 \param aDirection the ray direction (not necessarily normalized)
+		 */
+		Ray(const glm::vec3& aOrigin, const glm::vec3& aDirection);
+
+		glm::vec3 origin; ///< Ray origin.
+		glm::vec3 direction; ///< Ray direction.
+		glm::vec3 invDirection; ///< Component-wise inverse of the direction.
+	};
+
+	/** \brief Closest intersection along a ray. */
+	struct Hit {
+		uint item = 0; ///< Index of the intersected item.
+		float distance = std::numeric_limits<float>::max(); ///< Distance along the ray, in units of the ray direction.
+	};
+
+	/** Item refinement callback, used to test the exact item geometry against a ray.
+	 The callback receives the item index and the current closest distance, and should update the distance and return true if a closer intersection was found.
+	 */
+	using ItemIntersector = std::function<bool(uint item, float& distance)>;
+
+	/** Build the hierarchy over a set of boxes.
+	 \param boxes the items bounding boxes
+	 */
+	void build(const std::vector<BoundingBox>& boxes);
+
+	/** Remove all items and nodes. */
+	void clean();
+
+	/** Find the closest item intersected by a ray.
+	 \param ray the ray to cast
+	 \param hit will contain the closest intersection information
+	 \param intersector optional callback to refine the test for each item whose bounding box is intersected
+	 \return true if an item was intersected
+	 */
+	bool intersect(const Ray& ray, Hit& hit, const ItemIntersector& intersector = nullptr) const;
+
+	/** Find all items whose bounding box intersects a frustum.
+	 \param frustum the frustum to test
+	 \param items will be populated with the intersecting item indices
+	 */
+	void query(const Frustum& frustum, std::vector<uint>& items) const;
+
+	/** Find all items whose bounding box intersects a box.
+	 \param box the box to test
+	 \param items will be populated with the intersecting item indices
+	 */
+	void query(const BoundingBox& box, std::vector<uint>& items) const;
+
+	/** \return true if the hierarchy contains no item */
+	bool empty() const { return _nodes.empty(); }
+
+	/** \return the number of nodes in the hierarchy */
+	size_t nodeCount() const { return _nodes.size(); }
+
+private:
+
+	/** \brief Hierarchy node, either an interior node with two consecutive children or a leaf referencing a range of items. */
+	struct Node {
+		BoundingBox bbox; ///< Bounds of all items below the node.
+		uint first = 0; ///< First item index for a leaf, first child index otherwise.
+		uint count = 0; ///< Number of items for a leaf, 0 otherwise.
+	};
+
+	/** Intersect a ray with a box.
+	 \param ray the ray
+	 \param box the box
+	 \param maxDistance the maximum distance along the ray
+	 \param distance will contain the entry distance along the ray
+	 \return true if the ray intersects the box before maxDistance
+	 */
+	static bool intersects(const Ray& ray, const BoundingBox& box, float maxDistance, float& distance);
+
+	/** Find all items intersecting a region described by a box test predicate.
+	 \param test the predicate to evaluate on node and item boxes
+	 \param items will be populated with the intersecting item indices
+	 */
+	template<typename Predicate>
+	void queryRegion(const Predicate& test, std::vector<uint>& items) const;
+
+	std::vector<Node> _nodes; ///< Hierarchy nodes, the root is the first one.
+	std::vector<uint> _items; ///< Item indices, ordered so that each leaf references a contiguous range.
+	std::vector<BoundingBox> _boxes; ///< Item bounding boxes.
+};
@@ -46,6 +46,17 @@ std::vector<glm::vec3> BoundingBox::getCorners() const {
 		glm::vec3(maxis[0], maxis[1], maxis[2])};
 }
 
+void BoundingBox::getCorners(std::array<glm::vec3, 8>& corners) const {
+	corners[0] = glm::vec3(minis[0], minis[1], minis[2]);
+	corners[1] = glm::vec3(minis[0], minis[1], maxis[2]);
+	corners[2] = glm::vec3(minis[0], maxis[1], minis[2]);
+	corners[3] = glm::vec3(minis[0], maxis[1], maxis[2]);
+	corners[4] = glm::vec3(maxis[0], minis[1], minis[2]);
+	corners[5] = glm::vec3(maxis[0], minis[1], maxis[2]);
+	corners[6] = glm::vec3(maxis[0], maxis[1], minis[2]);
+	corners[7] = glm::vec3(maxis[0], maxis[1], maxis[2]);
+}
+
 std::vector<glm::vec4> BoundingBox::getHomogeneousCorners() const {
 	return {
 		glm::vec4(minis[0], minis[1], minis[2], 1.0f),
@@ -58,21 +69,36 @@ std::vector<glm::vec4> BoundingBox::getHomogeneousCorners() const {
 		glm::vec4(maxis[0], maxis[1], maxis[2], 1.0f)};
 }
 
+void BoundingBox::getHomogeneousCorners(std::array<glm::vec4, 8>& corners) const {
+	corners[0] = glm::vec4(minis[0], minis[1], minis[2], 1.0f);
+	corners[1] = glm::vec4(minis[0], minis[1], maxis[2], 1.0f);
+	corners[2] = glm::vec4(minis[0], maxis[1], minis[2], 1.0f);
+	corners[3] = glm::vec4(minis[0], maxis[1], maxis[2], 1.0f);
+	corners[4] = glm::vec4(maxis[0], minis[1], minis[2], 1.0f);
+	corners[5] = glm::vec4(maxis[0], minis[1], maxis[2], 1.0f);
+	corners[6] = glm::vec4(maxis[0], maxis[1], minis[2], 1.0f);
+	corners[7] = glm::vec4(maxis[0], maxis[1], maxis[2], 1.0f);
+}
+
 glm::vec3 BoundingBox::getCentroid() const {
 	return 0.5f * (minis + maxis);
 }
 
 BoundingBox BoundingBox::transformed(const glm::mat4 & trans) const {
-	BoundingBox newBox;
-	const std::vector<glm::vec4> corners = getHomogeneousCorners();
-
-	newBox.minis						 = glm::vec3(trans * corners[0]);
-	newBox.maxis						 = newBox.minis;
-	for(size_t i = 1; i < 8; ++i) {
-		const glm::vec3 transformedCorner = glm::vec3(trans * corners[i]);
-		newBox.minis					  = glm::min(newBox.minis, transformedCorner);
-		newBox.maxis					  = glm::max(newBox.maxis, transformedCorner);
+	// Transform the center and accumulate the absolute contribution of each half-extent axis,
+	// equivalent to bounding the eight transformed corners (J. Arvo, Transforming Axis-Aligned Bounding Boxes).
+	if(empty()){
+		return BoundingBox();
 	}
+	const glm::vec3 center = getCentroid();
+	const glm::vec3 extent = 0.5f * getSize();
+	const glm::vec3 newCenter = glm::vec3(trans * glm::vec4(center, 1.0f));
+	const glm::vec3 newExtent = glm::abs(glm::vec3(trans[0])) * extent.x
+							  + glm::abs(glm::vec3(trans[1])) * extent.y
+							  + glm::abs(glm::vec3(trans[2])) * extent.z;
+	BoundingBox newBox;
+	newBox.minis = newCenter - newExtent;
+	newBox.maxis = newCenter + newExtent;
 	return newBox;
 }
 
@@ -121,17 +147,15 @@ Frustum::Frustum(const glm::mat4 & vp){
 }
 
 bool Frustum::intersects(const BoundingBox & box) const {
-	const std::vector<glm::vec4> corners = box.getHomogeneousCorners();
-	// For each of the frustum planes, check if all points are in the "outside" half-space.
+	// For each of the frustum planes, check if all corners are in the "outside" half-space.
+	// This is the case iff the corner furthest along the plane normal is outside.
 	for(uint pid = 0; pid < FrustumPlane::COUNT; ++pid){
-		if((glm::dot(_planes[pid], corners[0]) < 0.0) &&
-		   (glm::dot(_planes[pid], corners[1]) < 0.0) &&
-		   (glm::dot(_planes[pid], corners[2]) < 0.0) &&
-		   (glm::dot(_planes[pid], corners[3]) < 0.0) &&
-		   (glm::dot(_planes[pid], corners[4]) < 0.0) &&
-		   (glm::dot(_planes[pid], corners[5]) < 0.0) &&
-		   (glm::dot(_planes[pid], corners[6]) < 0.0) &&
-		   (glm::dot(_planes[pid], corners[7]) < 0.0)){
+		const glm::vec4& plane = _planes[pid];
+		const glm::vec4 corner(plane.x >= 0.0f ? box.maxis.x : box.minis.x,
+							   plane.y >= 0.0f ? box.maxis.y : box.minis.y,
+							   plane.z >= 0.0f ? box.maxis.z : box.minis.z,
+							   1.0f);
+		if(glm::dot(plane, corner) < 0.0f){
 			return false;
 		}
 	}
@@ -69,12 +69,22 @@ public:
 	 */
 	std::vector<glm::vec3> getCorners() const;
 
+	/** Query the positions of the eight corners of the box without allocating, in the same order as getCorners().
+	 \param corners will contain the box corners
+	 */
+	void getCorners(std::array<glm::vec3, 8>& corners) const;
+
 	/** Query the homogeneous positions of the eight corners of the box, in the following order (with \p m=mini, \p M=maxi):
 	 \p (m,m,m,1), \p (m,m,M,1), \p (m,M,m,1), \p (m,M,M,1), \p (M,m,m,1), \p (M,m,M,1), \p (M,M,m,1), \p (M,M,M,1)
 	 \return a vector containing the box corners
 	 */
 	std::vector<glm::vec4> getHomogeneousCorners() const;
 
+	/** Query the homogeneous positions of the eight corners of the box without allocating, in the same order as getHomogeneousCorners().
+	 \param corners will contain the box corners
+	 */
+	void getHomogeneousCorners(std::array<glm::vec4, 8>& corners) const;
+
 	/** Query the center of the bounding box.
 	 \return the centroid
 	 */
@@ -120,6 +130,9 @@ public:
 	*/
 	bool intersects(const BoundingBox & box) const;
 
+	/** \return the six frustum planes coefficients, with normals pointing inside the frustum */
+	const std::array<glm::vec4, 6>& planes() const { return _planes; }
+
 	/** Generate a perspective projection matrix, correctly oriented for the rendering API.
 	 \param fov vertical field of view in radians
 	 \param ratio aspect ratio
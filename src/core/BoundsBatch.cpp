@@ -0,0 +1,389 @@
+#include "core/BoundsBatch.hpp"
+
+#include <array>
+#include <bitset>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#	define BOUNDS_SIMD_X86
+#	include <immintrin.h>
+#	if defined(_MSC_VER)
+#		include <intrin.h>
+#		define BOUNDS_TARGET_AVX2
+#	else
+#		define BOUNDS_TARGET_AVX2 __attribute__((target("avx2")))
+#	endif
+#endif
+
+static BoundingBoxBatch::Kernel detectBestKernel(){
+#ifdef BOUNDS_SIMD_X86
+#	if defined(_MSC_VER)
+	int infos[4];
+	__cpuid(infos, 1);
+	const bool osSavesYmm = (infos[2] & (1 << 27)) && (infos[2] & (1 << 28)) && ((_xgetbv(0) & 0x6) == 0x6);
+	__cpuidex(infos, 7, 0);
+	const bool hasAvx2 = osSavesYmm && (infos[1] & (1 << 5));
+#	else
+	__builtin_cpu_init();
+	const bool hasAvx2 = __builtin_cpu_supports("avx2");
+#	endif
+	return hasAvx2 ? BoundingBoxBatch::Kernel::AVX2 : BoundingBoxBatch::Kernel::SSE;
+#else
+	return BoundingBoxBatch::Kernel::SCALAR;
+#endif
+}
+
+static const BoundingBoxBatch::Kernel kBestKernel = detectBestKernel();
+// Below this number of boxes, the SIMD kernels setup cost outweighs their gain (SSE measured slower on ~400 boxes).
+static const size_t kSimdMinBoxCount = 1024u;
+
+void BoundingBoxBatch::setKernel(Kernel kernel){
+	_kernel = (kernel == Kernel::AUTO || (uint)kernel <= (uint)kBestKernel) ? kernel : kBestKernel;
+}
+
+BoundingBoxBatch::Kernel BoundingBoxBatch::bestKernel(){
+	return kBestKernel;
+}
+
+/** Select the kernel to run on a given number of boxes.
+ \param kernel the kernel requested by the batch
+ \param count the number of boxes to process
+ \return the kernel to run
+ */
+static BoundingBoxBatch::Kernel resolveKernel(BoundingBoxBatch::Kernel kernel, size_t count){
+	if(kernel != BoundingBoxBatch::Kernel::AUTO){
+		return kernel;
+	}
+	return count >= kSimdMinBoxCount ? kBestKernel : BoundingBoxBatch::Kernel::SCALAR;
+}
+
+BoundingBoxBatch::BoundingBoxBatch(const std::vector<BoundingBox>& boxes){
+	resize(boxes.size());
+	for(size_t i = 0; i < boxes.size(); ++i){
+		_minX[i] = boxes[i].minis.x;
+		_minY[i] = boxes[i].minis.y;
+		_minZ[i] = boxes[i].minis.z;
+		_maxX[i] = boxes[i].maxis.x;
+		_maxY[i] = boxes[i].maxis.y;
+		_maxZ[i] = boxes[i].maxis.z;
+	}
+}
+
+void BoundingBoxBatch::push_back(const BoundingBox& box){
+	_minX.push_back(box.minis.x);
+	_minY.push_back(box.minis.y);
+	_minZ.push_back(box.minis.z);
+	_maxX.push_back(box.maxis.x);
+	_maxY.push_back(box.maxis.y);
+	_maxZ.push_back(box.maxis.z);
+}
+
+void BoundingBoxBatch::resize(size_t count){
+	const BoundingBox empty;
+	_minX.resize(count, empty.minis.x);
+	_minY.resize(count, empty.minis.y);
+	_minZ.resize(count, empty.minis.z);
+	_maxX.resize(count, empty.maxis.x);
+	_maxY.resize(count, empty.maxis.y);
+	_maxZ.resize(count, empty.maxis.z);
+}
+
+void BoundingBoxBatch::clear(){
+	_minX.clear();
+	_minY.clear();
+	_minZ.clear();
+	_maxX.clear();
+	_maxY.clear();
+	_maxZ.clear();
+}
+
+BoundingBox BoundingBoxBatch::at(size_t i) const {
+	BoundingBox box;
+	box.minis = glm::vec3(_minX[i], _minY[i], _minZ[i]);
+	box.maxis = glm::vec3(_maxX[i], _maxY[i], _maxZ[i]);
+	return box;
+}
+
+// Transformation kernels.
+
+/** \brief Pointers to the input and output arrays of a transformation kernel. */
+struct TransformArrays {
+	const float* minis[3];
+	const float* maxis[3];
+	float* outMinis[3];
+	float* outMaxis[3];
+	const uint* indices;
+	const glm::mat4* frames;
+	size_t count;
+};
+
+static void transformScalar(const TransformArrays& arrays){
+	for(size_t i = 0; i < arrays.count; ++i){
+		const size_t src = arrays.indices ? arrays.indices[i] : i;
+		BoundingBox box;
+		box.minis = glm::vec3(arrays.minis[0][src], arrays.minis[1][src], arrays.minis[2][src]);
+		box.maxis = glm::vec3(arrays.maxis[0][src], arrays.maxis[1][src], arrays.maxis[2][src]);
+		const BoundingBox result = box.transformed(arrays.frames[i]);
+		for(uint c = 0; c < 3; ++c){
+			arrays.outMinis[c][i] = result.minis[c];
+			arrays.outMaxis[c][i] = result.maxis[c];
+		}
+	}
+}
+
+#ifdef BOUNDS_SIMD_X86
+
+static void transformSSE(const TransformArrays& arrays){
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	alignas(16) float outMin[4];
+	alignas(16) float outMax[4];
+
+	for(size_t i = 0; i < arrays.count; ++i){
+		const size_t src = arrays.indices ? arrays.indices[i] : i;
+		if(arrays.minis[0][src] == std::numeric_limits<float>::max()){
+			// Empty box stays empty.
+			for(uint c = 0; c < 3; ++c){
+				arrays.outMinis[c][i] = std::numeric_limits<float>::max();
+				arrays.outMaxis[c][i] = std::numeric_limits<float>::lowest();
+			}
+			continue;
+		}
+		// One box per iteration, SIMD over the matrix rows.
+		const float* frame = &arrays.frames[i][0][0];
+		const __m128 col0 = _mm_loadu_ps(frame);
+		const __m128 col1 = _mm_loadu_ps(frame + 4);
+		const __m128 col2 = _mm_loadu_ps(frame + 8);
+		const __m128 col3 = _mm_loadu_ps(frame + 12);
+
+		__m128 center[3];
+		__m128 extent[3];
+		for(uint c = 0; c < 3; ++c){
+			const __m128 mini = _mm_set1_ps(arrays.minis[c][src]);
+			const __m128 maxi = _mm_set1_ps(arrays.maxis[c][src]);
+			center[c] = _mm_mul_ps(half, _mm_add_ps(mini, maxi));
+			extent[c] = _mm_mul_ps(half, _mm_sub_ps(maxi, mini));
+		}
+		__m128 newCenter = _mm_add_ps(_mm_mul_ps(col0, center[0]), col3);
+		newCenter = _mm_add_ps(_mm_mul_ps(col1, center[1]), newCenter);
+		newCenter = _mm_add_ps(_mm_mul_ps(col2, center[2]), newCenter);
+		__m128 newExtent = _mm_mul_ps(_mm_andnot_ps(signMask, col0), extent[0]);
+		newExtent = _mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, col1), extent[1]), newExtent);
+		newExtent = _mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, col2), extent[2]), newExtent);
+
+		_mm_store_ps(outMin, _mm_sub_ps(newCenter, newExtent));
+		_mm_store_ps(outMax, _mm_add_ps(newCenter, newExtent));
+		for(uint c = 0; c < 3; ++c){
+			arrays.outMinis[c][i] = outMin[c];
+			arrays.outMaxis[c][i] = outMax[c];
+		}
+	}
+}
+
+BOUNDS_TARGET_AVX2 static void transformAVX2(const TransformArrays& arrays){
+	const __m256 half = _mm256_set1_ps(0.5f);
+	const __m256 signMask = _mm256_set1_ps(-0.0f);
+	alignas(32) float outMin[8];
+	alignas(32) float outMax[8];
+
+	// Two boxes per iteration, one per 128-bit lane.
+	const size_t pairCount = arrays.count / 2;
+	for(size_t p = 0; p < pairCount; ++p){
+		const size_t ids[2] = { 2 * p, 2 * p + 1 };
+		const size_t srcs[2] = {
+			arrays.indices ? arrays.indices[ids[0]] : ids[0],
+			arrays.indices ? arrays.indices[ids[1]] : ids[1]
+		};
+		const float* frame0 = &arrays.frames[ids[0]][0][0];
+		const float* frame1 = &arrays.frames[ids[1]][0][0];
+		__m256 cols[4];
+		for(uint c = 0; c < 4; ++c){
+			cols[c] = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(frame0 + 4 * c)), _mm_loadu_ps(frame1 + 4 * c), 1);
+		}
+		__m256 newCenter = cols[3];
+		__m256 newExtent = _mm256_setzero_ps();
+		for(uint c = 0; c < 3; ++c){
+			const __m256 mini = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(arrays.minis[c][srcs[0]])), _mm_set1_ps(arrays.minis[c][srcs[1]]), 1);
+			const __m256 maxi = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(arrays.maxis[c][srcs[0]])), _mm_set1_ps(arrays.maxis[c][srcs[1]]), 1);
+			const __m256 center = _mm256_mul_ps(half, _mm256_add_ps(mini, maxi));
+			const __m256 extent = _mm256_mul_ps(half, _mm256_sub_ps(maxi, mini));
+			newCenter = _mm256_add_ps(_mm256_mul_ps(cols[c], center), newCenter);
+			newExtent = _mm256_add_ps(_mm256_mul_ps(_mm256_andnot_ps(signMask, cols[c]), extent), newExtent);
+		}
+		_mm256_store_ps(outMin, _mm256_sub_ps(newCenter, newExtent));
+		_mm256_store_ps(outMax, _mm256_add_ps(newCenter, newExtent));
+		for(uint b = 0; b < 2; ++b){
+			const bool empty = arrays.minis[0][srcs[b]] == std::numeric_limits<float>::max();
+			for(uint c = 0; c < 3; ++c){
+				arrays.outMinis[c][ids[b]] = empty ? std::numeric_limits<float>::max() : outMin[4 * b + c];
+				arrays.outMaxis[c][ids[b]] = empty ? std::numeric_limits<float>::lowest() : outMax[4 * b + c];
+			}
+		}
+	}
+	// Remaining box.
+	if(arrays.count % 2 != 0){
+		TransformArrays tail = arrays;
+		const size_t last = arrays.count - 1;
+		tail.count = 1;
+		tail.frames = arrays.frames + last;
+		tail.indices = arrays.indices ? arrays.indices + last : nullptr;
+		for(uint c = 0; c < 3; ++c){
+			tail.outMinis[c] = arrays.outMinis[c] + last;
+			tail.outMaxis[c] = arrays.outMaxis[c] + last;
+			if(!arrays.indices){
+				tail.minis[c] = arrays.minis[c] + last;
+				tail.maxis[c] = arrays.maxis[c] + last;
+			}
+		}
+		transformSSE(tail);
+	}
+}
+
+#endif
+
+static void runTransform(const TransformArrays& arrays, BoundingBoxBatch::Kernel kernel){
+	switch(kernel){
+#ifdef BOUNDS_SIMD_X86
+		case BoundingBoxBatch::Kernel::AVX2:
+			transformAVX2(arrays);
+			break;
+		case BoundingBoxBatch::Kernel::SSE:
+			transformSSE(arrays);
+			break;
+#endif
+		default:
+			transformScalar(arrays);
+			break;
+	}
+}
+
+void BoundingBoxBatch::transform(const std::vector<glm::mat4>& frames, BoundingBoxBatch& result) const {
+	Log::check(frames.size() == size(), "Expected one frame per box.");
+	result.resize(size());
+	const TransformArrays arrays = {
+		{ _minX.data(), _minY.data(), _minZ.data() },
+		{ _maxX.data(), _maxY.data(), _maxZ.data() },
+		{ result._minX.data(), result._minY.data(), result._minZ.data() },
+		{ result._maxX.data(), result._maxY.data(), result._maxZ.data() },
+		nullptr, frames.data(), size()
+	};
+	runTransform(arrays, resolveKernel(_kernel, size()));
+}
+
+void BoundingBoxBatch::transform(const std::vector<uint>& boxIndices, const std::vector<glm::mat4>& frames, BoundingBoxBatch& result) const {
+	Log::check(frames.size() == boxIndices.size(), "Expected one frame per box index.");
+	result.resize(boxIndices.size());
+	const TransformArrays arrays = {
+		{ _minX.data(), _minY.data(), _minZ.data() },
+		{ _maxX.data(), _maxY.data(), _maxZ.data() },
+		{ result._minX.data(), result._minY.data(), result._minZ.data() },
+		{ result._maxX.data(), result._maxY.data(), result._maxZ.data() },
+		boxIndices.data(), frames.data(), boxIndices.size()
+	};
+	runTransform(arrays, resolveKernel(_kernel, boxIndices.size()));
+}
+
+// Culling kernels.
+
+/** \brief For each frustum plane, the coefficients and the box coordinate arrays furthest along its normal. */
+struct CullingPlanes {
+	std::array<glm::vec4, 6> planes;
+	std::array<const float*, 6> x;
+	std::array<const float*, 6> y;
+	std::array<const float*, 6> z;
+};
+
+static bool cullScalarBox(const CullingPlanes& planes, size_t i){
+	for(uint pid = 0; pid < 6; ++pid){
+		const glm::vec4& plane = planes.planes[pid];
+		const float dist = plane.x * planes.x[pid][i] + plane.y * planes.y[pid][i] + plane.z * planes.z[pid][i] + plane.w;
+		if(dist < 0.0f){
+			return false;
+		}
+	}
+	return true;
+}
+
+static void cullScalar(const CullingPlanes& planes, size_t first, size_t count, uint64_t* visibility){
+	for(size_t i = first; i < count; ++i){
+		if(cullScalarBox(planes, i)){
+			visibility[i >> 6u] |= uint64_t(1u) << (i & 63u);
+		}
+	}
+}
+
+#ifdef BOUNDS_SIMD_X86
+
+static void cullSSE(const CullingPlanes& planes, size_t count, uint64_t* visibility){
+	const size_t blockCount = count / 4;
+	for(size_t b = 0; b < blockCount; ++b){
+		const size_t i = 4 * b;
+		__m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for(uint pid = 0; pid < 6; ++pid){
+			const glm::vec4& plane = planes.planes[pid];
+			__m128 dist = _mm_set1_ps(plane.w);
+			dist = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), _mm_loadu_ps(planes.x[pid] + i)), dist);
+			dist = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.y), _mm_loadu_ps(planes.y[pid] + i)), dist);
+			dist = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), _mm_loadu_ps(planes.z[pid] + i)), dist);
+			visible = _mm_and_ps(visible, _mm_cmpge_ps(dist, _mm_setzero_ps()));
+		}
+		const uint64_t bits = (uint64_t)_mm_movemask_ps(visible);
+		visibility[i >> 6u] |= bits << (i & 63u);
+	}
+	cullScalar(planes, 4 * blockCount, count, visibility);
+}
+
+BOUNDS_TARGET_AVX2 static void cullAVX2(const CullingPlanes& planes, size_t count, uint64_t* visibility){
+	const size_t blockCount = count / 8;
+	for(size_t b = 0; b < blockCount; ++b){
+		const size_t i = 8 * b;
+		__m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for(uint pid = 0; pid < 6; ++pid){
+			const glm::vec4& plane = planes.planes[pid];
+			__m256 dist = _mm256_set1_ps(plane.w);
+			dist = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), _mm256_loadu_ps(planes.x[pid] + i)), dist);
+			dist = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.y), _mm256_loadu_ps(planes.y[pid] + i)), dist);
+			dist = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.z), _mm256_loadu_ps(planes.z[pid] + i)), dist);
+			visible = _mm256_and_ps(visible, _mm256_cmp_ps(dist, _mm256_setzero_ps(), _CMP_GE_OQ));
+		}
+		const uint64_t bits = (uint64_t)_mm256_movemask_ps(visible);
+		visibility[i >> 6u] |= bits << (i & 63u);
+	}
+	cullScalar(planes, 8 * blockCount, count, visibility);
+}
+
+#endif
+
+uint BoundingBoxBatch::cull(const Frustum& frustum, std::vector<uint64_t>& visibility) const {
+	const size_t count = size();
+	visibility.assign((count + 63u) / 64u, 0u);
+
+	// Select the corner furthest along each plane normal once for all boxes.
+	CullingPlanes planes;
+	planes.planes = frustum.planes();
+	for(uint pid = 0; pid < 6; ++pid){
+		const glm::vec4& plane = planes.planes[pid];
+		planes.x[pid] = plane.x >= 0.0f ? _maxX.data() : _minX.data();
+		planes.y[pid] = plane.y >= 0.0f ? _maxY.data() : _minY.data();
+		planes.z[pid] = plane.z >= 0.0f ? _maxZ.data() : _minZ.data();
+	}
+
+	switch(resolveKernel(_kernel, count)){
+#ifdef BOUNDS_SIMD_X86
+		case Kernel::AVX2:
+			cullAVX2(planes, count, visibility.data());
+			break;
+		case Kernel::SSE:
+			cullSSE(planes, count, visibility.data());
+			break;
+#endif
+		default:
+			cullScalar(planes, 0, count, visibility.data());
+			break;
+	}
+
+	uint visibleCount = 0;
+	for(const uint64_t word : visibility){
+		visibleCount += (uint)std::bitset<64>(word).count();
+	}
+	return visibleCount;
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include "core/Common.hpp"
+#include "core/Bounds.hpp"
+
+/**
+ \brief Store a list of axis-aligned bounding boxes in structure-of-arrays layout, for batch transformation and culling.
+ Kernels use SSE or AVX2 when available on the running CPU and the batch is large enough, and fall back to scalar code otherwise.
+ \ingroup Resources
+ */
+class BoundingBoxBatch {
+public:
+
+	/** Instruction set used by the batch kernels. */
+	enum class Kernel : uint {
+		SCALAR, SSE, AVX2,
+		AUTO ///< Best supported kernel, or scalar for small batches.
+	};
+
+	/** Empty batch constructor. */
+	BoundingBoxBatch() = default;
+
+	/** Constructor from a list of boxes.
+	 \param boxes the boxes to store
+	 */
+	explicit BoundingBoxBatch(const std::vector<BoundingBox>& boxes);
+
+	/** Append a box at the end of the batch.
+	 \param box the box to add
+	 */
+	void push_back(const BoundingBox& box);
+
+	/** Resize the batch, new boxes are empty.
+	 \param count the new number of boxes
+	 */
+	void resize(size_t count);
+
+	/** Remove all boxes. */
+	void clear();
+
+	/** Retrieve a box.
+	 \param i the index of the box
+	 \return the box
+	 */
+	BoundingBox at(size_t i) const;
+
+	/** \return the number of boxes */
+	size_t size() const { return _minX.size(); }
+
+	/** Transform each box by its corresponding matrix, storing the bounding boxes of the results.
+	 \param frames one transformation per box
+	 \param result will contain the transformed boxes
+	 */
+	void transform(const std::vector<glm::mat4>& frames, BoundingBoxBatch& result) const;
+
+	/** Transform each box by a matrix, storing the bounding boxes of the results.
+	 \param boxIndices for each output box, the index of the box to transform
+	 \param frames for each output box, the transformation to apply
+	 \param result will contain the transformed boxes
+	 */
+	void transform(const std::vector<uint>& boxIndices, const std::vector<glm::mat4>& frames, BoundingBoxBatch& result) const;
+
+	/** Test all boxes against a frustum, with the same conservative test as Frustum::intersects.
+	 \param frustum the frustum to test against
+	 \param visibility will contain one bit per box, set if the box intersects the frustum
+	 \return the number of visible boxes
+	 */
+	uint cull(const Frustum& frustum, std::vector<uint64_t>& visibility) const;
+
+	/** Force the kernels used by this batch, for testing and benchmarking.
+	 \param kernel the kernel to use, will be clamped to the best supported one
+	 */
+	void setKernel(Kernel kernel);
+
+	/** \return the kernel used by this batch */
+	Kernel kernel() const { return _kernel; }
+
+	/** \return the best kernel supported by the running CPU */
+	static Kernel bestKernel();
+
+	/** Query a box visibility bit.
+	 \param visibility the visibility mask computed by cull
+	 \param i the index of the box
+	 \return true if the box is visible
+	 */
+	static bool isVisible(const std::vector<uint64_t>& visibility, size_t i){
+		return (visibility[i >> 6u] >> (i & 63u)) & 1u;
+	}
+
+private:
+
+	std::vector<float> _minX; ///< Minimum X coordinates.
+	std::vector<float> _minY; ///< Minimum Y coordinates.
+	std::vector<float> _minZ; ///< Minimum Z coordinates.
+	std::vector<float> _maxX; ///< Maximum X coordinates.
+	std::vector<float> _maxY; ///< Maximum Y coordinates.
+	std::vector<float> _maxZ; ///< Maximum Z coordinates.
+
+	Kernel _kernel = Kernel::AUTO; ///< The kernel used by this batch.
+};
@@ -1,6 +1,7 @@
 #include "core/DFFParser.hpp"
 #include "core/Log.hpp"
 #include "core/TextUtilities.hpp"
+#include "core/Profiler.hpp"
 
 #include <glm/gtc/matrix_transform.hpp>
 
@@ -774,6 +775,7 @@ void convertToObj(Model& model, Object& outObject){
 }
 
 bool load(const fs::path& path, Object& outObject){
+	PROFILE_SCOPE("Dff::load");
 
 	Model model;
 	if(!parse(path, model)){
@@ -1,5 +1,6 @@
 #include "core/Image.hpp"
 #include "core/Log.hpp"
+#include "core/Profiler.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_WRITE_IMPLEMENTATION
@@ -70,6 +71,7 @@ void Image::clone( Image& dst ) const {
 }
 
 bool Image::load(const fs::path & path, uint layer) {
+	PROFILE_SCOPE("Image::load");
 	pixels.clear();
 	width = height = 0;
 
@@ -1,78 +1,347 @@
 #include "core/Log.hpp"
 
-#include <cstdio>
-#include <cstdarg>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 
-void Log::verbose(const char* format, ...){
-#ifdef _DEBUG
-	fprintf(stdout, "Verbose: ");
+// Maximum size of a queued message, longer ones are printed synchronously.
+static const size_t kMessageSize = 480u;
+// Delay without new messages before reporting suppressed repetitions.
+static const std::chrono::milliseconds kRepeatSummaryDelay(100);
+// Number of queued messages, must be a power of two.
+static const size_t kQueueSize = 2048u;
+static const size_t kQueueMask = kQueueSize - 1u;
 
-	va_list argptr;
-	va_start(argptr, format);
-	vfprintf(stdout, format, argptr);
-	va_end(argptr);
+static const char* kPrefixes[] = { "Verbose: ", "Info   : ", "Warning: ", "Error  : " };
 
-	fprintf(stdout, "\n");
-	fflush(stdout);
+#ifdef _DEBUG
+static std::atomic<int> sMinLevel{ int(Log::Level::VERBOSE) };
 #else
-	(void)format;
+static std::atomic<int> sMinLevel{ int(Log::Level::INFO) };
 #endif
+static std::atomic<unsigned int> sRepeatLimit{ 3u };
+// Set once the logger thread has been stopped at exit, fall back to direct printing.
+static std::atomic<bool> sLoggerStopped{ false };
+
+/** \brief Print messages on a background thread, producers post them in a lock-free bounded queue. */
+class Logger {
+public:
+
+	Logger(){
+		_slots = std::make_unique<Slot[]>(kQueueSize);
+		for(size_t i = 0; i < kQueueSize; ++i){
+			_slots[i].sequence.store(i, std::memory_order_relaxed);
+		}
+		_thread = std::thread(&Logger::run, this);
+	}
+
+	~Logger(){
+		_running = false;
+		_wakeUp.notify_one();
+		_thread.join();
+		sLoggerStopped = true;
+		if(_file){
+			fclose(_file);
+		}
+	}
+
+	void post(Log::Level level, const char* text, size_t size){
+		// Reserve a slot.
+		size_t pos = _enqueuePos.load(std::memory_order_relaxed);
+		Slot* slot = nullptr;
+		for(;;){
+			slot = &_slots[pos & kQueueMask];
+			const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+			const std::ptrdiff_t diff = std::ptrdiff_t(sequence) - std::ptrdiff_t(pos);
+			if(diff == 0){
+				if(_enqueuePos.compare_exchange_weak(pos, pos + 1u, std::memory_order_relaxed)){
+					break;
+				}
+			} else if(diff < 0){
+				// Queue full, wait for the background thread.
+				_wakeUp.notify_one();
+				std::this_thread::yield();
+				pos = _enqueuePos.load(std::memory_order_relaxed);
+			} else {
+				pos = _enqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+		// Fill and publish it.
+		slot->level = level;
+		slot->size = size;
+		memcpy(slot->text, text, size);
+		slot->sequence.store(pos + 1u, std::memory_order_release);
+		_wakeUp.notify_one();
+	}
+
+	void flush(){
+		const size_t target = _enqueuePos.load(std::memory_order_acquire);
+		while(_processedPos.load(std::memory_order_acquire) < target){
+			_wakeUp.notify_one();
+			std::this_thread::yield();
+		}
+	}
+
+	void writeSync(FILE* stream, const char* prefix, const char* text){
+		flush();
+		std::lock_guard<std::mutex> lock(_sinkMutex);
+		writeRepeatSummary();
+		fflush(stdout);
+		fprintf(stream, "%s%s\n", prefix, text);
+		fflush(stream);
+		if(_file){
+			fprintf(_file, "%s%s\n", prefix, text);
+			fflush(_file);
+		}
+	}
+
+	bool setFile(const char* path){
+		flush();
+		std::lock_guard<std::mutex> lock(_sinkMutex);
+		if(_file){
+			fclose(_file);
+			_file = nullptr;
+		}
+		if(path){
+			_file = fopen(path, "w");
+		}
+		return _file != nullptr;
+	}
+
+private:
+
+	/** \brief Queued message. */
+	struct Slot {
+		std::atomic<size_t> sequence;
+		Log::Level level;
+		size_t size;
+		char text[kMessageSize];
+	};
+
+	void run(){
+		while(_running){
+			if(drain()){
+				_lastDrainTime = std::chrono::steady_clock::now();
+				continue;
+			}
+			// Report repetitions once messages have stopped for a while.
+			if(std::chrono::steady_clock::now() - _lastDrainTime > kRepeatSummaryDelay){
+				std::lock_guard<std::mutex> lock(_sinkMutex);
+				if(_suppressed != 0){
+					writeRepeatSummary();
+					fflush(stdout);
+				}
+			}
+			std::unique_lock<std::mutex> lock(_wakeMutex);
+			_wakeUp.wait_for(lock, std::chrono::milliseconds(10));
+		}
+		drain();
+		std::lock_guard<std::mutex> lock(_sinkMutex);
+		writeRepeatSummary();
+		fflush(stdout);
+	}
+
+	bool drain(){
+		size_t pos = _processedPos.load(std::memory_order_relaxed);
+		const size_t start = pos;
+		std::lock_guard<std::mutex> lock(_sinkMutex);
+		for(;;){
+			Slot& slot = _slots[pos & kQueueMask];
+			if(slot.sequence.load(std::memory_order_acquire) != pos + 1u){
+				break;
+			}
+			write(slot.level, slot.text, slot.size);
+			// Release the slot for the next round.
+			slot.sequence.store(pos + kQueueSize, std::memory_order_release);
+			++pos;
+		}
+		if(pos == start){
+			return false;
+		}
+		fflush(stdout);
+		if(_file){
+			fflush(_file);
+		}
+		_processedPos.store(pos, std::memory_order_release);
+		return true;
+	}
+
+	void write(Log::Level level, const char* text, size_t size){
+		// Skip identical consecutive messages past the limit.
+		const unsigned int limit = sRepeatLimit.load(std::memory_order_relaxed);
+		if(limit != 0 && level == _lastLevel && size == _lastText.size() && memcmp(text, _lastText.data(), size) == 0){
+			++_repeats;
+			if(_repeats > limit){
+				++_suppressed;
+				return;
+			}
+		} else {
+			writeRepeatSummary();
+			_lastText.assign(text, size);
+			_lastLevel = level;
+			_repeats = 0;
+		}
+		const char* prefix = kPrefixes[int(level)];
+		fprintf(stdout, "%s%.*s\n", prefix, int(size), text);
+		if(_file){
+			fprintf(_file, "%s%.*s\n", prefix, int(size), text);
+		}
+	}
+
+	void writeRepeatSummary(){
+		if(_suppressed == 0){
+			return;
+		}
+		const char* prefix = kPrefixes[int(_lastLevel)];
+		fprintf(stdout, "%s(previous message repeated %u more times)\n", prefix, _suppressed);
+		if(_file){
+			fprintf(_file, "%s(previous message repeated %u more times)\n", prefix, _suppressed);
+		}
+		_suppressed = 0;
+	}
+
+	std::unique_ptr<Slot[]> _slots;
+	std::atomic<size_t> _enqueuePos{0};
+	std::atomic<size_t> _processedPos{0};
+
+	std::thread _thread;
+	std::mutex _wakeMutex;
+	std::condition_variable _wakeUp;
+	std::atomic<bool> _running{true};
+
+	std::mutex _sinkMutex;
+	FILE* _file = nullptr;
+
+	// Protected by the sink mutex.
+	std::chrono::steady_clock::time_point _lastDrainTime;
+	std::string _lastText;
+	Log::Level _lastLevel = Log::Level::VERBOSE;
+	unsigned int _repeats = 0;
+	unsigned int _suppressed = 0;
+};
+
+static Logger& logger(){
+	static Logger logger;
+	return logger;
 }
 
-void Log::info(const char* format, ...){
+static void postMessage(Log::Level level, const char* format, va_list args){
+	if(int(level) < sMinLevel.load(std::memory_order_relaxed)){
+		return;
+	}
+	char buffer[kMessageSize];
+	va_list argsCopy;
+	va_copy(argsCopy, args);
+	const int size = vsnprintf(buffer, kMessageSize, format, argsCopy);
+	va_end(argsCopy);
+	if(size < 0){
+		return;
+	}
+	if(size_t(size) < kMessageSize && !sLoggerStopped){
+		logger().post(level, buffer, size_t(size));
+		return;
+	}
+	// Long messages are printed synchronously.
+	std::string text(size_t(size) + 1u, '\0');
+	vsnprintf(&text[0], text.size(), format, args);
+	text.resize(size_t(size));
+	if(sLoggerStopped){
+		fprintf(stdout, "%s%s\n", kPrefixes[int(level)], text.c_str());
+		fflush(stdout);
+		return;
+	}
+	logger().writeSync(stdout, kPrefixes[int(level)], text.c_str());
+}
 
-	fprintf(stdout, "Info   : ");
+static void printSynchronous(FILE* stream, const char* prefix, const char* format, va_list args){
+	va_list argsCopy;
+	va_copy(argsCopy, args);
+	const int size = vsnprintf(nullptr, 0, format, argsCopy);
+	va_end(argsCopy);
+	if(size < 0){
+		return;
+	}
+	std::string text(size_t(size) + 1u, '\0');
+	vsnprintf(&text[0], text.size(), format, args);
+	text.resize(size_t(size));
+	if(sLoggerStopped){
+		fprintf(stream, "%s%s\n", prefix, text.c_str());
+		fflush(stream);
+		return;
+	}
+	logger().writeSync(stream, prefix, text.c_str());
+}
 
+void Log::verbose(const char* format, ...){
 	va_list argptr;
 	va_start(argptr, format);
-	vfprintf(stdout, format, argptr);
+	postMessage(Level::VERBOSE, format, argptr);
 	va_end(argptr);
+}
 
-	fprintf(stdout, "\n");
-	fflush(stdout);
+void Log::info(const char* format, ...){
+	va_list argptr;
+	va_start(argptr, format);
+	postMessage(Level::INFO, format, argptr);
+	va_end(argptr);
 }
 
 void Log::warning(const char* format, ...){
-
-	fprintf(stdout, "Warning: ");
-
 	va_list argptr;
 	va_start(argptr, format);
-	vfprintf(stdout, format, argptr);
+	postMessage(Level::WARNING, format, argptr);
 	va_end(argptr);
-
-	fprintf(stdout, "\n");
-	fflush(stdout);
 }
 
 void Log::error(const char* format, ...){
-
-	fprintf(stderr, "Error  : ");
-
 	va_list argptr;
 	va_start(argptr, format);
-	vfprintf(stderr, format, argptr);
+	printSynchronous(stderr, kPrefixes[int(Level::ERROR)], format, argptr);
 	va_end(argptr);
-
-	fprintf(stderr, "\n");
-	fflush(stderr);
 }
 
 bool Log::check(bool value, const char* format, ...){
 	if(!value){
-
-		fprintf(stderr, "Check  : Failed: ");
-
 		va_list argptr;
 		va_start(argptr, format);
-		vfprintf(stderr, format, argptr);
+		printSynchronous(stderr, "Check  : Failed: ", format, argptr);
 		va_end(argptr);
-
-		fprintf(stderr, "\n");
-		fflush(stderr);
-
 	}
 	assert(value);
 	return !value;
 }
+
+void Log::setLevel(Level level){
+	sMinLevel = int(level);
+}
+
+Log::Level Log::getLevel(){
+	return Level(sMinLevel.load());
+}
+
+void Log::setRepeatLimit(unsigned int limit){
+	sRepeatLimit = limit;
+}
+
+bool Log::setFile(const char* path){
+	if(sLoggerStopped){
+		return false;
+	}
+	return logger().setFile(path);
+}
+
+void Log::flush(){
+	if(sLoggerStopped){
+		return;
+	}
+	logger().flush();
+	fflush(stdout);
+}
@@ -1,16 +1,47 @@
 #pragma once
 
+#ifdef _WIN32
+#	undef ERROR
+#endif
+
 namespace Log {
 
+/** Message severity, used for filtering. */
+enum class Level : int {
+	VERBOSE = 0, INFO, WARNING, ERROR
+};
+
 void verbose(const char* format, ...);
 
 void info(const char* format, ...);
 
 void warning(const char* format, ...);
 
+/** Errors and failed checks are printed synchronously, after all pending messages. */
 void error(const char* format, ...);
 
 bool check(bool value, const char* format, ...);
 
-}
+/** Set the minimum severity of messages to print. Errors are always printed.
+ \param level the new minimum level
+ */
+void setLevel(Level level);
+
+/** \return the current minimum severity */
+Level getLevel();
 
+/** Limit the number of identical consecutive messages printed, the others are counted and summarized.
+ \param limit the maximum number of repetitions printed, 0 to disable the limit
+ */
+void setRepeatLimit(unsigned int limit);
+
+/** Copy all messages to a file, in addition to the console.
+ \param path the file path, or null to close the current file
+ \return true if the file was opened
+ */
+bool setFile(const char* path);
+
+/** Wait until all pending messages have been printed. */
+void flush();
+
+}
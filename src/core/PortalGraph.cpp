@@ -0,0 +1,200 @@
+#include "core/PortalGraph.hpp"
+
+// Traversal limits.
+static const uint kMaxPortalDepth = 16u;
+static const uint kMaxPortalCrossings = 512u;
+// Distance below which the viewpoint is considered on a portal, in world units.
+static const float kPortalEpsilon = 1.0f;
+// Margin when checking if a box fits in a zone.
+static const float kZoneMargin = 1.0f;
+
+ConvexVolume::ConvexVolume(const Frustum& frustum) :
+	planes(frustum.planes().begin(), frustum.planes().end()) {
+}
+
+bool ConvexVolume::intersects(const BoundingBox& box) const {
+	for(const glm::vec4& plane : planes){
+		const glm::vec4 corner(plane.x >= 0.0f ? box.maxis.x : box.minis.x,
+							   plane.y >= 0.0f ? box.maxis.y : box.minis.y,
+							   plane.z >= 0.0f ? box.maxis.z : box.minis.z,
+							   1.0f);
+		if(glm::dot(plane, corner) < 0.0f){
+			return false;
+		}
+	}
+	return true;
+}
+
+void ConvexVolume::clip(const std::vector<glm::vec3>& polygon, std::vector<glm::vec3>& clipped) const {
+	// Sutherland-Hodgman clipping against each plane in turn.
+	clipped = polygon;
+	std::vector<glm::vec3> input;
+	for(const glm::vec4& plane : planes){
+		if(clipped.empty()){
+			return;
+		}
+		std::swap(input, clipped);
+		clipped.clear();
+		const size_t count = input.size();
+		for(size_t i = 0; i < count; ++i){
+			const glm::vec3& a = input[i];
+			const glm::vec3& b = input[(i + 1) % count];
+			const float da = glm::dot(plane, glm::vec4(a, 1.0f));
+			const float db = glm::dot(plane, glm::vec4(b, 1.0f));
+			if(da >= 0.0f){
+				clipped.push_back(a);
+			}
+			if((da >= 0.0f) != (db >= 0.0f)){
+				clipped.push_back(glm::mix(a, b, da / (da - db)));
+			}
+		}
+	}
+}
+
+void PortalGraph::clean(){
+	_zones.clear();
+	_portals.clear();
+}
+
+void PortalGraph::build(const World& world){
+	clean();
+	_zones.resize(world.zones().size());
+	for(size_t zid = 0; zid < _zones.size(); ++zid){
+		_zones[zid].bbox = world.zones()[zid].bbox;
+	}
+	for(const World::Portal& portal : world.portals()){
+		if(portal.zones[0] >= _zones.size() || portal.zones[1] >= _zones.size()){
+			continue;
+		}
+		const uint portalId = (uint)_portals.size();
+		_portals.push_back(portal);
+		_zones[portal.zones[0]].portals.push_back(portalId);
+		_zones[portal.zones[1]].portals.push_back(portalId);
+	}
+}
+
+void PortalGraph::findZones(const glm::vec3& point, std::vector<uint>& zones) const {
+	for(uint zid = 0; zid < _zones.size(); ++zid){
+		if(_zones[zid].bbox.contains(point)){
+			zones.push_back(zid);
+		}
+	}
+}
+
+uint PortalGraph::findZone(const BoundingBox& box) const {
+	uint foundZone = World::Portal::NO_ZONE;
+	for(uint zid = 0; zid < _zones.size(); ++zid){
+		const BoundingBox& zoneBox = _zones[zid].bbox;
+		const bool contained = glm::all(glm::greaterThanEqual(box.minis, zoneBox.minis - kZoneMargin))
+							&& glm::all(glm::lessThanEqual(box.maxis, zoneBox.maxis + kZoneMargin));
+		if(!contained){
+			continue;
+		}
+		// Zone boxes overlap, and the traversal might reach only one of them: keep ambiguous instances always visible.
+		if(foundZone != World::Portal::NO_ZONE){
+			return World::Portal::NO_ZONE;
+		}
+		foundZone = zid;
+	}
+	return foundZone;
+}
+
+void PortalGraph::computeVisibility(const glm::vec3& eye, const glm::mat4& vp, Visibility& visibility) const {
+	const uint zoneCount = (uint)_zones.size();
+	visibility.zones.assign(zoneCount, false);
+	visibility.volumes.assign(zoneCount, {});
+	visibility.portalsTraversed = 0;
+	visibility.culled = true;
+
+	const ConvexVolume root{Frustum(vp)};
+
+	std::vector<uint> startZones;
+	findZones(eye, startZones);
+	// We can't reason about zones without portals.
+	bool fallback = startZones.empty() || _portals.empty();
+	for(const uint zone : startZones){
+		fallback |= _zones[zone].portals.empty();
+	}
+
+	if(!fallback){
+		std::vector<uint> path;
+		for(const uint zone : startZones){
+			traverse(zone, eye, root, root, 0, path, visibility);
+		}
+		for(uint zid = 0; zid < zoneCount; ++zid){
+			if(_zones[zid].portals.empty()){
+				visibility.zones[zid] = true;
+				visibility.volumes[zid].assign(1, root);
+			}
+		}
+	}
+	// Outside of connected zones or traversal too costly, consider everything as visible.
+	if(fallback || visibility.portalsTraversed > kMaxPortalCrossings){
+		visibility.culled = false;
+		for(uint zid = 0; zid < zoneCount; ++zid){
+			visibility.zones[zid] = true;
+			visibility.volumes[zid].assign(1, root);
+		}
+	}
+}
+
+void PortalGraph::traverse(uint zone, const glm::vec3& eye, const ConvexVolume& root, const ConvexVolume& volume, uint depth, std::vector<uint>& path, Visibility& visibility) const {
+	visibility.zones[zone] = true;
+	visibility.volumes[zone].push_back(volume);
+
+	if(depth >= kMaxPortalDepth || visibility.portalsTraversed > kMaxPortalCrossings){
+		return;
+	}
+
+	std::vector<glm::vec3> clipped;
+	for(const uint portalId : _zones[zone].portals){
+		// Don't go back through a portal already crossed.
+		if(std::find(path.begin(), path.end(), portalId) != path.end()){
+			continue;
+		}
+		const World::Portal& portal = _portals[portalId];
+		const uint nextZone = portal.zones[0] == zone ? portal.zones[1] : portal.zones[0];
+
+		volume.clip(portal.polygon, clipped);
+		if(clipped.size() < 3){
+			continue;
+		}
+		++visibility.portalsTraversed;
+
+		ConvexVolume nextVolume;
+		const float eyeDistance = glm::dot(portal.normal, eye - portal.center);
+		if(std::abs(eyeDistance) < kPortalEpsilon){
+			// Standing in the portal, the volume can't be narrowed.
+			nextVolume = volume;
+		} else {
+			glm::vec3 clippedCenter(0.0f);
+			for(const glm::vec3& vertex : clipped){
+				clippedCenter += vertex;
+			}
+			clippedCenter /= float(clipped.size());
+			// One plane through the eye for each edge of the clipped portal.
+			const size_t count = clipped.size();
+			for(size_t i = 0; i < count; ++i){
+				const glm::vec3& a = clipped[i];
+				const glm::vec3& b = clipped[(i + 1) % count];
+				glm::vec3 normal = glm::cross(a - eye, b - eye);
+				if(glm::length(normal) < 1e-6f){
+					continue;
+				}
+				if(glm::dot(normal, clippedCenter - eye) < 0.0f){
+					normal = -normal;
+				}
+				nextVolume.planes.emplace_back(normal, -glm::dot(normal, eye));
+			}
+			// Only keep what is beyond the portal.
+			const glm::vec3 portalNormal = eyeDistance > 0.0f ? -portal.normal : portal.normal;
+			nextVolume.planes.emplace_back(portalNormal, -glm::dot(portalNormal, portal.center));
+			// And what is inside the initial frustum.
+			nextVolume.planes.insert(nextVolume.planes.end(), root.planes.begin(), root.planes.end());
+		}
+
+		path.push_back(portalId);
+		traverse(nextZone, eye, root, nextVolume, depth + 1, path, visibility);
+		path.pop_back();
+	}
+}
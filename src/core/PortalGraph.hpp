@@ -0,0 +1,106 @@
+#pragma once
+#include "core/Common.hpp"
+#include "core/Bounds.hpp"
+#include "core/WorldParser.hpp"
+
+/**
+ \brief Convex region of space defined by a set of planes, such as a frustum clipped by portals.
+ \ingroup Resources
+ */
+class ConvexVolume {
+public:
+
+	/** Empty volume constructor (contains everything). */
+	ConvexVolume() = default;
+
+	/** Create a volume from a frustum.
+	 \param frustum the frustum to copy the planes from
+	 */
+	explicit ConvexVolume(const Frustum& frustum);
+
+	/** Indicate if a bounding box intersects this volume, with the same conservative test as Frustum::intersects.
+	 \param box the bounding box to test
+	 \return true if the bounding box intersects the volume.
+	 */
+	bool intersects(const BoundingBox& box) const;
+
+	/** Clip a convex polygon by the volume planes.
+	 \param polygon the polygon vertices, ordered
+	 \param clipped will contain the clipped polygon vertices, empty if the polygon is outside
+	 */
+	void clip(const std::vector<glm::vec3>& polygon, std::vector<glm::vec3>& clipped) const;
+
+	std::vector<glm::vec4> planes; ///< Plane coefficients, with normals pointing inside.
+};
+
+/**
+ \brief Graph of zones connected by visibility portals, used to determine which zones can be seen from a viewpoint.
+ \ingroup Resources
+ */
+class PortalGraph {
+public:
+
+	/** \brief Result of a visibility traversal. */
+	struct Visibility {
+		std::vector<bool> zones; ///< For each zone, is it potentially visible.
+		std::vector<std::vector<ConvexVolume>> volumes; ///< For each zone, the frusta clipped by the portals through which it is seen.
+		uint portalsTraversed = 0; ///< Number of portals crossed during the traversal.
+		bool culled = false; ///< Was portal culling applied (false if the viewpoint is outside all connected zones).
+	};
+
+	/** Build the graph from the world zones and portals.
+	 \param world the world to extract the graph from
+	 */
+	void build(const World& world);
+
+	/** Remove all zones and portals. */
+	void clean();
+
+	/** Find the zones containing a point.
+	 \param point the point to locate
+	 \param zones will be populated with the indices of zones containing the point
+	 */
+	void findZones(const glm::vec3& point, std::vector<uint>& zones) const;
+
+	/** Find the zone fully containing a box, if it is unique.
+	 \param box the box to locate
+	 \return the index of the only zone containing the box, or World::Portal::NO_ZONE if none or several zones contain it
+	 */
+	uint findZone(const BoundingBox& box) const;
+
+	/** Compute the zones visible from a viewpoint, by recursively traversing the portals visible in the view frustum.
+	 Zones without portals are always visible, and no culling is applied if the viewpoint is outside all connected zones.
+	 \param eye the viewpoint position
+	 \param vp the view projection matrix
+	 \param visibility will contain the visible zones and clipped frusta
+	 */
+	void computeVisibility(const glm::vec3& eye, const glm::mat4& vp, Visibility& visibility) const;
+
+	/** \return the number of zones in the graph */
+	size_t zoneCount() const { return _zones.size(); }
+
+	/** \return the number of portals in the graph */
+	size_t portalCount() const { return _portals.size(); }
+
+private:
+
+	/** Traverse the portals of a zone, seen through a given volume.
+	 \param zone the current zone
+	 \param eye the viewpoint position
+	 \param root the initial view frustum
+	 \param volume the current clipped view volume
+	 \param depth the current recursion depth
+	 \param path the portals crossed to reach the current zone
+	 \param visibility the visibility result to update
+	 */
+	void traverse(uint zone, const glm::vec3& eye, const ConvexVolume& root, const ConvexVolume& volume, uint depth, std::vector<uint>& path, Visibility& visibility) const;
+
+	/** \brief Zone and the portals leaving it. */
+	struct Zone {
+		BoundingBox bbox;
+		std::vector<uint> portals;
+	};
+
+	std::vector<Zone> _zones; ///< Graph zones.
+	std::vector<World::Portal> _portals; ///< Graph portals.
+};
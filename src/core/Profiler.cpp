@@ -0,0 +1,159 @@
+#include "core/Profiler.hpp"
+#include "core/Log.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+
+/** \brief Zones recorded by a thread. */
+struct ProfilerThreadBuffer {
+	std::mutex mutex; ///< Protect completed events from collection.
+	std::vector<Profiler::Event> events; ///< Completed events.
+	std::vector<std::pair<const char*, uint64_t>> stack; ///< Open zones, only accessed by the owning thread.
+	uint32_t index = 0; ///< Thread index.
+};
+
+/** \brief Shared profiler state. */
+struct ProfilerState {
+	std::mutex mutex; ///< Protect all members.
+	std::vector<std::shared_ptr<ProfilerThreadBuffer>> threads;
+	std::vector<Profiler::Event> frameEvents;
+	std::vector<Profiler::Event> capturedEvents;
+	std::unordered_set<std::string> names;
+	bool capturing = false;
+	const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+};
+
+static ProfilerState& state(){
+	static ProfilerState state;
+	return state;
+}
+
+static ProfilerThreadBuffer& threadBuffer(){
+	// Buffers are shared with the state, so that events survive their thread.
+	static thread_local std::shared_ptr<ProfilerThreadBuffer> buffer;
+	if(!buffer){
+		buffer = std::make_shared<ProfilerThreadBuffer>();
+		ProfilerState& profiler = state();
+		std::lock_guard<std::mutex> lock(profiler.mutex);
+		buffer->index = (uint32_t)profiler.threads.size();
+		profiler.threads.push_back(buffer);
+	}
+	return *buffer;
+}
+
+static uint64_t now(){
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - state().epoch).count();
+}
+
+static void collectEvents(ProfilerState& profiler, std::vector<Profiler::Event>& events){
+	for(std::shared_ptr<ProfilerThreadBuffer>& buffer : profiler.threads){
+		std::lock_guard<std::mutex> lock(buffer->mutex);
+		events.insert(events.end(), buffer->events.begin(), buffer->events.end());
+		buffer->events.clear();
+	}
+}
+
+void Profiler::begin(const char* name){
+	ProfilerThreadBuffer& buffer = threadBuffer();
+	buffer.stack.emplace_back(name, now());
+}
+
+void Profiler::begin(const std::string& name){
+	ProfilerState& profiler = state();
+	const char* internedName = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(profiler.mutex);
+		internedName = profiler.names.insert(name).first->c_str();
+	}
+	begin(internedName);
+}
+
+void Profiler::end(){
+	const uint64_t time = now();
+	ProfilerThreadBuffer& buffer = threadBuffer();
+	if(buffer.stack.empty()){
+		return;
+	}
+	const auto zone = buffer.stack.back();
+	buffer.stack.pop_back();
+	std::lock_guard<std::mutex> lock(buffer.mutex);
+	buffer.events.push_back({ zone.first, zone.second, time, buffer.index, (uint32_t)buffer.stack.size() });
+}
+
+void Profiler::newFrame(){
+	ProfilerState& profiler = state();
+	std::lock_guard<std::mutex> lock(profiler.mutex);
+	profiler.frameEvents.clear();
+	collectEvents(profiler, profiler.frameEvents);
+	std::sort(profiler.frameEvents.begin(), profiler.frameEvents.end(), [](const Event& a, const Event& b){
+		return a.thread < b.thread || (a.thread == b.thread && a.start < b.start);
+	});
+	if(profiler.capturing){
+		profiler.capturedEvents.insert(profiler.capturedEvents.end(), profiler.frameEvents.begin(), profiler.frameEvents.end());
+	}
+}
+
+const std::vector<Profiler::Event>& Profiler::frameEvents(){
+	return state().frameEvents;
+}
+
+void Profiler::startCapture(){
+	ProfilerState& profiler = state();
+	std::lock_guard<std::mutex> lock(profiler.mutex);
+	profiler.capturedEvents.clear();
+	profiler.capturing = true;
+}
+
+bool Profiler::stopCapture(const fs::path& path){
+	ProfilerState& profiler = state();
+	std::vector<Event> events;
+	{
+		std::lock_guard<std::mutex> lock(profiler.mutex);
+		if(!profiler.capturing){
+			return false;
+		}
+		// Include zones completed since the last frame.
+		collectEvents(profiler, profiler.capturedEvents);
+		profiler.capturing = false;
+		std::swap(events, profiler.capturedEvents);
+	}
+	return saveTrace(events, path);
+}
+
+bool Profiler::capturing(){
+	ProfilerState& profiler = state();
+	std::lock_guard<std::mutex> lock(profiler.mutex);
+	return profiler.capturing;
+}
+
+bool Profiler::saveTrace(const std::vector<Event>& events, const fs::path& path){
+	FILE* file = fopen(path.string().c_str(), "w");
+	if(!file){
+		Log::error("Profiler: Unable to save trace to %s.", path.string().c_str());
+		return false;
+	}
+	// Complete events, with times in microseconds.
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	uint32_t maxThread = 0;
+	for(size_t eid = 0; eid < events.size(); ++eid){
+		const Event& event = events[eid];
+		std::string name(event.name);
+		std::replace(name.begin(), name.end(), '"', '\'');
+		std::replace(name.begin(), name.end(), '\\', '/');
+		fprintf(file, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f},\n", name.c_str(), event.thread,
+				double(event.start) * 1e-3, double(event.end - event.start) * 1e-3);
+		maxThread = std::max(maxThread, event.thread);
+	}
+	// Thread names metadata.
+	for(uint32_t tid = 0; tid <= maxThread; ++tid){
+		fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"Thread %u\"}}%s\n", tid, tid, tid == maxThread ? "" : ",");
+	}
+	fprintf(file, "]}\n");
+	fclose(file);
+	Log::info("Profiler: Saved %lu zones to %s.", events.size(), path.string().c_str());
+	return true;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "core/System.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ \brief Record timed CPU zones per thread, for live display or export to the Chrome trace format.
+ Zones are recorded through the PROFILE_* macros, that compile to nothing unless PROFILER_ENABLED is defined.
+ \ingroup System
+ */
+class Profiler {
+public:
+
+	/** \brief Completed zone. */
+	struct Event {
+		const char* name; ///< Zone name, with static lifetime.
+		uint64_t start; ///< Start time in nanoseconds.
+		uint64_t end; ///< End time in nanoseconds.
+		uint32_t thread; ///< Index of the recording thread.
+		uint32_t depth; ///< Nesting depth on the recording thread.
+	};
+
+	/** \brief Record a zone for the duration of the scope. */
+	class Scope {
+	public:
+		/** Constructor.
+		 \param name the zone name, with static lifetime
+		 */
+		explicit Scope(const char* name){ Profiler::begin(name); }
+
+		/** Destructor. */
+		~Scope(){ Profiler::end(); }
+	};
+
+	/** Start a zone on the calling thread.
+	 \param name the zone name, with static lifetime
+	 */
+	static void begin(const char* name);
+
+	/** Start a zone on the calling thread.
+	 \param name the zone name, will be copied
+	 */
+	static void begin(const std::string& name);
+
+	/** End the last zone started on the calling thread. */
+	static void end();
+
+	/** Collect zones completed by all threads since the last call, and keep them if capturing. */
+	static void newFrame();
+
+	/** \return the zones collected by the last call to newFrame, sorted by thread and start time */
+	static const std::vector<Event>& frameEvents();
+
+	/** Start keeping all zones for export. */
+	static void startCapture();
+
+	/** Stop keeping zones and export the captured ones.
+	 \param path the output JSON file path
+	 \return true if the file was saved
+	 */
+	static bool stopCapture(const fs::path& path);
+
+	/** \return true if zones are being captured */
+	static bool capturing();
+
+	/** Save zones in the Chrome trace event format, for chrome://tracing or Perfetto.
+	 \param events the zones to save
+	 \param path the output JSON file path
+	 \return true if the file was saved
+	 */
+	static bool saveTrace(const std::vector<Event>& events, const fs::path& path);
+
+};
+
+#ifdef PROFILER_ENABLED
+
+#define PROFILE_CONCAT_INTERNAL(A, B) A##B
+#define PROFILE_CONCAT(A, B) PROFILE_CONCAT_INTERNAL(A, B)
+/// Record a zone for the rest of the scope, the name should be a literal.
+#define PROFILE_SCOPE(NAME) Profiler::Scope PROFILE_CONCAT(profileScope, __LINE__)(NAME)
+/// Start and end a zone explicitly, the name can be a dynamic string.
+#define PROFILE_BEGIN(NAME) Profiler::begin(NAME)
+#define PROFILE_END() Profiler::end()
+/// Collect zones of the frame that ended.
+#define PROFILE_FRAME() Profiler::newFrame()
+
+#else
+
+#define PROFILE_SCOPE(NAME)
+#define PROFILE_BEGIN(NAME)
+#define PROFILE_END()
+#define PROFILE_FRAME()
+
+#endif
@@ -0,0 +1,379 @@
+#include "core/ScenePack.hpp"
+#include "core/Log.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <unordered_map>
+
+static const char kPackMagic[8] = { 'X', '1', '1', '2', 'P', 'A', 'C', 'K' };
+
+/** \brief File header. */
+struct PackHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t sectionCount;
+	uint64_t key;
+	uint64_t size;
+};
+
+/** \brief Entry of the section table, following the header. */
+struct PackSection {
+	uint32_t id;
+	uint32_t elementSize;
+	uint64_t count;
+	uint64_t offset;
+	uint64_t size;
+};
+
+/// Flag marking references to composed names in the name parts sections.
+static const uint32_t kComposedNameFlag = 0x80000000u;
+
+/** Register a pooled name and its parts in the pack local tables, children before parents.
+ \param id the pool identifier
+ \param refs the local reference of each already registered pool identifier
+ \param strings the local interned strings
+ \param composed the local composed names, as triplets of references
+ \return the local reference
+ */
+static uint32_t registerName(uint32_t id, std::unordered_map<uint32_t, uint32_t>& refs, std::vector<std::string>& strings, std::vector<uint32_t>& composed){
+	auto existing = refs.find(id);
+	if(existing != refs.end()){
+		return existing->second;
+	}
+	uint32_t ref = 0u;
+	uint32_t prefix, separator, suffix;
+	if(StringPool::parts(id, prefix, separator, suffix)){
+		const uint32_t prefixRef = registerName(prefix, refs, strings, composed);
+		const uint32_t separatorRef = registerName(separator, refs, strings, composed);
+		const uint32_t suffixRef = registerName(suffix, refs, strings, composed);
+		ref = kComposedNameFlag | (uint32_t)(composed.size() / 3u);
+		composed.insert(composed.end(), { prefixRef, separatorRef, suffixRef });
+	} else {
+		ref = (uint32_t)strings.size();
+		strings.emplace_back(StringPool::c_str(id));
+	}
+	refs[id] = ref;
+	return ref;
+}
+
+static uint64_t alignOffset(uint64_t offset){
+	return (offset + ScenePack::ALIGNMENT - 1u) & ~uint64_t(ScenePack::ALIGNMENT - 1u);
+}
+
+static bool readHeader(FILE* file, uint64_t key, PackHeader& header){
+	if(fread(&header, sizeof(PackHeader), 1, file) != 1){
+		return false;
+	}
+	return memcmp(header.magic, kPackMagic, sizeof(kPackMagic)) == 0 && header.version == ScenePack::VERSION && header.key == key;
+}
+
+/** Check that the header describes a file large enough for its section table.
+ \param header the file header
+ \return true if the layout is consistent
+ */
+static bool checkHeaderLayout(const PackHeader& header){
+	if(header.size < sizeof(PackHeader)){
+		return false;
+	}
+	const uint64_t maxSectionCount = (header.size - sizeof(PackHeader)) / sizeof(PackSection);
+	return uint64_t(header.sectionCount) <= maxSectionCount;
+}
+
+void ScenePack::Writer::add(uint32_t id, const void* data, size_t elementSize, size_t count){
+	_entries.push_back({ data, elementSize, count, id });
+}
+
+void ScenePack::Writer::addStrings(uint32_t id, const std::vector<std::string>& strings){
+	// Null-terminated strings, back to back.
+	size_t totalSize = 0;
+	for(const std::string& str : strings){
+		totalSize += str.size() + 1u;
+	}
+	std::vector<char>& storage = _storage.emplace_back();
+	storage.reserve(totalSize);
+	for(const std::string& str : strings){
+		storage.insert(storage.end(), str.begin(), str.end());
+		storage.push_back('\0');
+	}
+	add(id, storage.data(), 1u, storage.size());
+}
+
+void ScenePack::Writer::addNames(uint32_t stringsId, uint32_t partsId, const std::vector<Name>& names){
+	// Parts: name count, a reference per name, then a triplet of references per composed name.
+	std::unordered_map<uint32_t, uint32_t> refs;
+	std::vector<std::string> strings;
+	std::vector<uint32_t> composed;
+	std::vector<uint32_t> parts;
+	parts.reserve(names.size() + 1u);
+	parts.push_back((uint32_t)names.size());
+	for(const Name& name : names){
+		parts.push_back(registerName(name.id(), refs, strings, composed));
+	}
+	parts.insert(parts.end(), composed.begin(), composed.end());
+	addStrings(stringsId, strings);
+	addCopy(partsId, parts);
+}
+
+bool ScenePack::Writer::save(const fs::path& path, uint64_t key) const {
+	const uint32_t sectionCount = (uint32_t)_entries.size();
+	// Lay out sections after the table.
+	std::vector<PackSection> sections(sectionCount);
+	uint64_t offset = alignOffset(sizeof(PackHeader) + sizeof(PackSection) * sectionCount);
+	for(uint32_t sid = 0; sid < sectionCount; ++sid){
+		const Entry& entry = _entries[sid];
+		PackSection& section = sections[sid];
+		section.id = entry.id;
+		section.elementSize = (uint32_t)entry.elementSize;
+		section.count = entry.count;
+		section.size = entry.elementSize * entry.count;
+		section.offset = offset;
+		offset = alignOffset(offset + section.size);
+	}
+
+	PackHeader header;
+	memcpy(header.magic, kPackMagic, sizeof(kPackMagic));
+	header.version = VERSION;
+	header.sectionCount = sectionCount;
+	header.key = key;
+	header.size = offset;
+
+	std::error_code ec;
+	fs::create_directories(path.parent_path(), ec);
+	// Write to a temporary file first, so that an interrupted save doesn't leave a truncated pack.
+	const fs::path tmpPath = path.string() + ".tmp";
+	FILE* file = fopen(tmpPath.string().c_str(), "wb");
+	if(!file){
+		Log::warning("ScenePack: Unable to write pack to %s.", path.string().c_str());
+		return false;
+	}
+	static const char padding[ALIGNMENT] = {};
+	bool success = fwrite(&header, sizeof(PackHeader), 1, file) == 1;
+	success = success && (sectionCount == 0 || fwrite(sections.data(), sizeof(PackSection), sectionCount, file) == sectionCount);
+	uint64_t written = sizeof(PackHeader) + sizeof(PackSection) * sectionCount;
+	for(uint32_t sid = 0; sid < sectionCount && success; ++sid){
+		const PackSection& section = sections[sid];
+		success = fwrite(padding, 1, section.offset - written, file) == section.offset - written;
+		success = success && (section.size == 0 || fwrite(_entries[sid].data, 1, section.size, file) == section.size);
+		written = section.offset + section.size;
+	}
+	success = success && fwrite(padding, 1, header.size - written, file) == header.size - written;
+	fclose(file);
+	if(success){
+		fs::rename(tmpPath, path, ec);
+		success = !ec;
+	}
+	if(!success){
+		fs::remove(tmpPath, ec);
+		Log::warning("ScenePack: Unable to write pack to %s.", path.string().c_str());
+		return false;
+	}
+	Log::info("ScenePack: Saved %u sections (%.1fMB) to %s.", sectionCount, double(header.size) / (1024.0 * 1024.0), path.string().c_str());
+	return true;
+}
+
+bool ScenePack::load(const fs::path& path, uint64_t key){
+	_storage.reset();
+	_content = nullptr;
+	_size = 0;
+	_sections.clear();
+
+	FILE* file = fopen(path.string().c_str(), "rb");
+	if(!file){
+		return false;
+	}
+	PackHeader header;
+	if(!readHeader(file, key, header)){
+		fclose(file);
+		Log::info("ScenePack: Pack at %s is outdated.", path.string().c_str());
+		return false;
+	}
+	if(!checkHeaderLayout(header) || header.size > uint64_t(SIZE_MAX - ALIGNMENT)){
+		fclose(file);
+		Log::warning("ScenePack: Pack at %s is corrupted.", path.string().c_str());
+		return false;
+	}
+	// Read the whole file in aligned memory, so that sections keep their alignment.
+	_storage = std::make_unique<char[]>(header.size + ALIGNMENT);
+	char* content = reinterpret_cast<char*>(alignOffset(reinterpret_cast<uintptr_t>(_storage.get())));
+	memcpy(content, &header, sizeof(PackHeader));
+	const size_t remaining = header.size - sizeof(PackHeader);
+	const bool success = fread(content + sizeof(PackHeader), 1, remaining, file) == remaining;
+	fclose(file);
+	if(!success){
+		_storage.reset();
+		Log::warning("ScenePack: Pack at %s is truncated.", path.string().c_str());
+		return false;
+	}
+	_content = content;
+	_size = header.size;
+
+	const PackSection* sections = reinterpret_cast<const PackSection*>(content + sizeof(PackHeader));
+	_sections.reserve(header.sectionCount);
+	for(uint32_t sid = 0; sid < header.sectionCount; ++sid){
+		const PackSection& section = sections[sid];
+		// Compare sizes without overflowing.
+		const bool inBounds = section.offset <= _size && section.size <= _size - section.offset;
+		const bool consistentSize = section.elementSize == 0u ? section.size == 0u : (section.count <= section.size / section.elementSize && section.size == section.elementSize * section.count);
+		if(!inBounds || !consistentSize){
+			Log::warning("ScenePack: Pack at %s is corrupted.", path.string().c_str());
+			_sections.clear();
+			_storage.reset();
+			_content = nullptr;
+			return false;
+		}
+		_sections.push_back({ section.id, section.elementSize, section.count, section.offset });
+	}
+	std::sort(_sections.begin(), _sections.end(), [](const Location& a, const Location& b){
+		return a.id < b.id;
+	});
+	return true;
+}
+
+bool ScenePack::isValid(const fs::path& path, uint64_t key){
+	FILE* file = fopen(path.string().c_str(), "rb");
+	if(!file){
+		return false;
+	}
+	PackHeader header;
+	const bool valid = readHeader(file, key, header) && checkHeaderLayout(header);
+	fclose(file);
+	return valid;
+}
+
+const void* ScenePack::data(uint32_t id, size_t elementSize, size_t& count) const {
+	const auto section = std::lower_bound(_sections.begin(), _sections.end(), id, [](const Location& a, uint32_t b){
+		return a.id < b;
+	});
+	if(section == _sections.end() || section->id != id){
+		return nullptr;
+	}
+	if(section->elementSize != elementSize && section->count != 0){
+		Log::warning("ScenePack: Unexpected element size for section %u.", id);
+		return nullptr;
+	}
+	count = section->count;
+	return _content + section->offset;
+}
+
+bool ScenePack::read(uint32_t id, void* dst, size_t elementSize, size_t count) const {
+	size_t sectionCount = 0;
+	const void* src = data(id, elementSize, sectionCount);
+	if(src == nullptr || sectionCount != count){
+		return false;
+	}
+	memcpy(dst, src, elementSize * count);
+	return true;
+}
+
+bool ScenePack::readStrings(uint32_t id, std::vector<std::string>& dst) const {
+	size_t size = 0;
+	const char* src = static_cast<const char*>(data(id, 1u, size));
+	if(src == nullptr){
+		return false;
+	}
+	dst.clear();
+	size_t start = 0;
+	for(size_t i = 0; i < size; ++i){
+		if(src[i] == '\0'){
+			dst.emplace_back(src + start, i - start);
+			start = i + 1u;
+		}
+	}
+	return true;
+}
+
+bool ScenePack::readNames(uint32_t stringsId, uint32_t partsId, std::vector<Name>& dst) const {
+	std::vector<std::string> strings;
+	std::vector<uint32_t> parts;
+	if(!readStrings(stringsId, strings) || !read(partsId, parts) || parts.empty()){
+		return false;
+	}
+	const size_t nameCount = parts[0];
+	if(nameCount + 1u > parts.size() || (parts.size() - nameCount - 1u) % 3u != 0u){
+		return false;
+	}
+	std::vector<Name> leaves;
+	leaves.reserve(strings.size());
+	for(const std::string& str : strings){
+		leaves.emplace_back(str);
+	}
+	// Composed names only reference names listed before them.
+	std::vector<Name> composed;
+	auto resolve = [&leaves, &composed](uint32_t ref, Name& name){
+		const uint32_t index = ref & ~kComposedNameFlag;
+		const std::vector<Name>& list = (ref & kComposedNameFlag) ? composed : leaves;
+		if(index >= list.size()){
+			return false;
+		}
+		name = list[index];
+		return true;
+	};
+	for(size_t i = nameCount + 1u; i < parts.size(); i += 3u){
+		Name prefix, separator, suffix;
+		if(!resolve(parts[i], prefix) || !resolve(parts[i + 1u], separator) || !resolve(parts[i + 2u], suffix)){
+			return false;
+		}
+		composed.push_back(Name::compose(prefix, separator, suffix));
+	}
+	dst.resize(nameCount);
+	for(size_t i = 0; i < nameCount; ++i){
+		if(!resolve(parts[i + 1u], dst[i])){
+			return false;
+		}
+	}
+	return true;
+}
+
+uint64_t ScenePack::hashDirectory(const fs::path& directory){
+	// Sort entries, as the iteration order is unspecified.
+	std::vector<std::pair<std::string, uint64_t>> entries;
+	std::error_code ec;
+	for(fs::recursive_directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)){
+		if(!it->is_regular_file(ec)){
+			continue;
+		}
+		const uint64_t size = it->file_size(ec);
+		const uint64_t time = (uint64_t)it->last_write_time(ec).time_since_epoch().count();
+		entries.emplace_back(fs::relative(it->path(), directory, ec).generic_string(), size ^ (time * 0x9E3779B97F4A7C15ull));
+	}
+	std::sort(entries.begin(), entries.end());
+
+	std::vector<uint64_t> hashes;
+	hashes.reserve(entries.size() * 2u);
+	for(const auto& entry : entries){
+		hashes.push_back(System::hash64(entry.first.data(), entry.first.size()));
+		hashes.push_back(entry.second);
+	}
+	return System::hash64(hashes.data(), hashes.size() * sizeof(uint64_t));
+}
+
+uint64_t ScenePack::computeKey(const fs::path& mainFile, uint64_t dependenciesHash, uint64_t options){
+	size_t size = 0;
+	char* content = System::loadData(mainFile, size);
+	const uint64_t keyData[4] = {
+		content ? System::hash64(content, size) : 0u,
+		dependenciesHash,
+		options,
+		VERSION
+	};
+	delete[] content;
+	return System::hash64(keyData, sizeof(keyData));
+}
+
+uint64_t ScenePack::sceneKey(const fs::path& worldPath, uint64_t resourcesHash, const SceneOptions& options){
+	const uint64_t packedOptions = (options.staticBatching ? 1u : 0u) | (uint64_t(options.maxTextureArrays) << 1u) | (uint64_t(options.textureBudget) << 32u);
+	return computeKey(worldPath, resourcesHash, packedOptions);
+}
+
+fs::path ScenePack::path(const fs::path& resourcesPath, const fs::path& worldPath){
+	fs::path root = resourcesPath;
+	if(!root.has_filename()){
+		root = root.parent_path();
+	}
+	return root.parent_path() / "packs" / (worldPath.stem().string() + ".x112pack");
+}
+
+fs::path ScenePack::shadowsPath(const fs::path& resourcesPath, const fs::path& worldPath){
+	// Keep the extension, as areas and worlds can share the same name.
+	return path(resourcesPath, worldPath).parent_path() / (worldPath.filename().string() + ".x112shadows");
+}
@@ -0,0 +1,249 @@
+#pragma once
+
+#include "core/System.hpp"
+#include "core/Common.hpp"
+#include "core/StringPool.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <type_traits>
+
+/**
+ \brief Binary file of typed data sections, caching the processed content of a scene, a compiled shader or pipeline states.
+ The file starts with a header and a table of sections, followed by the section contents. Each section
+ is aligned on 64 bytes, so that the file can be memory-mapped and each section copied as-is to staging memory.
+ A pack is tagged with a key computed from its inputs, and rejected if the key doesn't match.
+ \ingroup System
+ */
+class ScenePack {
+public:
+
+	/// Bump when the layout of the pack or of any serialized structure changes.
+	static const uint32_t VERSION = 2u;
+	/// Alignment of sections in the file, in bytes.
+	static const size_t ALIGNMENT = 64u;
+
+	/** \brief Scene generation options affecting the content of a world pack. */
+	struct SceneOptions {
+		bool staticBatching = false; ///< Merge small static objects together.
+		uint maxTextureArrays = 0u; ///< Maximum number of texture arrays, larger textures are downsampled to fit (0 for no limit).
+		uint textureBudget = 0u; ///< Maximum texture arrays size in MB, top mip levels are dropped to fit (0 for no limit).
+	};
+
+	/** \brief Known sections. */
+	enum Section : uint32_t {
+		// World content used after generation.
+		WORLD_NAME = 0, WORLD_CAMERAS, WORLD_CAMERA_NAMES, WORLD_LIGHTS, WORLD_LIGHT_NAMES,
+		WORLD_ZONES, WORLD_ZONE_NAMES, WORLD_PORTALS, WORLD_PORTAL_NAMES, WORLD_PORTAL_POLYGONS,
+		WORLD_EMITTERS, WORLD_EMITTER_NAMES, WORLD_BILLBOARDS, WORLD_BILLBOARD_NAMES,
+		WORLD_CAMERA_NAME_PARTS, WORLD_LIGHT_NAME_PARTS, WORLD_EMITTER_NAME_PARTS, WORLD_BILLBOARD_NAME_PARTS,
+		// Scene geometry streams.
+		MESH_POSITIONS = 100, MESH_NORMALS, MESH_TANGENTS, MESH_BITANGENTS, MESH_COLORS, MESH_TEXCOORDS, MESH_INDICES,
+		BILLBOARD_POSITIONS = 120, BILLBOARD_NORMALS, BILLBOARD_TANGENTS, BILLBOARD_BITANGENTS, BILLBOARD_COLORS, BILLBOARD_TEXCOORDS, BILLBOARD_INDICES,
+		// Scene GPU data.
+		MESH_RANGES = 140, BILLBOARD_RANGES, PARTICLE_RANGES,
+		MESH_INFOS, INSTANCE_INFOS, MATERIAL_INFOS, LIGHT_INFOS, ZONE_INFOS,
+		TEXTURES, TEXTURE_NAMES, TEXTURE_IMAGES,
+		// Scene CPU data.
+		MESH_DEBUG_INFOS = 180, MESH_DEBUG_NAMES, INSTANCE_DEBUG_INFOS, INSTANCE_DEBUG_NAMES, TEXTURE_DEBUG_INFOS, TEXTURE_DEBUG_NAMES,
+		MESH_DEBUG_NAME_PARTS, INSTANCE_DEBUG_NAME_PARTS,
+		// Compiled shader stage.
+		SHADER_SPIRV = 200, SHADER_INFOS, SHADER_IMAGES, SHADER_IMAGE_NAMES, SHADER_BUFFERS, SHADER_BUFFER_NAMES,
+		// Pipelines created in a previous run.
+		PIPELINE_RECORDS = 220, PIPELINE_PROGRAM_NAMES, PIPELINE_ATTRIBUTES, PIPELINE_BINDINGS, PIPELINE_COLOR_FORMATS,
+		// Baked shadow maps, only the occupied atlas tiles.
+		SHADOW_INFOS = 240, SHADOW_DEPTH,
+		// One section per texture image, starting at this identifier.
+		TEXTURE_PIXELS = 0x10000,
+	};
+
+	/** \brief Accumulate sections and save them to a pack file. */
+	class Writer {
+	public:
+
+		/** Add a section, the data is referenced and should be kept alive until the pack is saved.
+		 \param id the section identifier
+		 \param data the section elements
+		 \param elementSize the size of an element in bytes
+		 \param count the number of elements
+		 */
+		void add(uint32_t id, const void* data, size_t elementSize, size_t count);
+
+		/** Add a section, the data is referenced and should be kept alive until the pack is saved.
+		 \param id the section identifier
+		 \param data the section elements
+		 */
+		template<typename T>
+		void add(uint32_t id, const std::vector<T>& data){
+			static_assert(std::is_trivially_copyable<T>::value, "Pack sections should only contain plain data.");
+			add(id, data.data(), sizeof(T), data.size());
+		}
+
+		/** Add a section containing a copy of the data.
+		 \param id the section identifier
+		 \param data the section elements
+		 */
+		template<typename T>
+		void addCopy(uint32_t id, const std::vector<T>& data){
+			static_assert(std::is_trivially_copyable<T>::value, "Pack sections should only contain plain data.");
+			std::vector<char>& storage = _storage.emplace_back(sizeof(T) * data.size());
+			if(!data.empty()){
+				memcpy(storage.data(), data.data(), storage.size());
+			}
+			add(id, storage.data(), sizeof(T), data.size());
+		}
+
+		/** Add a section containing a copy of a list of strings.
+		 \param id the section identifier
+		 \param strings the strings to store
+		 */
+		void addStrings(uint32_t id, const std::vector<std::string>& strings);
+
+		/** Add two sections storing a list of pooled names, composed names are kept composed.
+		 \param stringsId the identifier of the section containing the interned strings
+		 \param partsId the identifier of the section describing how names are built from these strings
+		 \param names the names to store
+		 */
+		void addNames(uint32_t stringsId, uint32_t partsId, const std::vector<Name>& names);
+
+		/** Save all sections to a file, creating its parent directory if needed.
+		 \param path the output file path
+		 \param key the key identifying the pack inputs
+		 \return true if the file was saved
+		 */
+		bool save(const fs::path& path, uint64_t key) const;
+
+	private:
+
+		/** \brief Referenced section data. */
+		struct Entry {
+			const void* data;
+			size_t elementSize;
+			size_t count;
+			uint32_t id;
+		};
+
+		std::vector<Entry> _entries; ///< Sections to write.
+		std::deque<std::vector<char>> _storage; ///< Copied section data.
+	};
+
+	/** Load a pack file.
+	 \param path the pack file path
+	 \param key the expected key, the pack is rejected if different
+	 \return true if the pack was loaded and is valid
+	 */
+	bool load(const fs::path& path, uint64_t key);
+
+	/** Check if a pack exists for the given key, without loading its content.
+	 \param path the pack file path
+	 \param key the expected key
+	 \return true if the pack header is valid and matches the key
+	 */
+	static bool isValid(const fs::path& path, uint64_t key);
+
+	/** Retrieve a section content, pointing into the loaded file.
+	 \param id the section identifier
+	 \param elementSize the expected element size in bytes
+	 \param count will contain the number of elements
+	 \return a pointer to the first element, or null if the section is missing or has a different element size
+	 */
+	const void* data(uint32_t id, size_t elementSize, size_t& count) const;
+
+	/** Copy a section to a list.
+	 \param id the section identifier
+	 \param dst will contain the section elements
+	 \return true if the section was found
+	 */
+	template<typename T>
+	bool read(uint32_t id, std::vector<T>& dst) const {
+		static_assert(std::is_trivially_copyable<T>::value, "Pack sections should only contain plain data.");
+		size_t count = 0;
+		const void* src = data(id, sizeof(T), count);
+		if(src == nullptr){
+			return false;
+		}
+		dst.resize(count);
+		if(count != 0){
+			memcpy(dst.data(), src, sizeof(T) * count);
+		}
+		return true;
+	}
+
+	/** Copy a section to a fixed-size array of elements.
+	 \param id the section identifier
+	 \param dst the destination
+	 \param count the expected number of elements
+	 \return true if the section was found with the expected size
+	 */
+	bool read(uint32_t id, void* dst, size_t elementSize, size_t count) const;
+
+	/** Retrieve a list of strings.
+	 \param id the section identifier
+	 \param dst will contain the strings
+	 \return true if the section was found
+	 */
+	bool readStrings(uint32_t id, std::vector<std::string>& dst) const;
+
+	/** Retrieve a list of pooled names, interning their strings.
+	 \param stringsId the identifier of the section containing the interned strings
+	 \param partsId the identifier of the section describing how names are built from these strings
+	 \param dst will contain the names
+	 \return true if the sections were found and are valid
+	 */
+	bool readNames(uint32_t stringsId, uint32_t partsId, std::vector<Name>& dst) const;
+
+	/** \return the size of the loaded file in bytes */
+	size_t size() const { return _size; }
+
+	/** Hash the names, sizes and modification times of all files in a directory and its subdirectories.
+	 \param directory the directory to scan
+	 \return the hash
+	 */
+	static uint64_t hashDirectory(const fs::path& directory);
+
+	/** Compute the key of a pack.
+	 \param mainFile the main input file, its content is hashed
+	 \param dependenciesHash hash of the other inputs
+	 \param options additional generation parameters
+	 \return the key
+	 */
+	static uint64_t computeKey(const fs::path& mainFile, uint64_t dependenciesHash, uint64_t options);
+
+	/** Compute the key of a world pack, shared by the viewer generating packs and the tools checking them.
+	 \param worldPath the world file path
+	 \param resourcesHash hash of the game resources directory
+	 \param options the scene generation options
+	 \return the key
+	 */
+	static uint64_t sceneKey(const fs::path& worldPath, uint64_t resourcesHash, const SceneOptions& options);
+
+	/** Pack file location for a world, in a packs directory next to the game resources (i.e. <install>/packs).
+	 \param resourcesPath the game resources directory
+	 \param worldPath the world file path
+	 \return the pack path
+	 */
+	static fs::path path(const fs::path& resourcesPath, const fs::path& worldPath);
+
+	/** Baked shadow maps location for a world, next to its pack.
+	 \param resourcesPath the game resources directory
+	 \param worldPath the world file path
+	 \return the shadow maps pack path
+	 */
+	static fs::path shadowsPath(const fs::path& resourcesPath, const fs::path& worldPath);
+
+private:
+
+	/** \brief Location of a section in the loaded file. */
+	struct Location {
+		uint32_t id;
+		uint32_t elementSize;
+		uint64_t count;
+		uint64_t offset;
+	};
+
+	std::unique_ptr<char[]> _storage; ///< Loaded file, with extra room for alignment.
+	const char* _content = nullptr; ///< Aligned start of the file content.
+	size_t _size = 0; ///< File size.
+	std::vector<Location> _sections; ///< Section table, sorted by identifier.
+};
@@ -0,0 +1,266 @@
+#include "core/Scheduler.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+// Default arena block size.
+static const size_t kArenaBlockSize = 256u * 1024u;
+// Number of chunks per thread when splitting a loop, to balance uneven workloads.
+static const size_t kChunksPerThread = 8u;
+
+// Queue of the current thread, 0 for non-worker threads.
+static thread_local size_t sQueueIndex = 0u;
+
+void* ScratchArena::allocate(size_t size, size_t alignment){
+	for(;;){
+		if(_current >= _blocks.size()){
+			Block block;
+			block.size = std::max(kArenaBlockSize, size + alignment);
+			block.data.reset(new char[block.size]);
+			_blocks.push_back(std::move(block));
+			_current = _blocks.size() - 1u;
+			_offset = 0u;
+		}
+		Block& block = _blocks[_current];
+		const uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+		const uintptr_t aligned = (base + _offset + alignment - 1u) & ~uintptr_t(alignment - 1u);
+		const size_t start = size_t(aligned - base);
+		if(start + size <= block.size){
+			_offset = start + size;
+			return block.data.get() + start;
+		}
+		// Move to the next block, or create a new one.
+		++_current;
+		_offset = 0u;
+	}
+}
+
+void ScratchArena::rewind(const Marker& marker){
+	_current = marker.block;
+	_offset = marker.offset;
+}
+
+size_t ScratchArena::capacity() const {
+	size_t total = 0u;
+	for(const Block& block : _blocks){
+		total += block.size;
+	}
+	return total;
+}
+
+TaskGroup::~TaskGroup(){
+	wait();
+}
+
+void TaskGroup::run(Task task){
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		++_pending;
+		if(_unresolved > 0){
+			_deferred.push_back(std::move(task));
+			return;
+		}
+	}
+	Scheduler::instance().push(std::move(task), this);
+}
+
+void TaskGroup::dependsOn(TaskGroup& dependency){
+	std::scoped_lock lock(_mutex, dependency._mutex);
+	if(dependency._pending == 0){
+		return;
+	}
+	++_unresolved;
+	dependency._dependents.push_back(this);
+}
+
+void TaskGroup::wait(){
+	while(!done()){
+		if(!Scheduler::runPendingTask()){
+			std::this_thread::yield();
+		}
+	}
+	// Ensure the thread that completed the group has released it.
+	std::lock_guard<std::mutex> lock(_mutex);
+}
+
+bool TaskGroup::done() const {
+	return _pending == 0 && _unresolved == 0;
+}
+
+void TaskGroup::taskFinished(){
+	std::vector<TaskGroup*> dependents;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if(--_pending == 0){
+			std::swap(dependents, _dependents);
+		}
+	}
+	for(TaskGroup* dependent : dependents){
+		dependent->dependencyResolved();
+	}
+}
+
+void TaskGroup::dependencyResolved(){
+	std::vector<Task> tasks;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if(--_unresolved == 0){
+			std::swap(tasks, _deferred);
+		}
+	}
+	// Deferred tasks are counted as pending, the group is still alive.
+	Scheduler& scheduler = Scheduler::instance();
+	for(Task& task : tasks){
+		scheduler.push(std::move(task), this);
+	}
+}
+
+Scheduler::Scheduler(size_t workers){
+	_queues.resize(workers + 1u);
+	for(std::unique_ptr<Queue>& queue : _queues){
+		queue = std::make_unique<Queue>();
+	}
+	_threads.reserve(workers);
+	for(size_t wid = 0; wid < workers; ++wid){
+		_threads.emplace_back(&Scheduler::workerLoop, this, wid + 1u);
+	}
+}
+
+Scheduler::~Scheduler(){
+	{
+		std::lock_guard<std::mutex> lock(_sleepMutex);
+		_running = false;
+	}
+	_wakeUp.notify_all();
+	for(std::thread& thread : _threads){
+		thread.join();
+	}
+}
+
+Scheduler& Scheduler::instance(){
+	// Always leave one thread free.
+	static Scheduler scheduler(size_t(std::max(int(std::thread::hardware_concurrency()) - 1, 1)));
+	return scheduler;
+}
+
+size_t Scheduler::workerCount(){
+	return instance()._threads.size();
+}
+
+ScratchArena& Scheduler::scratch(){
+	static thread_local ScratchArena arena;
+	return arena;
+}
+
+bool Scheduler::runPendingTask(){
+	Scheduler& scheduler = instance();
+	Item item;
+	if(!scheduler.pop(item)){
+		return false;
+	}
+	scheduler.execute(item);
+	return true;
+}
+
+void Scheduler::push(TaskGroup::Task&& task, TaskGroup* group){
+	++_queuedCount;
+	Queue& queue = *_queues[sQueueIndex];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.items.push_back({ std::move(task), group });
+	}
+	{
+		// Lock to avoid missing a worker about to sleep.
+		std::lock_guard<std::mutex> lock(_sleepMutex);
+	}
+	_wakeUp.notify_one();
+}
+
+bool Scheduler::pop(Item& item){
+	const size_t self = sQueueIndex;
+	const size_t queueCount = _queues.size();
+	// Own queue first, most recent task for locality.
+	{
+		Queue& queue = *_queues[self];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if(!queue.items.empty()){
+			item = std::move(queue.items.back());
+			queue.items.pop_back();
+			--_queuedCount;
+			return true;
+		}
+	}
+	// Then steal the oldest task of the other queues.
+	for(size_t i = 1; i < queueCount; ++i){
+		Queue& queue = *_queues[(self + i) % queueCount];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if(!queue.items.empty()){
+			item = std::move(queue.items.front());
+			queue.items.pop_front();
+			--_queuedCount;
+			return true;
+		}
+	}
+	return false;
+}
+
+void Scheduler::execute(Item& item){
+	// Tasks can be nested when waiting, restore the arena to its state before the task.
+	ScratchArena& arena = scratch();
+	const ScratchArena::Marker marker = arena.marker();
+	item.task();
+	arena.rewind(marker);
+	if(item.group){
+		item.group->taskFinished();
+	}
+}
+
+void Scheduler::workerLoop(size_t index){
+	sQueueIndex = index;
+	while(_running){
+		Item item;
+		if(pop(item)){
+			execute(item);
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(_sleepMutex);
+		_wakeUp.wait(lock, [this]{ return !_running || _queuedCount > 0; });
+	}
+}
+
+void Scheduler::parallelForRange(size_t low, size_t high, const RangeTask& task, size_t grain){
+	if(high <= low){
+		return;
+	}
+	const size_t count = high - low;
+	const size_t threadCount = workerCount() + 1u;
+	if(grain == 0){
+		grain = std::max(size_t(1), count / (threadCount * kChunksPerThread));
+	}
+	const size_t chunkCount = (count + grain - 1u) / grain;
+	if(chunkCount == 1){
+		task(low, high);
+		return;
+	}
+
+	// Each participant grabs the next chunk until the range is exhausted.
+	std::atomic<size_t> next{low};
+	auto processChunks = [&next, &task, grain, high](){
+		for(;;){
+			const size_t first = next.fetch_add(grain);
+			if(first >= high){
+				break;
+			}
+			task(first, std::min(first + grain, high));
+		}
+	};
+
+	TaskGroup group;
+	const size_t helperCount = std::min(threadCount - 1u, chunkCount - 1u);
+	for(size_t hid = 0; hid < helperCount; ++hid){
+		group.run(processChunks);
+	}
+	// The calling thread participates.
+	processChunks();
+	group.wait();
+}
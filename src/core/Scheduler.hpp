@@ -0,0 +1,222 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ \brief Linear allocator for short-lived temporary memory, one per thread.
+ Memory is kept between rewinds, so steady-state allocations are free.
+ \ingroup System
+ */
+class ScratchArena {
+public:
+
+	/** \brief Position in the arena, to rewind to. */
+	struct Marker {
+		size_t block = 0; ///< Block index.
+		size_t offset = 0; ///< Offset in the block.
+	};
+
+	/** Allocate memory, valid until the arena is rewound before this allocation.
+	 \param size the size in bytes
+	 \param alignment the required alignment, a power of two
+	 \return a pointer to the allocated memory
+	 */
+	void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+	/** Allocate an uninitialized array.
+	 \param count the number of elements
+	 \return a pointer to the first element
+	 */
+	template<typename T>
+	T* allocate(size_t count){
+		return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+	}
+
+	/** \return the current position in the arena */
+	Marker marker() const { return { _current, _offset }; }
+
+	/** Release all allocations performed after a given position.
+	 \param marker the position to go back to
+	 */
+	void rewind(const Marker& marker);
+
+	/** Release all allocations. */
+	void reset(){ rewind(Marker()); }
+
+	/** \return the total size of memory owned by the arena, in bytes */
+	size_t capacity() const;
+
+private:
+
+	/** \brief Contiguous chunk of memory. */
+	struct Block {
+		std::unique_ptr<char[]> data;
+		size_t size = 0;
+	};
+
+	std::vector<Block> _blocks; ///< Memory blocks.
+	size_t _current = 0; ///< Block currently allocated from.
+	size_t _offset = 0; ///< Offset in the current block.
+};
+
+class Scheduler;
+
+/**
+ \brief Set of tasks that can be waited on, and that can depend on the completion of other groups.
+ \ingroup System
+ */
+class TaskGroup {
+public:
+
+	using Task = std::function<void()>;
+
+	/** Constructor. */
+	TaskGroup() = default;
+
+	/** Destructor, waits for all tasks to complete. */
+	~TaskGroup();
+
+	/** Schedule a task, or defer it until all dependencies of the group are complete.
+	 \param task the task to run
+	 */
+	void run(Task task);
+
+	/** Defer the tasks of this group until another group has completed all its current tasks.
+	 \param dependency the group to wait for
+	 \note Call before submitting tasks to this group.
+	 */
+	void dependsOn(TaskGroup& dependency);
+
+	/** Wait for all tasks of the group to complete, executing pending tasks in the meantime. */
+	void wait();
+
+	/** \return true if all tasks submitted to the group are complete */
+	bool done() const;
+
+	TaskGroup(const TaskGroup&) = delete;
+	TaskGroup& operator=(const TaskGroup&) = delete;
+
+private:
+
+	friend class Scheduler;
+
+	/** Notify that a task of the group has completed. */
+	void taskFinished();
+
+	/** Notify that a group this group depends on has completed. */
+	void dependencyResolved();
+
+	std::mutex _mutex; ///< Protect deferred tasks and dependents.
+	std::atomic<size_t> _pending{0}; ///< Submitted tasks not yet complete, including deferred ones.
+	std::atomic<size_t> _unresolved{0}; ///< Dependencies not yet complete.
+	std::vector<Task> _deferred; ///< Tasks waiting for dependencies.
+	std::vector<TaskGroup*> _dependents; ///< Groups waiting for this one.
+};
+
+/**
+ \brief Process-wide pool of worker threads, each with its own task queue.
+ Idle workers steal tasks from the others, and threads waiting on a group execute pending tasks.
+ \ingroup System
+ */
+class Scheduler {
+public:
+
+	using RangeTask = std::function<void(size_t, size_t)>;
+
+	/** Multi-threaded for-loop on ranges, split dynamically in chunks.
+	 \param low lower (included) bound
+	 \param high higher (excluded) bound
+	 \param task the function to execute on each chunk, will receive the chunk bounds
+	 \param grain the chunk size, or 0 to select it based on the number of threads
+	 */
+	static void parallelForRange(size_t low, size_t high, const RangeTask& task, size_t grain = 0);
+
+	/** Multi-threaded for-loop, split dynamically in chunks.
+	 \param low lower (included) bound
+	 \param high higher (excluded) bound
+	 \param func the function to execute at each iteration, will receive the index of the element
+	 \param grain the chunk size, or 0 to select it based on the number of threads
+	 */
+	template<typename Func>
+	static void parallelFor(size_t low, size_t high, Func func, size_t grain = 0){
+		parallelForRange(low, high, [&func](size_t a, size_t b){
+			for(size_t i = a; i < b; ++i){
+				func(i);
+			}
+		}, grain);
+	}
+
+	/** \return the number of worker threads, not counting the calling thread */
+	static size_t workerCount();
+
+	/** \return the scratch arena of the calling thread, rewound after each task */
+	static ScratchArena& scratch();
+
+	/** Execute one pending task on the calling thread, if any.
+	 \return true if a task was executed
+	 */
+	static bool runPendingTask();
+
+	~Scheduler();
+
+private:
+
+	friend class TaskGroup;
+
+	/** \brief Scheduled task. */
+	struct Item {
+		TaskGroup::Task task;
+		TaskGroup* group = nullptr;
+	};
+
+	/** \brief Task queue, owners pop from the back and thieves from the front. */
+	struct Queue {
+		std::mutex mutex;
+		std::deque<Item> items;
+	};
+
+	/** Constructor.
+	 \param workers the number of worker threads to create
+	 */
+	explicit Scheduler(size_t workers);
+
+	/** \return the process-wide scheduler */
+	static Scheduler& instance();
+
+	/** Schedule a task on the queue of the calling thread.
+	 \param task the task
+	 \param group the group to notify on completion
+	 */
+	void push(TaskGroup::Task&& task, TaskGroup* group);
+
+	/** Retrieve a task, from the calling thread queue first and then from the others.
+	 \param item will contain the task
+	 \return true if a task was retrieved
+	 */
+	bool pop(Item& item);
+
+	/** Execute a task and notify its group.
+	 \param item the task to run
+	 */
+	void execute(Item& item);
+
+	/** Worker thread main loop.
+	 \param index the worker queue index
+	 */
+	void workerLoop(size_t index);
+
+	std::vector<std::unique_ptr<Queue>> _queues; ///< Queue 0 is shared by non-worker threads.
+	std::vector<std::thread> _threads; ///< Worker threads.
+	std::mutex _sleepMutex; ///< Idle workers synchronization.
+	std::condition_variable _wakeUp; ///< Signaled when tasks are available.
+	std::atomic<size_t> _queuedCount{0}; ///< Number of queued tasks.
+	std::atomic<bool> _running{true}; ///< Are workers running.
+};
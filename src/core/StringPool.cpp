@@ -0,0 +1,168 @@
+#include "core/StringPool.hpp"
+
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+/** \brief Pool entry, either an interned string or a composed name. */
+struct StringPoolEntry {
+	uint32_t prefix; ///< Composed names only.
+	uint32_t separator; ///< Composed names only.
+	uint32_t suffix; ///< Composed names only.
+	uint32_t string; ///< Index of the stored string, NO_STRING for composed names that haven't been displayed yet.
+};
+
+/** \brief Shared pool state. */
+struct StringPoolState {
+	/// Size of storage blocks, longer strings get their own block.
+	static const size_t BLOCK_SIZE = 64u * 1024u;
+	/// Marks composed names that don't have a stored string yet.
+	static const uint32_t NO_STRING = 0xFFFFFFFF;
+
+	std::mutex mutex; ///< Protect all members.
+	std::deque<std::unique_ptr<char[]>> blocks; ///< String storage, never reallocated.
+	size_t blockOffset = BLOCK_SIZE; ///< Current position in the last block.
+	size_t storageSize = 0u; ///< Total size of all blocks.
+	std::vector<StringPoolEntry> entries;
+	std::vector<const char*> stored; ///< Stored null-terminated strings.
+	std::unordered_map<std::string_view, uint32_t> strings; ///< Interned strings lookup, keys point into the blocks.
+	size_t composedCount = 0u;
+	size_t materializedCount = 0u;
+
+	StringPoolState(){
+		entries.push_back({ StringPool::EMPTY, StringPool::EMPTY, StringPool::EMPTY, 0u });
+		stored.push_back("");
+		strings[std::string_view()] = StringPool::EMPTY;
+	}
+
+	/** Copy a string in the blocks, adding a null terminator.
+	 \return the index of the stored string
+	 */
+	uint32_t store(std::string_view str){
+		const size_t size = str.size() + 1u;
+		char* dst = nullptr;
+		if(size > BLOCK_SIZE / 4u){
+			// Keep the current block for short strings.
+			dst = blocks.emplace_front(new char[size]).get();
+			storageSize += size;
+		} else {
+			if(blockOffset + size > BLOCK_SIZE){
+				blocks.emplace_back(new char[BLOCK_SIZE]);
+				blockOffset = 0u;
+				storageSize += BLOCK_SIZE;
+			}
+			dst = blocks.back().get() + blockOffset;
+			blockOffset += size;
+		}
+		std::memcpy(dst, str.data(), str.size());
+		dst[str.size()] = '\0';
+		stored.push_back(dst);
+		return (uint32_t)(stored.size() - 1u);
+	}
+
+	/** Append the string of an entry, recursively for composed names. */
+	void append(uint32_t id, std::string& dst) const {
+		const StringPoolEntry& entry = entries[id];
+		if(entry.string != NO_STRING){
+			dst.append(stored[entry.string]);
+			return;
+		}
+		append(entry.prefix, dst);
+		append(entry.separator, dst);
+		append(entry.suffix, dst);
+	}
+};
+
+static StringPoolState& state(){
+	static StringPoolState state;
+	return state;
+}
+
+uint32_t StringPool::intern(std::string_view str){
+	StringPoolState& pool = state();
+	std::lock_guard<std::mutex> lock(pool.mutex);
+	auto existing = pool.strings.find(str);
+	if(existing != pool.strings.end()){
+		return existing->second;
+	}
+	const uint32_t string = pool.store(str);
+	const uint32_t id = (uint32_t)pool.entries.size();
+	pool.entries.push_back({ EMPTY, EMPTY, EMPTY, string });
+	pool.strings[std::string_view(pool.stored[string], str.size())] = id;
+	return id;
+}
+
+uint32_t StringPool::compose(uint32_t prefix, uint32_t separator, uint32_t suffix){
+	StringPoolState& pool = state();
+	std::lock_guard<std::mutex> lock(pool.mutex);
+	if(prefix == EMPTY && separator == EMPTY && suffix == EMPTY){
+		return EMPTY;
+	}
+	// Composed names are usually unique (instance of a given mesh part), don't look for duplicates.
+	const uint32_t id = (uint32_t)pool.entries.size();
+	pool.entries.push_back({ prefix, separator, suffix, StringPoolState::NO_STRING });
+	++pool.composedCount;
+	return id;
+}
+
+bool StringPool::parts(uint32_t id, uint32_t& prefix, uint32_t& separator, uint32_t& suffix){
+	StringPoolState& pool = state();
+	std::lock_guard<std::mutex> lock(pool.mutex);
+	const StringPoolEntry& entry = pool.entries[id];
+	if(entry.prefix == EMPTY && entry.separator == EMPTY && entry.suffix == EMPTY){
+		return false;
+	}
+	prefix = entry.prefix;
+	separator = entry.separator;
+	suffix = entry.suffix;
+	return true;
+}
+
+std::string StringPool::str(uint32_t id){
+	StringPoolState& pool = state();
+	std::lock_guard<std::mutex> lock(pool.mutex);
+	std::string result;
+	pool.append(id, result);
+	return result;
+}
+
+const char* StringPool::c_str(uint32_t id){
+	StringPoolState& pool = state();
+	std::lock_guard<std::mutex> lock(pool.mutex);
+	if(pool.entries[id].string == StringPoolState::NO_STRING){
+		std::string result;
+		pool.append(id, result);
+		pool.entries[id].string = pool.store(result);
+		++pool.materializedCount;
+	}
+	return pool.stored[pool.entries[id].string];
+}
+
+StringPool::Statistics StringPool::statistics(){
+	StringPoolState& pool = state();
+	std::lock_guard<std::mutex> lock(pool.mutex);
+	Statistics stats;
+	stats.strings = pool.entries.size() - pool.composedCount;
+	stats.composed = pool.composedCount;
+	stats.materialized = pool.materializedCount;
+	// Approximate the lookup table size with one node and one bucket per string.
+	const size_t lookupSize = pool.strings.size() * (sizeof(std::string_view) + sizeof(uint32_t) + 2u * sizeof(void*))
+							+ pool.strings.bucket_count() * sizeof(void*);
+	stats.bytes = pool.storageSize + pool.entries.capacity() * sizeof(StringPoolEntry) + pool.stored.capacity() * sizeof(const char*) + lookupSize;
+	return stats;
+}
+
+Name Name::compose(Name prefix, Name separator, Name suffix){
+	Name name;
+	name._id = StringPool::compose(prefix._id, separator._id, suffix._id);
+	return name;
+}
+
+Name Name::compose(Name prefix, std::string_view separator, Name suffix){
+	return compose(prefix, Name(separator), suffix);
+}
+
+Name Name::compose(Name prefix, std::string_view separator, uint number){
+	return compose(prefix, separator, Name(std::to_string(number)));
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "core/Common.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ \brief Global pool of interned strings, each stored once and referenced by a compact identifier.
+ Names built from other names (prefix, separator, suffix) are stored as a triplet of identifiers and only
+ turned into a string when first displayed. The pool is thread-safe and never releases its strings, so
+ identifiers and returned pointers stay valid for the lifetime of the program.
+ \ingroup System
+ */
+class StringPool {
+public:
+
+	/// Identifier of the empty string.
+	static const uint32_t EMPTY = 0u;
+
+	/** \brief Pool memory usage. */
+	struct Statistics {
+		size_t strings; ///< Number of distinct interned strings.
+		size_t composed; ///< Number of composed names.
+		size_t materialized; ///< Number of composed names that have been turned into strings.
+		size_t bytes; ///< Total memory used by the pool, in bytes.
+	};
+
+	/** Intern a string, returning the existing identifier if it was already added.
+	 \param str the string
+	 \return the identifier
+	 */
+	static uint32_t intern(std::string_view str);
+
+	/** Register a name composed of two existing names and a separator, without building the string.
+	 \param prefix the prefix identifier
+	 \param separator the separator identifier
+	 \param suffix the suffix identifier
+	 \return the identifier of the composed name
+	 */
+	static uint32_t compose(uint32_t prefix, uint32_t separator, uint32_t suffix);
+
+	/** Retrieve the parts of a composed name.
+	 \param id the identifier
+	 \param prefix will contain the prefix identifier
+	 \param separator will contain the separator identifier
+	 \param suffix will contain the suffix identifier
+	 \return false if the identifier is an interned string
+	 */
+	static bool parts(uint32_t id, uint32_t& prefix, uint32_t& separator, uint32_t& suffix);
+
+	/** Build the string for an identifier, without storing it in the pool.
+	 \param id the identifier
+	 \return the string
+	 */
+	static std::string str(uint32_t id);
+
+	/** Retrieve a null-terminated string for an identifier, composed names are stored on first call.
+	 \param id the identifier
+	 \return the string, valid for the lifetime of the program
+	 */
+	static const char* c_str(uint32_t id);
+
+	/** \return the current pool memory usage */
+	static Statistics statistics();
+
+};
+
+/**
+ \brief Compact handle to a string stored in the global string pool.
+ \ingroup System
+ */
+class Name {
+public:
+
+	/** Empty name. */
+	Name() = default;
+
+	/** Intern a string.
+	 \param str the string
+	 */
+	explicit Name(std::string_view str) : _id(StringPool::intern(str)) {}
+
+	/** Create a name composed of two names joined by a separator, the string is only built when needed.
+	 \param prefix the first part
+	 \param separator the name inserted between both parts
+	 \param suffix the second part
+	 \return the composed name
+	 */
+	static Name compose(Name prefix, Name separator, Name suffix);
+
+	/** Create a name composed of two names joined by a separator, the string is only built when needed.
+	 \param prefix the first part
+	 \param separator the string inserted between both parts
+	 \param suffix the second part
+	 \return the composed name
+	 */
+	static Name compose(Name prefix, std::string_view separator, Name suffix);
+
+	/** Create a name composed of a name and a number joined by a separator, the string is only built when needed.
+	 \param prefix the first part
+	 \param separator the string inserted between both parts
+	 \param number the number to append
+	 \return the composed name
+	 */
+	static Name compose(Name prefix, std::string_view separator, uint number);
+
+	/** \return a copy of the string */
+	std::string str() const { return StringPool::str(_id); }
+
+	/** \return the null-terminated string, valid for the lifetime of the program */
+	const char* c_str() const { return StringPool::c_str(_id); }
+
+	/** \return true if the name is empty */
+	bool empty() const { return _id == StringPool::EMPTY; }
+
+	/** \return the pool identifier */
+	uint32_t id() const { return _id; }
+
+private:
+
+	uint32_t _id = StringPool::EMPTY; ///< Pool identifier.
+};
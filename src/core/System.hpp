@@ -5,9 +5,10 @@
 
 namespace fs = ghc::filesystem;
 
+#include "core/Scheduler.hpp"
+
 #include <pugixml/pugixml.hpp>
 #include <string>
-#include <thread>
 #include <vector>
 
 namespace System {
@@ -28,7 +29,7 @@ namespace System {
 
 	uint32_t hash32( const void* data, size_t size );
 
-	/** Multi-threaded for-loop.
+	/** Multi-threaded for-loop, executed by the process-wide scheduler.
 		 \param low lower (included) bound
 		 \param high higher (excluded) bound
 		 \param func the function to execute at each iteration, will receive the index of the
@@ -39,33 +40,9 @@ namespace System {
 	static void forParallel(size_t low, size_t high, ThreadFunc func) {
 		// Make sure the loop is increasing.
 		if(high < low) {
-			const size_t temp = low;
-			low				  = high;
-			high			  = temp;
-		}
-		// Prepare the threads pool.
-		// Always leave one thread free.
-		const size_t count = size_t(std::max(int(std::thread::hardware_concurrency())-1, 1));
-		std::vector<std::thread> threads;
-		threads.reserve(count);
-
-		// Compute the span of each thread.
-		const size_t span = std::max(size_t(1), (high - low) / count);
-		// Helper to execute the function passed on a subset of the total interval.
-		auto launchThread = [&func](size_t a, size_t b) {
-			for(size_t i = a; i < b; ++i) {
-				func(i);
-			}
-		};
-
-		for(size_t tid = 0; tid < count; ++tid) {
-			// For each thread, call the same lambda with different bounds as arguments.
-			const size_t threadLow  = tid * span;
-			const size_t threadHigh = tid == (count-1) ? high : ((tid + 1) * span);
-			threads.emplace_back(launchThread, threadLow, threadHigh);
+			std::swap(low, high);
 		}
-		// Wait for all threads to finish.
-		std::for_each(threads.begin(), threads.end(), [](std::thread & x) { x.join(); });
+		Scheduler::parallelFor(low, high, func);
 	}
 
 }
@@ -1,5 +1,7 @@
 #include "core/TextUtilities.hpp"
 #include <sstream>
+#include <cstdlib>
+#include <cstring>
 
 std::string TextUtilities::trim(const std::string & str, const std::string & del) {
 	const size_t firstNotDel = str.find_first_not_of(del);
@@ -46,26 +48,28 @@ void TextUtilities::replace(std::string & source, const std::string & fromChars,
 	}
 }
 
-bool TextUtilities::hasPrefix(const std::string & source, const std::string & prefix) {
+void TextUtilities::replace(std::string & source, char fromChar, char toChar) {
+	std::replace(source.begin(), source.end(), fromChar, toChar);
+}
+
+bool TextUtilities::hasPrefix(std::string_view source, std::string_view prefix) {
 	if(prefix.empty() || source.empty()) {
 		return false;
 	}
 	if(prefix.size() > source.size()) {
 		return false;
 	}
-	const std::string sourcePrefix = source.substr(0, prefix.size());
-	return sourcePrefix == prefix;
+	return source.substr(0, prefix.size()) == prefix;
 }
 
-bool TextUtilities::hasSuffix(const std::string & source, const std::string & suffix) {
+bool TextUtilities::hasSuffix(std::string_view source, std::string_view suffix) {
 	if(suffix.empty() || source.empty()) {
 		return false;
 	}
 	if(suffix.size() > source.size()) {
 		return false;
 	}
-	const std::string sourceSuffix = source.substr(source.size() - suffix.size(), suffix.size());
-	return sourceSuffix == suffix;
+	return source.substr(source.size() - suffix.size(), suffix.size()) == suffix;
 }
 
 std::string TextUtilities::join(const std::vector<std::string> & tokens, const std::string & delimiter){
@@ -137,3 +141,91 @@ std::string TextUtilities::uppercase(const std::string & src){
 	});
 	return dst;
 }
+
+TextUtilities::Tokenizer::Tokenizer(std::string_view str, char delimiter, bool skipEmpty) :
+	_str(str), _delimiter(delimiter), _skipEmpty(skipEmpty) {
+}
+
+bool TextUtilities::Tokenizer::next(std::string_view & token){
+	// As with split, a trailing delimiter doesn't produce an empty token.
+	while(_pos < _str.size()){
+		size_t end = _str.find(_delimiter, _pos);
+		if(end == std::string_view::npos){
+			end = _str.size();
+		}
+		token = _str.substr(_pos, end - _pos);
+		_pos = end + 1;
+		if(!_skipEmpty || !token.empty()){
+			return true;
+		}
+	}
+	return false;
+}
+
+std::string_view TextUtilities::trimView(std::string_view str, std::string_view del){
+	const size_t firstNotDel = str.find_first_not_of(del);
+	if(firstNotDel == std::string_view::npos) {
+		return std::string_view();
+	}
+	const size_t lastNotDel = str.find_last_not_of(del);
+	return str.substr(firstNotDel, lastNotDel - firstNotDel + 1);
+}
+
+static unsigned char lowercaseChar(unsigned char c){
+	return (c >= 'A' && c <= 'Z') ? (c - 'A' + 'a') : c;
+}
+
+bool TextUtilities::equalsIgnoreCase(std::string_view a, std::string_view b){
+	if(a.size() != b.size()){
+		return false;
+	}
+	for(size_t i = 0; i < a.size(); ++i){
+		if(lowercaseChar(a[i]) != lowercaseChar(b[i])){
+			return false;
+		}
+	}
+	return true;
+}
+
+size_t TextUtilities::hashIgnoreCase(std::string_view str){
+	// FNV-1a on lowercase characters.
+	uint64_t hash = 14695981039346656037ull;
+	for(const char c : str){
+		hash ^= lowercaseChar(c);
+		hash *= 1099511628211ull;
+	}
+	return size_t(hash);
+}
+
+bool TextUtilities::parseFloat(std::string_view str, float & value){
+	// strtof needs a null-terminated string, copy to the stack.
+	char buffer[64];
+	if(str.empty() || str.size() >= sizeof(buffer)){
+		return false;
+	}
+	memcpy(buffer, str.data(), str.size());
+	buffer[str.size()] = '\0';
+	char* end = nullptr;
+	const float result = std::strtof(buffer, &end);
+	if(end == buffer){
+		return false;
+	}
+	value = result;
+	return true;
+}
+
+bool TextUtilities::parseUint(std::string_view str, uint & value){
+	str = trimView(str, " \t\r\n");
+	if(str.empty()){
+		return false;
+	}
+	uint result = 0;
+	for(const char c : str){
+		if(c < '0' || c > '9'){
+			return false;
+		}
+		result = result * 10u + uint(c - '0');
+	}
+	value = result;
+	return true;
+}
@@ -2,6 +2,8 @@
 
 #include "core/Common.hpp"
 
+#include <string_view>
+
 /**
  \brief Provides utilities process strings.
  \ingroup System
@@ -42,19 +44,26 @@ public:
 	 */
 	static void replace(std::string & source, const std::string & fromChars, const char toChar);
 
+	/** Replace all occurences of a character by another character in a string, in place.
+	 \param source the string in which substitutions should happen
+	 \param fromChar character to replace
+	 \param toChar new character to insert
+	 */
+	static void replace(std::string & source, char fromChar, char toChar);
+
 	/** Test if a string is a prefix of another string.
 	 \param source the string to examine
 	 \param prefix the prefix string to test
 	 \return true if the prefix is here
 	 */
-	static bool hasPrefix(const std::string & source, const std::string & prefix);
+	static bool hasPrefix(std::string_view source, std::string_view prefix);
 
 	/** Test if a string is a suffix of another string.
 	 \param source the string to examine
 	 \param suffix the suffix string to test
 	 \return true if the suffix is here
 	 */
-	static bool hasSuffix(const std::string & source, const std::string & suffix);
+	static bool hasSuffix(std::string_view source, std::string_view suffix);
 	
 	/** Join a list of strings together using a custom delimiter.
 	 \param tokens the list of strings to join
@@ -87,5 +96,74 @@ public:
 
 	static std::string lowercase(const std::string & src);
 	static std::string uppercase(const std::string & src);
-	
+
+	/** \brief Iterate over the tokens of a string separated by a delimiter, without copying them.
+	 Tokens are produced in the same way as split, and are views into the original string.
+	 */
+	class Tokenizer {
+	public:
+		/** Constructor.
+		 \param str the string to split, should outlive the tokenizer and its tokens
+		 \param delimiter the character used as a splitting point
+		 \param skipEmpty should empty tokens be ignored
+		 */
+		Tokenizer(std::string_view str, char delimiter, bool skipEmpty);
+
+		/** Retrieve the next token.
+		 \param token will contain the token
+		 \return true if a token was found, false at the end of the string
+		 */
+		bool next(std::string_view & token);
+
+	private:
+		std::string_view _str; ///< The string to split.
+		size_t _pos = 0; ///< Start of the next token.
+		char _delimiter; ///< Splitting character.
+		bool _skipEmpty; ///< Ignore empty tokens.
+	};
+
+	/** Trim characters from both ends of a string, without copying it.
+	 \param str the string to trim from
+	 \param del the characters to delete
+	 \return a view of the trimmed string
+	 */
+	static std::string_view trimView(std::string_view str, std::string_view del);
+
+	/** Compare two strings, ignoring the case of ASCII letters.
+	 \param a first string
+	 \param b second string
+	 \return true if the strings are equal
+	 */
+	static bool equalsIgnoreCase(std::string_view a, std::string_view b);
+
+	/** Hash a string, ignoring the case of ASCII letters.
+	 \param str the string to hash
+	 \return the hash, identical for strings that are equal ignoring case
+	 */
+	static size_t hashIgnoreCase(std::string_view str);
+
+	/** \brief Case-insensitive hash functor, for unordered containers. */
+	struct CaseInsensitiveHash {
+		size_t operator()(std::string_view str) const { return hashIgnoreCase(str); }
+	};
+
+	/** \brief Case-insensitive equality functor, for unordered containers. */
+	struct CaseInsensitiveEqual {
+		bool operator()(std::string_view a, std::string_view b) const { return equalsIgnoreCase(a, b); }
+	};
+
+	/** Parse a floating point number from a string, without copying it to the heap.
+	 \param str the string to parse
+	 \param value will contain the number if successful
+	 \return true if a number was parsed
+	 */
+	static bool parseFloat(std::string_view str, float & value);
+
+	/** Parse an unsigned integer from a string of decimal digits.
+	 \param str the string to parse
+	 \param value will contain the number if successful
+	 \return true if a number was parsed
+	 */
+	static bool parseUint(std::string_view str, uint & value);
+
 };
@@ -0,0 +1,202 @@
+#include "core/TextureArrayPlanner.hpp"
+#include "core/Log.hpp"
+
+/** \brief Textures sharing a size and format. */
+struct TextureGroup {
+	uint width;
+	uint height;
+	uint levels;
+	Image::Compression format;
+	std::vector<uint> textures;
+};
+
+static size_t groupSize(const TextureGroup& group){
+	size_t layerSize = 0u;
+	for(uint mid = 0u; mid < group.levels; ++mid){
+		layerSize += TextureArrayPlanner::imageSize(std::max(group.width >> mid, 1u), std::max(group.height >> mid, 1u), group.format);
+	}
+	return layerSize * group.textures.size();
+}
+
+size_t TextureArrayPlanner::imageSize(uint width, uint height, Image::Compression format){
+	if(format == Image::Compression::NONE){
+		// Uploaded as RGBA8.
+		return size_t(width) * size_t(height) * 4u;
+	}
+	// 4x4 blocks of 8 bytes for BC1, 16 bytes for BC2 and BC3.
+	const size_t blockSize = format == Image::Compression::BC1 ? 8u : 16u;
+	return size_t((width + 3u) / 4u) * size_t((height + 3u) / 4u) * blockSize;
+}
+
+TextureArrayPlanner::Plan TextureArrayPlanner::plan(const std::vector<Texture>& textures, const Settings& settings){
+
+	const uint textureCount = (uint)textures.size();
+	std::vector<uint> skipped(textureCount, 0u);
+	auto remainingLevels = [&textures, &skipped](uint tid){
+		return textures[tid].levels - skipped[tid];
+	};
+
+	// Start with one group per exact size and format, in order of first use.
+	std::vector<TextureGroup> groups;
+	for(uint tid = 0u; tid < textureCount; ++tid){
+		const Texture& tex = textures[tid];
+		auto group = std::find_if(groups.begin(), groups.end(), [&tex](const TextureGroup& other){
+			return other.width == tex.width && other.height == tex.height && other.format == tex.format;
+		});
+		if(group == groups.end()){
+			groups.push_back({ tex.width, tex.height, tex.levels, tex.format, {} });
+			group = groups.end() - 1;
+		}
+		group->levels = std::min(group->levels, tex.levels);
+		group->textures.push_back(tid);
+	}
+
+	// Move outliers to groups of smaller textures, until the number of groups is small enough.
+	while(settings.downsample && settings.maxArrays != 0u && groups.size() > settings.maxArrays){
+		size_t bestSource = groups.size();
+		size_t bestTarget = groups.size();
+		uint bestShift = 0u;
+		for(size_t sid = 0u; sid < groups.size(); ++sid){
+			const TextureGroup& source = groups[sid];
+			for(size_t did = 0u; did < groups.size(); ++did){
+				const TextureGroup& target = groups[did];
+				if(did == sid || target.format != source.format || target.width >= source.width){
+					continue;
+				}
+				// Is the target a mip level of the source?
+				uint shift = 1u;
+				while((source.width >> shift) > target.width){
+					++shift;
+				}
+				if((source.width >> shift) != target.width || (source.height >> shift) != target.height){
+					continue;
+				}
+				// All textures should keep at least as many levels as the target array, to avoid truncating it.
+				bool compatible = true;
+				for(const uint tid : source.textures){
+					if(remainingLevels(tid) < target.levels + shift){
+						compatible = false;
+						break;
+					}
+				}
+				if(!compatible){
+					continue;
+				}
+				// Prefer moving few textures by a small amount, to the most used group.
+				bool better = bestSource == groups.size();
+				if(!better){
+					const TextureGroup& best = groups[bestSource];
+					if(source.textures.size() != best.textures.size()){
+						better = source.textures.size() < best.textures.size();
+					} else if(shift != bestShift){
+						better = shift < bestShift;
+					} else {
+						better = target.textures.size() > groups[bestTarget].textures.size();
+					}
+				}
+				if(better){
+					bestSource = sid;
+					bestTarget = did;
+					bestShift = shift;
+				}
+			}
+		}
+		if(bestSource == groups.size()){
+			Log::warning("Texture arrays: unable to merge below %u arrays.", (uint)groups.size());
+			break;
+		}
+		TextureGroup& target = groups[bestTarget];
+		for(const uint tid : groups[bestSource].textures){
+			skipped[tid] += bestShift;
+			target.textures.push_back(tid);
+		}
+		groups.erase(groups.begin() + bestSource);
+	}
+
+	// Drop the top level of the largest groups until the budget is met.
+	size_t totalSize = 0u;
+	for(const TextureGroup& group : groups){
+		totalSize += groupSize(group);
+	}
+	while(settings.budget != 0u && totalSize > settings.budget){
+		size_t largest = groups.size();
+		size_t largestSize = 0u;
+		for(size_t gid = 0u; gid < groups.size(); ++gid){
+			const size_t size = groupSize(groups[gid]);
+			// Keep at least a full compression block.
+			const bool canShrink = groups[gid].levels > 1u && std::min(groups[gid].width, groups[gid].height) > 4u;
+			if(canShrink && size > largestSize){
+				largest = gid;
+				largestSize = size;
+			}
+		}
+		if(largest == groups.size()){
+			Log::warning("Texture arrays: unable to fit in %.1fMB.", double(settings.budget) / (1024.0 * 1024.0));
+			break;
+		}
+		TextureGroup& group = groups[largest];
+		group.width = std::max(group.width >> 1u, 1u);
+		group.height = std::max(group.height >> 1u, 1u);
+		group.levels -= 1u;
+		for(const uint tid : group.textures){
+			skipped[tid] += 1u;
+		}
+		// Merge with a group that now has the same size.
+		for(size_t gid = 0u; gid < groups.size(); ++gid){
+			TextureGroup& other = groups[gid];
+			if(gid != largest && other.width == group.width && other.height == group.height && other.format == group.format){
+				if(group.levels < other.levels){
+					// Layers of an array share the same mip chain.
+					Log::warning("Texture arrays: merging %u textures reduces the mip chain of %ux%u array from %u to %u levels.",
+								 (uint)group.textures.size(), other.width, other.height, other.levels, group.levels);
+				}
+				other.levels = std::min(other.levels, group.levels);
+				other.textures.insert(other.textures.end(), group.textures.begin(), group.textures.end());
+				groups.erase(groups.begin() + largest);
+				break;
+			}
+		}
+		totalSize = 0u;
+		for(const TextureGroup& other : groups){
+			totalSize += groupSize(other);
+		}
+	}
+
+	// Final arrays and placements.
+	Plan result;
+	result.placements.resize(textureCount);
+	for(const TextureGroup& group : groups){
+		const uint arrayIndex = (uint)result.arrays.size();
+		Array& array = result.arrays.emplace_back();
+		array.width = group.width;
+		array.height = group.height;
+		array.levels = group.levels;
+		array.format = group.format;
+		array.textures = group.textures;
+		array.bytes = groupSize(group);
+		result.bytes += array.bytes;
+		for(uint lid = 0u; lid < (uint)group.textures.size(); ++lid){
+			const uint tid = group.textures[lid];
+			result.placements[tid] = { arrayIndex, lid, skipped[tid] };
+			result.downsampledCount += skipped[tid] != 0u ? 1u : 0u;
+		}
+	}
+	return result;
+}
+
+void TextureArrayPlanner::log(const Plan& plan, const Plan& reference){
+	static const char* formatNames[] = { "RGBA8", "BC1", "BC2", "BC3" };
+	const double toMB = 1.0 / (1024.0 * 1024.0);
+	for(uint aid = 0u; aid < (uint)plan.arrays.size(); ++aid){
+		const Array& array = plan.arrays[aid];
+		uint downsampled = 0u;
+		for(const uint tid : array.textures){
+			downsampled += plan.placements[tid].skippedLevels != 0u ? 1u : 0u;
+		}
+		Log::info("\t* array %u: %ux%u %s, %u layers (%u downsampled), %u levels, %.2fMB (%.1f%%)", aid, array.width, array.height,
+				  formatNames[uint(array.format)], (uint)array.textures.size(), downsampled, array.levels, double(array.bytes) * toMB,
+				  plan.bytes != 0u ? 100.0 * double(array.bytes) / double(plan.bytes) : 0.0);
+	}
+	Log::info("Texture arrays: %u arrays, %.2fMB, %u textures downsampled (exact layout: %u arrays, %.2fMB).", (uint)plan.arrays.size(),
+			  double(plan.bytes) * toMB, plan.downsampledCount, (uint)reference.arrays.size(), double(reference.bytes) * toMB);
+}
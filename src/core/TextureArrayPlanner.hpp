@@ -0,0 +1,76 @@
+#pragma once
+#include "core/Common.hpp"
+#include "core/Image.hpp"
+
+/**
+ \brief Group 2D textures into a bounded number of texture arrays, within a memory budget.
+ Textures can only share an array if they have the same format and size. A texture can be moved to an array of
+ smaller textures by skipping its top mip levels, as long as it keeps as many levels as the array. The same
+ skipping is applied to whole arrays when the memory budget is exceeded.
+ \ingroup Resources
+ */
+class TextureArrayPlanner {
+public:
+
+	/** \brief Description of a texture to place. */
+	struct Texture {
+		uint width; ///< Width of the first level.
+		uint height; ///< Height of the first level.
+		uint levels; ///< Number of available mip levels.
+		Image::Compression format; ///< Data format.
+	};
+
+	/** \brief Planning options. */
+	struct Settings {
+		uint maxArrays = 0u; ///< Maximum number of arrays, 0 for no limit.
+		size_t budget = 0u; ///< Maximum total size in bytes, 0 for no limit.
+		bool downsample = true; ///< Allow textures to skip top levels to join an array of smaller textures.
+	};
+
+	/** \brief Texture array to create. */
+	struct Array {
+		uint width = 0u; ///< Width of the first level.
+		uint height = 0u; ///< Height of the first level.
+		uint levels = 0u; ///< Number of mip levels, the minimum available across layers.
+		Image::Compression format = Image::Compression::NONE; ///< Data format.
+		std::vector<uint> textures; ///< Texture stored in each layer.
+		size_t bytes = 0u; ///< Total size of the array.
+	};
+
+	/** \brief Location of a texture. */
+	struct Placement {
+		uint array = 0u; ///< Array index.
+		uint layer = 0u; ///< Layer in the array.
+		uint skippedLevels = 0u; ///< Number of top levels of the texture that are not stored.
+	};
+
+	/** \brief Result of the planning. */
+	struct Plan {
+		std::vector<Array> arrays; ///< Arrays to create.
+		std::vector<Placement> placements; ///< Location of each input texture.
+		size_t bytes = 0u; ///< Total size of all arrays.
+		uint downsampledCount = 0u; ///< Number of textures stored with skipped levels.
+	};
+
+	/** Place textures in arrays.
+	 \param textures the textures to place
+	 \param settings the planning options
+	 \return the plan
+	 */
+	static Plan plan(const std::vector<Texture>& textures, const Settings& settings);
+
+	/** Size of a single image.
+	 \param width the image width
+	 \param height the image height
+	 \param format the data format
+	 \return the size in bytes
+	 */
+	static size_t imageSize(uint width, uint height, Image::Compression format);
+
+	/** Log the content of each array, and compare the plan with another one.
+	 \param plan the plan to describe
+	 \param reference the plan to compare to
+	 */
+	static void log(const Plan& plan, const Plan& reference);
+
+};
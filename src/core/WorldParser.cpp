@@ -5,10 +5,15 @@
 #include "core/DFFParser.hpp"
 #include "core/GameCode.hpp"
 #include "core/Common.hpp"
+#include "core/Profiler.hpp"
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/euler_angles.hpp>
 #include <unordered_map>
+#include <chrono>
+#include <atomic>
+#include <cstddef>
+#include <fstream>
 
 // Fix up data
 
@@ -23,20 +28,81 @@ static const std::unordered_map<std::string, std::string> dffFileSubstitutions =
 		{"galet_pouf_b", "galet_pouf"},
 };
 
-void applyWorldFixups(std::string& content){
-	TextUtilities::replace(content, "\"count=", "\" count=");
-	TextUtilities::replace(content, "<param name=\"scale\" data=\"string\">data_", "<param name=\"scale\" data=\"string\">data_");
+// Track the memory allocated by XML documents, for reporting.
+static std::atomic<size_t> sXmlMemory{0};
+static const size_t kXmlHeaderSize = alignof(std::max_align_t);
+
+static void* xmlAllocate(size_t size){
+	char* ptr = static_cast<char*>(malloc(size + kXmlHeaderSize));
+	if(ptr == nullptr){
+		return nullptr;
+	}
+	*reinterpret_cast<size_t*>(ptr) = size;
+	sXmlMemory.fetch_add(size, std::memory_order_relaxed);
+	return ptr + kXmlHeaderSize;
+}
+
+static void xmlDeallocate(void* ptr){
+	if(ptr == nullptr){
+		return;
+	}
+	char* base = static_cast<char*>(ptr) - kXmlHeaderSize;
+	sXmlMemory.fetch_sub(*reinterpret_cast<size_t*>(base), std::memory_order_relaxed);
+	free(base);
+}
+
+static bool sXmlMemoryTracking = false;
+
+// Load a world file in a buffer.
+static bool loadWorldBuffer(const fs::path& path, std::vector<char>& buffer){
+	std::ifstream inputFile(path, std::ios::binary | std::ios::ate);
+	if(inputFile.bad() || inputFile.fail()) {
+		return false;
+	}
+	const size_t fileSize = size_t(inputFile.tellg());
+	// Leave room for fixups that insert characters, to avoid reallocating.
+	buffer.reserve(fileSize + fileSize / 256u + 16u);
+	buffer.resize(fileSize);
+	inputFile.seekg(0, std::ios::beg);
+	inputFile.read(buffer.data(), fileSize);
+	return size_t(inputFile.gcount()) == fileSize;
+}
+
+// Fix known syntax errors in a single pass over the content, valid content is left untouched.
+static void applyWorldFixups(std::vector<char>& buffer){
+	// Some attributes are missing a separating space: "count=
+	const std::string_view pattern = "\"count=";
+	std::vector<size_t> insertions;
+	const std::string_view content(buffer.data(), buffer.size());
+	for(size_t pos = content.find(pattern); pos != std::string_view::npos; pos = content.find(pattern, pos + pattern.size())){
+		insertions.push_back(pos + 1u);
+	}
+	if(insertions.empty()){
+		return;
+	}
+	// Shift segments backwards from the end, inserting a space at each position.
+	const size_t oldSize = buffer.size();
+	buffer.resize(oldSize + insertions.size());
+	size_t end = oldSize;
+	size_t shift = insertions.size();
+	for(size_t iid = insertions.size(); iid > 0; --iid){
+		const size_t pos = insertions[iid - 1u];
+		memmove(buffer.data() + pos + shift, buffer.data() + pos, end - pos);
+		--shift;
+		buffer[pos + shift] = ' ';
+		end = pos;
+	}
 }
 
 // World
 
 //#define LOG_WORLD_LOADING
 
-World::Instance::Instance(const std::string& _name, uint _object, const glm::mat4& _frame, float _heat) :
+World::Instance::Instance(Name _name, uint _object, const glm::mat4& _frame, float _heat) :
 	frame(_frame), name(_name), object(_object), heat(_heat){
 
 }
-World::Camera::Camera(const std::string& _name, const glm::mat4& _frame, float _fov) :
+World::Camera::Camera(Name _name, const glm::mat4& _frame, float _fov) :
 	frame(_frame), name(_name), fov(_fov){
 
 }
@@ -75,7 +141,7 @@ World::World(const Object& object){
 		}
 	}
 
-	_instances.emplace_back(object.name, 0, glm::mat4(1.0f));
+	_instances.emplace_back(Name(object.name), 0, glm::mat4(1.0f));
 
 	// Default zone.
 	BoundingBox bbox;
@@ -108,43 +174,96 @@ World::World(const Object& object){
 	
 	light.frame = glm::inverse(view);
 	light.color = glm::vec3(1.0f);
-	light.name = "Default";
+	light.name = Name("Default");
 	light.radius = glm::vec3(glm::length(bbox.getSize()));
 	light.angle = 0.0f;
 	light.shadow = true;
 	light.material = Object::Material::NO_MATERIAL;
 }
 
-std::string getEntityAttribute(const pugi::xml_node& entity, const char* key){
+/** \brief Index of the named parameters of an XML node, to avoid repeated linear scans of its children. */
+class ParamIndex {
+public:
+
+	/** Constructor, indexes all children with a name attribute.
+	 \param node the node to index
+	 */
+	explicit ParamIndex(const pugi::xml_node& node){
+		for(const auto& child : node.children()){
+			const char* name = child.attribute("name").value();
+			if(name[0] != '\0'){
+				_entries.push_back({ name, child });
+			}
+		}
+		// Keep document order for duplicates, lookups return the first one.
+		std::stable_sort(_entries.begin(), _entries.end(), [](const Entry& a, const Entry& b){
+			return strcmp(a.name, b.name) < 0;
+		});
+	}
+
+	/** Find a parameter.
+	 \param name the parameter name
+	 \return the first child with this name, or an empty node
+	 */
+	pugi::xml_node find(const char* name) const {
+		const auto it = std::lower_bound(_entries.begin(), _entries.end(), name, [](const Entry& a, const char* b){
+			return strcmp(a.name, b) < 0;
+		});
+		if(it == _entries.end() || strcmp(it->name, name) != 0){
+			return pugi::xml_node();
+		}
+		return it->node;
+	}
+
+	/** Find the value of a parameter.
+	 \param name the parameter name
+	 \return the parameter content, or an empty string
+	 */
+	const char* value(const char* name) const {
+		return find(name).child_value();
+	}
+
+private:
+
+	/** \brief Named child. */
+	struct Entry {
+		const char* name;
+		pugi::xml_node node;
+	};
+
+	std::vector<Entry> _entries; ///< Children sorted by name.
+};
+
+std::string getEntityAttribute(const pugi::xml_node& entity, const ParamIndex& params, const char* key){
 	std::string val = entity.attribute(key).value();
 	if(!val.empty()){
 		return TextUtilities::lowercase(val);
 	}
-	val = entity.find_child_by_attribute("name", key).child_value();
+	val = params.value(key);
 	if(!val.empty()){
 		return TextUtilities::lowercase(val);
 	}
 	return "";
 }
 
-const char* getLightAttribute(const pugi::xml_node& parent, const pugi::xml_node& child, const char* key){
-	const char* valStr = child.find_child_by_attribute("name", key).child_value();
+const char* getLightAttribute(const ParamIndex& parent, const ParamIndex& child, const char* key){
+	const char* valStr = child.value(key);
 	if(!valStr || valStr[0] == '\0'){
-		valStr = parent.find_child_by_attribute("name", key).child_value();
+		valStr = parent.value(key);
 	}
 	return valStr;
 }
 
-bool isEntityVisible(const pugi::xml_node& entity){
-	const char* boolVal = entity.find_child_by_attribute("name", "visible").child_value();
+bool isEntityVisible(const ParamIndex& params){
+	const char* boolVal = params.value("visible");
 	return Area::parseBool(boolVal, true);
 }
 
 
-glm::mat4 getEntityFrame(const pugi::xml_node& entity){
-	const char* objPosStr = entity.find_child_by_attribute("name", "position").child_value();
-	const char* objRotStr = entity.find_child_by_attribute("name", "rotation").child_value();
-	const char* objScaStr = entity.find_child_by_attribute("name", "scale").child_value();
+glm::mat4 getEntityFrame(const ParamIndex& params){
+	const char* objPosStr = params.value("position");
+	const char* objRotStr = params.value("rotation");
+	const char* objScaStr = params.value("scale");
 	const glm::vec3 position = Area::parseVec3(objPosStr);
 	const glm::vec3 rotAngles = Area::parseVec3(objRotStr) / 180.0f * glm::pi<float>();
 	const glm::vec3 scale = Area::parseVec3(objScaStr, glm::vec3(1.0f));
@@ -165,16 +284,21 @@ std::string getMaterialTexture(const std::string& inMaterialStr, const fs::path&
 	}
 
 	std::string materialStr(inMaterialStr);
-	TextUtilities::replace(materialStr, "\\", "/");
-	materialStr = TextUtilities::trim(materialStr, "/");
-
-	const fs::path materialPath = materialStr;
-	const std::string extension = TextUtilities::lowercase(materialPath.filename().extension().string());
+	TextUtilities::replace(materialStr, '\\', '/');
+	const std::string_view materialView = TextUtilities::trimView(materialStr, "/");
+
+	const fs::path materialPath = materialView;
+	// Extension of the file name, if any.
+	std::string_view extension;
+	const size_t extPos = materialView.find_last_of("./");
+	if(extPos != std::string_view::npos && materialView[extPos] == '.'){
+		extension = materialView.substr(extPos);
+	}
 	// Two possibilities: either a texture file, or a material definition.
 	// In both cases we want to retrieve a non-empty texture name.
 	std::string textureName;
 
-	if(extension == ".mtl"){
+	if(TextUtilities::equalsIgnoreCase(extension, ".mtl")){
 		// Load the mtl XML file.
 		fs::path mtlPath = resourcePath / materialPath;
 		pugi::xml_document mtlDef;
@@ -202,15 +326,15 @@ std::string getMaterialTexture(const std::string& inMaterialStr, const fs::path&
 			// Extract texture name, assume it is unique.
 			std::string textureStr = frame.attribute("sourcename").value();
 			if(!textureStr.empty()){
-				TextUtilities::replace(textureStr, "\\", "/");
-				const fs::path texturePath = TextUtilities::trim(textureStr, "/");
+				TextUtilities::replace(textureStr, '\\', '/');
+				const fs::path texturePath = TextUtilities::trimView(textureStr, "/");
 				textureName = texturePath.filename().replace_extension().string();
 			}
 		} else {
 			Log::error("Unable to load mtl file at path %s", mtlPath.string().c_str());
 		}
 
-	} else if(extension == ".tga" || extension == ".dds" || extension == ".png"){
+	} else if(TextUtilities::equalsIgnoreCase(extension, ".tga") || TextUtilities::equalsIgnoreCase(extension, ".dds") || TextUtilities::equalsIgnoreCase(extension, ".png")){
 		textureName = materialPath.filename().replace_extension().string();
 	}
 	return textureName;
@@ -258,48 +382,49 @@ void World::processFxDef(const pugi::xml_document& fxDef, const std::string& bas
 	   <param name="regenrate" data="real">400.000</param>
 		*/
 
-		const char* emitterTypeStr = emitter.find_child_by_attribute("name", "type").child_value();
+		const ParamIndex params(emitter);
+		const char* emitterTypeStr = params.value("type");
 		const int emitterType = Area::parseInt(emitterTypeStr, 0);
-		const char* blendingStr = emitter.find_child_by_attribute("name", "blending").child_value();
+		const char* blendingStr = params.value("blending");
 		const int blending = Area::parseInt(blendingStr, 0);
-		const char* particleTypeStr = emitter.find_child_by_attribute("name", "particletype").child_value();
+		const char* particleTypeStr = params.value("particletype");
 		const int particleType = Area::parseInt(particleTypeStr, 0);
 
-		std::string materialStr = emitter.find_child_by_attribute("name", "material").child_value();
+		std::string materialStr = params.value("material");
 		materialStr = TextUtilities::trim(materialStr, "\"");
 		const std::string textureName = getMaterialTexture(materialStr, resourcePath);
 		const uint materialId = registerTextureMaterial(Object::Material::PARTICLE, textureName);
 
-		const char* minDimStr =  emitter.find_child_by_attribute("name", "dimension_min").child_value();
-		const char* maxDimStr =  emitter.find_child_by_attribute("name", "dimension_max").child_value();
+		const char* minDimStr =  params.value("dimension_min");
+		const char* maxDimStr =  params.value("dimension_max");
 		const glm::vec3 minDim = Area::parseVec3(minDimStr, glm::vec3(0.f));
 		const glm::vec3 maxDim = Area::parseVec3(maxDimStr, glm::vec3(0.f));
 
-		const char* minColorStr =  emitter.find_child_by_attribute("name", "color_min").child_value();
-		const char* maxColorStr =  emitter.find_child_by_attribute("name", "color_max").child_value();
+		const char* minColorStr =  params.value("color_min");
+		const char* maxColorStr =  params.value("color_max");
 		const glm::vec4 minColor = Area::parseVec4(minColorStr, glm::vec4(1.f));
 		const glm::vec4 maxColor = Area::parseVec4(maxColorStr, glm::vec4(1.f));
 
-		const char* tankSizeStr = emitter.find_child_by_attribute("name", "tanksize").child_value();
+		const char* tankSizeStr = params.value("tanksize");
 		const int tankSize = Area::parseInt(tankSizeStr, 1);
 
-		const char* sizeStr =  emitter.find_child_by_attribute("name", "size").child_value();
+		const char* sizeStr =  params.value("size");
 		const glm::vec2 size = Area::parseVec2(sizeStr, glm::vec2(1.f));
 
-		const char* angleStr =  emitter.find_child_by_attribute("name", "angle").child_value();
+		const char* angleStr =  params.value("angle");
 		const glm::vec2 angle = Area::parseVec2(angleStr, glm::vec2(0.f));
 
-		const char* velocityStr =  emitter.find_child_by_attribute("name", "velocity").child_value();
+		const char* velocityStr =  params.value("velocity");
 		const glm::vec2 velocity = Area::parseVec2(velocityStr, glm::vec2(0.f));
 
-		const char* radiusStr = emitter.find_child_by_attribute("name", "radius").child_value();
+		const char* radiusStr = params.value("radius");
 		const float radius = Area::parseFloat(radiusStr, 0.0);
 
-		const char* rateStr = emitter.find_child_by_attribute("name", "regenrate").child_value();
+		const char* rateStr = params.value("regenrate");
 		const float rate = Area::parseFloat(rateStr, 1.0);
 
 		Emitter& fx = _particles.emplace_back();
-		fx.name = baseName + "_emitter_" + std::to_string(i);
+		fx.name = Name::compose(Name(baseName), "_emitter_", i);
 		fx.frame = frame;
 		fx.material = materialId;
 		fx.bbox = BoundingBox(minDim, maxDim);
@@ -322,22 +447,26 @@ void World::processFxDef(const pugi::xml_document& fxDef, const std::string& bas
 		++i;
 
 		const glm::vec3 sizes = fx.bbox.getSize();
-		Log::verbose("Emitter %s: %d,%d,%d %fx%fx%f, %s", fx.name.c_str(), emitterType, blending, particleType, sizes[0], sizes[1], sizes[2], textureName.c_str());
+		Log::verbose("Emitter %s: %d,%d,%d %fx%fx%f, %s", fx.name.str().c_str(), emitterType, blending, particleType, sizes[0], sizes[1], sizes[2], textureName.c_str());
 
 	}
 }
 
 void World::processEntity(const pugi::xml_node& entity, const glm::mat4& globalFrame, bool templated, const fs::path& resourcePath, ObjectReferenceList& objectRefs, EntityFrameList& entitiesList){
 
-	const std::string type = getEntityAttribute(entity, "type");
+	const ParamIndex params(entity);
+	const std::string type = getEntityAttribute(entity, params, "type");
 	if(type.empty()){
 		return;
 	}
 
-	const std::string objName = getEntityAttribute(entity, "name");
+	const std::string objName = getEntityAttribute(entity, params, "name");
 	glm::mat4 frame = globalFrame;
 
-	pugi::xml_node linkedEntity = entity.find_child_by_attribute("param", "name", "link");
+	pugi::xml_node linkedEntity = params.find("link");
+	if(linkedEntity && strcmp(linkedEntity.name(), "param") != 0){
+		linkedEntity = entity.find_child_by_attribute("param", "name", "link");
+	}
 	if(linkedEntity){
 		std::string linkedEntityName(linkedEntity.child_value());
 		linkedEntityName = TextUtilities::lowercase(linkedEntityName);
@@ -355,7 +484,7 @@ void World::processEntity(const pugi::xml_node& entity, const glm::mat4& globalF
 	// Skip the local frame for the main element of a template.
 	bool useLocalFrame = !templated || linkedEntity;
 	if(useLocalFrame){
-		glm::mat4 localFrame = getEntityFrame(entity);
+		glm::mat4 localFrame = getEntityFrame(params);
 		frame = frame * localFrame;
 	}
 
@@ -369,8 +498,8 @@ void World::processEntity(const pugi::xml_node& entity, const glm::mat4& globalF
 
 	// Special case for lights
 	if(type == "light"){
-		const char* mdlPosStr = entity.find_child_by_attribute("name", "modelPosition").child_value();
-		const char* mdlRotStr = entity.find_child_by_attribute("name", "modelRotation").child_value();
+		const char* mdlPosStr = params.value("modelPosition");
+		const char* mdlRotStr = params.value("modelRotation");
 
 		const glm::vec3 mdlPosition = Area::parseVec3(mdlPosStr);
 		const glm::vec3 mdlRotAngles = Area::parseVec3(mdlRotStr) / 180.0f * glm::pi<float>();
@@ -381,19 +510,19 @@ void World::processEntity(const pugi::xml_node& entity, const glm::mat4& globalF
 
 		frame = frame * mdlFrame;
 	} else if(type == "camera"){
-		const char* cam2DRotStr = entity.find_child_by_attribute("name", "cameraInitialRotation").child_value();
+		const char* cam2DRotStr = params.value("cameraInitialRotation");
 		const glm::vec2 cam2DRot = Area::parseVec2(cam2DRotStr); // Conversion to radians will be done below.
 		glm::mat4 mdlFrame = GameCode::cameraRotationMatrix(cam2DRot[0], cam2DRot[1]);
 		frame = frame * mdlFrame;
 
-		const std::string uiName = entity.find_child_by_attribute("name", "uiName").child_value();
+		const std::string uiName = params.value("uiName");
 		const std::string camName = !uiName.empty() ? std::string(uiName) : (!objName.empty() ? objName : "Unknown camera");
-		const char* fovStr = entity.find_child_by_attribute("name", "fov").child_value();
+		const char* fovStr = params.value("fov");
 		float fov = ((fovStr && fovStr[0] != '\0') ? std::stof(fovStr) : 45.0f) * glm::pi<float>() / 180.0f;
 		// Adjust the frame, putting the viewpoint at the front of the default camera.
 		glm::mat4 renderFrame = frame * glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -2.75f, 11.0f));
 		// Store the camera
-		_cameras.emplace_back(camName, renderFrame, fov);
+		_cameras.emplace_back(Name(camName), renderFrame, fov);
 	}
 
 
@@ -411,7 +540,7 @@ void World::processEntity(const pugi::xml_node& entity, const glm::mat4& globalF
 	if(type == "particle" || type == "fx"){
 		// Two types of FX
 
-		const char* fxTypeStr = entity.find_child_by_attribute("name", "fxType").child_value();
+		const char* fxTypeStr = params.value("fxType");
 		const int fxType = Area::parseInt(fxTypeStr, 0);
 
 		if(fxType == 9){
@@ -421,30 +550,30 @@ void World::processEntity(const pugi::xml_node& entity, const glm::mat4& globalF
 			// 1 is rotate around X ? (la_croisee)
 			// 2 is track camera fully? (see emitters)
 			// 3 is rotate around Y (ct03_06)
-			const char* billboardTypeStr = entity.find_child_by_attribute("name", "billboardType").child_value();
+			const char* billboardTypeStr = params.value("billboardType");
 			const int billboardType = Area::parseInt(billboardTypeStr, 0);
 			// Blending 1 is additive. 2 could be multiply. 3 is alpha blend. 0 could be opaque.
-			const char* blendingStr = entity.find_child_by_attribute("name", "blending").child_value();
+			const char* blendingStr = params.value("blending");
 			const int blending = Area::parseInt(blendingStr, 0);
 
-			const char* widthStr = entity.find_child_by_attribute("name", "width").child_value();
+			const char* widthStr = params.value("width");
 			const float width = Area::parseFloat(widthStr, 1.f);
-			const char* heightStr = entity.find_child_by_attribute("name", "height").child_value();
+			const char* heightStr = params.value("height");
 			const float height = Area::parseFloat(heightStr, 1.f);
 
-			const char* colorStr = entity.find_child_by_attribute("name", "color").child_value();
-			if(!colorStr){
+			const char* colorStr = params.value("color");
+			if(colorStr[0] == '\0'){
 				// Typo found in some files
-				colorStr = entity.find_child_by_attribute("name", " color").child_value();
+				colorStr = params.value(" color");
 			}
 			const glm::vec3 color = Area::parseVec3(colorStr, glm::vec3(1.0f));
 
-			const std::string materialStr = getEntityAttribute(entity, "material");
+			const std::string materialStr = getEntityAttribute(entity, params, "material");
 			const std::string textureName = getMaterialTexture(materialStr, resourcePath);
 			const uint materialId = registerTextureMaterial(Object::Material::BILLBOARD, textureName);
 
 			Billboard& fx = _billboards.emplace_back();
-			fx.name = objName + "_" + textureName;
+			fx.name = Name::compose(Name(objName), "_", Name(textureName));
 			fx.frame = frame;
 			fx.material = materialId;
 			fx.size = glm::vec2( width, height );
@@ -457,14 +586,14 @@ void World::processEntity(const pugi::xml_node& entity, const glm::mat4& globalF
 		} else if(fxType == 7){
 			// System
 			// Immediately retrieve fxDef path.
-			std::string fxDefStr = getEntityAttribute(entity, "sourceName");
-			TextUtilities::replace(fxDefStr, "\\", "/");
-			fxDefStr = TextUtilities::trim(fxDefStr, "/");
-			if(fxDefStr.empty()){
+			std::string fxDefStr = getEntityAttribute(entity, params, "sourceName");
+			TextUtilities::replace(fxDefStr, '\\', '/');
+			const std::string_view fxDefView = TextUtilities::trimView(fxDefStr, "/");
+			if(fxDefView.empty()){
 				return;
 			}
 			// Load the FXDEF XML file.
-			const fs::path fxDefPath = resourcePath / fxDefStr;
+			const fs::path fxDefPath = resourcePath / fxDefView;
 			std::string fxDefContent = System::loadString(fxDefPath);
 			if(fxDefContent.empty()){
 				return;
@@ -487,25 +616,26 @@ void World::processEntity(const pugi::xml_node& entity, const glm::mat4& globalF
 	if(type == "light"){
 		// Some lights have a child named "light".
 		const pugi::xml_node lightChild =  entity.child("light");
+		const ParamIndex lightParams(lightChild);
 		// Retrieve type.
 		std::string lightTypeStr = lightChild.attribute("type").value();
 		if(lightTypeStr.empty()){
-			lightTypeStr = entity.find_child_by_attribute("name", "lightType").child_value();
+			lightTypeStr = params.value("lightType");
 		}
 		const int lightType = Area::parseInt(lightTypeStr.c_str(), 1);
 		Log::check(lightType >= 1 && lightType <= 3, "Unexpected type for light %s", objName.c_str());
 
 		Light& light = _lights.emplace_back();
 		light.frame = entityFrame;
-		light.name = objName;
+		light.name = Name(objName);
 		light.type = (Light::Type)lightType;
 
-		light.color = Area::parseVec3(getLightAttribute(entity, lightChild, "color"), glm::vec3(1.0f));
-		light.radius = Area::parseVec3(getLightAttribute(entity, lightChild, "radius"), glm::vec3(10000.0f));
+		light.color = Area::parseVec3(getLightAttribute(params, lightParams, "color"), glm::vec3(1.0f));
+		light.radius = Area::parseVec3(getLightAttribute(params, lightParams, "radius"), glm::vec3(10000.0f));
 
-		const char* coneTypeStr = getLightAttribute(entity, lightChild, "coneAngle");
+		const char* coneTypeStr = getLightAttribute(params, lightParams, "coneAngle");
 		if(!coneTypeStr || coneTypeStr[0] == '\0'){
-			coneTypeStr = getLightAttribute(entity, lightChild, "cone angle");
+			coneTypeStr = getLightAttribute(params, lightParams, "cone angle");
 		}
 		light.angle = (float)(Area::parseInt(coneTypeStr)) * glm::pi<float>() / 180.0f * 0.5f;
 		// Fallback based on radii if angle is null for a spotlight.
@@ -517,20 +647,20 @@ void World::processEntity(const pugi::xml_node& entity, const glm::mat4& globalF
 			light.angle = std::max( angles.x, angles.y );
 			light.type = Light::POINT;
 		}
-		const char* shadowStr = getLightAttribute(entity, lightChild, "shadow");
+		const char* shadowStr = getLightAttribute(params, lightParams, "shadow");
 		light.shadow = Area::parseBool(shadowStr);
 
-		const std::string materialStr = getLightAttribute(entity, lightChild, "material");
+		const std::string materialStr = getLightAttribute(params, lightParams, "material");
 		const std::string textureName = getMaterialTexture(materialStr, resourcePath);
 		light.material = registerTextureMaterial(Object::Material::LIGHT, textureName);
 	}
 
-	std::string objPathStr = getEntityAttribute(entity, "sourceName");
+	std::string objPathStr = getEntityAttribute(entity, params, "sourceName");
 	// Camera model has a few options including  default fallback.
 	if(type == "camera"){
-		objPathStr = entity.find_child_by_attribute("name", "cameramodel").child_value();
+		objPathStr = params.value("cameramodel");
 		if(objPathStr.empty()){
-			objPathStr = entity.find_child_by_attribute("name", "cameraModel").child_value();
+			objPathStr = params.value("cameraModel");
 		}
 		if(objPathStr.empty()){
 			objPathStr = "models\\objets\\cameras\\camera.dff";
@@ -542,12 +672,12 @@ void World::processEntity(const pugi::xml_node& entity, const glm::mat4& globalF
 		return;
 
 	// Cleanup model path.
-	TextUtilities::replace(objPathStr, "\\", "/");
+	TextUtilities::replace(objPathStr, '\\', '/');
 	fs::path objPath = TextUtilities::lowercase(objPathStr);
 	objPath.replace_extension("dff");
 
 	// Parse heat if it exists.
-	const std::string heatStr = getEntityAttribute(entity, "heat");
+	const std::string heatStr = getEntityAttribute(entity, params, "heat");
 	const float heat = Area::parseFloat(heatStr.c_str(), 0.f);
 
 	// Has this model already been encountered?
@@ -555,7 +685,7 @@ void World::processEntity(const pugi::xml_node& entity, const glm::mat4& globalF
 		const uint objCount = (uint)objectRefs.size();
 		objectRefs[objPath] = objCount;
 	}
-	_instances.emplace_back(objName, objectRefs[objPath], frame, heat);
+	_instances.emplace_back(Name(objName), objectRefs[objPath], frame, heat);
 
 #ifdef LOG_WORLD_LOADING
 	Log::info("Actor: %s", objName);
@@ -564,21 +694,41 @@ void World::processEntity(const pugi::xml_node& entity, const glm::mat4& globalF
 
 }
 
-bool World::load(const fs::path& path, const fs::path& resourcePath){
+void World::trackXmlMemory(){
+	pugi::set_memory_management_functions(&xmlAllocate, &xmlDeallocate);
+	sXmlMemoryTracking = true;
+}
 
+bool World::load(const fs::path& path, const fs::path& resourcePath){
+	PROFILE_SCOPE("World::load");
+
+	const auto parseStart = std::chrono::steady_clock::now();
+	// The document references the buffer content, both should be kept alive.
+	std::vector<char> worldContent;
+	if(!loadWorldBuffer(path, worldContent)){
+		Log::error("Unable to load world file at path %s", path.string().c_str());
+		return false;
+	}
+	const size_t xmlMemoryBefore = sXmlMemory.load();
 	pugi::xml_document world;
-	pugi::xml_parse_result res = world.load_file(path.c_str());
+	// No whitespace, comments or declaration nodes, and no end-of-line normalization.
+	const unsigned int parseFlags = pugi::parse_minimal | pugi::parse_escapes | pugi::parse_cdata;
+	// Patch the broken syntax found in some files before parsing, so the file is read and parsed once.
+	applyWorldFixups(worldContent);
+	const pugi::xml_parse_result res = world.load_buffer_inplace(worldContent.data(), worldContent.size(), parseFlags);
 	if(!res){
-		// Attempt to load the string content, apply a few fixups, and reparse.
-		std::string worldContent = System::loadString(path);
-		if(!worldContent.empty()){
-			applyWorldFixups(worldContent);
-			res = world.load_string(worldContent.c_str());
-		}
-		if(!res){
-			Log::error("Unable to load world file at path %s:%llu %s", path.string().c_str(), res.offset, res.description());
-			return false;
-		}
+		Log::error("Unable to load world file at path %s:%llu %s", path.string().c_str(), res.offset, res.description());
+		return false;
+	}
+	const auto parseEnd = std::chrono::steady_clock::now();
+	const double parseDuration = std::chrono::duration<double, std::milli>(parseEnd - parseStart).count();
+	if(sXmlMemoryTracking){
+		const size_t xmlMemory = sXmlMemory.load() - xmlMemoryBefore;
+		Log::info("World %s: parsed %.2fMB in %.2fms, document uses %.2fMB.", path.filename().string().c_str(),
+				  double(worldContent.size()) / (1024.0 * 1024.0), parseDuration, double(xmlMemory) / (1024.0 * 1024.0));
+	} else {
+		Log::info("World %s: parsed %.2fMB in %.2fms.", path.filename().string().c_str(),
+				  double(worldContent.size()) / (1024.0 * 1024.0), parseDuration);
 	}
 
 	_name = path.filename().replace_extension().string();
@@ -588,22 +738,26 @@ bool World::load(const fs::path& path, const fs::path& resourcePath){
 
 	const auto& items = world.child("World").child("scene").child("entities").children();
 
+	const auto entitiesStart = std::chrono::steady_clock::now();
+	size_t entityCount = 0;
 	for(const auto& item : items){
 		if(strcmp(item.name(), "entity") == 0){
 			processEntity(item, glm::mat4(1.0f), false, resourcePath, referencedObjects, entitiesList);
+			++entityCount;
 			continue;
 		}
 		if(strcmp(item.name(), "instance") == 0){
-			const std::string name = getEntityAttribute(item, "name");
-			glm::mat4 frame = getEntityFrame(item);
+			const ParamIndex params(item);
+			const std::string name = getEntityAttribute(item, params, "name");
+			glm::mat4 frame = getEntityFrame(params);
 			entitiesList[name] = frame;
 
 			//if(!isEntityVisible(item)){
 			//	continue;
 			//}
 
-			std::string xmlFile = item.find_child_by_attribute("name", "template").child_value();
-			TextUtilities::replace(xmlFile, "\\", "/");
+			std::string xmlFile = params.value("template");
+			TextUtilities::replace(xmlFile, '\\', '/');
 			const fs::path xmlPath = resourcePath / xmlFile;
 
 			pugi::xml_document templateDef;
@@ -618,10 +772,15 @@ bool World::load(const fs::path& path, const fs::path& resourcePath){
 			EntityFrameList templateEntitiesList;
 			for(const auto& entity : entities.children("entity")){
 				processEntity(entity, frame, true, resourcePath, referencedObjects, templateEntitiesList);
+				++entityCount;
 			}
 			continue;
 		}
 	}
+	const auto entitiesEnd = std::chrono::steady_clock::now();
+	// Includes template files loading.
+	Log::info("World %s: processed %lu entities in %.2fms.", _name.c_str(), entityCount,
+			  std::chrono::duration<double, std::milli>(entitiesEnd - entitiesStart).count());
 
 	/// Objects loading.
 	// Create objects from reference list.
@@ -645,6 +804,8 @@ bool World::load(const fs::path& path, const fs::path& resourcePath){
 	}
 
 	/// Areas loading.
+	// Portals of each area, to link once all zones are known.
+	std::vector<std::pair<uint, Area::Portal>> areaPortals;
 	const auto& areas = world.child("World").child("scene").child("areas");
 	for(const auto& area : areas.children()){
 
@@ -652,7 +813,7 @@ bool World::load(const fs::path& path, const fs::path& resourcePath){
 		const char* areaPathStr = area.attribute("sourceName").value();
 		// Cleanup model path.
 		std::string areaPathStrUp(areaPathStr);
-		TextUtilities::replace(areaPathStrUp, "\\", "/");
+		TextUtilities::replace(areaPathStrUp, '\\', '/');
 		areaPathStrUp = TextUtilities::lowercase(areaPathStrUp);
 
 		const fs::path areaPath = resourcePath / areaPathStrUp;
@@ -660,11 +821,15 @@ bool World::load(const fs::path& path, const fs::path& resourcePath){
 #ifdef LOG_WORLD_LOADING
 		Log::info("Area: %s", areaName.c_str());
 #endif
-		if(!Area::load(areaPath, _objects.emplace_back())){
+		std::vector<Area::Portal> portals;
+		if(!Area::load(areaPath, _objects.emplace_back(), &portals)){
 			_objects.pop_back();
 			continue;
 		}
-		_instances.emplace_back(areaName, ( uint )_objects.size()-1, glm::mat4(1.0f));
+		for(const Area::Portal& portal : portals){
+			areaPortals.emplace_back((uint)_zones.size(), portal);
+		}
+		_instances.emplace_back(Name(areaName), ( uint )_objects.size()-1, glm::mat4(1.0f));
 
 		// Parse postprocess infos.
 		Zone& zone = _zones.emplace_back();
@@ -676,16 +841,60 @@ bool World::load(const fs::path& path, const fs::path& resourcePath){
 			zone.bbox.merge(pos);
 		}
 		// Other information.
-		const char* ambientStr = area.find_child_by_attribute("name", "ambientColor").child_value();
-		const char* fogColorStr = area.find_child_by_attribute("name", "fogColor").child_value();
-		const char* fogParamsStr = area.find_child_by_attribute("name", "hfogParams").child_value();
-		const char* fogDensityStr = area.find_child_by_attribute("name", "fogDensity").child_value();
+		const ParamIndex params(area);
+		const char* ambientStr = params.value("ambientColor");
+		const char* fogColorStr = params.value("fogColor");
+		const char* fogParamsStr = params.value("hfogParams");
+		const char* fogDensityStr = params.value("fogDensity");
 		zone.ambientColor = Area::parseVec4(ambientStr);
 		zone.fogColor = Area::parseVec4(fogColorStr);
 		zone.fogParams = Area::parseVec4(fogParamsStr);
 		zone.fogDensity = Area::parseFloat(fogDensityStr);
 	}
 
+	/// Portals linking.
+	// The zone on the other side of a portal is the closest other zone, as portals lie on zone boundaries.
+	const float portalTolerance = 50.0f;
+	for(const auto& areaPortal : areaPortals){
+		const uint zoneId = areaPortal.first;
+		const Area::Portal& portal = areaPortal.second;
+		uint otherId = Portal::NO_ZONE;
+		float bestDistance = portalTolerance;
+		for(uint zid = 0; zid < _zones.size(); ++zid){
+			if(zid == zoneId){
+				continue;
+			}
+			const float distance = _zones[zid].bbox.distance(portal.center);
+			if(distance <= bestDistance){
+				bestDistance = distance;
+				otherId = zid;
+			}
+		}
+		if(otherId == Portal::NO_ZONE){
+			Log::verbose("Unable to find the zone on the other side of portal %s.", portal.name.c_str());
+			continue;
+		}
+		// Both areas often define the same portal.
+		bool duplicate = false;
+		for(const Portal& existing : _portals){
+			const bool sameZones = (existing.zones[0] == otherId && existing.zones[1] == zoneId) || (existing.zones[0] == zoneId && existing.zones[1] == otherId);
+			if(sameZones && glm::length(existing.center - portal.center) < portalTolerance){
+				duplicate = true;
+				break;
+			}
+		}
+		if(duplicate){
+			continue;
+		}
+		Portal& newPortal = _portals.emplace_back();
+		newPortal.polygon = portal.polygon;
+		newPortal.normal = portal.normal;
+		newPortal.center = portal.center;
+		newPortal.name = portal.name;
+		newPortal.zones[0] = zoneId;
+		newPortal.zones[1] = otherId;
+	}
+
 	/// Empty objects cleanup.
 	// Remove empty objects, and update instance indices.
 	const uint objCount = ( uint )_objects.size();
@@ -774,3 +983,236 @@ bool World::load(const fs::path& path, const fs::path& resourcePath){
 
 	return true;
 }
+
+// Packed world content, names are stored separately.
+
+struct PackedCamera {
+	glm::mat4 frame;
+	float fov;
+};
+
+struct PackedLight {
+	glm::mat4 frame;
+	glm::vec3 color;
+	glm::vec3 radius;
+	float angle;
+	uint material;
+	uint type;
+	uint shadow;
+};
+
+struct PackedZone {
+	BoundingBox bbox;
+	glm::vec4 ambientColor;
+	glm::vec4 fogColor;
+	glm::vec4 fogParams;
+	float fogDensity;
+};
+
+struct PackedPortal {
+	glm::vec3 normal;
+	glm::vec3 center;
+	uint zones[2];
+	uint firstVertex;
+	uint vertexCount;
+};
+
+struct PackedEmitter {
+	BoundingBox bbox;
+	glm::mat4 frame;
+	glm::vec4 colorMin;
+	glm::vec4 colorMax;
+	glm::vec2 sizeRange;
+	glm::vec2 velocityRange;
+	glm::vec2 angleRange;
+	uint maxCount;
+	uint material;
+	uint type;
+	float radius;
+	float rate;
+	uint alignment;
+	uint blending;
+};
+
+struct PackedBillboard {
+	glm::mat4 frame;
+	glm::vec3 color;
+	glm::vec2 size;
+	uint material;
+	uint alignment;
+	uint blending;
+};
+
+void World::save(ScenePack::Writer& pack) const {
+	pack.addStrings(ScenePack::WORLD_NAME, { _name });
+
+	std::vector<PackedCamera> cameras;
+	std::vector<Name> cameraNames;
+	for(const Camera& camera : _cameras){
+		cameras.push_back({ camera.frame, camera.fov });
+		cameraNames.push_back(camera.name);
+	}
+	pack.addCopy(ScenePack::WORLD_CAMERAS, cameras);
+	pack.addNames(ScenePack::WORLD_CAMERA_NAMES, ScenePack::WORLD_CAMERA_NAME_PARTS, cameraNames);
+
+	std::vector<PackedLight> lights;
+	std::vector<Name> lightNames;
+	for(const Light& light : _lights){
+		lights.push_back({ light.frame, light.color, light.radius, light.angle, light.material, uint(light.type), uint(light.shadow) });
+		lightNames.push_back(light.name);
+	}
+	pack.addCopy(ScenePack::WORLD_LIGHTS, lights);
+	pack.addNames(ScenePack::WORLD_LIGHT_NAMES, ScenePack::WORLD_LIGHT_NAME_PARTS, lightNames);
+
+	std::vector<PackedZone> zones;
+	std::vector<std::string> zoneNames;
+	for(const Zone& zone : _zones){
+		zones.push_back({ zone.bbox, zone.ambientColor, zone.fogColor, zone.fogParams, zone.fogDensity });
+		zoneNames.push_back(zone.name);
+	}
+	pack.addCopy(ScenePack::WORLD_ZONES, zones);
+	pack.addStrings(ScenePack::WORLD_ZONE_NAMES, zoneNames);
+
+	std::vector<PackedPortal> portals;
+	std::vector<std::string> portalNames;
+	std::vector<glm::vec3> portalPolygons;
+	for(const Portal& portal : _portals){
+		portals.push_back({ portal.normal, portal.center, { portal.zones[0], portal.zones[1] }, (uint)portalPolygons.size(), (uint)portal.polygon.size() });
+		portalNames.push_back(portal.name);
+		portalPolygons.insert(portalPolygons.end(), portal.polygon.begin(), portal.polygon.end());
+	}
+	pack.addCopy(ScenePack::WORLD_PORTALS, portals);
+	pack.addStrings(ScenePack::WORLD_PORTAL_NAMES, portalNames);
+	pack.addCopy(ScenePack::WORLD_PORTAL_POLYGONS, portalPolygons);
+
+	std::vector<PackedEmitter> emitters;
+	std::vector<Name> emitterNames;
+	for(const Emitter& emitter : _particles){
+		emitters.push_back({ emitter.bbox, emitter.frame, emitter.colorMin, emitter.colorMax, emitter.sizeRange, emitter.velocityRange, emitter.angleRange,
+			emitter.maxCount, emitter.material, emitter.type, emitter.radius, emitter.rate, uint(emitter.alignment), uint(emitter.blending) });
+		emitterNames.push_back(emitter.name);
+	}
+	pack.addCopy(ScenePack::WORLD_EMITTERS, emitters);
+	pack.addNames(ScenePack::WORLD_EMITTER_NAMES, ScenePack::WORLD_EMITTER_NAME_PARTS, emitterNames);
+
+	std::vector<PackedBillboard> billboards;
+	std::vector<Name> billboardNames;
+	for(const Billboard& billboard : _billboards){
+		billboards.push_back({ billboard.frame, billboard.color, billboard.size, billboard.material, uint(billboard.alignment), uint(billboard.blending) });
+		billboardNames.push_back(billboard.name);
+	}
+	pack.addCopy(ScenePack::WORLD_BILLBOARDS, billboards);
+	pack.addNames(ScenePack::WORLD_BILLBOARD_NAMES, ScenePack::WORLD_BILLBOARD_NAME_PARTS, billboardNames);
+}
+
+bool World::load(const ScenePack& pack){
+	*this = World();
+
+	std::vector<std::string> names;
+	if(!pack.readStrings(ScenePack::WORLD_NAME, names) || names.size() != 1){
+		return false;
+	}
+	_name = names[0];
+	std::vector<Name> entityNames;
+
+	std::vector<PackedCamera> cameras;
+	if(!pack.read(ScenePack::WORLD_CAMERAS, cameras) || !pack.readNames(ScenePack::WORLD_CAMERA_NAMES, ScenePack::WORLD_CAMERA_NAME_PARTS, entityNames) || entityNames.size() != cameras.size()){
+		return false;
+	}
+	for(size_t i = 0; i < cameras.size(); ++i){
+		_cameras.emplace_back(entityNames[i], cameras[i].frame, cameras[i].fov);
+	}
+
+	std::vector<PackedLight> lights;
+	if(!pack.read(ScenePack::WORLD_LIGHTS, lights) || !pack.readNames(ScenePack::WORLD_LIGHT_NAMES, ScenePack::WORLD_LIGHT_NAME_PARTS, entityNames) || entityNames.size() != lights.size()){
+		return false;
+	}
+	for(size_t i = 0; i < lights.size(); ++i){
+		const PackedLight& packed = lights[i];
+		Light& light = _lights.emplace_back();
+		light.frame = packed.frame;
+		light.color = packed.color;
+		light.radius = packed.radius;
+		light.name = entityNames[i];
+		light.angle = packed.angle;
+		light.material = packed.material;
+		light.type = Light::Type(packed.type);
+		light.shadow = packed.shadow != 0;
+	}
+
+	std::vector<PackedZone> zones;
+	if(!pack.read(ScenePack::WORLD_ZONES, zones) || !pack.readStrings(ScenePack::WORLD_ZONE_NAMES, names) || names.size() != zones.size()){
+		return false;
+	}
+	for(size_t i = 0; i < zones.size(); ++i){
+		const PackedZone& packed = zones[i];
+		Zone& zone = _zones.emplace_back();
+		zone.bbox = packed.bbox;
+		zone.ambientColor = packed.ambientColor;
+		zone.fogColor = packed.fogColor;
+		zone.fogParams = packed.fogParams;
+		zone.name = names[i];
+		zone.fogDensity = packed.fogDensity;
+	}
+
+	std::vector<PackedPortal> portals;
+	std::vector<glm::vec3> portalPolygons;
+	if(!pack.read(ScenePack::WORLD_PORTALS, portals) || !pack.readStrings(ScenePack::WORLD_PORTAL_NAMES, names) || names.size() != portals.size()
+	   || !pack.read(ScenePack::WORLD_PORTAL_POLYGONS, portalPolygons)){
+		return false;
+	}
+	for(size_t i = 0; i < portals.size(); ++i){
+		const PackedPortal& packed = portals[i];
+		if(size_t(packed.firstVertex) + packed.vertexCount > portalPolygons.size()){
+			return false;
+		}
+		Portal& portal = _portals.emplace_back();
+		portal.polygon.assign(portalPolygons.begin() + packed.firstVertex, portalPolygons.begin() + packed.firstVertex + packed.vertexCount);
+		portal.normal = packed.normal;
+		portal.center = packed.center;
+		portal.name = names[i];
+		portal.zones[0] = packed.zones[0];
+		portal.zones[1] = packed.zones[1];
+	}
+
+	std::vector<PackedEmitter> emitters;
+	if(!pack.read(ScenePack::WORLD_EMITTERS, emitters) || !pack.readNames(ScenePack::WORLD_EMITTER_NAMES, ScenePack::WORLD_EMITTER_NAME_PARTS, entityNames) || entityNames.size() != emitters.size()){
+		return false;
+	}
+	for(size_t i = 0; i < emitters.size(); ++i){
+		const PackedEmitter& packed = emitters[i];
+		Emitter& emitter = _particles.emplace_back();
+		emitter.bbox = packed.bbox;
+		emitter.frame = packed.frame;
+		emitter.colorMin = packed.colorMin;
+		emitter.colorMax = packed.colorMax;
+		emitter.sizeRange = packed.sizeRange;
+		emitter.velocityRange = packed.velocityRange;
+		emitter.angleRange = packed.angleRange;
+		emitter.name = entityNames[i];
+		emitter.maxCount = packed.maxCount;
+		emitter.material = packed.material;
+		emitter.type = packed.type;
+		emitter.radius = packed.radius;
+		emitter.rate = packed.rate;
+		emitter.alignment = Alignment(packed.alignment);
+		emitter.blending = Blending(packed.blending);
+	}
+
+	std::vector<PackedBillboard> billboards;
+	if(!pack.read(ScenePack::WORLD_BILLBOARDS, billboards) || !pack.readNames(ScenePack::WORLD_BILLBOARD_NAMES, ScenePack::WORLD_BILLBOARD_NAME_PARTS, entityNames) || entityNames.size() != billboards.size()){
+		return false;
+	}
+	for(size_t i = 0; i < billboards.size(); ++i){
+		const PackedBillboard& packed = billboards[i];
+		Billboard& billboard = _billboards.emplace_back();
+		billboard.frame = packed.frame;
+		billboard.color = packed.color;
+		billboard.size = packed.size;
+		billboard.name = entityNames[i];
+		billboard.material = packed.material;
+		billboard.alignment = Alignment(packed.alignment);
+		billboard.blending = Blending(packed.blending);
+	}
+	return true;
+}
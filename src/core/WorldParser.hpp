@@ -4,6 +4,8 @@
 #include "core/Geometry.hpp"
 #include "core/Common.hpp"
 #include "core/Bounds.hpp"
+#include "core/ScenePack.hpp"
+#include "core/StringPool.hpp"
 #include <map>
 #include <unordered_map>
 
@@ -17,19 +19,19 @@ public:
 
 	struct Instance {
 		glm::mat4 frame;
-		std::string name;
+		Name name;
 		uint object;
 		float heat;
 
-		Instance(const std::string& _name, uint _object, const glm::mat4& _frame, float _heat = 0.f);
+		Instance(Name _name, uint _object, const glm::mat4& _frame, float _heat = 0.f);
 	};
 
 	struct Camera {
 		glm::mat4 frame;
-		std::string name;
+		Name name;
 		float fov;
 
-		Camera(const std::string& _name, const glm::mat4& _frame, float _fov);
+		Camera(Name _name, const glm::mat4& _frame, float _fov);
 	};
 
 	struct Light {
@@ -43,7 +45,7 @@ public:
 		glm::mat4 frame;
 		glm::vec3 color;
 		glm::vec3 radius;
-		std::string name;
+		Name name;
 		float angle;
 		uint material;
 		Type type;
@@ -60,6 +62,16 @@ public:
 		float fogDensity;
 	};
 
+	struct Portal {
+		static const uint NO_ZONE = 0xFFFF;
+
+		std::vector<glm::vec3> polygon;
+		glm::vec3 normal;
+		glm::vec3 center;
+		std::string name;
+		uint zones[2];
+	};
+
 	enum Alignment {
 		ALIGN_WORLD = 0, ALIGN_AROUND_X = 1, ALIGN_SCREEN = 2, ALIGN_AROUND_Y = 3, ALIGN_COUNT
 	};
@@ -76,7 +88,7 @@ public:
 		glm::vec2 sizeRange;
 		glm::vec2 velocityRange;
 		glm::vec2 angleRange;
-		std::string name;
+		Name name;
 		uint maxCount;
 		uint material;
 		uint type;
@@ -90,7 +102,7 @@ public:
 		glm::mat4 frame;
 		glm::vec3 color;
 		glm::vec2 size;
-		std::string name;
+		Name name;
 		uint material;
 		Alignment alignment;
 		Blending blending;
@@ -98,6 +110,22 @@ public:
 
 	bool load(const fs::path& path, const fs::path& resourcesPath);
 
+	/** Store the world content that is still needed after scene generation (all but objects, instances and materials).
+	 \param pack the pack to add sections to
+	 */
+	void save(ScenePack::Writer& pack) const;
+
+	/** Restore the world content stored in a pack, objects, instances and materials will be empty.
+	 \param pack the loaded pack
+	 \return true if all sections were found
+	 */
+	bool load(const ScenePack& pack);
+
+	/** Count the memory allocated by XML documents, and report it when loading worlds.
+	 This replaces the pugixml allocation functions for the whole process, and should be called before any world is loaded.
+	 */
+	static void trackXmlMemory();
+
 	const std::vector<Object>& objects() const {  return _objects; };
 
 	const std::vector<Instance>& instances() const {  return _instances; };
@@ -114,6 +142,8 @@ public:
 	
 	const std::vector<Zone>& zones() const {  return _zones; };
 
+	const std::vector<Portal>& portals() const {  return _portals; };
+
 	const std::string& name() const{ return _name; };
 
 private:
@@ -135,6 +165,7 @@ private:
 	std::vector<Emitter> _particles;
 	std::vector<Billboard> _billboards;
 	std::vector<Zone> _zones;
+	std::vector<Portal> _portals;
 	std::string _name;
 
 };
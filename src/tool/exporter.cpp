@@ -3,6 +3,9 @@
 #include "core/TextUtilities.hpp"
 #include "core/Image.hpp"
 #include "core/WorldParser.hpp"
+#include "core/Profiler.hpp"
+#include "core/ScenePack.hpp"
+#include "core/StringPool.hpp"
 
 
 #include <fstream>
@@ -19,6 +22,9 @@ int main(int argc, const char** argv)
 	const fs::path inputPath(argv[1]);
 	const bool dryRun = argc == 2;
 	const fs::path outputPath = dryRun ? "" : fs::path(argv[2]);
+#ifdef PROFILER_ENABLED
+	Profiler::startCapture();
+#endif
 
 	const fs::path modelsPath = inputPath / "models";
 	const fs::path texturesPath = inputPath / "textures";
@@ -46,6 +52,9 @@ int main(int argc, const char** argv)
 
 	if(dryRun){
 		Log::info("Dry run:");
+		// Scene packs are generated by the viewer, report their state for the default options.
+		const ScenePack::SceneOptions packOptions;
+		const uint64_t resourcesHash = ScenePack::hashDirectory(inputPath);
 		for(const auto& worldPath : worldsList){
 			Log::info("Processing world %s", worldPath.filename().string().c_str());
 
@@ -60,8 +69,17 @@ int main(int argc, const char** argv)
 			Log::info("\t* %lu cameras", world.cameras().size());
 			Log::info("\t* %lu lights", world.lights().size());
 			Log::info("\t* %lu zones", world.zones().size());
+			Log::info("\t* %lu portals", world.portals().size());
+			const fs::path packPath = ScenePack::path(inputPath, worldPath);
+			const bool packValid = ScenePack::isValid(packPath, ScenePack::sceneKey(worldPath, resourcesHash, packOptions));
+			Log::info("\t* scene pack %s", packValid ? "up to date" : (fs::exists(packPath) ? "outdated" : "missing"));
 
 		}
+		const StringPool::Statistics names = StringPool::statistics();
+		Log::info("Name pool: %lu strings, %lu composed names, %.1fKB", names.strings, names.composed, double(names.bytes) / 1024.0);
+#ifdef PROFILER_ENABLED
+		Profiler::stopCapture("eXporter112_trace.json");
+#endif
 		return 0;
 	}
 
@@ -171,6 +189,9 @@ int main(int argc, const char** argv)
 	// texturesPath+modelPath many formats(dds,...)
 	// zonesPath .rf3
 
+#ifdef PROFILER_ENABLED
+	Profiler::stopCapture("eXporter112_trace.json");
+#endif
 	return 0;
 
 }